@@ -37,6 +37,7 @@ DECLARE_bool(keep_isymbols);
 DECLARE_bool(keep_osymbols);
 DECLARE_bool(keep_state_numbering);
 DECLARE_bool(allow_negative_labels);
+DECLARE_int32(threads);
 
 int fstcompile_main(int argc, char **argv) {
   namespace s = fst::script;
@@ -94,7 +95,7 @@ int fstcompile_main(int argc, char **argv) {
       osyms.get(), ssyms.get(), FLAGS_acceptor,
       FLAGS_keep_isymbols, FLAGS_keep_osymbols,
       FLAGS_keep_state_numbering,
-      FLAGS_allow_negative_labels);
+      FLAGS_allow_negative_labels, FLAGS_threads, fstrm.is_open());
 
   return 0;
 }
@@ -28,6 +28,8 @@ DEFINE_bool(keep_osymbols, false, "Store output label symbol table with FST");
 DEFINE_bool(keep_state_numbering, false, "Do not renumber input states");
 DEFINE_bool(allow_negative_labels, false,
             "Allow negative labels (not recommended; may cause conflicts)");
+DEFINE_int32(threads, 1, "Number of threads; if greater than one, "
+             "lines are parsed in parallel");
 
 int fstcompile_main(int argc, char **argv);
 
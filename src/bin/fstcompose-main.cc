@@ -28,6 +28,7 @@
 
 DECLARE_string(compose_filter);
 DECLARE_bool(connect);
+DECLARE_int32(threads);
 
 int fstcompose_main(int argc, char **argv) {
   namespace s = fst::script;
@@ -78,7 +79,7 @@ int fstcompose_main(int argc, char **argv) {
     return 1;
   }
 
-  const ComposeOptions opts(FLAGS_connect, compose_filter);
+  const ComposeOptions opts(FLAGS_connect, compose_filter, FLAGS_threads);
 
   s::Compose(*ifst1, *ifst2, &ofst, opts);
 
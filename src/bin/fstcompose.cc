@@ -21,6 +21,8 @@ DEFINE_string(compose_filter, "auto",
               "Composition filter: one of \"alt_sequence\", \"auto\", "
               "\"match\", \"no_match\", \"null\", \"sequence\", \"trivial\"");
 DEFINE_bool(connect, true, "Trim output");
+DEFINE_int32(threads, 1, "Number of threads; if greater than one, "
+             "states are expanded in parallel");
 
 int fstcompose_main(int argc, char **argv);
 
@@ -31,6 +31,7 @@ DECLARE_int64(nstate);
 DECLARE_int64(subsequential_label);
 DECLARE_string(det_type);
 DECLARE_bool(increment_subsequential_label);
+DECLARE_int32(threads);
 
 int fstdeterminize_main(int argc, char **argv) {
   namespace s = fst::script;
@@ -75,7 +76,7 @@ int fstdeterminize_main(int argc, char **argv) {
   const s::DeterminizeOptions opts(
       FLAGS_delta, weight_threshold, FLAGS_nstate,
       FLAGS_subsequential_label, det_type,
-      FLAGS_increment_subsequential_label);
+      FLAGS_increment_subsequential_label, FLAGS_threads);
 
   s::Determinize(*ifst, &ofst, opts);
 
@@ -31,6 +31,8 @@ DEFINE_string(det_type, "functional",
 DEFINE_bool(increment_subsequential_label, false,
             "Increment subsequential_label to obtain distinct labels for "
             " subsequential arcs at a given state");
+DEFINE_int32(threads, 1, "Number of threads; if greater than one, "
+             "subsets are constructed in parallel");
 
 int fstdeterminize_main(int argc, char **argv);
 
@@ -27,6 +27,7 @@
 
 DECLARE_double(delta);
 DECLARE_bool(allow_nondet);
+DECLARE_int32(threads);
 
 int fstminimize_main(int argc, char **argv) {
   namespace s = fst::script;
@@ -62,11 +63,11 @@ int fstminimize_main(int argc, char **argv) {
   if (argc > 3) {
     std::unique_ptr<MutableFstClass> fst2(new VectorFstClass(fst1->ArcType()));
     s::Minimize(fst1.get(), fst2.get(), FLAGS_delta,
-                FLAGS_allow_nondet);
+                FLAGS_allow_nondet, FLAGS_threads);
     if (!fst2->Write(out2_name)) return 1;
   } else {
     s::Minimize(fst1.get(), nullptr, FLAGS_delta,
-                FLAGS_allow_nondet);
+                FLAGS_allow_nondet, FLAGS_threads);
   }
 
   return !fst1->Write(out1_name);
@@ -21,6 +21,8 @@
 
 DEFINE_double(delta, fst::kShortestDelta, "Comparison/quantization delta");
 DEFINE_bool(allow_nondet, false, "Minimize non-deterministic FSTs");
+DEFINE_int32(threads, 1, "Number of threads; if greater than one, "
+             "deterministic FSTs are minimized in parallel");
 
 int fstminimize_main(int argc, char **argv);
 
@@ -37,6 +37,7 @@ DECLARE_string(save_osymbols);
 DECLARE_bool(show_weight_one);
 DECLARE_bool(allow_negative_labels);
 DECLARE_string(missing_symbol);
+DECLARE_int32(threads);
 
 int fstprint_main(int argc, char **argv) {
   namespace s = fst::script;
@@ -106,8 +107,8 @@ int fstprint_main(int argc, char **argv) {
   }
 
   s::Print(*fst, ostrm, dest, isyms.get(), osyms.get(), ssyms.get(),
-           FLAGS_acceptor, FLAGS_show_weight_one,
-           FLAGS_missing_symbol);
+           FLAGS_acceptor, FLAGS_show_weight_one, FLAGS_missing_symbol,
+           FLAGS_threads);
 
   if (isyms && !FLAGS_save_isymbols.empty()) {
     if (!isyms->WriteText(FLAGS_save_isymbols)) return 1;
@@ -30,6 +30,8 @@ DEFINE_bool(allow_negative_labels, false,
             "Allow negative labels (not recommended; may cause conflicts)?");
 DEFINE_string(missing_symbol, "",
               "Symbol to print when lookup fails (default raises error)");
+DEFINE_int32(threads, 1, "Number of threads; if greater than one, "
+             "states are formatted in parallel");
 
 int fstprint_main(int argc, char **argv);
 
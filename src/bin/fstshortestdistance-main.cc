@@ -32,6 +32,7 @@ DECLARE_bool(reverse);
 DECLARE_double(delta);
 DECLARE_int64(nstate);
 DECLARE_string(queue_type);
+DECLARE_int32(threads);
 
 int fstshortestdistance_main(int argc, char **argv) {
   namespace s = fst::script;
@@ -74,12 +75,12 @@ int fstshortestdistance_main(int argc, char **argv) {
   }
 
   if (FLAGS_reverse) {
-    s::ShortestDistance(*ifst, &distance, FLAGS_reverse,
-                        FLAGS_delta);
+    s::ShortestDistance(*ifst, &distance, FLAGS_reverse, FLAGS_delta,
+                        FLAGS_threads);
   } else {
     const s::ShortestDistanceOptions opts(queue_type, s::ArcFilterType::ANY,
-                                          FLAGS_nstate,
-                                          FLAGS_delta);
+                                          FLAGS_nstate, FLAGS_delta,
+                                          FLAGS_threads);
     s::ShortestDistance(*ifst, &distance, opts);
   }
 
@@ -26,6 +26,8 @@ DEFINE_int64(nstate, fst::kNoStateId, "State number threshold");
 DEFINE_string(queue_type, "auto",
               "Queue type: one of \"auto\", "
               "\"fifo\", \"lifo\", \"shortest\", \"state\", \"top\"");
+DEFINE_int32(threads, 1, "Number of threads; if greater than one, "
+             "independent SCCs are processed in parallel");
 
 int fstshortestdistance_main(int argc, char **argv);
 
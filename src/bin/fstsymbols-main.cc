@@ -39,9 +39,11 @@ DECLARE_string(save_isymbols);
 DECLARE_string(save_osymbols);
 DECLARE_bool(allow_negative_labels);
 DECLARE_bool(verify);
+DECLARE_bool(pack_symbols);
 
 int fstsymbols_main(int argc, char **argv) {
   namespace s = fst::script;
+  using fst::PackedSymbolTable;
   using fst::ReadLabelPairs;
   using fst::SymbolTable;
   using fst::SymbolTableTextOptions;
@@ -123,6 +125,17 @@ int fstsymbols_main(int argc, char **argv) {
     fst->SetOutputSymbols(osyms_relabel.get());
   }
 
+  if (FLAGS_pack_symbols) {
+    if (fst->InputSymbols()) {
+      const PackedSymbolTable isyms_packed(*fst->InputSymbols());
+      fst->SetInputSymbols(&isyms_packed);
+    }
+    if (fst->OutputSymbols()) {
+      const PackedSymbolTable osyms_packed(*fst->OutputSymbols());
+      fst->SetOutputSymbols(&osyms_packed);
+    }
+  }
+
   if (FLAGS_verify && !s::Verify(*fst)) return 1;
 
   return !fst->Write(out_name);
@@ -28,6 +28,8 @@ DEFINE_string(save_osymbols, "", "Save fst file's output symbol table to file");
 DEFINE_bool(allow_negative_labels, false,
             "Allow negative labels (not recommended; may cause conflicts)");
 DEFINE_bool(verify, false, "Verify fst properities before saving");
+DEFINE_bool(pack_symbols, false,
+            "Store the symbol tables in the packed, memory-mappable format");
 
 int fstsymbols_main(int argc, char **argv);
 
@@ -39,6 +39,7 @@ DECLARE_string(unknown_symbol);
 DECLARE_bool(file_list_input);
 DECLARE_bool(keep_symbols);
 DECLARE_bool(initial_symbols);
+DECLARE_int32(threads);
 
 int farcompilestrings_main(int argc, char **argv) {
   namespace s = fst::script;
@@ -101,7 +102,7 @@ int farcompilestrings_main(int argc, char **argv) {
                        far_type, FLAGS_generate_keys, entry_type, token_type,
                        FLAGS_symbols, FLAGS_unknown_symbol, FLAGS_keep_symbols,
                        FLAGS_initial_symbols, FLAGS_allow_negative_labels,
-                       FLAGS_key_prefix, FLAGS_key_suffix);
+                       FLAGS_key_prefix, FLAGS_key_suffix, FLAGS_threads);
 
   return 0;
 }
@@ -40,6 +40,8 @@ DEFINE_bool(keep_symbols, false, "Store symbol table in the FAR file");
 DEFINE_bool(initial_symbols, true,
             "When keep_symbols is true, stores symbol table only for the first"
             " FST in archive.");
+DEFINE_int32(threads, 1, "Number of threads; if greater than one, "
+             "strings are compiled in parallel");
 
 int farcompilestrings_main(int argc, char **argv);
 
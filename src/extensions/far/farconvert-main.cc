@@ -27,6 +27,9 @@
 
 DECLARE_string(far_type);
 DECLARE_string(fst_type);
+DECLARE_int32(threads);
+DECLARE_int32(shards);
+DECLARE_int64(max_shard_size);
 
 int farconvert_main(int argc, char *argv[]) {
   namespace s = fst::script;
@@ -58,6 +61,11 @@ int farconvert_main(int argc, char *argv[]) {
     return 1;
   }
 
+  if (FLAGS_shards > 0 && FLAGS_max_shard_size > 0) {
+    LOG(ERROR) << "Only one of --shards and --max_shard_size can be set";
+    return 1;
+  }
+
   // We use a different meaning of far_type. DEFAULT means "same as input",
   // so snoop the input far_type.
   if (far_type == fst::FarType::DEFAULT) {
@@ -83,7 +91,8 @@ int farconvert_main(int argc, char *argv[]) {
   }
 
   // Empty fst_type means use input fst type for each fst individually.
-  s::FarConvert(in_far, out_far, arc_type, FLAGS_fst_type, far_type);
+  s::FarConvert(in_far, out_far, arc_type, FLAGS_fst_type, far_type,
+                FLAGS_threads, FLAGS_shards, FLAGS_max_shard_size);
 
   return 0;
 }
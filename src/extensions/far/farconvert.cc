@@ -21,6 +21,14 @@ DEFINE_string(far_type, "default",
               "FAR file format type: one of: \"default\", \"fst\", "
               "\"stlist\", \"sttable\". "
               "\"default\" means use type of input FAR.");
+DEFINE_int32(threads, 1, "Number of threads; if greater than one, "
+             "FSTs are converted in parallel");
+DEFINE_int32(shards, 0,
+             "If positive, writes an STTable archive as this many shards, "
+             "split by key hash, and a manifest");
+DEFINE_int64(max_shard_size, 0,
+             "If positive, writes an STTable archive as shards of about this "
+             "many bytes, split by key range, and a manifest");
 
 int farconvert_main(int argc, char **argv);
 
@@ -26,6 +26,7 @@
 DECLARE_string(begin_key);
 DECLARE_string(end_key);
 DECLARE_double(delta);
+DECLARE_int32(threads);
 
 int farisomorphic_main(int argc, char **argv) {
   namespace s = fst::script;
@@ -49,7 +50,8 @@ int farisomorphic_main(int argc, char **argv) {
   if (arc_type.empty()) return 1;
 
   bool result = s::FarIsomorphic(argv[1], argv[2], arc_type, FLAGS_delta,
-                                 FLAGS_begin_key, FLAGS_end_key);
+                                 FLAGS_begin_key, FLAGS_end_key,
+                                 FLAGS_threads);
 
   if (!result) VLOG(1) << "FARs are not isomorphic.";
 
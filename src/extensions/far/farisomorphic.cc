@@ -19,6 +19,8 @@ DEFINE_string(begin_key, "",
               "First key to extract (def: first key in archive)");
 DEFINE_string(end_key, "", "Last key to extract (def: last key in archive)");
 DEFINE_double(delta, fst::kDelta, "Comparison/quantization delta");
+DEFINE_int32(threads, 1, "Number of threads; if greater than one, "
+             "FSTs are compared in parallel");
 
 int farisomorphic_main(int argc, char **argv);
 
@@ -35,6 +35,7 @@ DECLARE_string(entry_type);
 DECLARE_string(token_type);
 DECLARE_string(symbols);
 DECLARE_bool(initial_symbols);
+DECLARE_int32(threads);
 
 int farprintstrings_main(int argc, char **argv) {
   namespace s = fst::script;
@@ -71,7 +72,7 @@ int farprintstrings_main(int argc, char **argv) {
                      FLAGS_begin_key, FLAGS_end_key, FLAGS_print_key,
                      FLAGS_print_weight, FLAGS_symbols, FLAGS_initial_symbols,
                      FLAGS_generate_filenames, FLAGS_filename_prefix,
-                     FLAGS_filename_suffix);
+                     FLAGS_filename_suffix, FLAGS_threads);
 
   return 0;
 }
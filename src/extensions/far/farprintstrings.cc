@@ -33,6 +33,8 @@ DEFINE_string(token_type, "symbol",
 DEFINE_string(symbols, "", "Label symbol table");
 DEFINE_bool(initial_symbols, true,
             "Uses symbol table from the first Fst in archive for all entries.");
+DEFINE_int32(threads, 1, "Number of threads; if greater than one, "
+             "strings are computed in parallel");
 
 int farprintstrings_main(int argc, char **argv);
 
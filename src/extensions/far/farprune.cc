@@ -0,0 +1,30 @@
+// Copyright 2005-2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the 'License');
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an 'AS IS' BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+#include <fst/flags.h>
+#include <fst/fst.h>
+#include <fst/weight.h>
+
+DEFINE_double(delta, fst::kDelta, "Comparison/quantization delta");
+DEFINE_int64(nstate, fst::kNoStateId, "State number threshold");
+DEFINE_string(weight, "", "Weight threshold");
+DEFINE_string(far_type, "default",
+              "FAR file format type: one of: \"default\", \"fst\", "
+              "\"stlist\", \"sttable\". "
+              "\"default\" means use type of input FAR.");
+DEFINE_int32(threads, 1, "Number of threads");
+
+int farprune_main(int argc, char **argv);
+
+int main(int argc, char **argv) { return farprune_main(argc, argv); }
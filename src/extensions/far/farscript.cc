@@ -40,11 +40,12 @@ void FarCompileStrings(const std::vector<std::string> &in_sources,
                        const std::string &unknown_symbol, bool keep_symbols,
                        bool initial_symbols, bool allow_negative_labels,
                        const std::string &key_prefix,
-                       const std::string &key_suffix) {
+                       const std::string &key_suffix, int num_threads) {
   FarCompileStringsArgs args{in_sources, out_source, fst_type, far_type,
                              generate_keys, fet, tt, symbols_source,
                              unknown_symbol, keep_symbols, initial_symbols,
-                             allow_negative_labels, key_prefix, key_suffix};
+                             allow_negative_labels, key_prefix, key_suffix,
+                             num_threads};
   Apply<Operation<FarCompileStringsArgs>>("FarCompileStrings", arc_type, &args);
 }
 
@@ -52,8 +53,10 @@ REGISTER_FST_OPERATION_4ARCS(FarCompileStrings, FarCompileStringsArgs);
 
 void FarConvert(const std::string &in_source, const std::string &out_source,
                 const std::string &arc_type, const std::string &fst_type,
-                const FarType &far_type) {
-  FarConvertArgs args{in_source, out_source, fst_type, far_type};
+                const FarType &far_type, int num_threads, int32 num_shards,
+                int64 max_shard_size) {
+  FarConvertArgs args{in_source, out_source, fst_type, far_type,
+                      num_threads, num_shards, max_shard_size};
   Apply<Operation<FarConvertArgs>>("FarConvert", arc_type, &args);
 }
 
@@ -72,8 +75,10 @@ REGISTER_FST_OPERATION_4ARCS(FarCreate, FarCreateArgs);
 
 bool FarEqual(const std::string &source1, const std::string &source2,
               const std::string &arc_type, float delta,
-              const std::string &begin_key, const std::string &end_key) {
-  FarEqualInnerArgs args{source1, source2, delta, begin_key, end_key};
+              const std::string &begin_key, const std::string &end_key,
+              int num_threads) {
+  FarEqualInnerArgs args{source1, source2, delta, begin_key, end_key,
+                         num_threads};
   FarEqualArgs args_with_retval(args);
   Apply<Operation<FarEqualArgs>>("FarEqual", arc_type, &args_with_retval);
   return args_with_retval.retval;
@@ -114,8 +119,10 @@ REGISTER_FST_OPERATION_4ARCS(GetFarInfo, GetFarInfoArgs);
 
 bool FarIsomorphic(const std::string &source1, const std::string &source2,
                    const std::string &arc_type, float delta,
-                   const std::string &begin_key, const std::string &end_key) {
-  FarIsomorphicInnerArgs args{source1, source2, delta, begin_key, end_key};
+                   const std::string &begin_key, const std::string &end_key,
+                   int num_threads) {
+  FarIsomorphicInnerArgs args{source1, source2, delta, begin_key, end_key,
+                              num_threads};
   FarIsomorphicArgs args_with_retval(args);
   Apply<Operation<FarIsomorphicArgs>>("FarIsomorphic", arc_type,
                                       &args_with_retval);
@@ -131,15 +138,29 @@ void FarPrintStrings(const std::vector<std::string> &isources,
                      bool print_weight, const std::string &symbols_source,
                      bool initial_symbols, const int32 generate_sources,
                      const std::string &source_prefix,
-                     const std::string &source_suffix) {
+                     const std::string &source_suffix, int num_threads) {
   FarPrintStringsArgs args{isources, entry_type, token_type, begin_key, end_key,
                            print_key, print_weight, symbols_source,
                            initial_symbols, generate_sources, source_prefix,
-                           source_suffix};
+                           source_suffix, num_threads};
   Apply<Operation<FarPrintStringsArgs>>("FarPrintStrings", arc_type, &args);
 }
 
 REGISTER_FST_OPERATION_4ARCS(FarPrintStrings, FarPrintStringsArgs);
 
+bool FarPrune(const std::string &in_source, const std::string &out_source,
+              const std::string &arc_type, const std::string &weight_threshold,
+              int64 state_threshold, float delta, const FarType &far_type,
+              int num_threads) {
+  FarPruneInnerArgs args{in_source, out_source, weight_threshold,
+                         state_threshold, delta, far_type, num_threads};
+  FarPruneArgs args_with_retval(args);
+  args_with_retval.retval = false;
+  Apply<Operation<FarPruneArgs>>("FarPrune", arc_type, &args_with_retval);
+  return args_with_retval.retval;
+}
+
+REGISTER_FST_OPERATION_4ARCS(FarPrune, FarPruneArgs);
+
 }  // namespace script
 }  // namespace fst
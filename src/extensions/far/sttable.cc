@@ -17,10 +17,155 @@
 
 #include <fst/extensions/far/sttable.h>
 
+#include <algorithm>
 #include <fstream>
+#include <iomanip>
+#include <memory>
+#include <sstream>
 
 namespace fst {
 
+bool STTableIndex::Read(std::istream &strm, const std::string &source,
+                        int32 version) {
+  int64 size = -1;
+  strm.seekg(-static_cast<int>(sizeof(int64)), std::ios_base::end);
+  ReadType(strm, &size);  // Reads number of entries.
+  if (strm.fail() || size < 0) return false;
+  size_ = size;
+  if (version == 1) {
+    if (size > 0) {
+      strm.seekg(-static_cast<int>(sizeof(int64)) * (size + 1),
+                 std::ios_base::end);
+      v1_positions_.resize(size);
+      for (int64 i = 0; i < size && !strm.fail(); ++i) {
+        ReadType(strm, &v1_positions_[i]);
+      }
+      positions_ = v1_positions_.data();
+    }
+    return !strm.fail();
+  }
+  strm.seekg(-3 * static_cast<int>(sizeof(int64)), std::ios_base::end);
+  const int64 footer_pos = strm.tellg();
+  int64 index_pos = -1;
+  ReadType(strm, &index_pos);
+  int64 nbuckets = -1;
+  ReadType(strm, &nbuckets);
+  if (strm.fail() || index_pos < 0 || index_pos > footer_pos || nbuckets < 0 ||
+      (nbuckets & (nbuckets - 1)) != 0 || nbuckets < 2 * size) {
+    return false;
+  }
+  const size_t region_size = footer_pos - index_pos;
+  const size_t arrays_size = (2 * size + 1) * sizeof(int64) +
+                             nbuckets * sizeof(uint32);
+  if (region_size < arrays_size) return false;
+  strm.seekg(index_pos);
+  region_.reset(MappedFile::Map(&strm, /*memorymap=*/true, source,
+                                region_size));
+  if (strm.fail() || !region_) return false;
+  const auto *positions = static_cast<const int64 *>(region_->data());
+  const auto *key_offsets = positions + size;
+  const auto *buckets =
+      reinterpret_cast<const uint32 *>(key_offsets + size + 1);
+  // The key offsets must be nondecreasing and within the key blob, and the
+  // buckets must refer to entries and leave some empty to end the probes.
+  const int64 keys_size = region_size - arrays_size;
+  if (key_offsets[0] != 0 || key_offsets[size] > keys_size) return false;
+  for (int64 i = 0; i < size; ++i) {
+    if (key_offsets[i] > key_offsets[i + 1]) return false;
+  }
+  int64 nfull = 0;
+  for (int64 b = 0; b < nbuckets; ++b) {
+    if (buckets[b] > size) return false;
+    if (buckets[b] != 0) ++nfull;
+  }
+  if (nbuckets > 0 && nfull == nbuckets) return false;
+  positions_ = positions;
+  key_offsets_ = key_offsets;
+  buckets_ = buckets;
+  keys_ = reinterpret_cast<const char *>(buckets_ + nbuckets);
+  nbuckets_ = nbuckets;
+  return true;
+}
+
+bool STTableIndex::Write(std::ostream &strm,
+                         const std::vector<int64> &positions,
+                         const std::string &key_blob,
+                         const std::vector<int64> &key_offsets) {
+  const int64 size = positions.size();
+  int64 nbuckets = size > 0 ? 2 : 0;
+  while (nbuckets < 2 * size) nbuckets *= 2;
+  std::vector<uint32> buckets(nbuckets, 0);
+  std::string_view last_key;
+  for (int64 i = 0; i < size; ++i) {
+    const std::string_view key(key_blob.data() + key_offsets[i],
+                               key_offsets[i + 1] - key_offsets[i]);
+    // Only the first of several entries with the same key is hashed.
+    if (i > 0 && key == last_key) continue;
+    last_key = key;
+    auto b = Hash(key) & (nbuckets - 1);
+    while (buckets[b] != 0) b = (b + 1) & (nbuckets - 1);
+    buckets[b] = i + 1;
+  }
+  if (!AlignOutput(strm)) return false;
+  const int64 index_pos = strm.tellp();
+  strm.write(reinterpret_cast<const char *>(positions.data()),
+             size * sizeof(int64));
+  strm.write(reinterpret_cast<const char *>(key_offsets.data()),
+             (size + 1) * sizeof(int64));
+  strm.write(reinterpret_cast<const char *>(buckets.data()),
+             nbuckets * sizeof(uint32));
+  strm.write(key_blob.data(), key_blob.size());
+  for (auto i = key_blob.size(); i % sizeof(int64) != 0; ++i) strm.write("", 1);
+  WriteType(strm, index_pos);
+  WriteType(strm, nbuckets);
+  WriteType(strm, size);
+  strm.flush();
+  return !strm.fail();
+}
+
+size_t STTableIndex::LowerBound(std::string_view key) const {
+  if (nbuckets_ > 0) {
+    for (auto b = Hash(key) & (nbuckets_ - 1); buckets_[b] != 0;
+         b = (b + 1) & (nbuckets_ - 1)) {
+      if (Key(buckets_[b] - 1) == key) return buckets_[b] - 1;
+    }
+  }
+  size_t low = 0;
+  size_t high = size_;
+  while (low < high) {
+    const auto mid = (low + high) / 2;
+    if (Key(mid) < key) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  return low;
+}
+
+uint64 STTableIndex::Hash(std::string_view key) {
+  uint64 hash = 14695981039346656037ULL;
+  for (const char c : key) {
+    hash ^= static_cast<unsigned char>(c);
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+std::istream *OpenSTTableStream(const std::string &source, bool memorymap) {
+  auto strm = std::make_unique<std::ifstream>(
+      source, std::ios_base::in | std::ios_base::binary);
+  if (!memorymap || strm->fail()) return strm.release();
+  strm->seekg(0, std::ios_base::end);
+  const auto size = strm->tellg();
+  strm->seekg(0);
+  if (strm->fail() || size < 0) return strm.release();
+  std::shared_ptr<const MappedFile> file(
+      MappedFile::Map(strm.get(), /*memorymap=*/true, source, size));
+  if (!file) return nullptr;
+  return new MappedFileInputStream(std::move(file), size);
+}
+
 bool IsSTTable(const std::string &source) {
   std::ifstream strm(source);
   if (!strm.good()) return false;
@@ -30,4 +175,117 @@ bool IsSTTable(const std::string &source) {
   return magic_number == kSTTableMagicNumber;
 }
 
+namespace {
+
+// Returns the directory part of source, including the final separator.
+std::string Dirname(const std::string &source) {
+  const auto pos = source.rfind('/');
+  return pos == std::string::npos ? std::string() : source.substr(0, pos + 1);
+}
+
+}  // namespace
+
+bool STTableShards::Read(const std::string &source) {
+  std::ifstream strm(source, std::ios_base::in | std::ios_base::binary);
+  if (!strm) {
+    LOG(ERROR) << "STTableShards::Read: Could not open file: " << source;
+    return false;
+  }
+  int32 magic_number = 0;
+  ReadType(strm, &magic_number);
+  int32 file_version = 0;
+  ReadType(strm, &file_version);
+  if (magic_number != kSTTableShardsMagicNumber) {
+    LOG(ERROR) << "STTableShards::Read: Wrong file type: " << source;
+    return false;
+  }
+  if (file_version != kSTTableShardsFileVersion) {
+    LOG(ERROR) << "STTableShards::Read: Wrong file version: " << source;
+    return false;
+  }
+  int32 type = 0;
+  ReadType(strm, &type);
+  if (type != static_cast<int32>(STTableShardType::HASH) &&
+      type != static_cast<int32>(STTableShardType::RANGE)) {
+    LOG(ERROR) << "STTableShards::Read: Unknown shard type: " << source;
+    return false;
+  }
+  type_ = static_cast<STTableShardType>(type);
+  int64 size = 0;
+  ReadType(strm, &size);
+  if (strm.fail() || size <= 0) {
+    LOG(ERROR) << "STTableShards::Read: Error reading file: " << source;
+    return false;
+  }
+  const auto dir = Dirname(source);
+  sources_.resize(size);
+  first_keys_.resize(size);
+  for (int64 i = 0; i < size && strm; ++i) {
+    ReadType(strm, &sources_[i]);
+    ReadType(strm, &first_keys_[i]);
+    if (sources_[i].empty() || sources_[i][0] != '/') {
+      sources_[i] = dir + sources_[i];
+    }
+  }
+  if (strm.fail()) {
+    LOG(ERROR) << "STTableShards::Read: Error reading file: " << source;
+    return false;
+  }
+  return true;
+}
+
+bool STTableShards::Write(const std::string &source) const {
+  std::ofstream strm(source, std::ios_base::out | std::ios_base::binary);
+  WriteType(strm, kSTTableShardsMagicNumber);
+  WriteType(strm, kSTTableShardsFileVersion);
+  WriteType(strm, static_cast<int32>(type_));
+  WriteType(strm, static_cast<int64>(sources_.size()));
+  const auto dir = Dirname(source);
+  for (size_t i = 0; i < sources_.size(); ++i) {
+    const auto &shard_source = sources_[i];
+    if (!dir.empty() && shard_source.compare(0, dir.size(), dir) == 0) {
+      WriteType(strm, shard_source.substr(dir.size()));
+    } else {
+      WriteType(strm, shard_source);
+    }
+    WriteType(strm, first_keys_[i]);
+  }
+  strm.flush();
+  if (strm.fail()) {
+    LOG(ERROR) << "STTableShards::Write: Error writing file: " << source;
+    return false;
+  }
+  return true;
+}
+
+size_t STTableShards::Find(std::string_view key) const {
+  if (type_ == STTableShardType::HASH) {
+    // Uses the high bits, as the low ones select the buckets of each shard's
+    // key index.
+    return (STTableIndex::Hash(key) >> 32) % sources_.size();
+  }
+  const auto it =
+      std::upper_bound(first_keys_.begin() + 1, first_keys_.end(), key,
+                       [](std::string_view key, const std::string &first_key) {
+                         return key < first_key;
+                       });
+  return it - first_keys_.begin() - 1;
+}
+
+std::string STTableShards::ShardSource(const std::string &source, size_t i,
+                                       size_t n) {
+  std::ostringstream strm;
+  strm << source << "-" << std::setfill('0') << std::setw(5) << i;
+  if (n > 0) strm << "-of-" << std::setw(5) << n;
+  return strm.str();
+}
+
+bool IsSTTableShards(const std::string &source) {
+  std::ifstream strm(source);
+  if (!strm.good()) return false;
+  int32 magic_number = 0;
+  ReadType(strm, &magic_number);
+  return magic_number == kSTTableShardsMagicNumber;
+}
+
 }  // namespace fst
@@ -18,6 +18,8 @@
 #include <fst/extensions/ngram/bitmap-index.h>
 
 #include <algorithm>
+#include <cstdint>
+#include <cstring>
 #include <iterator>
 
 #include <fst/types.h>
@@ -252,23 +254,24 @@ void BitmapIndex::BuildIndex(const uint64* bits, size_t num_bits,
   DCHECK_LT(num_bits, uint64{1} << 32);
   bits_ = bits;
   num_bits_ = num_bits;
-  rank_index_.resize(rank_index_size());
+  rank_index_storage_.resize(rank_index_size());
 
-  select_0_index_.clear();
+  select_0_index_storage_.clear();
   if (enable_select_0_index) {
     // Reserve approximately enough for density = 1/2.
-    select_0_index_.reserve(num_bits / (2 * kBitsPerSelect0Block) + 1);
+    select_0_index_storage_.reserve(num_bits / (2 * kBitsPerSelect0Block) + 1);
   }
 
-  select_1_index_.clear();
+  select_1_index_storage_.clear();
   if (enable_select_1_index) {
-    select_1_index_.reserve(num_bits / (2 * kBitsPerSelect1Block) + 1);
+    select_1_index_storage_.reserve(num_bits / (2 * kBitsPerSelect1Block) + 1);
   }
 
   uint32 ones_count = 0;
   uint32 zeros_count = 0;  // Only updated if enable_select_0_index.
   for (uint32 word_index = 0; word_index < ArraySize(); ++word_index) {
-    auto& rank_index_entry = rank_index_[word_index / kUnitsPerRankIndexEntry];
+    auto& rank_index_entry =
+        rank_index_storage_[word_index / kUnitsPerRankIndexEntry];
     static_assert(kUnitsPerRankIndexEntry == 8);
     switch (word_index % kUnitsPerRankIndexEntry) {
       case 0:
@@ -326,7 +329,7 @@ void BitmapIndex::BuildIndex(const uint64* bits, size_t num_bits,
       const uint32 zeros_to_skip = -zeros_count % kBitsPerSelect0Block;
       if (word_zeros_count > zeros_to_skip) {
         const int nth = nth_bit(~word, zeros_to_skip);
-        select_0_index_.push_back(bit_offset + nth);
+        select_0_index_storage_.push_back(bit_offset + nth);
       }
 
       zeros_count += word_zeros_count;
@@ -336,7 +339,7 @@ void BitmapIndex::BuildIndex(const uint64* bits, size_t num_bits,
       const uint32 ones_to_skip = -ones_count % kBitsPerSelect1Block;
       if (word_ones_count > ones_to_skip) {
         const int nth = nth_bit(word, ones_to_skip);
-        select_1_index_.push_back(bit_offset + nth);
+        select_1_index_storage_.push_back(bit_offset + nth);
       }
     }
 
@@ -352,7 +355,8 @@ void BitmapIndex::BuildIndex(const uint64* bits, size_t num_bits,
   // this, mutants complains that it can be changed to if (true).
   // Therefore, we complicate the understanding of the code to please the
   // tools.
-  auto& rank_index_entry = rank_index_[(num_bits - 1) / kBitsPerRankIndexEntry];
+  auto& rank_index_entry =
+      rank_index_storage_[(num_bits - 1) / kBitsPerRankIndexEntry];
   switch (((num_bits - 1) / kStorageBitSize) % kUnitsPerRankIndexEntry) {
     case 0:
       rank_index_entry.set_relative_ones_count_1(
@@ -382,18 +386,102 @@ void BitmapIndex::BuildIndex(const uint64* bits, size_t num_bits,
   }
 
   // Add the extra entry with the total number of bits.
-  rank_index_.back().set_absolute_ones_count(ones_count);
+  rank_index_storage_.back().set_absolute_ones_count(ones_count);
 
   if (enable_select_0_index) {
     // Add extra entry with num_bits_.
-    select_0_index_.push_back(num_bits_);
-    select_0_index_.shrink_to_fit();
+    select_0_index_storage_.push_back(num_bits_);
+    select_0_index_storage_.shrink_to_fit();
   }
 
   if (enable_select_1_index) {
-    select_1_index_.push_back(num_bits_);
-    select_1_index_.shrink_to_fit();
+    select_1_index_storage_.push_back(num_bits_);
+    select_1_index_storage_.shrink_to_fit();
   }
+
+  rank_index_ = IndexArray<RankIndexEntry>(rank_index_storage_);
+  select_0_index_ = IndexArray<uint32>(select_0_index_storage_);
+  select_1_index_ = IndexArray<uint32>(select_1_index_storage_);
+}
+
+namespace {
+
+// The serialized index starts with the sizes of the rank, select 0 and
+// select 1 indices, followed by their entries, and is padded to a multiple of
+// this alignment.
+constexpr size_t kIndexAlignment = sizeof(uint64);
+constexpr size_t kIndexHeaderBytes = 3 * sizeof(uint64);
+
+size_t PadIndexBytes(size_t size) {
+  return (size + kIndexAlignment - 1) & ~(kIndexAlignment - 1);
+}
+
+}  // namespace
+
+size_t BitmapIndex::SerializedIndexBytes() const {
+  return PadIndexBytes(kIndexHeaderBytes + IndexBytes());
+}
+
+bool BitmapIndex::WriteIndex(std::ostream& strm) const {
+  const uint64 sizes[] = {rank_index_.size(), select_0_index_.size(),
+                          select_1_index_.size()};
+  strm.write(reinterpret_cast<const char*>(sizes), sizeof(sizes));
+  strm.write(reinterpret_cast<const char*>(rank_index_.data()),
+             rank_index_.size() * sizeof(rank_index_[0]));
+  strm.write(reinterpret_cast<const char*>(select_0_index_.data()),
+             select_0_index_.size() * sizeof(select_0_index_[0]));
+  strm.write(reinterpret_cast<const char*>(select_1_index_.data()),
+             select_1_index_.size() * sizeof(select_1_index_[0]));
+  for (size_t i = kIndexHeaderBytes + IndexBytes();
+       i < SerializedIndexBytes(); ++i) {
+    strm.put(0);
+  }
+  return !strm.fail();
+}
+
+size_t BitmapIndex::BorrowIndex(const uint64* bits, size_t num_bits,
+                                const char* index, size_t size) {
+  DCHECK_LT(num_bits, uint64{1} << 32);
+  DCHECK_EQ(reinterpret_cast<uintptr_t>(index) % kIndexAlignment, 0);
+  if (size < kIndexHeaderBytes) return 0;
+  uint64 sizes[3];
+  memcpy(sizes, index, sizeof(sizes));
+  const size_t rank_size =
+      (StorageSize(num_bits) + kUnitsPerRankIndexEntry - 1) /
+          kUnitsPerRankIndexEntry +
+      1;
+  // Each select index has at most one entry per bit, plus a final entry.
+  if (sizes[0] != rank_size || sizes[1] > num_bits + 1 ||
+      sizes[2] > num_bits + 1) {
+    return 0;
+  }
+  const size_t rank_bytes = sizes[0] * sizeof(RankIndexEntry);
+  const size_t select_0_bytes = sizes[1] * sizeof(uint32);
+  const size_t select_1_bytes = sizes[2] * sizeof(uint32);
+  const size_t total = PadIndexBytes(kIndexHeaderBytes + rank_bytes +
+                                     select_0_bytes + select_1_bytes);
+  if (total > size) return 0;
+  const char* data = index + kIndexHeaderBytes;
+  const auto* rank_index = reinterpret_cast<const RankIndexEntry*>(data);
+  const auto* select_0_index =
+      reinterpret_cast<const uint32*>(data + rank_bytes);
+  const auto* select_1_index =
+      reinterpret_cast<const uint32*>(data + rank_bytes + select_0_bytes);
+  // The extra entries hold the number of ones and the number of bits.
+  if (rank_index[sizes[0] - 1].absolute_ones_count() > num_bits ||
+      (sizes[1] > 0 && select_0_index[sizes[1] - 1] != num_bits) ||
+      (sizes[2] > 0 && select_1_index[sizes[2] - 1] != num_bits)) {
+    return 0;
+  }
+  bits_ = bits;
+  num_bits_ = num_bits;
+  rank_index_storage_.clear();
+  select_0_index_storage_.clear();
+  select_1_index_storage_.clear();
+  rank_index_ = IndexArray<RankIndexEntry>(rank_index, sizes[0]);
+  select_0_index_ = IndexArray<uint32>(select_0_index, sizes[1]);
+  select_1_index_ = IndexArray<uint32>(select_1_index, sizes[2]);
+  return total;
 }
 
 const BitmapIndex::RankIndexEntry& BitmapIndex::FindRankIndexEntry(
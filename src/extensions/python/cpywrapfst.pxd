@@ -17,9 +17,12 @@
 # finite-state transducer library.
 
 
+from libc.stddef cimport ptrdiff_t
+
 from libcpp cimport bool
 from libcpp.memory cimport unique_ptr
 from libcpp.string cimport string
+from libcpp.string_view cimport string_view
 from libcpp.vector cimport vector
 from libcpp.utility cimport pair
 
@@ -189,7 +192,7 @@ cdef extern from "<fst/fstlib.h>" namespace "fst" nogil:
       cppclass value_type:
 
         int64 Label()
-        string Symbol()
+        string_view Symbol()
 
       # When wrapped in a unique_ptr siter.Label() and siter.Symbol() are
       # ambiguous to Cython because there's no way to make the -> explicit.
@@ -230,7 +233,7 @@ cdef extern from "<fst/fstlib.h>" namespace "fst" nogil:
     SymbolTable *Copy()
 
     # Aliased for overload.
-    string FindSymbol "Find"(int64)
+    string_view FindSymbol "Find"(int64)
 
     # Aliased for overload.
     int64 FindIndex "Find"(const string &)
@@ -528,6 +531,32 @@ cdef extern from "<fst/script/fstscript.h>" namespace "fst::script" nogil:
 
   cdef void ArcSort(MutableFstClass *, ArcSortType)
 
+  cdef cppclass FstArrayColumn:
+
+    FstArrayColumn()
+
+    FstArrayColumn(const void *, ptrdiff_t, size_t)
+
+    const char *data
+    ptrdiff_t stride
+    size_t size
+
+  cdef cppclass FstArrays:
+
+    int64 start
+    size_t num_states
+    size_t num_arcs
+    FstArrayColumn finals
+    FstArrayColumn offsets
+    FstArrayColumn ilabels
+    FstArrayColumn olabels
+    FstArrayColumn weights
+    FstArrayColumn nextstates
+
+  cdef bool ArraysToFst(const FstArrays &, MutableFstClass *)
+
+  cdef void FstToArrays(const FstClass &, FstArrays *)
+
   cdef ClosureType GetClosureType(bool)
 
   cdef void Closure(MutableFstClass *, ClosureType)
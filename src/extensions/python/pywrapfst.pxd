@@ -255,6 +255,8 @@ cdef class Fst:
 
   cpdef _ArcIterator arcs(self, int64 state)
 
+  cpdef arrays(self)
+
   cpdef Fst copy(self)
 
   cpdef void draw(self,
@@ -483,6 +485,44 @@ cdef class _StateIterator:
   cpdef int64 value(self)
 
 
+# Array views.
+
+
+cdef class _FstArrays:
+
+  cdef shared_ptr[fst.FstClass] _fst
+  cdef unique_ptr[fst.FstArrays] _arrays
+
+
+cdef class _ArrayColumn:
+
+  cdef _FstArrays _owner
+  cdef const char *_data
+  cdef const char *_format
+  cdef Py_ssize_t _itemsize
+  cdef Py_ssize_t _shape[1]
+  cdef Py_ssize_t _strides[1]
+
+
+cdef memoryview _init_ArrayColumn(_FstArrays owner,
+                                  const fst.FstArrayColumn &column,
+                                  size_t size,
+                                  const char *format)
+
+
+cdef class _ReadOnlyBuffer:
+
+  cdef Py_buffer _view
+  cdef bool _acquired
+
+
+cdef fst.FstArrayColumn _get_FstArrayColumn(_ReadOnlyBuffer buf,
+                                            obj,
+                                            name,
+                                            bytes formats,
+                                            Py_ssize_t size) except *
+
+
 # Constructive operations on Fst.
 
 
@@ -522,6 +562,15 @@ cpdef bool equal(Fst ifst1, Fst ifst2, float delta=?)
 
 cpdef bool equivalent(Fst ifst1, Fst ifst2, float delta=?) except *
 
+cpdef MutableFst from_arrays(int64 start,
+                             finals,
+                             offsets,
+                             ilabels,
+                             olabels,
+                             weights,
+                             nextstates,
+                             arc_type=?)
+
 cpdef MutableFst intersect(Fst ifst1,
                            Fst ifst2,
                            compose_filter=?,
@@ -38,6 +38,11 @@ context-independent phones C, and an HMM set H:
 
 Python variables here use snake_case and constants are in all caps, minus the
 normal `k` prefix.
+
+The global interpreter lock is released while FST operations, FST reading and
+writing, and FAR iteration run in C++, so calls from several Python threads run
+in parallel. As in C++, an FST must not be mutated while another thread is
+using it.
 """
 
 # Outline:
@@ -55,6 +60,7 @@ normal `k` prefix.
 # * Arc
 # * _ArcIterator and _MutableArcIterator
 # * _StateIterator
+# * Array views
 # * FST operations
 # * Compiler
 # * FarReader and FarWriter
@@ -72,6 +78,10 @@ normal `k` prefix.
 # Cython's type annotations (e.g., `string`) are used when the variables will
 # be sent as arguments to C++ functions, but are not used for variables used
 # within the module.
+#
+# Heavy C++ calls are made inside `with nogil` blocks. Python arguments are
+# converted to C++ values before entering these blocks, since no Python object
+# may be touched without the GIL.
 
 
 ## Imports.
@@ -82,6 +92,7 @@ from cython.operator cimport dereference as deref  # *foo
 from cython.operator cimport preincrement as inc   # ++foo
 
 # C imports.
+from libc.stddef cimport ptrdiff_t
 from libc.stdint cimport INT32_MAX
 from libc.stdint cimport SIZE_MAX
 from libc.time cimport time
@@ -90,6 +101,15 @@ from libc.time cimport time
 from libcpp cimport bool
 from libcpp.cast cimport static_cast
 from libcpp.memory cimport static_pointer_cast
+from libcpp.string_view cimport string_view
+
+# Python C-API imports.
+from cpython.buffer cimport PyBUF_FORMAT
+from cpython.buffer cimport PyBUF_ND
+from cpython.buffer cimport PyBUF_STRIDES
+from cpython.buffer cimport PyBUF_WRITABLE
+from cpython.buffer cimport PyBuffer_Release
+from cpython.buffer cimport PyObject_GetBuffer
 
 # Missing C++ imports.
 from cios cimport ofstream
@@ -815,10 +835,13 @@ cdef class SymbolTableView:
           not found.
     """
     cdef const_SymbolTable_ptr _raw = self._raw_ptr_or_raise()
+    # Copies the symbol, since the C++ method returns a view.
+    cdef string_view _symbol
     try:
       return _raw.FindIndex(tostring(key))
     except TypeError:
-      return _raw.FindSymbol(key)
+      _symbol = _raw.FindSymbol(key)
+      return string(_symbol.data(), _symbol.size())
 
   cpdef int64 get_nth_key(self, ssize_t pos) except *:
     """
@@ -1286,7 +1309,9 @@ cdef class _SymbolTableIterator:
     if self._table._raw_ptr_or_raise().end() == deref(self._siter):
       raise StopIteration
     cdef int64 _label = self._siter.get().Pair().Label()
-    cdef string _symbol = self._siter.get().Pair().Symbol()
+    # Copies the symbol before advancing, since the C++ method returns a view.
+    cdef string_view _view = self._siter.get().Pair().Symbol()
+    cdef string _symbol = string(_view.data(), _view.size())
     inc(deref(self._siter))
     return (_label, _symbol)
 
@@ -1651,6 +1676,53 @@ cdef class Fst:
     """
     return _ArcIterator(self, state)
 
+  cpdef arrays(self):
+    """
+    arrays(self)
+
+    Returns a flat, column-wise view of the FST.
+
+    The result is an FstArrays named tuple whose fields other than `start` are
+    read-only, one-dimensional memoryviews: state s has final weight
+    `finals[s]` (float64) and the arcs `offsets[s]` to `offsets[s + 1]`
+    (int64), whose labels and destination states are in `ilabels`, `olabels`
+    and `nextstates` (int32) and whose weights are in `weights` (float32 or
+    float64, as given by the arc type). These support the buffer protocol, so,
+    for example, `numpy.asarray(fst.arrays().ilabels)` makes a NumPy array
+    without copying. The arc columns share the arcs of FSTs which store them
+    contiguously (e.g., ConstFst); for other FSTs the arcs are copied once.
+    Only arc types with 32-bit labels and a real-valued weight, such as
+    "standard", "log" and "log64", are supported.
+
+    Returns:
+      An FstArrays named tuple.
+
+    Raises:
+      FstOpError: Unsupported arc type.
+
+    See also: `from_arrays`.
+    """
+    cdef _FstArrays _owner = _FstArrays.__new__(_FstArrays)
+    _owner._fst = self._fst
+    _owner._arrays.reset(new fst.FstArrays())
+    with nogil:
+      fst.FstToArrays(deref(self._fst), _owner._arrays.get())
+    cdef fst.FstArrays *_arrays = _owner._arrays.get()
+    if _arrays.offsets.data == NULL:
+      raise FstOpError("Operation failed")
+    cdef const char *_weight_format = (b"f" if _arrays.weights.size == 4 else
+                                       b"d")
+    return FstArrays(
+        _arrays.start,
+        _init_ArrayColumn(_owner, _arrays.finals, _arrays.num_states, b"d"),
+        _init_ArrayColumn(_owner, _arrays.offsets, _arrays.num_states + 1,
+                          b"q"),
+        _init_ArrayColumn(_owner, _arrays.ilabels, _arrays.num_arcs, b"i"),
+        _init_ArrayColumn(_owner, _arrays.olabels, _arrays.num_arcs, b"i"),
+        _init_ArrayColumn(_owner, _arrays.weights, _arrays.num_arcs,
+                          _weight_format),
+        _init_ArrayColumn(_owner, _arrays.nextstates, _arrays.num_arcs, b"i"))
+
   cpdef Fst copy(self):
     """
     copy(self)
@@ -1883,15 +1955,17 @@ cdef class Fst:
     if ssymbols is not None:
       _ssymbols = ssymbols._raw_ptr_or_raise()
     cdef stringstream _sstrm
-    fst.Print(deref(self._fst),
-              _sstrm,
-              b"<pywrapfst>",
-              _isymbols,
-              _osymbols,
-              _ssymbols,
-              acceptor,
-              show_weight_one,
-              tostring(missing_sym))
+    cdef string _missing_sym = tostring(missing_sym)
+    with nogil:
+      fst.Print(deref(self._fst),
+                _sstrm,
+                b"<pywrapfst>",
+                _isymbols,
+                _osymbols,
+                _ssymbols,
+                acceptor,
+                show_weight_one,
+                _missing_sym)
     return _sstrm.str()
 
   def properties(self, mask, bool test):
@@ -1978,7 +2052,10 @@ cdef class Fst:
     Returns:
       True if the contents are sane, False otherwise.
     """
-    return fst.Verify(deref(self._fst))
+    cdef bool _result
+    with nogil:
+      _result = fst.Verify(deref(self._fst))
+    return _result
 
   cpdef string weight_type(self):
     """
@@ -2005,7 +2082,11 @@ cdef class Fst:
     Raises:
       FstIOError: Write failed.
     """
-    if not self._fst.get().Write(path_tostring(source)):
+    cdef string _source = path_tostring(source)
+    cdef bool _success
+    with nogil:
+      _success = self._fst.get().Write(_source)
+    if not _success:
       raise FstIOError(f"Write failed: {source!r}")
 
   cpdef bytes write_to_string(self):
@@ -2021,7 +2102,10 @@ cdef class Fst:
       FstIOError: Write to string failed.
     """
     cdef stringstream _sstrm
-    if not self._fst.get().Write(_sstrm, b"<pywrapfst>"):
+    cdef bool _success
+    with nogil:
+      _success = self._fst.get().Write(_sstrm, b"<pywrapfst>")
+    if not _success:
       raise FstIOError("Write to string failed")
     return _sstrm.str()
 
@@ -2095,7 +2179,8 @@ cdef class MutableFst(Fst):
     cdef fst.ArcSortType _sort_type
     if not fst.GetArcSortType(tostring(sort_type), addr(_sort_type)):
       raise FstArgError(f"Unknown sort type: {sort_type!r}")
-    fst.ArcSort(self._mfst.get(), _sort_type)
+    with nogil:
+      fst.ArcSort(self._mfst.get(), _sort_type)
 
   def arcsort(self, sort_type="ilabel"):
     """
@@ -2120,7 +2205,8 @@ cdef class MutableFst(Fst):
     return self
 
   cdef void _closure(self, bool closure_plus=False):
-    fst.Closure(self._mfst.get(), fst.GetClosureType(closure_plus))
+    with nogil:
+      fst.Closure(self._mfst.get(), fst.GetClosureType(closure_plus))
 
   def closure(self, bool closure_plus=False):
     """
@@ -2144,7 +2230,8 @@ cdef class MutableFst(Fst):
     return self
 
   cdef void _concat(self, Fst fst2) except *:
-    fst.Concat(self._mfst.get(), deref(fst2._fst))
+    with nogil:
+      fst.Concat(self._mfst.get(), deref(fst2._fst))
     self._check_mutating_imethod()
 
   def concat(self, Fst fst2):
@@ -2168,7 +2255,8 @@ cdef class MutableFst(Fst):
     return self
 
   cdef void _connect(self):
-    fst.Connect(self._mfst.get())
+    with nogil:
+      fst.Connect(self._mfst.get())
 
   def connect(self):
     """
@@ -2186,7 +2274,8 @@ cdef class MutableFst(Fst):
     return self
 
   cdef void _decode(self, EncodeMapper mapper) except *:
-    fst.Decode(self._mfst.get(), deref(mapper._mapper))
+    with nogil:
+      fst.Decode(self._mfst.get(), deref(mapper._mapper))
     self._check_mutating_imethod()
 
   def decode(self, EncodeMapper mapper):
@@ -2262,7 +2351,8 @@ cdef class MutableFst(Fst):
     return self
 
   cdef void _encode(self, EncodeMapper mapper) except *:
-    fst.Encode(self._mfst.get(), mapper._mapper.get())
+    with nogil:
+      fst.Encode(self._mfst.get(), mapper._mapper.get())
     self._check_mutating_imethod()
 
   def encode(self, EncodeMapper mapper):
@@ -2288,7 +2378,8 @@ cdef class MutableFst(Fst):
     return self
 
   cdef void _invert(self):
-    fst.Invert(self._mfst.get())
+    with nogil:
+      fst.Invert(self._mfst.get())
 
   def invert(self):
     """
@@ -2309,7 +2400,8 @@ cdef class MutableFst(Fst):
                       float delta=fst.kShortestDelta,
                       bool allow_nondet=False) except *:
     # This runs in-place when the second argument is null.
-    fst.Minimize(self._mfst.get(), NULL, delta, allow_nondet)
+    with nogil:
+      fst.Minimize(self._mfst.get(), NULL, delta, allow_nondet)
     self._check_mutating_imethod()
 
   def minimize(self, float delta=fst.kShortestDelta, bool allow_nondet=False):
@@ -2384,7 +2476,10 @@ cdef class MutableFst(Fst):
     return self._mfst.get().NumStates()
 
   cdef void _project(self, project_type) except *:
-    fst.Project(self._mfst.get(), _get_project_type(tostring(project_type)))
+    cdef fst.ProjectType _project_type = _get_project_type(
+        tostring(project_type))
+    with nogil:
+      fst.Project(self._mfst.get(), _project_type)
 
   def project(self, project_type):
     """
@@ -2413,7 +2508,8 @@ cdef class MutableFst(Fst):
     # Threshold is set to semiring Zero (no pruning) if no weight is specified.
     cdef fst.WeightClass _weight = _get_WeightClass_or_zero(self.weight_type(),
                                                             weight)
-    fst.Prune(self._mfst.get(), _weight, nstate, delta)
+    with nogil:
+      fst.Prune(self._mfst.get(), _weight, nstate, delta)
     self._check_mutating_imethod()
 
   def prune(self,
@@ -2446,10 +2542,11 @@ cdef class MutableFst(Fst):
                   float delta=fst.kShortestDelta,
                   bool remove_total_weight=False,
                   bool to_final=False):
-    fst.Push(self._mfst.get(),
-             fst.GetReweightType(to_final),
-             delta,
-             remove_total_weight)
+    with nogil:
+      fst.Push(self._mfst.get(),
+               fst.GetReweightType(to_final),
+               delta,
+               remove_total_weight)
 
   def push(self,
            float delta=fst.kShortestDelta,
@@ -2492,7 +2589,8 @@ cdef class MutableFst(Fst):
         _opairs.push_back(fst.LabelPair(before, after))
     if _ipairs.empty() and _opairs.empty():
       raise FstArgError("No relabeling pairs specified")
-    fst.Relabel(self._mfst.get(), _ipairs, _opairs)
+    with nogil:
+      fst.Relabel(self._mfst.get(), _ipairs, _opairs)
     self._check_mutating_imethod()
 
   def relabel_pairs(self, ipairs=None, opairs=None):
@@ -2541,15 +2639,18 @@ cdef class MutableFst(Fst):
     cdef const fst.SymbolTable *_new_osymbols = NULL
     if new_osymbols is not None:
       _new_osymbols = new_osymbols._raw_ptr_or_raise()
-    fst.Relabel(self._mfst.get(),
-        _old_isymbols,
-        _new_isymbols,
-        tostring(unknown_isymbol),
-        attach_new_isymbols,
-        _old_osymbols,
-        _new_osymbols,
-        tostring(unknown_osymbol),
-        attach_new_osymbols)
+    cdef string _unknown_isymbol = tostring(unknown_isymbol)
+    cdef string _unknown_osymbol = tostring(unknown_osymbol)
+    with nogil:
+      fst.Relabel(self._mfst.get(),
+          _old_isymbols,
+          _new_isymbols,
+          _unknown_isymbol,
+          attach_new_isymbols,
+          _old_osymbols,
+          _new_osymbols,
+          _unknown_osymbol,
+          attach_new_osymbols)
     self._check_mutating_imethod()
 
   def relabel_tables(self,
@@ -2651,7 +2752,8 @@ cdef class MutableFst(Fst):
     cdef vector[fst.WeightClass] _potentials
     for weight in potentials:
       _potentials.push_back(_get_WeightClass_or_one(_weight_type, weight))
-    fst.Reweight(self._mfst.get(), _potentials, fst.GetReweightType(to_final))
+    with nogil:
+      fst.Reweight(self._mfst.get(), _potentials, fst.GetReweightType(to_final))
     self._check_mutating_imethod()
 
   def reweight(self, potentials, bool to_final=False):
@@ -2694,7 +2796,8 @@ cdef class MutableFst(Fst):
                                  _weight,
                                  nstate,
                                  delta))
-    fst.RmEpsilon(self._mfst.get(), deref(_opts))
+    with nogil:
+      fst.RmEpsilon(self._mfst.get(), deref(_opts))
     self._check_mutating_imethod()
 
   def rmepsilon(self,
@@ -2844,7 +2947,10 @@ cdef class MutableFst(Fst):
 
   cdef void _topsort(self):
     # TopSort returns False if the FST is cyclic, and thus can't be TopSorted.
-    if not fst.TopSort(self._mfst.get()):
+    cdef bool _success
+    with nogil:
+      _success = fst.TopSort(self._mfst.get())
+    if not _success:
       logging.warning("Cannot topsort cyclic FST")
 
   def topsort(self):
@@ -2883,7 +2989,8 @@ cdef class MutableFst(Fst):
     cdef vector[const_FstClass_ptr] _fsts2
     for _fst2 in fsts2:
       _fsts2.push_back(_fst2._fst.get())
-    fst.Union(self._mfst.get(), _fsts2)
+    with nogil:
+      fst.Union(self._mfst.get(), _fsts2)
     self._check_mutating_imethod()
     return self
 
@@ -2954,8 +3061,10 @@ cdef Fst _init_XFst(FstClass_ptr tfst):
 
 
 cpdef Fst _read_Fst(source):
+  cdef string _source = path_tostring(source)
   cdef unique_ptr[fst.FstClass] _tfst
-  _tfst.reset(fst.FstClass.Read(path_tostring(source)))
+  with nogil:
+    _tfst.reset(fst.FstClass.Read(_source))
   if _tfst.get() == NULL:
     raise FstIOError(f"Read failed: {source!r}")
   return _init_XFst(_tfst.release())
@@ -2965,7 +3074,8 @@ cpdef Fst _read_Fst_from_string(string state):
   cdef stringstream _sstrm
   _sstrm << state
   cdef unique_ptr[fst.FstClass] _tfst
-  _tfst.reset(fst.FstClass.ReadStream(_sstrm, b"<pywrapfst>"))
+  with nogil:
+    _tfst.reset(fst.FstClass.ReadStream(_sstrm, b"<pywrapfst>"))
   if _tfst.get() == NULL:
     raise FstIOError("Read from string failed")
   return _init_XFst(_tfst.release())
@@ -3444,6 +3554,122 @@ cdef class _StateIterator:
     return self._siter.get().Value()
 
 
+## Array views.
+
+
+FstArrays = typing.NamedTuple("FstArrays", [("start", int),
+                                            ("finals", memoryview),
+                                            ("offsets", memoryview),
+                                            ("ilabels", memoryview),
+                                            ("olabels", memoryview),
+                                            ("weights", memoryview),
+                                            ("nextstates", memoryview)])
+
+
+cdef class _FstArrays:
+
+  """
+  (No constructor.)
+
+  Owner of the arrays describing an FST, which are kept alive together with the
+  FST they may share memory with.
+  """
+
+  def __init__(self):
+    raise NotImplementedError(f"Cannot construct {self.__class__.__name__}")
+
+
+cdef class _ArrayColumn:
+
+  """
+  (No constructor.)
+
+  Read-only, one-dimensional buffer exposing one column of an FST's arrays.
+  """
+
+  def __init__(self):
+    raise NotImplementedError(f"Cannot construct {self.__class__.__name__}")
+
+  def __getbuffer__(self, Py_buffer *buffer, int flags):
+    if flags & PyBUF_WRITABLE:
+      raise BufferError("FST array columns are read-only")
+    if ((flags & PyBUF_STRIDES) != PyBUF_STRIDES and
+        self._strides[0] != self._itemsize):
+      raise BufferError("FST array column is not contiguous")
+    buffer.buf = <void *> self._data
+    buffer.obj = self
+    buffer.len = self._shape[0] * self._itemsize
+    buffer.readonly = 1
+    buffer.itemsize = self._itemsize
+    buffer.format = <char *> self._format if flags & PyBUF_FORMAT else NULL
+    buffer.ndim = 1
+    buffer.shape = NULL
+    if flags & PyBUF_ND:
+      buffer.shape = self._shape
+    buffer.strides = NULL
+    if (flags & PyBUF_STRIDES) == PyBUF_STRIDES:
+      buffer.strides = self._strides
+    buffer.suboffsets = NULL
+    buffer.internal = NULL
+
+  def __releasebuffer__(self, Py_buffer *buffer):
+    pass
+
+
+cdef memoryview _init_ArrayColumn(_FstArrays owner,
+                                  const fst.FstArrayColumn &column,
+                                  size_t size,
+                                  const char *format):
+  cdef _ArrayColumn _column = _ArrayColumn.__new__(_ArrayColumn)
+  _column._owner = owner
+  _column._data = column.data
+  _column._format = format
+  _column._itemsize = column.size
+  _column._shape[0] = size
+  _column._strides[0] = column.stride
+  return memoryview(_column)
+
+
+cdef class _ReadOnlyBuffer:
+
+  """
+  (No constructor.)
+
+  Holds a buffer acquired from a Python object until it is released.
+  """
+
+  def __init__(self):
+    raise NotImplementedError(f"Cannot construct {self.__class__.__name__}")
+
+  def __dealloc__(self):
+    if self._acquired:
+      PyBuffer_Release(&self._view)
+
+
+cdef fst.FstArrayColumn _get_FstArrayColumn(_ReadOnlyBuffer buf,
+                                            obj,
+                                            name,
+                                            bytes formats,
+                                            Py_ssize_t size) except *:
+  """Acquires a one-dimensional buffer of the given size and formats."""
+  PyObject_GetBuffer(obj, &buf._view, PyBUF_STRIDES | PyBUF_FORMAT)
+  buf._acquired = True
+  if buf._view.ndim != 1:
+    raise FstArgError(f"{name} must be one-dimensional")
+  if buf._view.shape[0] != size:
+    raise FstArgError(f"{name} has {buf._view.shape[0]} elements; "
+                      f"expected {size}")
+  # Native and explicit little-endian formats are accepted; the formats are
+  # single characters, each of which implies an item size.
+  cdef bytes _format = (<bytes> buf._view.format).lstrip(b"@=<")
+  if len(_format) != 1 or _format not in formats:
+    raise FstArgError(f"{name} has unsupported format "
+                      f"{_format.decode('ascii', 'replace')!r}")
+  return fst.FstArrayColumn(buf._view.buf,
+                            buf._view.strides[0],
+                            buf._view.itemsize)
+
+
 ## FST operations.
 
 
@@ -3460,8 +3686,10 @@ cdef Fst _map(Fst ifst,
       _weight = _get_WeightClass_or_one(ifst.weight_type(), weight)
   else:
       _weight = _get_WeightClass_or_zero(ifst.weight_type(), weight)
-  return _init_XFst(
-    fst.Map(deref(ifst._fst), _map_type, delta, power, _weight).release())
+  cdef unique_ptr[fst.FstClass] _tfst
+  with nogil:
+    _tfst = fst.Map(deref(ifst._fst), _map_type, delta, power, _weight)
+  return _init_XFst(_tfst.release())
 
 
 cpdef Fst arcmap(Fst ifst,
@@ -3543,7 +3771,8 @@ cpdef MutableFst compose(Fst ifst1,
   _opts.reset(
       new fst.ComposeOptions(connect,
                              _get_compose_filter(tostring(compose_filter))))
-  fst.Compose(deref(ifst1._fst), deref(ifst2._fst), _tfst.get(), deref(_opts))
+  with nogil:
+    fst.Compose(deref(ifst1._fst), deref(ifst2._fst), _tfst.get(), deref(_opts))
   return _init_MutableFst(_tfst.release())
 
 
@@ -3566,7 +3795,8 @@ cpdef Fst convert(Fst ifst, fst_type=""):
   """
   cdef string _fst_type = tostring(fst_type)
   cdef unique_ptr[fst.FstClass] _tfst
-  _tfst = fst.Convert(deref(ifst._fst), _fst_type)
+  with nogil:
+    _tfst = fst.Convert(deref(ifst._fst), _fst_type)
   # Script-land Convert returns a null pointer to signal failure.
   if _tfst.get() == NULL:
     raise FstOpError(f"Conversion to {fst_type!r} failed")
@@ -3628,7 +3858,8 @@ cpdef MutableFst determinize(Fst ifst,
                                  subsequential_label,
                                  _det_type,
                                  increment_subsequential_label))
-  fst.Determinize(deref(ifst._fst), _tfst.get(), deref(_opts))
+  with nogil:
+    fst.Determinize(deref(ifst._fst), _tfst.get(), deref(_opts))
   return _init_MutableFst(_tfst.release())
 
 
@@ -3665,10 +3896,11 @@ cpdef MutableFst difference(Fst ifst1,
   _opts.reset(
       new fst.ComposeOptions(connect,
                             _get_compose_filter(tostring(compose_filter))))
-  fst.Difference(deref(ifst1._fst),
-                 deref(ifst2._fst),
-                 _tfst.get(),
-                 deref(_opts))
+  with nogil:
+    fst.Difference(deref(ifst1._fst),
+                   deref(ifst2._fst),
+                   _tfst.get(),
+                   deref(_opts))
   return _init_MutableFst(_tfst.release())
 
 
@@ -3711,7 +3943,8 @@ cpdef MutableFst disambiguate(Fst ifst,
                                   _weight,
                                   nstate,
                                   subsequential_label))
-  fst.Disambiguate(deref(ifst._fst), _tfst.get(), deref(_opts))
+  with nogil:
+    fst.Disambiguate(deref(ifst._fst), _tfst.get(), deref(_opts))
   return _init_MutableFst(_tfst.release())
 
 
@@ -3737,10 +3970,10 @@ cpdef MutableFst epsnormalize(Fst ifst, bool eps_norm_output=False):
   """
   cdef unique_ptr[fst.VectorFstClass] _tfst
   _tfst.reset(new fst.VectorFstClass(ifst.arc_type()))
-  fst.EpsNormalize(
-      deref(ifst._fst),
-      _tfst.get(),
+  cdef fst.EpsNormalizeType _eps_norm_type = (
       fst.EPS_NORM_OUTPUT if eps_norm_output else fst.EPS_NORM_INPUT)
+  with nogil:
+    fst.EpsNormalize(deref(ifst._fst), _tfst.get(), _eps_norm_type)
   return _init_MutableFst(_tfst.release())
 
 
@@ -3762,7 +3995,10 @@ cpdef bool equal(Fst ifst1, Fst ifst2, float delta=fst.kDelta):
   Returns:
     True if the FSTs satisfy the above condition, else False.
   """
-  return fst.Equal(deref(ifst1._fst), deref(ifst2._fst), delta)
+  cdef bool _result
+  with nogil:
+    _result = fst.Equal(deref(ifst1._fst), deref(ifst2._fst), delta)
+  return _result
 
 
 cpdef bool equivalent(Fst ifst1, Fst ifst2, float delta=fst.kDelta):
@@ -3783,7 +4019,88 @@ cpdef bool equivalent(Fst ifst1, Fst ifst2, float delta=fst.kDelta):
   Returns:
     True if the FSTs satisfy the above condition, else False.
   """
-  return fst.Equivalent(deref(ifst1._fst), deref(ifst2._fst), delta)
+  cdef bool _result
+  with nogil:
+    _result = fst.Equivalent(deref(ifst1._fst), deref(ifst2._fst), delta)
+  return _result
+
+
+cpdef MutableFst from_arrays(int64 start,
+                             finals,
+                             offsets,
+                             ilabels,
+                             olabels,
+                             weights,
+                             nextstates,
+                             arc_type="standard"):
+  """
+  from_arrays(start, finals, offsets, ilabels, olabels, weights, nextstates,
+              arc_type="standard")
+
+  Constructs an FST from flat, column-wise arrays.
+
+  This is the inverse of `Fst.arrays`. The columns may be any one-dimensional
+  objects supporting the buffer protocol, including NumPy arrays and strided
+  fields of NumPy record arrays, and are read without being copied first.
+
+  Args:
+    start: The start state ID, or -1 for an empty FST.
+    finals: Final weights of the states (float32 or float64).
+    offsets: Arc offsets of the states, one more than the number of states
+        (int64).
+    ilabels: Input labels of the arcs (int32).
+    olabels: Output labels of the arcs (int32).
+    weights: Weights of the arcs (float32 or float64).
+    nextstates: Destination states of the arcs (int32).
+    arc_type: A string indicating the arc type.
+
+  Returns:
+    An FST.
+
+  Raises:
+    FstArgError: Arrays of the wrong shape or type.
+    FstOpError: Unknown or unsupported arc type, or inconsistent arrays.
+
+  See also: `Fst.arrays`.
+  """
+  cdef fst.FstArrays _arrays
+  cdef _ReadOnlyBuffer _finals = _ReadOnlyBuffer.__new__(_ReadOnlyBuffer)
+  cdef _ReadOnlyBuffer _offsets = _ReadOnlyBuffer.__new__(_ReadOnlyBuffer)
+  cdef _ReadOnlyBuffer _ilabels = _ReadOnlyBuffer.__new__(_ReadOnlyBuffer)
+  cdef _ReadOnlyBuffer _olabels = _ReadOnlyBuffer.__new__(_ReadOnlyBuffer)
+  cdef _ReadOnlyBuffer _weights = _ReadOnlyBuffer.__new__(_ReadOnlyBuffer)
+  cdef _ReadOnlyBuffer _nextstates = _ReadOnlyBuffer.__new__(_ReadOnlyBuffer)
+  _arrays.start = start
+  _arrays.num_states = len(memoryview(finals))
+  _arrays.num_arcs = len(memoryview(ilabels))
+  _arrays.finals = _get_FstArrayColumn(_finals, finals, "finals", b"fd",
+                                       _arrays.num_states)
+  _arrays.offsets = _get_FstArrayColumn(_offsets, offsets, "offsets", b"lq",
+                                        _arrays.num_states + 1)
+  if _arrays.offsets.size != 8:
+    raise FstArgError("offsets must have 64-bit elements")
+  _arrays.ilabels = _get_FstArrayColumn(_ilabels, ilabels, "ilabels", b"il",
+                                        _arrays.num_arcs)
+  _arrays.olabels = _get_FstArrayColumn(_olabels, olabels, "olabels", b"il",
+                                        _arrays.num_arcs)
+  _arrays.weights = _get_FstArrayColumn(_weights, weights, "weights", b"fd",
+                                        _arrays.num_arcs)
+  _arrays.nextstates = _get_FstArrayColumn(_nextstates, nextstates,
+                                           "nextstates", b"il",
+                                           _arrays.num_arcs)
+  if (_arrays.ilabels.size != 4 or _arrays.olabels.size != 4 or
+      _arrays.nextstates.size != 4):
+    raise FstArgError("Labels and next states must have 32-bit elements")
+  cdef unique_ptr[fst.MutableFstClass] _tfst
+  _tfst.reset(new fst.VectorFstClass(tostring(arc_type)))
+  if _tfst.get().Properties(fst.kError, True) == fst.kError:
+    raise FstOpError(f"Unknown arc type: {arc_type!r}")
+  cdef bool _success
+  with nogil:
+    _success = fst.ArraysToFst(_arrays, _tfst.get())
+  if not _success:
+    raise FstOpError("Operation failed")
+  return _init_MutableFst(_tfst.release())
 
 
 cpdef MutableFst intersect(Fst ifst1,
@@ -3817,7 +4134,8 @@ cpdef MutableFst intersect(Fst ifst1,
   _opts.reset(
       new fst.ComposeOptions(connect,
                             _get_compose_filter(tostring(compose_filter))))
-  fst.Intersect(deref(ifst1._fst), deref(ifst2._fst), _tfst.get(), deref(_opts))
+  with nogil:
+    fst.Intersect(deref(ifst1._fst), deref(ifst2._fst), _tfst.get(), deref(_opts))
   return _init_MutableFst(_tfst.release())
 
 
@@ -3842,7 +4160,10 @@ cpdef bool isomorphic(Fst ifst1, Fst ifst2, float delta=fst.kDelta):
   Returns:
     True if the two transducers satisfy the above condition, else False.
   """
-  return fst.Isomorphic(deref(ifst1._fst), deref(ifst2._fst), delta)
+  cdef bool _result
+  with nogil:
+    _result = fst.Isomorphic(deref(ifst1._fst), deref(ifst2._fst), delta)
+  return _result
 
 
 cpdef MutableFst prune(Fst ifst,
@@ -3873,7 +4194,8 @@ cpdef MutableFst prune(Fst ifst,
   _tfst.reset(new fst.VectorFstClass(ifst.arc_type()))
   cdef fst.WeightClass _weight = _get_WeightClass_or_zero(ifst.weight_type(),
                                                           weight)
-  fst.Prune(deref(ifst._fst), _tfst.get(), _weight, nstate, delta)
+  with nogil:
+    fst.Prune(deref(ifst._fst), _tfst.get(), _weight, nstate, delta)
   return _init_MutableFst(_tfst.release())
 
 
@@ -3925,11 +4247,12 @@ cpdef MutableFst push(Fst ifst,
                                       push_labels,
                                       remove_common_affix,
                                       remove_total_weight)
-  fst.Push(deref(ifst._fst),
-           _tfst.get(),
-           flags,
-           fst.GetReweightType(to_final),
-           delta)
+  with nogil:
+    fst.Push(deref(ifst._fst),
+             _tfst.get(),
+             flags,
+             fst.GetReweightType(to_final),
+             delta)
   return _init_MutableFst(_tfst.release())
 
 
@@ -3977,12 +4300,15 @@ cpdef bool randequivalent(Fst ifst1,
                                                     False))
   if seed == 0:
     seed = time(NULL)
-  return fst.RandEquivalent(deref(ifst1._fst),
-                            deref(ifst2._fst),
-                            npath,
-                            deref(_opts),
-                            delta,
-                            seed)
+  cdef bool _result
+  with nogil:
+    _result = fst.RandEquivalent(deref(ifst1._fst),
+                                 deref(ifst2._fst),
+                                 npath,
+                                 deref(_opts),
+                                 delta,
+                                 seed)
+  return _result
 
 
 cpdef MutableFst randgen(Fst ifst,
@@ -4033,7 +4359,8 @@ cpdef MutableFst randgen(Fst ifst,
   _tfst.reset(new fst.VectorFstClass(ifst.arc_type()))
   if seed == 0:
     seed = time(NULL)
-  fst.RandGen(deref(ifst._fst), _tfst.get(), deref(_opts), seed)
+  with nogil:
+    fst.RandGen(deref(ifst._fst), _tfst.get(), deref(_opts), seed)
   return _init_MutableFst(_tfst.release())
 
 
@@ -4093,7 +4420,8 @@ cpdef MutableFst replace(pairs,
       epsilon_on_replace)
   cdef unique_ptr[fst.ReplaceOptions] _opts
   _opts.reset(new fst.ReplaceOptions(_pairs[0].first, _cal, _ral, return_label))
-  fst.Replace(_pairs, _tfst.get(), deref(_opts))
+  with nogil:
+    fst.Replace(_pairs, _tfst.get(), deref(_opts))
   return _init_MutableFst(_tfst.release())
 
 
@@ -4118,7 +4446,8 @@ cpdef MutableFst reverse(Fst ifst, bool require_superinitial=True):
   """
   cdef unique_ptr[fst.VectorFstClass] _tfst
   _tfst.reset(new fst.VectorFstClass(ifst.arc_type()))
-  fst.Reverse(deref(ifst._fst), _tfst.get(), require_superinitial)
+  with nogil:
+    fst.Reverse(deref(ifst._fst), _tfst.get(), require_superinitial)
   return _init_MutableFst(_tfst.release())
 
 
@@ -4135,14 +4464,16 @@ cdef void _shortestdistance(Fst ifst,
   if reverse:
     # Only the simpler signature supports shortest distance to final states;
     # `nstate` and `queue_type` arguments are ignored.
-    fst.ShortestDistance(deref(ifst._fst), distance, True, delta)
+    with nogil:
+      fst.ShortestDistance(deref(ifst._fst), distance, True, delta)
   else:
     _opts.reset(
         new fst.ShortestDistanceOptions(_get_queue_type(tostring(queue_type)),
                                         fst.ArcFilterType.ANY_ARC_FILTER,
                                         nstate,
                                         delta))
-    fst.ShortestDistance(deref(ifst._fst), distance, deref(_opts))
+    with nogil:
+      fst.ShortestDistance(deref(ifst._fst), distance, deref(_opts))
 
 
 def shortestdistance(Fst ifst,
@@ -4232,7 +4563,8 @@ cpdef MutableFst shortestpath(Fst ifst,
                                   delta,
                                   _weight,
                                   nstate))
-  fst.ShortestPath(deref(ifst._fst), _tfst.get(), deref(_opts))
+  with nogil:
+    fst.ShortestPath(deref(ifst._fst), _tfst.get(), deref(_opts))
   return _init_MutableFst(_tfst.release())
 
 
@@ -4283,7 +4615,8 @@ cpdef MutableFst synchronize(Fst ifst):
   """
   cdef unique_ptr[fst.VectorFstClass] _tfst
   _tfst.reset(new fst.VectorFstClass(ifst.arc_type()))
-  fst.Synchronize(deref(ifst._fst), _tfst.get())
+  with nogil:
+    fst.Synchronize(deref(ifst._fst), _tfst.get())
   return _init_MutableFst(_tfst.release())
 
 
@@ -4385,18 +4718,19 @@ cdef class Compiler:
       FstOpError: Compilation failed.
     """
     cdef unique_ptr[fst.FstClass] _tfst
-    _tfst = fst.CompileFstInternal(deref(self._sstrm),
-                                   b"<pywrapfst>",
-                                   self._fst_type,
-                                   self._arc_type,
-                                   self._isymbols,
-                                   self._osymbols,
-                                   self._ssymbols,
-                                   self._acceptor,
-                                   self._keep_isymbols,
-                                   self._keep_osymbols,
-                                   self._keep_state_numbering,
-                                   self._allow_negative_labels)
+    with nogil:
+      _tfst = fst.CompileFstInternal(deref(self._sstrm),
+                                     b"<pywrapfst>",
+                                     self._fst_type,
+                                     self._arc_type,
+                                     self._isymbols,
+                                     self._osymbols,
+                                     self._ssymbols,
+                                     self._acceptor,
+                                     self._keep_isymbols,
+                                     self._keep_osymbols,
+                                     self._keep_state_numbering,
+                                     self._allow_negative_labels)
     self._sstrm.reset(new stringstream())
     if _tfst.get() == NULL:
       raise FstOpError("Compilation failed")
@@ -4470,7 +4804,8 @@ cdef class FarReader:
     """
     cdef vector[string] _sources = [path_tostring(source) for source in sources]
     cdef unique_ptr[fst.FarReaderClass] _tfar
-    _tfar = fst.FarReaderClass.Open(_sources)
+    with nogil:
+      _tfar = fst.FarReaderClass.Open(_sources)
     if _tfar.get() == NULL:
       raise FstIOError(f"Read failed: {sources!r}")
     cdef FarReader reader = FarReader.__new__(FarReader)
@@ -4523,7 +4858,11 @@ cdef class FarReader:
     Returns:
       True if the key was found, False otherwise.
     """
-    return self._reader.get().Find(tostring(key))
+    cdef string _key = tostring(key)
+    cdef bool _result
+    with nogil:
+      _result = self._reader.get().Find(_key)
+    return _result
 
   cpdef Fst get_fst(self):
     """
@@ -4553,7 +4892,8 @@ cdef class FarReader:
 
     Advances the iterator.
     """
-    self._reader.get().Next()
+    with nogil:
+      self._reader.get().Next()
 
   cpdef void reset(self):
     """
@@ -4561,10 +4901,11 @@ cdef class FarReader:
 
     Resets the iterator to the initial position.
     """
-    self._reader.get().Reset()
+    with nogil:
+      self._reader.get().Reset()
 
   def __getitem__(self, key):
-    if self._reader.get().Find(tostring(key)):
+    if self.find(key):
       return self.get_fst()
     else:
       raise KeyError(key)
@@ -4630,11 +4971,12 @@ cdef class FarWriter:
     Raises:
       FstIOError: Read failed.
     """
+    cdef string _source = path_tostring(source)
+    cdef string _arc_type = tostring(arc_type)
+    cdef fst.FarType _far_type = _get_far_type(tostring(far_type))
     cdef unique_ptr[fst.FarWriterClass] _tfar
-    _tfar = fst.FarWriterClass.Create(
-        path_tostring(source),
-        tostring(arc_type),
-        _get_far_type(tostring(far_type)))
+    with nogil:
+      _tfar = fst.FarWriterClass.Create(_source, _arc_type, _far_type)
     if _tfar.get() == NULL:
       raise FstIOError(f"Open failed: {source!r}")
     cdef FarWriter writer = FarWriter.__new__(FarWriter)
@@ -4664,7 +5006,11 @@ cdef class FarWriter:
     """
     # Failure here results from passing an FST with a different arc type than
     # used by the FAR was initialized to use.
-    if not self._writer.get().Add(tostring(key), deref(ifst._fst)):
+    cdef string _key = tostring(key)
+    cdef bool _success
+    with nogil:
+      _success = self._writer.get().Add(_key, deref(ifst._fst))
+    if not _success:
       raise FstOpError("Incompatible or invalid arc type")
 
   cpdef string arc_type(self):
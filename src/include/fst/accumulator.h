@@ -31,9 +31,37 @@
 #include <fst/arcsort.h>
 #include <fst/dfs-visit.h>
 #include <fst/expanded-fst.h>
+#include <fst/log-sum-exp.h>
 #include <fst/replace.h>
 
 namespace fst {
+namespace internal {
+
+// Returns the log semiring sum of w and the weights of the arcs at positions
+// [begin, end) of aiter, computed in log64 with the batch kernels of
+// log-sum-exp.h. Assumes Weight has a WeightConvert specialization to and from
+// log64 weights.
+template <class Weight, class ArcIter>
+Weight LogSumArcWeights(Weight w, ArcIter *aiter, ssize_t begin, ssize_t end) {
+  if (begin >= end) return w;
+  static constexpr ssize_t kChunkSize = 64;
+  const WeightConvert<Weight, Log64Weight> to_log_weight;
+  const WeightConvert<Log64Weight, Weight> to_weight;
+  double values[kChunkSize + 1];
+  auto sum = to_log_weight(w).Value();
+  aiter->Seek(begin);
+  for (auto pos = begin; pos < end;) {
+    size_t n = 0;
+    values[n++] = sum;
+    for (; pos < end && n <= kChunkSize; aiter->Next(), ++pos) {
+      values[n++] = to_log_weight(aiter->Value().weight).Value();
+    }
+    sum = LogSumExp(values, n);
+  }
+  return to_weight(Log64Weight(sum));
+}
+
+}  // namespace internal
 
 // This class accumulates arc weights using the semiring Plus().
 // Sum(w, aiter, begin, end) has time complexity O(begin - end).
@@ -91,12 +119,7 @@ class LogAccumulator {
 
   template <class ArcIter>
   Weight Sum(Weight w, ArcIter *aiter, ssize_t begin, ssize_t end) {
-    auto sum = w;
-    aiter->Seek(begin);
-    for (auto pos = begin; pos < end; aiter->Next(), ++pos) {
-      sum = LogPlus(sum, aiter->Value().weight);
-    }
-    return sum;
+    return internal::LogSumArcWeights(w, aiter, begin, end);
   }
 
   constexpr bool Error() const { return false; }
@@ -278,10 +301,7 @@ class FastLogAccumulator {
     // Computes sum before pre-stored weights.
     if (begin < stored_begin) {
       const auto pos_end = std::min(stored_begin, end);
-      aiter->Seek(begin);
-      for (auto pos = begin; pos < pos_end; aiter->Next(), ++pos) {
-        sum = LogPlus(sum, aiter->Value().weight);
-      }
+      sum = internal::LogSumArcWeights(sum, aiter, begin, pos_end);
     }
     // Computes sum between pre-stored weights.
     if (stored_begin < stored_end) {
@@ -301,10 +321,7 @@ class FastLogAccumulator {
     // Computes sum after pre-stored weights.
     if (stored_end < end) {
       const auto pos_start = std::max(stored_begin, stored_end);
-      aiter->Seek(pos_start);
-      for (auto pos = pos_start; pos < end; aiter->Next(), ++pos) {
-        sum = LogPlus(sum, aiter->Value().weight);
-      }
+      sum = internal::LogSumArcWeights(sum, aiter, pos_start, end);
     }
     return sum;
   }
@@ -535,12 +552,7 @@ class CacheLogAccumulator {
   template <class ArcIter>
   Weight Sum(Weight w, ArcIter *aiter, ssize_t begin, ssize_t end) {
     if (weights_ == nullptr) {
-      auto sum = w;
-      aiter->Seek(begin);
-      for (auto pos = begin; pos < end; aiter->Next(), ++pos) {
-        sum = LogPlus(sum, aiter->Value().weight);
-      }
-      return sum;
+      return internal::LogSumArcWeights(w, aiter, begin, end);
     } else {
       Extend(end, aiter);
       const auto &f1 = (*weights_)[end];
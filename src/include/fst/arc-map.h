@@ -564,6 +564,9 @@ class ArcMapFst : public ImplToFst<internal::ArcMapFstImpl<A, B, C>> {
     GetMutableImpl()->InitArcIterator(s, data);
   }
 
+  // Returns statistics on the state cache of this FST.
+  CacheStats GetCacheStats() const { return GetImpl()->GetCacheStats(); }
+
  protected:
   using ImplToFst<Impl>::GetImpl;
   using ImplToFst<Impl>::GetMutableImpl;
@@ -1029,7 +1032,7 @@ class GallicToNewSymbolsMapper {
           fst_->AddArc(p, ToArc(i ? 0 : l, iter1.Value(), n));
           if (isymbols_) {
             if (i) s = s + "_";
-            s = s + osymbols_->Find(iter1.Value());
+            s += osymbols_->Find(iter1.Value());
           }
         }
         if (isymbols_) isymbols_->AddSymbol(s, l);
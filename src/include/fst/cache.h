@@ -21,6 +21,8 @@
 #define FST_CACHE_H_
 
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <functional>
 #include <list>
 #include <vector>
@@ -29,12 +31,14 @@
 #include <fst/types.h>
 #include <fst/log.h>
 
+#include <fst/lock.h>
 #include <fst/vector-fst.h>
 
 #include <unordered_map>
 
 DECLARE_bool(fst_default_cache_gc);
 DECLARE_int64(fst_default_cache_gc_limit);
+DECLARE_bool(fst_default_cache_gc_clock);
 
 namespace fst {
 
@@ -42,10 +46,12 @@ namespace fst {
 struct CacheOptions {
   bool gc;          // Enables GC.
   size_t gc_limit;  // Number of bytes allowed before GC.
+  bool gc_clock;    // Uses CLOCK replacement rather than mark-sweep GC.
 
   explicit CacheOptions(bool gc = FLAGS_fst_default_cache_gc,
-                        size_t gc_limit = FLAGS_fst_default_cache_gc_limit)
-      : gc(gc), gc_limit(gc_limit) {}
+                        size_t gc_limit = FLAGS_fst_default_cache_gc_limit,
+                        bool gc_clock = FLAGS_fst_default_cache_gc_clock)
+      : gc(gc), gc_limit(gc_limit), gc_clock(gc_clock) {}
 };
 
 // Options for controlling caching behavior, at a lower level than
@@ -56,14 +62,38 @@ struct CacheImplOptions {
   size_t gc_limit;    // Number of bytes allowed before GC.
   CacheStore *store;  // Cache store.
   bool own_store;     // Should CacheImpl takes ownership of the store?
+  bool gc_clock;      // Uses CLOCK replacement rather than mark-sweep GC.
 
   explicit CacheImplOptions(bool gc = FLAGS_fst_default_cache_gc,
                             size_t gc_limit = FLAGS_fst_default_cache_gc_limit,
                             CacheStore *store = nullptr)
-      : gc(gc), gc_limit(gc_limit), store(store), own_store(true) {}
+      : gc(gc),
+        gc_limit(gc_limit),
+        store(store),
+        own_store(true),
+        gc_clock(FLAGS_fst_default_cache_gc_clock) {}
 
   explicit CacheImplOptions(const CacheOptions &opts)
-      : gc(opts.gc), gc_limit(opts.gc_limit), store(nullptr), own_store(true) {}
+      : gc(opts.gc),
+        gc_limit(opts.gc_limit),
+        store(nullptr),
+        own_store(true),
+        gc_clock(opts.gc_clock) {}
+};
+
+// Cache statistics, as reported by CacheBaseImpl::GetCacheStats(). Counts are
+// cumulative over the lifetime of the cache and may undercount when an FST is
+// read from several threads at once.
+struct CacheStats {
+  size_t hits = 0;             // Lookups of cached finals or arcs found.
+  size_t misses = 0;           // Lookups of cached finals or arcs not found.
+  size_t nexpanded = 0;        // Number of state expansions.
+  size_t nstates = 0;          // Number of states currently cached.
+  size_t cache_size = 0;       // Bytes currently cached (when GC tracked).
+  size_t cache_limit = 0;      // Bytes allowed before GC (when GC tracked).
+  size_t ngc = 0;              // Number of GC passes.
+  size_t nreclaimed = 0;       // Number of states freed by GC.
+  size_t bytes_reclaimed = 0;  // Bytes freed by GC.
 };
 
 // Cache flags.
@@ -234,6 +264,138 @@ class CacheState {
   mutable int ref_count_;  // If 0, available for GC.
 };
 
+// Cache state for use with ConcurrentCacheStore, with arcs stored in a
+// per-state std::vector. Flags are atomic so that readers may mark a state as
+// recently visited while other threads read it. Since the concurrent store
+// never garbage-collects, reference counts are not maintained. A state must be
+// built by a single thread; setting kCacheArcs (resp. kCacheFinal) publishes
+// the arcs (resp. final weight) to other threads.
+template <class A>
+class ConcurrentCacheState {
+ public:
+  using Arc = A;
+  using Label = typename Arc::Label;
+  using StateId = typename Arc::StateId;
+  using Weight = typename Arc::Weight;
+
+  ConcurrentCacheState()
+      : final_weight_(Weight::Zero()), niepsilons_(0), noepsilons_(0) {}
+
+  ConcurrentCacheState(const ConcurrentCacheState<A> &state)
+      : final_weight_(state.Final()),
+        niepsilons_(state.NumInputEpsilons()),
+        noepsilons_(state.NumOutputEpsilons()),
+        arcs_(state.arcs_),
+        flags_(state.Flags()) {}
+
+  void Reset() {
+    final_weight_ = Weight::Zero();
+    niepsilons_ = 0;
+    noepsilons_ = 0;
+    flags_.store(0, std::memory_order_relaxed);
+    arcs_.clear();
+  }
+
+  Weight Final() const { return final_weight_; }
+
+  size_t NumInputEpsilons() const { return niepsilons_; }
+
+  size_t NumOutputEpsilons() const { return noepsilons_; }
+
+  size_t NumArcs() const { return arcs_.size(); }
+
+  const Arc &GetArc(size_t n) const { return arcs_[n]; }
+
+  // Used by the ArcIterator<Fst<Arc>> efficient implementation.
+  const Arc *Arcs() const { return !arcs_.empty() ? &arcs_[0] : nullptr; }
+
+  // Accesses flags; used by the caller.
+  uint8 Flags() const { return flags_.load(std::memory_order_acquire); }
+
+  // Reference counts are not maintained; always 0.
+  int RefCount() const { return 0; }
+
+  void SetFinal(Weight weight = Weight::One()) {
+    final_weight_ = std::move(weight);
+  }
+
+  void ReserveArcs(size_t n) { arcs_.reserve(n); }
+
+  void AddArc(const Arc &arc) {
+    IncrementNumEpsilons(arc);
+    arcs_.push_back(arc);
+  }
+
+  void AddArc(Arc &&arc) {
+    IncrementNumEpsilons(arc);
+    arcs_.push_back(std::move(arc));
+  }
+
+  void PushArc(const Arc &arc) { arcs_.push_back(arc); }
+
+  void PushArc(Arc &&arc) { arcs_.push_back(std::move(arc)); }
+
+  template <class... T>
+  void EmplaceArc(T &&... ctor_args) {
+    arcs_.emplace_back(std::forward<T>(ctor_args)...);
+  }
+
+  void SetArcs() {
+    for (const auto &arc : arcs_) {
+      IncrementNumEpsilons(arc);
+    }
+  }
+
+  void SetArc(const Arc &arc, size_t n) {
+    if (arcs_[n].ilabel == 0) --niepsilons_;
+    if (arcs_[n].olabel == 0) --noepsilons_;
+    IncrementNumEpsilons(arc);
+    arcs_[n] = arc;
+  }
+
+  void DeleteArcs() {
+    niepsilons_ = 0;
+    noepsilons_ = 0;
+    arcs_.clear();
+  }
+
+  void DeleteArcs(size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+      if (arcs_.back().ilabel == 0) --niepsilons_;
+      if (arcs_.back().olabel == 0) --noepsilons_;
+      arcs_.pop_back();
+    }
+  }
+
+  // Sets status flags atomically; used by the caller.
+  void SetFlags(uint8 flags, uint8 mask) const {
+    auto old_flags = flags_.load(std::memory_order_relaxed);
+    while (!flags_.compare_exchange_weak(
+        old_flags, static_cast<uint8>((old_flags & ~mask) | flags),
+        std::memory_order_acq_rel, std::memory_order_relaxed)) {
+    }
+  }
+
+  int IncrRefCount() const { return 0; }
+
+  int DecrRefCount() const { return 0; }
+
+  // Returns nullptr so that arc iterators do not update a reference count.
+  int *MutableRefCount() const { return nullptr; }
+
+ private:
+  void IncrementNumEpsilons(const Arc &arc) {
+    if (arc.ilabel == 0) ++niepsilons_;
+    if (arc.olabel == 0) ++noepsilons_;
+  }
+
+  Weight final_weight_;
+  size_t niepsilons_;
+  size_t noepsilons_;
+  std::vector<Arc> arcs_;
+  mutable std::atomic<uint8> flags_{0};
+};
+
 // Cache store, allocating and storing states, providing a mapping from state
 // IDs to cached states, and an iterator over these states. The state template
 // argument must implement the CacheState interface. The state for a StateId s
@@ -285,6 +447,10 @@ class CacheState {
 //   // Number of cached states.
 //   StateId CountStates();
 //
+//   // Fills in the store fields of the cache statistics; only needed if
+//   // CacheBaseImpl::GetCacheStats() is called.
+//   void GetCacheStats(CacheStats *stats) const;
+//
 //   // Iterates over cached states (in an arbitrary order); only needed if
 //   // opts.gc is true.
 //   bool Done() const;      // End of iteration.
@@ -379,6 +545,8 @@ class VectorCacheStore {
                          [](const State *s) { return s != nullptr; });
   }
 
+  void GetCacheStats(CacheStats *stats) const { stats->nstates = CountStates(); }
+
   // Iterates over cached states (in an arbitrary order); only works if GC is
   // enabled (o.w. avoiding state_list_ overhead).
   bool Done() const { return iter_ == state_list_.end(); }
@@ -461,8 +629,18 @@ class HashCacheStore {
 
   // Creates state if state is not stored.
   State *GetMutableState(StateId s) {
-    auto *&state = state_map_[s];
-    if (!state) state = new (&state_alloc_) State(arc_alloc_);
+    const auto it = state_map_.find(s);
+    if (it != state_map_.end()) return it->second;
+    // Inserting may rehash the map, invalidating the iteration position, which
+    // is then sought again by state ID so that iteration (e.g., the CLOCK hand
+    // of GCCacheStore) can continue across insertions.
+    const auto nbuckets = state_map_.bucket_count();
+    const auto value = Done() ? kNoStateId : Value();
+    auto *state = new (&state_alloc_) State(arc_alloc_);
+    state_map_.emplace(s, state);
+    if (state_map_.bucket_count() != nbuckets) {
+      iter_ = value == kNoStateId ? state_map_.end() : state_map_.find(value);
+    }
     return state;
   }
 
@@ -485,10 +663,13 @@ class HashCacheStore {
       State::Destroy(it->second, &state_alloc_);
     }
     state_map_.clear();
+    Reset();
   }
 
   StateId CountStates() const { return state_map_.size(); }
 
+  void GetCacheStats(CacheStats *stats) const { stats->nstates = CountStates(); }
+
   // Iterates over cached states (in an arbitrary order).
   bool Done() const { return iter_ == state_map_.end(); }
 
@@ -520,6 +701,232 @@ class HashCacheStore {
   typename State::ArcAllocator arc_alloc_;      // For arc allocation.
 };
 
+// This class is a thread-safe store for states of type ConcurrentCacheState
+// (or another state type with the same interface): many threads may look up,
+// create and build states in one store at the same time.
+//
+// State pointers are kept in a table of geometrically growing segments that are
+// never reallocated, so GetState() is lock-free. State creation is lock-striped:
+// a miss in GetMutableState() locks only the stripe owning the state ID, so
+// threads creating different states rarely contend. A given state must be
+// built by one thread at a time; StateMutex() returns the stripe lock that
+// callers may use for this purpose. Clear(), copying, assignment and the
+// iteration methods are not thread-safe. This store never garbage-collects, so
+// opts.gc and opts.gc_limit are ignored.
+//
+// A thread-safe store does not by itself make a delayed FST safe to share
+// between threads: the bookkeeping of CacheBaseImpl and the delayed FST
+// implementations (e.g., their state tables and matchers) are not
+// thread-safe, so calls on a shared delayed FST must still be serialized by
+// the caller.
+template <class S>
+class ConcurrentCacheStore {
+ public:
+  using State = S;
+  using Arc = typename State::Arc;
+  using StateId = typename Arc::StateId;
+
+  // Required constructors/assignment operators.
+  explicit ConcurrentCacheStore(const CacheOptions &opts) : iter_(0) {
+    for (auto &segment : segments_) segment.store(nullptr);
+  }
+
+  ConcurrentCacheStore(const ConcurrentCacheStore<S> &store) : iter_(0) {
+    for (auto &segment : segments_) segment.store(nullptr);
+    CopyStates(store);
+    Reset();
+  }
+
+  ~ConcurrentCacheStore() {
+    Clear();
+    for (auto &segment : segments_) delete[] segment.load();
+  }
+
+  ConcurrentCacheStore &operator=(const ConcurrentCacheStore &store) {
+    if (this != &store) {
+      CopyStates(store);
+      Reset();
+    }
+    return *this;
+  }
+
+  // Returns nullptr if state is not stored; lock-free.
+  const State *GetState(StateId s) const {
+    const auto *slot = FindSlot(s);
+    return slot ? slot->load(std::memory_order_acquire) : nullptr;
+  }
+
+  // Creates state if state is not stored; locks only when creating.
+  State *GetMutableState(StateId s) {
+    auto *slot = FindOrAddSlot(s);
+    auto *state = slot->load(std::memory_order_acquire);
+    if (state) return state;
+    MutexLock lock(StateMutex(s));
+    state = slot->load(std::memory_order_relaxed);
+    if (!state) {
+      state = new State();
+      slot->store(state, std::memory_order_release);
+      nstates_.fetch_add(1, std::memory_order_relaxed);
+      auto max_state = max_state_.load(std::memory_order_relaxed);
+      while (s > max_state &&
+             !max_state_.compare_exchange_weak(max_state, s,
+                                               std::memory_order_relaxed)) {
+      }
+    }
+    return state;
+  }
+
+  // Returns the lock striped over state IDs that guards state s.
+  Mutex *StateMutex(StateId s) const {
+    return &stripes_[static_cast<size_t>(s) % kNumStripes];
+  }
+
+  // Similar to State::AddArc() but updates cache store book-keeping.
+  void AddArc(State *state, const Arc &arc) { state->AddArc(arc); }
+
+  // Similar to State::SetArcs() but updates cache store book-keeping; call
+  // only once.
+  void SetArcs(State *state) { state->SetArcs(); }
+
+  // Deletes all arcs.
+  void DeleteArcs(State *state) { state->DeleteArcs(); }
+
+  // Deletes some arcs.
+  void DeleteArcs(State *state, size_t n) { state->DeleteArcs(n); }
+
+  // Deletes all cached states; segments are retained for reuse.
+  void Clear() {
+    const auto max_state = max_state_.load(std::memory_order_relaxed);
+    for (StateId s = 0; s <= max_state; ++s) {
+      auto *slot = FindSlot(s);
+      if (slot) delete slot->exchange(nullptr, std::memory_order_relaxed);
+    }
+    nstates_.store(0, std::memory_order_relaxed);
+    max_state_.store(kNoStateId, std::memory_order_relaxed);
+  }
+
+  StateId CountStates() const {
+    return nstates_.load(std::memory_order_relaxed);
+  }
+
+  void GetCacheStats(CacheStats *stats) const { stats->nstates = CountStates(); }
+
+  // Iterates over cached states (in ID order).
+  bool Done() const {
+    return iter_ > max_state_.load(std::memory_order_relaxed);
+  }
+
+  StateId Value() const { return iter_; }
+
+  void Next() {
+    ++iter_;
+    SkipEmpty();
+  }
+
+  void Reset() {
+    iter_ = 0;
+    SkipEmpty();
+  }
+
+  // Deletes current state and advances to next.
+  void Delete() {
+    delete FindSlot(iter_)->exchange(nullptr, std::memory_order_relaxed);
+    nstates_.fetch_sub(1, std::memory_order_relaxed);
+    Next();
+  }
+
+ private:
+  using Slot = std::atomic<State *>;
+
+  // The first segment holds 2^kFirstSegmentBits states; each subsequent one
+  // doubles in size, so that kNumSegments segments cover all state IDs.
+  static constexpr int kFirstSegmentBits = 10;
+  static constexpr int kNumSegments = 8 * sizeof(StateId) - kFirstSegmentBits;
+  static constexpr size_t kNumStripes = 64;
+
+  // Maps a state ID to its segment and to its offset in that segment.
+  static void Locate(StateId s, int *segment, size_t *offset) {
+    const uint64 i = static_cast<uint64>(s) + (uint64{1} << kFirstSegmentBits);
+    const int msb = 63 - __builtin_clzll(i);
+    *segment = msb - kFirstSegmentBits;
+    *offset = i - (uint64{1} << msb);
+  }
+
+  static size_t SegmentSize(int segment) {
+    return size_t{1} << (segment + kFirstSegmentBits);
+  }
+
+  const Slot *FindSlot(StateId s) const {
+    if (s < 0) return nullptr;
+    int segment;
+    size_t offset;
+    Locate(s, &segment, &offset);
+    const auto *slots = segments_[segment].load(std::memory_order_acquire);
+    return slots ? &slots[offset] : nullptr;
+  }
+
+  Slot *FindSlot(StateId s) {
+    return const_cast<Slot *>(
+        static_cast<const ConcurrentCacheStore *>(this)->FindSlot(s));
+  }
+
+  // Allocates the segment holding state s if needed; racing allocations are
+  // resolved by compare-and-swap.
+  Slot *FindOrAddSlot(StateId s) {
+    int segment;
+    size_t offset;
+    Locate(s, &segment, &offset);
+    auto *slots = segments_[segment].load(std::memory_order_acquire);
+    if (!slots) {
+      auto *new_slots = new Slot[SegmentSize(segment)];
+      for (size_t i = 0; i < SegmentSize(segment); ++i) {
+        new_slots[i].store(nullptr, std::memory_order_relaxed);
+      }
+      if (segments_[segment].compare_exchange_strong(
+              slots, new_slots, std::memory_order_acq_rel,
+              std::memory_order_acquire)) {
+        slots = new_slots;
+      } else {
+        delete[] new_slots;
+      }
+    }
+    return &slots[offset];
+  }
+
+  void SkipEmpty() {
+    while (!Done() && !GetState(iter_)) ++iter_;
+  }
+
+  void CopyStates(const ConcurrentCacheStore<State> &store) {
+    Clear();
+    const auto max_state = store.max_state_.load(std::memory_order_relaxed);
+    for (StateId s = 0; s <= max_state; ++s) {
+      const auto *store_state = store.GetState(s);
+      if (store_state) {
+        FindOrAddSlot(s)->store(new State(*store_state),
+                                std::memory_order_relaxed);
+      }
+    }
+    nstates_.store(store.CountStates(), std::memory_order_relaxed);
+    max_state_.store(max_state, std::memory_order_relaxed);
+  }
+
+  std::array<std::atomic<Slot *>, kNumSegments> segments_;  // State segments.
+  mutable std::array<Mutex, kNumStripes> stripes_;  // State creation locks.
+  std::atomic<StateId> nstates_{0};                 // Number of states.
+  std::atomic<StateId> max_state_{kNoStateId};      // Maximum stored ID.
+  StateId iter_;                                    // Iteration position.
+};
+
+template <class S>
+constexpr int ConcurrentCacheStore<S>::kFirstSegmentBits;
+
+template <class S>
+constexpr int ConcurrentCacheStore<S>::kNumSegments;
+
+template <class S>
+constexpr size_t ConcurrentCacheStore<S>::kNumStripes;
+
 // Garbage-colllection cache stores.
 
 // This class implements a simple garbage collection scheme when
@@ -623,6 +1030,8 @@ class FirstCacheStore {
 
   StateId CountStates() const { return store_.CountStates(); }
 
+  void GetCacheStats(CacheStats *stats) const { store_.GetCacheStats(stats); }
+
   // Iterates over cached states (in an arbitrary order). Only needed if GC is
   // enabled.
   bool Done() const { return store_.Done(); }
@@ -659,6 +1068,15 @@ class FirstCacheStore {
 // caller can increment the reference count to inhibit the GC of in-use state
 // (e.g., in an ArcIterator). With GC enabled, the 'gc_limit' parameter allows
 // the caller to trade-off time vs. space.
+//
+// If 'opts.gc_clock' is set, CLOCK replacement is used instead: a hand
+// persisting across collections sweeps the states in insertion order, giving
+// recently visited states a second chance and evicting others only until the
+// cache is back under 'gc_limit'. This keeps a recently used frontier resident
+// at O(1) amortized cost per cached state, rather than sweeping the whole
+// cache. The iteration position of the underlying store must remain valid as
+// states are added, as it does for VectorCacheStore, and for HashCacheStore,
+// which seeks it again after a rehash.
 template <class CacheStore>
 class GCCacheStore {
  public:
@@ -672,8 +1090,12 @@ class GCCacheStore {
         cache_gc_request_(opts.gc),
         cache_limit_(opts.gc_limit > kMinCacheLimit ? opts.gc_limit
                                                     : kMinCacheLimit),
+        cache_clock_(opts.gc_clock),
         cache_gc_(false),
-        cache_size_(0) {}
+        cache_size_(0),
+        ngc_(0),
+        nreclaimed_(0),
+        bytes_reclaimed_(0) {}
 
   // Returns 0 if state is not stored.
   const State *GetState(StateId s) const { return store_.GetState(s); }
@@ -686,7 +1108,7 @@ class GCCacheStore {
       cache_size_ += sizeof(State) + state->NumArcs() * sizeof(Arc);
       // GC is enabled once an uninited state (from underlying store) is seen.
       cache_gc_ = true;
-      if (cache_size_ > cache_limit_) GC(state, false);
+      if (cache_size_ > cache_limit_) Collect(state);
     }
     return state;
   }
@@ -696,7 +1118,7 @@ class GCCacheStore {
     store_.AddArc(state, arc);
     if (cache_gc_ && (state->Flags() & kCacheInit)) {
       cache_size_ += sizeof(Arc);
-      if (cache_size_ > cache_limit_) GC(state, false);
+      if (cache_size_ > cache_limit_) Collect(state);
     }
   }
 
@@ -706,7 +1128,7 @@ class GCCacheStore {
     store_.SetArcs(state);
     if (cache_gc_ && (state->Flags() & kCacheInit)) {
       cache_size_ += state->NumArcs() * sizeof(Arc);
-      if (cache_size_ > cache_limit_) GC(state, false);
+      if (cache_size_ > cache_limit_) Collect(state);
     }
   }
 
@@ -729,11 +1151,21 @@ class GCCacheStore {
   // Deletes all cached states.
   void Clear() {
     store_.Clear();
+    store_.Reset();
     cache_size_ = 0;
   }
 
   StateId CountStates() const { return store_.CountStates(); }
 
+  void GetCacheStats(CacheStats *stats) const {
+    store_.GetCacheStats(stats);
+    stats->cache_size = cache_size_;
+    stats->cache_limit = cache_limit_;
+    stats->ngc = ngc_;
+    stats->nreclaimed = nreclaimed_;
+    stats->bytes_reclaimed = bytes_reclaimed_;
+  }
+
   // Iterates over cached states (in an arbitrary order); only needed if GC is
   // enabled.
   bool Done() const { return store_.Done(); }
@@ -762,6 +1194,12 @@ class GCCacheStore {
   // unable to free enough memory, then widens cache_limit_.
   void GC(const State *current, bool free_recent, float cache_fraction = 0.666);
 
+  // Advances the CLOCK hand, clearing the recently visited flag of states it
+  // passes and removing (not referenced-counted and not the current) states
+  // not visited since it last passed, until at most cache_limit_ bytes are
+  // cached. If unable to free enough memory, then widens cache_limit_.
+  void ClockGC(const State *current);
+
   // Returns the current cache size in bytes or 0 if GC is disabled.
   size_t CacheSize() const { return cache_size_; }
 
@@ -771,11 +1209,23 @@ class GCCacheStore {
  private:
   static constexpr size_t kMinCacheLimit = 8096;  // Minimum cache limit.
 
+  void Collect(const State *current) {
+    if (cache_clock_) {
+      ClockGC(current);
+    } else {
+      GC(current, false);
+    }
+  }
+
   CacheStore store_;       // Underlying store.
   bool cache_gc_request_;  // GC requested but possibly not yet enabled.
   size_t cache_limit_;     // Number of bytes allowed before GC.
+  bool cache_clock_;       // Uses CLOCK replacement.
   bool cache_gc_;          // GC enabled
   size_t cache_size_;      // Number of bytes cached.
+  size_t ngc_;              // Number of GC passes.
+  size_t nreclaimed_;       // Number of states freed by GC.
+  size_t bytes_reclaimed_;  // Number of bytes freed by GC.
 };
 
 template <class CacheStore>
@@ -788,6 +1238,7 @@ void GCCacheStore<CacheStore>::GC(const State *current, bool free_recent,
           << ", cache frac = " << cache_fraction
           << ", cache limit = " << cache_limit_ << "\n";
   size_t cache_target = cache_fraction * cache_limit_;
+  ++ngc_;
   store_.Reset();
   while (!store_.Done()) {
     auto *state = store_.GetMutableState(store_.Value());
@@ -797,8 +1248,10 @@ void GCCacheStore<CacheStore>::GC(const State *current, bool free_recent,
         size_t size = sizeof(State) + state->NumArcs() * sizeof(Arc);
         if (size < cache_size_) {
           cache_size_ -= size;
+          bytes_reclaimed_ += size;
         }
       }
+      ++nreclaimed_;
       store_.Delete();
     } else {
       state->SetFlags(0, kCacheRecent);
@@ -822,6 +1275,45 @@ void GCCacheStore<CacheStore>::GC(const State *current, bool free_recent,
           << ", cache limit = " << cache_limit_ << "\n";
 }
 
+template <class CacheStore>
+void GCCacheStore<CacheStore>::ClockGC(const State *current) {
+  if (!cache_gc_) return;
+  VLOG(2) << "GCCacheStore: Enter ClockGC: object = "
+          << "(" << this << "), cache size = " << cache_size_
+          << ", cache limit = " << cache_limit_ << "\n";
+  ++ngc_;
+  // The hand wraps at most twice: once to clear the recently visited flags,
+  // and once more to collect the states that were flagged.
+  for (int nwraps = 0; cache_size_ > cache_limit_;) {
+    if (store_.Done()) {
+      if (++nwraps > 2) break;
+      store_.Reset();
+      if (store_.Done()) break;
+      continue;
+    }
+    auto *state = store_.GetMutableState(store_.Value());
+    if (state->RefCount() == 0 && state != current &&
+        !(state->Flags() & kCacheRecent)) {
+      if (state->Flags() & kCacheInit) {
+        const size_t size = sizeof(State) + state->NumArcs() * sizeof(Arc);
+        if (size < cache_size_) {
+          cache_size_ -= size;
+          bytes_reclaimed_ += size;
+        }
+      }
+      ++nreclaimed_;
+      store_.Delete();
+    } else {
+      state->SetFlags(0, kCacheRecent);
+      store_.Next();
+    }
+  }
+  while (cache_size_ > cache_limit_) cache_limit_ *= 2;  // Widens cache limit.
+  VLOG(2) << "GCCacheStore: Exit ClockGC: object = "
+          << "(" << this << "), cache size = " << cache_size_
+          << ", cache limit = " << cache_limit_ << "\n";
+}
+
 template <class CacheStore>
 constexpr size_t GCCacheStore<CacheStore>::kMinCacheLimit;
 
@@ -868,6 +1360,7 @@ class CacheBaseImpl : public FstImpl<typename State::Arc> {
         max_expanded_state_id_(-1),
         cache_gc_(opts.gc),
         cache_limit_(opts.gc_limit),
+        cache_clock_(opts.gc_clock),
         cache_store_(new CacheStore(opts)),
         new_cache_store_(true),
         own_cache_store_(true) {}
@@ -880,9 +1373,10 @@ class CacheBaseImpl : public FstImpl<typename State::Arc> {
         max_expanded_state_id_(-1),
         cache_gc_(opts.gc),
         cache_limit_(opts.gc_limit),
-        cache_store_(
-            opts.store ? opts.store
-                       : new CacheStore(CacheOptions(opts.gc, opts.gc_limit))),
+        cache_clock_(opts.gc_clock),
+        cache_store_(opts.store ? opts.store
+                                : new CacheStore(CacheOptions(
+                                      opts.gc, opts.gc_limit, opts.gc_clock))),
         new_cache_store_(!opts.store),
         own_cache_store_(opts.store ? opts.own_store : true) {}
 
@@ -898,7 +1392,9 @@ class CacheBaseImpl : public FstImpl<typename State::Arc> {
         max_expanded_state_id_(-1),
         cache_gc_(impl.cache_gc_),
         cache_limit_(impl.cache_limit_),
-        cache_store_(new CacheStore(CacheOptions(cache_gc_, cache_limit_))),
+        cache_clock_(impl.cache_clock_),
+        cache_store_(new CacheStore(
+            CacheOptions(cache_gc_, cache_limit_, cache_clock_))),
         new_cache_store_(impl.new_cache_store_ || !preserve_cache),
         own_cache_store_(true) {
     if (preserve_cache) {
@@ -962,6 +1458,7 @@ class CacheBaseImpl : public FstImpl<typename State::Arc> {
       if (arc.nextstate >= nknown_states_) nknown_states_ = arc.nextstate + 1;
     }
     SetExpandedState(s);
+    IncrementStat(&nexpanded_);
     static constexpr auto flags = kCacheArcs | kCacheRecent;
     state->SetFlags(flags, flags);
   }
@@ -1001,8 +1498,10 @@ class CacheBaseImpl : public FstImpl<typename State::Arc> {
     const auto *state = cache_store_->GetState(s);
     if (state && state->Flags() & kCacheFinal) {
       state->SetFlags(kCacheRecent, kCacheRecent);
+      IncrementStat(&hits_);
       return true;
     } else {
+      IncrementStat(&misses_);
       return false;
     }
   }
@@ -1012,8 +1511,10 @@ class CacheBaseImpl : public FstImpl<typename State::Arc> {
     const auto *state = cache_store_->GetState(s);
     if (state && state->Flags() & kCacheArcs) {
       state->SetFlags(kCacheRecent, kCacheRecent);
+      IncrementStat(&hits_);
       return true;
     } else {
+      IncrementStat(&misses_);
       return false;
     }
   }
@@ -1103,7 +1604,27 @@ class CacheBaseImpl : public FstImpl<typename State::Arc> {
 
   size_t GetCacheLimit() const { return cache_limit_; }
 
+  bool GetCacheClock() const { return cache_clock_; }
+
+  // Returns cache statistics; requires that the store implements
+  // GetCacheStats().
+  CacheStats GetCacheStats() const {
+    CacheStats stats;
+    cache_store_->GetCacheStats(&stats);
+    stats.hits = hits_.load(std::memory_order_relaxed);
+    stats.misses = misses_.load(std::memory_order_relaxed);
+    stats.nexpanded = nexpanded_.load(std::memory_order_relaxed);
+    return stats;
+  }
+
  private:
+  // Increments a statistics counter without a read-modify-write, keeping it
+  // cheap on the lookup path; concurrent increments may be lost.
+  static void IncrementStat(std::atomic<size_t> *counter) {
+    counter->store(counter->load(std::memory_order_relaxed) + 1,
+                   std::memory_order_relaxed);
+  }
+
   mutable bool has_start_;                   // Is the start state cached?
   StateId cache_start_;                      // ID of start state.
   StateId nknown_states_;                    // Number of known states.
@@ -1112,9 +1633,13 @@ class CacheBaseImpl : public FstImpl<typename State::Arc> {
   mutable StateId max_expanded_state_id_;    // Maximum ever-expanded state ID
   bool cache_gc_;                            // GC enabled.
   size_t cache_limit_;       // Number of bytes allowed before GC.
+  bool cache_clock_;         // Uses CLOCK replacement.
   CacheStore *cache_store_;  // The store of cached states.
   bool new_cache_store_;     // Was the store was created by class?
   bool own_cache_store_;     // Is the store owned by class?
+  mutable std::atomic<size_t> hits_{0};  // Cached final/arcs lookup hits.
+  mutable std::atomic<size_t> misses_{0};  // Cached final/arcs lookup misses.
+  std::atomic<size_t> nexpanded_{0};       // Number of state expansions.
 
   CacheBaseImpl &operator=(const CacheBaseImpl &impl) = delete;
 };
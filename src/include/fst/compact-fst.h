@@ -920,7 +920,8 @@ class CompactFstImpl
   template <class OtherCacheStore>
   explicit CompactFstImpl(
       const CompactFstImpl<Arc, Compactor, OtherCacheStore> &impl)
-      : ImplBase(CacheOptions(impl.GetCacheGc(), impl.GetCacheLimit())),
+      : ImplBase(CacheOptions(impl.GetCacheGc(), impl.GetCacheLimit(),
+                              impl.GetCacheClock())),
         compactor_(impl.compactor_ == nullptr
                        ? std::make_shared<Compactor>()
                        : std::make_shared<Compactor>(*impl.compactor_)) {
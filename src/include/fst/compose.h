@@ -23,6 +23,7 @@
 #include <algorithm>
 #include <memory>
 #include <utility>
+#include <vector>
 
 #include <fst/types.h>
 #include <fst/log.h>
@@ -34,6 +35,7 @@
 #include <fst/matcher.h>
 #include <fst/state-table.h>
 #include <fst/test-properties.h>
+#include <fst/thread-pool.h>
 
 
 namespace fst {
@@ -624,6 +626,9 @@ class ComposeFst
     return GetImpl()->InitMatcher(*this, match_type);
   }
 
+  // Returns statistics on the state cache of this FST.
+  CacheStats GetCacheStats() const { return GetImpl()->GetCacheStats(); }
+
  protected:
   using ImplToFst<Impl>::GetImpl;
   using ImplToFst<Impl>::GetMutableImpl;
@@ -940,6 +945,207 @@ class ComposeFstMatcher : public MatcherBase<typename CacheStore::Arc> {
 // Useful alias when using StdArc.
 using StdComposeFst = ComposeFst<StdArc>;
 
+namespace internal {
+
+// Composition state table used by each worker of ParallelComposer. Tuples
+// already in the shared table, which is only read while the workers run, map
+// to their state IDs; other tuples are kept in a table local to the worker and
+// map to provisional IDs less than kNoStateId, which ParallelComposer replaces
+// with state IDs once the workers are done.
+template <class Arc, class FilterState>
+class ParallelComposeStateTable {
+ public:
+  using StateId = typename Arc::StateId;
+  using StateTuple = DefaultComposeStateTuple<StateId, FilterState>;
+  using SharedTable = HashStateTable<StateTuple, ComposeHash<StateTuple>>;
+
+  // Uses a shared table of its own; required by ComposeFstImpl.
+  ParallelComposeStateTable(const Fst<Arc> &fst1, const Fst<Arc> &fst2)
+      : own_shared_(new SharedTable()), shared_(own_shared_.get()) {}
+
+  explicit ParallelComposeStateTable(const SharedTable *shared)
+      : shared_(shared) {}
+
+  ParallelComposeStateTable(const ParallelComposeStateTable &table)
+      : own_shared_(table.own_shared_ ? new SharedTable(*table.own_shared_)
+                                      : nullptr),
+        shared_(own_shared_ ? own_shared_.get() : table.shared_),
+        local_(table.local_) {}
+
+  StateId FindState(const StateTuple &tuple) {
+    const auto s = const_cast<SharedTable *>(shared_)->FindId(tuple, false);
+    return s != kNoStateId ? s : ToProvisional(local_.FindState(tuple));
+  }
+
+  const StateTuple &Tuple(StateId s) const {
+    return s >= 0 ? shared_->Tuple(s) : local_.Tuple(FromProvisional(s));
+  }
+
+  StateId Size() const { return shared_->Size(); }
+
+  constexpr bool Error() const { return false; }
+
+  // Forgets the provisional IDs.
+  void ClearLocal() { local_.Clear(); }
+
+  static StateId ToProvisional(StateId s) { return -2 - s; }
+
+  static StateId FromProvisional(StateId s) { return -2 - s; }
+
+ private:
+  std::unique_ptr<SharedTable> own_shared_;
+  const SharedTable *shared_;
+  SharedTable local_;
+
+  ParallelComposeStateTable &operator=(const ParallelComposeStateTable &) =
+      delete;
+};
+
+// Eager composition expanding the states of each breadth-first frontier
+// concurrently. Each worker owns a ComposeFst with its own copies of the input
+// FSTs, filter and matchers, which looks tuples up in a shared state table;
+// new tuples found by a worker get provisional IDs. After each frontier, the
+// provisional IDs are replaced in state and arc order, which assigns exactly
+// the state IDs of sequential composition, so the result is identical.
+template <class Arc, class M, class Filter>
+class ParallelComposer {
+ public:
+  using StateId = typename Arc::StateId;
+  using Weight = typename Arc::Weight;
+  using FilterState = typename Filter::FilterState;
+
+  using StateTable = ParallelComposeStateTable<Arc, FilterState>;
+  using SharedTable = typename StateTable::SharedTable;
+  // Caches only the state being expanded, without per-state arrays.
+  using Store = GCCacheStore<FirstCacheStore<HashCacheStore<CacheState<Arc>>>>;
+  using WorkerFst = ComposeFst<Arc, Store>;
+
+  ParallelComposer(const Fst<Arc> &fst1, const Fst<Arc> &fst2,
+                   int num_threads)
+      : pool_(num_threads) {
+    CacheOptions copts;
+    copts.gc_limit = 0;
+    // The FirstCacheStore keeps the one state being expanded; CLOCK
+    // replacement, if the default, would only add bookkeeping.
+    copts.gc_clock = false;
+    for (int i = 0; i < pool_.NumThreads(); ++i) {
+      fsts1_.emplace_back(fst1.Copy(true));
+      fsts2_.emplace_back(fst2.Copy(true));
+      tables_.emplace_back(new StateTable(&shared_));
+      ComposeFstImplOptions<M, M, Filter, StateTable, Store> nopts(
+          copts, nullptr, nullptr, nullptr, tables_.back().get());
+      nopts.own_state_table = false;
+      workers_.emplace_back(
+          new WorkerFst(*fsts1_.back(), *fsts2_.back(), nopts));
+    }
+  }
+
+  void Compose(MutableFst<Arc> *ofst) {
+    ofst->DeleteStates();
+    const auto &worker0 = *workers_.front();
+    ofst->SetInputSymbols(worker0.InputSymbols());
+    ofst->SetOutputSymbols(worker0.OutputSymbols());
+    const auto start = worker0.Start();
+    if (start != kNoStateId) {
+      ofst->SetStart(Resolve(0, start, ofst));
+      for (StateId lo = 0, hi; lo < ofst->NumStates(); lo = hi) {
+        hi = ofst->NumStates();
+        ExpandFrontier(lo, hi, ofst);
+      }
+    }
+    auto props = worker0.Properties(kCopyProperties, false);
+    for (const auto &worker : workers_) {
+      if (worker->Properties(kError, false)) props |= kError;
+    }
+    ofst->SetProperties(props, kCopyProperties);
+  }
+
+ private:
+  // Minimum number of states expanded by a worker.
+  static constexpr StateId kMinChunk = 64;
+
+  // Expands the frontier states [lo, hi), which must all be in the output.
+  void ExpandFrontier(StateId lo, StateId hi, MutableFst<Arc> *ofst) {
+    const auto size = hi - lo;
+    const auto nworkers = std::max<StateId>(
+        1, std::min<StateId>(workers_.size(), size / kMinChunk));
+    const auto chunk = (size + nworkers - 1) / nworkers;
+    finals_.resize(size);
+    arcs_.resize(size);
+    for (StateId i = 0; i < nworkers; ++i) {
+      const auto begin = lo + i * chunk;
+      const auto end = std::min(hi, begin + chunk);
+      if (nworkers == 1) {
+        ExpandStates(i, begin, end, lo);
+      } else {
+        pool_.Schedule([this, i, begin, end, lo] {
+          ExpandStates(i, begin, end, lo);
+        });
+      }
+    }
+    if (nworkers > 1) pool_.Wait();
+    for (StateId s = lo; s < hi; ++s) {
+      const auto worker = (s - lo) / chunk;
+      auto &arcs = arcs_[s - lo];
+      ofst->SetFinal(s, std::move(finals_[s - lo]));
+      ofst->ReserveArcs(s, arcs.size());
+      for (auto &arc : arcs) {
+        arc.nextstate = Resolve(worker, arc.nextstate, ofst);
+        ofst->AddArc(s, std::move(arc));
+      }
+      std::vector<Arc>().swap(arcs);
+    }
+    for (StateId i = 0; i < nworkers; ++i) tables_[i]->ClearLocal();
+  }
+
+  void ExpandStates(StateId worker, StateId begin, StateId end, StateId lo) {
+    const auto &fst = *workers_[worker];
+    for (auto s = begin; s < end; ++s) {
+      finals_[s - lo] = fst.Final(s);
+      auto &arcs = arcs_[s - lo];
+      arcs.reserve(fst.NumArcs(s));
+      for (ArcIterator<WorkerFst> aiter(fst, s); !aiter.Done(); aiter.Next()) {
+        arcs.push_back(aiter.Value());
+      }
+    }
+  }
+
+  // Maps a state ID returned by the worker to an output state ID, adding the
+  // state to the output if new.
+  StateId Resolve(StateId worker, StateId s, MutableFst<Arc> *ofst) {
+    if (s >= 0) return s;
+    const auto &tuple = tables_[worker]->Tuple(s);
+    const auto t = shared_.FindState(tuple);
+    if (t == ofst->NumStates()) ofst->AddState();
+    return t;
+  }
+
+  SharedTable shared_;
+  std::vector<std::unique_ptr<const Fst<Arc>>> fsts1_;
+  std::vector<std::unique_ptr<const Fst<Arc>>> fsts2_;
+  std::vector<std::unique_ptr<StateTable>> tables_;
+  std::vector<std::unique_ptr<WorkerFst>> workers_;
+  std::vector<Weight> finals_;
+  std::vector<std::vector<Arc>> arcs_;
+  ThreadPool pool_;
+};
+
+}  // namespace internal
+
+// Composes two FSTs into a MutableFst with the matcher M and the composition
+// filter Filter, as in ComposeFstOptions, expanding states on num_threads
+// threads. The result is identical to that of ComposeFst with the same matcher
+// and filter (before trimming). The input FSTs are accessed through copies
+// made with Fst::Copy(true), one per thread.
+template <class Arc, class M = Matcher<Fst<Arc>>,
+          class Filter = SequenceComposeFilter<M>>
+void ParallelCompose(const Fst<Arc> &ifst1, const Fst<Arc> &ifst2,
+                     MutableFst<Arc> *ofst, int num_threads) {
+  internal::ParallelComposer<Arc, M, Filter> composer(ifst1, ifst2,
+                                                      num_threads);
+  composer.Compose(ofst);
+}
+
 enum ComposeFilter {
   AUTO_FILTER,
   NULL_FILTER,
@@ -953,12 +1159,33 @@ enum ComposeFilter {
 struct ComposeOptions {
   bool connect;               // Connect output?
   ComposeFilter filter_type;  // Pre-defined filter to use.
+  int num_threads;            // If greater than one, expands states in
+                              // parallel; see ParallelCompose.
 
   explicit ComposeOptions(bool connect = true,
-                          ComposeFilter filter_type = AUTO_FILTER)
-      : connect(connect), filter_type(filter_type) {}
+                          ComposeFilter filter_type = AUTO_FILTER,
+                          int num_threads = 1)
+      : connect(connect), filter_type(filter_type), num_threads(num_threads) {}
 };
 
+namespace internal {
+
+// Composes with a pre-defined filter, in parallel if num_threads > 1.
+template <class Arc, class M, class Filter>
+void ComposeWithFilter(const Fst<Arc> &ifst1, const Fst<Arc> &ifst2,
+                       MutableFst<Arc> *ofst, int num_threads) {
+  if (num_threads > 1) {
+    ParallelCompose<Arc, M, Filter>(ifst1, ifst2, ofst, num_threads);
+    return;
+  }
+  // We cache only the last state for fastest copy.
+  ComposeFstOptions<Arc, M, Filter> copts;
+  copts.gc_limit = 0;
+  *ofst = ComposeFst<Arc>(ifst1, ifst2, copts);
+}
+
+}  // namespace internal
+
 // Computes the composition of two transducers. This version writes
 // the composed FST into a MutableFst. If FST1 transduces string x to
 // y with weight a and FST2 transduces y to z with weight b, then
@@ -991,55 +1218,69 @@ struct ComposeOptions {
 //     the input side of the second transducer or prefer placing
 //     them later in a path since they delay matching and can
 //     introduce non-coaccessible states and transitions.
+// - With opts.num_threads > 1, the states are expanded on that many threads,
+//   giving the same result; see ParallelCompose.
 template <class Arc>
 void Compose(const Fst<Arc> &ifst1, const Fst<Arc> &ifst2,
              MutableFst<Arc> *ofst,
              const ComposeOptions &opts = ComposeOptions()) {
   using M = Matcher<Fst<Arc>>;
-  // In each case, we cache only the last state for fastest copy.
   switch (opts.filter_type) {
     case AUTO_FILTER: {
-      CacheOptions nopts;
-      nopts.gc_limit = 0;
-      *ofst = ComposeFst<Arc>(ifst1, ifst2, nopts);
+      if (opts.num_threads <= 1) {
+        // We cache only the last state for fastest copy.
+        CacheOptions nopts;
+        nopts.gc_limit = 0;
+        *ofst = ComposeFst<Arc>(ifst1, ifst2, nopts);
+        break;
+      }
+      // Picks the matcher and filter as ComposeFst does.
+      switch (LookAheadMatchType(ifst1, ifst2)) {
+        default:
+        case MATCH_NONE:
+          ParallelCompose(ifst1, ifst2, ofst, opts.num_threads);
+          break;
+        case MATCH_OUTPUT: {
+          using LA = DefaultLookAhead<Arc, MATCH_OUTPUT>;
+          ParallelCompose<Arc, typename LA::FstMatcher,
+                          typename LA::ComposeFilter>(ifst1, ifst2, ofst,
+                                                      opts.num_threads);
+          break;
+        }
+        case MATCH_INPUT: {
+          using LA = DefaultLookAhead<Arc, MATCH_INPUT>;
+          ParallelCompose<Arc, typename LA::FstMatcher,
+                          typename LA::ComposeFilter>(ifst1, ifst2, ofst,
+                                                      opts.num_threads);
+          break;
+        }
+      }
       break;
     }
-    case NULL_FILTER: {
-      ComposeFstOptions<Arc, M, NullComposeFilter<M>> copts;
-      copts.gc_limit = 0;
-      *ofst = ComposeFst<Arc>(ifst1, ifst2, copts);
+    case NULL_FILTER:
+      internal::ComposeWithFilter<Arc, M, NullComposeFilter<M>>(
+          ifst1, ifst2, ofst, opts.num_threads);
       break;
-    }
-    case SEQUENCE_FILTER: {
-      ComposeFstOptions<Arc, M, SequenceComposeFilter<M>> copts;
-      copts.gc_limit = 0;
-      *ofst = ComposeFst<Arc>(ifst1, ifst2, copts);
+    case SEQUENCE_FILTER:
+      internal::ComposeWithFilter<Arc, M, SequenceComposeFilter<M>>(
+          ifst1, ifst2, ofst, opts.num_threads);
       break;
-    }
-    case ALT_SEQUENCE_FILTER: {
-      ComposeFstOptions<Arc, M, AltSequenceComposeFilter<M>> copts;
-      copts.gc_limit = 0;
-      *ofst = ComposeFst<Arc>(ifst1, ifst2, copts);
+    case ALT_SEQUENCE_FILTER:
+      internal::ComposeWithFilter<Arc, M, AltSequenceComposeFilter<M>>(
+          ifst1, ifst2, ofst, opts.num_threads);
       break;
-    }
-    case MATCH_FILTER: {
-      ComposeFstOptions<Arc, M, MatchComposeFilter<M>> copts;
-      copts.gc_limit = 0;
-      *ofst = ComposeFst<Arc>(ifst1, ifst2, copts);
+    case MATCH_FILTER:
+      internal::ComposeWithFilter<Arc, M, MatchComposeFilter<M>>(
+          ifst1, ifst2, ofst, opts.num_threads);
       break;
-    }
-    case NO_MATCH_FILTER: {
-      ComposeFstOptions<Arc, M, NoMatchComposeFilter<M>> copts;
-      copts.gc_limit = 0;
-      *ofst = ComposeFst<Arc>(ifst1, ifst2, copts);
+    case NO_MATCH_FILTER:
+      internal::ComposeWithFilter<Arc, M, NoMatchComposeFilter<M>>(
+          ifst1, ifst2, ofst, opts.num_threads);
       break;
-    }
-    case TRIVIAL_FILTER: {
-      ComposeFstOptions<Arc, M, TrivialComposeFilter<M>> copts;
-      copts.gc_limit = 0;
-      *ofst = ComposeFst<Arc>(ifst1, ifst2, copts);
+    case TRIVIAL_FILTER:
+      internal::ComposeWithFilter<Arc, M, TrivialComposeFilter<M>>(
+          ifst1, ifst2, ofst, opts.num_threads);
       break;
-    }
   }
   if (opts.connect) Connect(ofst);
 }
@@ -24,7 +24,9 @@
 #include <climits>
 #include <forward_list>
 #include <map>
+#include <memory>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -39,6 +41,8 @@
 #include <fst/filter-state.h>
 #include <fst/prune.h>
 #include <fst/test-properties.h>
+#include <fst/thread-pool.h>
+#include <fst/vector-fst.h>
 
 namespace fst {
 
@@ -197,6 +201,31 @@ struct DeterminizeArc {
   StateTuple *dest_tuple;  // Destination subset and filter state.
 };
 
+// Comparison object for state tuples, compared through pointers.
+template <class StateTuple>
+class DeterminizeStateTupleEqual {
+ public:
+  bool operator()(const StateTuple *tuple1, const StateTuple *tuple2) const {
+    return *tuple1 == *tuple2;
+  }
+};
+
+// Hash function for state tuples, hashed through pointers.
+template <class StateTuple>
+class DeterminizeStateTupleKey {
+ public:
+  size_t operator()(const StateTuple *tuple) const {
+    size_t h = tuple->filter_state.Hash();
+    for (auto it = tuple->subset.begin(); it != tuple->subset.end(); ++it) {
+      const size_t h1 = it->state_id;
+      static constexpr auto lshift = 5;
+      static constexpr auto rshift = CHAR_BIT * sizeof(size_t) - 5;
+      h ^= h << 1 ^ h1 << lshift ^ h1 >> rshift ^ it->weight.Hash();
+    }
+    return h;
+  }
+};
+
 }  // namespace internal
 
 // Determinization filters are used to compute destination state tuples based
@@ -337,28 +366,8 @@ class DefaultDeterminizeStateTable {
   const StateTuple *Tuple(StateId s) { return tuples_.FindEntry(s); }
 
  private:
-  // Comparison object for StateTuples.
-  class StateTupleEqual {
-   public:
-    bool operator()(const StateTuple *tuple1, const StateTuple *tuple2) const {
-      return *tuple1 == *tuple2;
-    }
-  };
-
-  // Hash function for StateTuples.
-  class StateTupleKey {
-   public:
-    size_t operator()(const StateTuple *tuple) const {
-      size_t h = tuple->filter_state.Hash();
-      for (auto it = tuple->subset.begin(); it != tuple->subset.end(); ++it) {
-        const size_t h1 = it->state_id;
-        static constexpr auto lshift = 5;
-        static constexpr auto rshift = CHAR_BIT * sizeof(size_t) - 5;
-        h ^= h << 1 ^ h1 << lshift ^ h1 >> rshift ^ it->weight.Hash();
-      }
-      return h;
-    }
-  };
+  using StateTupleEqual = internal::DeterminizeStateTupleEqual<StateTuple>;
+  using StateTupleKey = internal::DeterminizeStateTupleKey<StateTuple>;
 
   size_t table_size_;
   CompactHashBiTable<StateId, StateTuple *, StateTupleKey, StateTupleEqual,
@@ -764,6 +773,7 @@ class DeterminizeFstImpl : public DeterminizeFstImplBase<Arc> {
   using DeterminizeFstImplBase<Arc>::GetFst;
   using CacheBaseImpl<CacheState<Arc>>::GetCacheGc;
   using CacheBaseImpl<CacheState<Arc>>::GetCacheLimit;
+  using CacheBaseImpl<CacheState<Arc>>::GetCacheClock;
 
   DeterminizeFstImpl(
       const Fst<Arc> &fst,
@@ -920,6 +930,9 @@ class DeterminizeFst : public ImplToFst<internal::DeterminizeFstImplBase<A>> {
     GetMutableImpl()->InitArcIterator(s, data);
   }
 
+  // Returns statistics on the state cache of this FST.
+  CacheStats GetCacheStats() const { return GetImpl()->GetCacheStats(); }
+
  private:
   using ImplToFst<Impl>::GetImpl;
   using ImplToFst<Impl>::GetMutableImpl;
@@ -982,7 +995,7 @@ void DeterminizeFstImpl<A, G, D, F, T>::Init(const Fst<A> &fst, F *filter) {
   auto *to_filter = filter ? new ToFilter(to_fst, filter) : nullptr;
   // This recursive call terminates since it is to a (non-recursive)
   // different constructor.
-  const CacheOptions copts(GetCacheGc(), GetCacheLimit());
+  const CacheOptions copts(GetCacheGc(), GetCacheLimit(), GetCacheClock());
   const DeterminizeFstOptions<ToArc, ToCommonDivisor, ToFilter, ToStateTable>
       dopts(copts, delta_, 0, DETERMINIZE_FUNCTIONAL, false, to_filter);
   // Uses acceptor-only constructor to avoid template recursion.
@@ -1030,6 +1043,318 @@ inline void DeterminizeFst<Arc>::InitStateIterator(
 // Useful aliases when using StdArc.
 using StdDeterminizeFst = DeterminizeFst<StdArc>;
 
+namespace internal {
+
+// Table of determinization state tuples, which it owns. Find() may be called
+// concurrently as long as FindState() is not.
+template <class Arc, class FilterState>
+class DeterminizeStateTupleTable {
+ public:
+  using StateId = typename Arc::StateId;
+  using StateTuple = DeterminizeStateTuple<Arc, FilterState>;
+
+  // Looks up the state ID of a tuple, adding it if not found. Takes ownership
+  // of the tuple.
+  StateId FindState(StateTuple *tuple) {
+    const auto result = ids_.emplace(tuple, tuples_.size());
+    if (result.second) {
+      tuples_.emplace_back(tuple);
+    } else {
+      delete tuple;
+    }
+    return result.first->second;
+  }
+
+  // Looks up the state ID of a tuple, returning kNoStateId if not found.
+  StateId Find(const StateTuple &tuple) const {
+    const auto it = ids_.find(&tuple);
+    return it == ids_.end() ? kNoStateId : it->second;
+  }
+
+  const StateTuple *Tuple(StateId s) const { return tuples_[s].get(); }
+
+  StateId Size() const { return tuples_.size(); }
+
+  void Clear() {
+    ids_.clear();
+    tuples_.clear();
+  }
+
+ private:
+  std::unordered_map<const StateTuple *, StateId,
+                     DeterminizeStateTupleKey<StateTuple>,
+                     DeterminizeStateTupleEqual<StateTuple>>
+      ids_;
+  std::vector<std::unique_ptr<StateTuple>> tuples_;
+};
+
+// Determinization state table used by each worker of ParallelDeterminizer.
+// Tuples already in the shared table, which is only read while the workers
+// run, map to their state IDs; other tuples are kept in a table local to the
+// worker and map to provisional IDs less than kNoStateId, which
+// ParallelDeterminizer replaces with state IDs once the workers are done.
+template <class Arc, class FilterState>
+class ParallelDeterminizeStateTable {
+ public:
+  using StateId = typename Arc::StateId;
+  using StateTuple = DeterminizeStateTuple<Arc, FilterState>;
+  using SharedTable = DeterminizeStateTupleTable<Arc, FilterState>;
+
+  template <class B, class G>
+  struct rebind {
+    using Other = ParallelDeterminizeStateTable<B, G>;
+  };
+
+  // Uses and adds to a shared table of its own, as an ordinary state table.
+  ParallelDeterminizeStateTable()
+      : own_shared_(new SharedTable()), shared_(own_shared_.get()) {}
+
+  explicit ParallelDeterminizeStateTable(const SharedTable *shared)
+      : shared_(shared) {}
+
+  // Does not copy the tuples.
+  ParallelDeterminizeStateTable(const ParallelDeterminizeStateTable &table)
+      : own_shared_(table.own_shared_ ? new SharedTable() : nullptr),
+        shared_(own_shared_ ? own_shared_.get() : table.shared_) {}
+
+  StateId FindState(StateTuple *tuple) {
+    if (own_shared_) return own_shared_->FindState(tuple);
+    const auto s = shared_->Find(*tuple);
+    if (s != kNoStateId) {
+      delete tuple;
+      return s;
+    }
+    return ToProvisional(local_.FindState(tuple));
+  }
+
+  const StateTuple *Tuple(StateId s) const {
+    return s >= 0 ? shared_->Tuple(s) : local_.Tuple(FromProvisional(s));
+  }
+
+  // Forgets the provisional IDs.
+  void ClearLocal() { local_.Clear(); }
+
+  static StateId ToProvisional(StateId s) { return -2 - s; }
+
+  static StateId FromProvisional(StateId s) { return -2 - s; }
+
+ private:
+  std::unique_ptr<SharedTable> own_shared_;
+  const SharedTable *shared_;
+  SharedTable local_;
+
+  ParallelDeterminizeStateTable &operator=(
+      const ParallelDeterminizeStateTable &) = delete;
+};
+
+// Eager acceptor determinization expanding the states of each breadth-first
+// frontier concurrently. Each worker owns a DeterminizeFst with its own copy of
+// the input FST and filter, which looks subsets up in a shared state table;
+// new subsets found by a worker get provisional IDs. After each frontier, the
+// provisional IDs are replaced in state and arc order, which assigns exactly
+// the state IDs of sequential determinization, so the result is identical.
+template <class Arc, class CommonDivisor>
+class ParallelDeterminizer {
+ public:
+  using StateId = typename Arc::StateId;
+  using Weight = typename Arc::Weight;
+
+  using Filter = DefaultDeterminizeFilter<Arc>;
+  using StateTable =
+      ParallelDeterminizeStateTable<Arc, typename Filter::FilterState>;
+  using SharedTable = typename StateTable::SharedTable;
+  using Options = DeterminizeFstOptions<Arc, CommonDivisor, Filter, StateTable>;
+
+  // The filter and state table options must be null; the cache options are
+  // ignored.
+  ParallelDeterminizer(const Fst<Arc> &fst, const Options &opts,
+                       int num_threads)
+      : pool_(num_threads) {
+    Options nopts(opts);
+    nopts.gc_limit = 0;  // Caches only the state being expanded.
+    for (int i = 0; i < pool_.NumThreads(); ++i) {
+      fsts_.emplace_back(fst.Copy(true));
+      tables_.push_back(new StateTable(&shared_));
+      nopts.state_table = tables_.back();  // Owned by the worker FST.
+      workers_.emplace_back(
+          new DeterminizeFst<Arc>(*fsts_.back(), nullptr, nullptr, nopts));
+    }
+  }
+
+  void Determinize(MutableFst<Arc> *ofst) {
+    ofst->DeleteStates();
+    const auto &worker0 = *workers_.front();
+    ofst->SetInputSymbols(worker0.InputSymbols());
+    ofst->SetOutputSymbols(worker0.OutputSymbols());
+    const auto start = worker0.Start();
+    if (start != kNoStateId) {
+      ofst->SetStart(Resolve(0, start, ofst));
+      for (StateId lo = 0, hi; lo < ofst->NumStates(); lo = hi) {
+        hi = ofst->NumStates();
+        ExpandFrontier(lo, hi, ofst);
+      }
+    }
+    auto props = worker0.Properties(kCopyProperties, false);
+    for (const auto &worker : workers_) {
+      if (worker->Properties(kError, false)) props |= kError;
+    }
+    ofst->SetProperties(props, kCopyProperties);
+  }
+
+ private:
+  // Minimum number of states expanded by a worker.
+  static constexpr StateId kMinChunk = 64;
+
+  // Expands the frontier states [lo, hi), which must all be in the output.
+  void ExpandFrontier(StateId lo, StateId hi, MutableFst<Arc> *ofst) {
+    const auto size = hi - lo;
+    const auto nworkers = std::max<StateId>(
+        1, std::min<StateId>(workers_.size(), size / kMinChunk));
+    const auto chunk = (size + nworkers - 1) / nworkers;
+    finals_.resize(size);
+    arcs_.resize(size);
+    for (StateId i = 0; i < nworkers; ++i) {
+      const auto begin = lo + i * chunk;
+      const auto end = std::min(hi, begin + chunk);
+      if (nworkers == 1) {
+        ExpandStates(i, begin, end, lo);
+      } else {
+        pool_.Schedule([this, i, begin, end, lo] {
+          ExpandStates(i, begin, end, lo);
+        });
+      }
+    }
+    if (nworkers > 1) pool_.Wait();
+    for (StateId s = lo; s < hi; ++s) {
+      const auto worker = (s - lo) / chunk;
+      auto &arcs = arcs_[s - lo];
+      ofst->SetFinal(s, std::move(finals_[s - lo]));
+      ofst->ReserveArcs(s, arcs.size());
+      for (auto &arc : arcs) {
+        arc.nextstate = Resolve(worker, arc.nextstate, ofst);
+        ofst->AddArc(s, std::move(arc));
+      }
+      std::vector<Arc>().swap(arcs);
+    }
+    for (StateId i = 0; i < nworkers; ++i) tables_[i]->ClearLocal();
+  }
+
+  void ExpandStates(StateId worker, StateId begin, StateId end, StateId lo) {
+    const auto &fst = *workers_[worker];
+    for (auto s = begin; s < end; ++s) {
+      finals_[s - lo] = fst.Final(s);
+      auto &arcs = arcs_[s - lo];
+      arcs.reserve(fst.NumArcs(s));
+      for (ArcIterator<DeterminizeFst<Arc>> aiter(fst, s); !aiter.Done();
+           aiter.Next()) {
+        arcs.push_back(aiter.Value());
+      }
+    }
+  }
+
+  // Maps a state ID returned by the worker to an output state ID, adding the
+  // state to the output if new.
+  StateId Resolve(StateId worker, StateId s, MutableFst<Arc> *ofst) {
+    if (s >= 0) return s;
+    const auto &tuple = *tables_[worker]->Tuple(s);
+    auto t = shared_.Find(tuple);
+    if (t == kNoStateId) {
+      t = shared_.FindState(new typename StateTable::StateTuple(tuple));
+      ofst->AddState();
+    }
+    return t;
+  }
+
+  SharedTable shared_;
+  std::vector<std::unique_ptr<const Fst<Arc>>> fsts_;
+  std::vector<StateTable *> tables_;
+  std::vector<std::unique_ptr<DeterminizeFst<Arc>>> workers_;
+  std::vector<Weight> finals_;
+  std::vector<std::vector<Arc>> arcs_;
+  ThreadPool pool_;
+};
+
+// Eager transducer determinization: the Gallic acceptor is determinized by
+// ParallelDeterminizer and then mapped back as in DeterminizeFstImpl::Init,
+// which gives the same state IDs as sequential determinization.
+template <class Arc, GallicType G>
+void ParallelDeterminizeTransducer(const Fst<Arc> &ifst, MutableFst<Arc> *ofst,
+                                   const DeterminizeFstOptions<Arc> &opts,
+                                   int num_threads) {
+  using Weight = typename Arc::Weight;
+  using Impl = DeterminizeFstImpl<Arc, G, DefaultCommonDivisor<Weight>,
+                                  DefaultDeterminizeFilter<Arc>,
+                                  DefaultDeterminizeStateTable<
+                                      Arc, CharFilterState>>;
+  using ToArc = typename Impl::ToArc;
+  using ToCommonDivisor = typename Impl::ToCommonDivisor;
+  const typename Impl::ToFst to_fst(ifst, typename Impl::ToMapper());
+  const typename ParallelDeterminizer<ToArc, ToCommonDivisor>::Options dopts(
+      opts.delta);
+  VectorFst<ToArc> det_fsa;
+  ParallelDeterminizer<ToArc, ToCommonDivisor>(to_fst, dopts, num_threads)
+      .Determinize(&det_fsa);
+  const FactorWeightOptions<ToArc> fopts(
+      CacheOptions(true, 0), opts.delta, kFactorFinalWeights,
+      opts.subsequential_label, opts.subsequential_label,
+      opts.increment_subsequential_label, opts.increment_subsequential_label);
+  const FactorWeightFst<ToArc, typename Impl::FactorIterator> factored_fst(
+      det_fsa, fopts);
+  *ofst = typename Impl::FromFst(
+      factored_fst, typename Impl::FromMapper(opts.subsequential_label));
+  // Sets the properties DeterminizeFst would have.
+  auto props = DeterminizeProperties(
+      ifst.Properties(kFstProperties, false), opts.subsequential_label != 0,
+      opts.type == DETERMINIZE_NONFUNCTIONAL
+          ? opts.increment_subsequential_label
+          : true);
+  if (ifst.Properties(kError, false) || ofst->Properties(kError, false)) {
+    props |= kError;
+  }
+  ofst->SetProperties(props, kCopyProperties);
+  ofst->SetInputSymbols(ifst.InputSymbols());
+  ofst->SetOutputSymbols(ifst.OutputSymbols());
+}
+
+// Eager determinization on num_threads threads, giving the same result as
+// copying DeterminizeFst with the default filter and state table.
+template <class Arc>
+void ParallelDeterminize(const Fst<Arc> &ifst, MutableFst<Arc> *ofst,
+                         const DeterminizeFstOptions<Arc> &opts,
+                         int num_threads) {
+  using Weight = typename Arc::Weight;
+  if (ifst.Properties(kAcceptor, true)) {
+    using Determinizer =
+        ParallelDeterminizer<Arc, DefaultCommonDivisor<Weight>>;
+    typename Determinizer::Options nopts(opts.delta, opts.subsequential_label,
+                                         opts.type,
+                                         opts.increment_subsequential_label);
+    Determinizer(ifst, nopts, num_threads).Determinize(ofst);
+    return;
+  }
+  switch (opts.type) {
+    case DETERMINIZE_FUNCTIONAL:
+      ParallelDeterminizeTransducer<Arc, GALLIC_RESTRICT>(ifst, ofst, opts,
+                                                          num_threads);
+      return;
+    case DETERMINIZE_NONFUNCTIONAL:
+      ParallelDeterminizeTransducer<Arc, GALLIC>(ifst, ofst, opts,
+                                                 num_threads);
+      return;
+    case DETERMINIZE_DISAMBIGUATE:
+      if constexpr (IsPath<Weight>::value) {
+        ParallelDeterminizeTransducer<Arc, GALLIC_MIN>(ifst, ofst, opts,
+                                                       num_threads);
+        return;
+      }
+      break;
+  }
+  // Reports the error as DeterminizeFst does.
+  *ofst = DeterminizeFst<Arc>(ifst, opts);
+}
+
+}  // namespace internal
+
 template <class Arc>
 struct DeterminizeOptions {
   using Label = typename Arc::Label;
@@ -1044,19 +1369,23 @@ struct DeterminizeOptions {
   bool increment_subsequential_label;  // When creating several subsequential
                                        // arcs at a given state, make their
                                        // label distinct by incrementation?
+  int num_threads;  // If greater than one, subsets are constructed in
+                    // parallel, except when pruning an acceptor.
 
   explicit DeterminizeOptions(float delta = kDelta,
                               Weight weight_threshold = Weight::Zero(),
                               StateId state_threshold = kNoStateId,
                               Label subsequential_label = 0,
                               DeterminizeType type = DETERMINIZE_FUNCTIONAL,
-                              bool increment_subsequential_label = false)
+                              bool increment_subsequential_label = false,
+                              int num_threads = 1)
       : delta(delta),
         weight_threshold(std::move(weight_threshold)),
         state_threshold(state_threshold),
         subsequential_label(subsequential_label),
         type(type),
-        increment_subsequential_label(increment_subsequential_label) {}
+        increment_subsequential_label(increment_subsequential_label),
+        num_threads(num_threads) {}
 };
 
 // Determinizes a weighted transducer. This version writes the
@@ -1074,6 +1403,10 @@ struct DeterminizeOptions {
 //   Non-determinizable: does not terminate
 //
 // The determinizable automata include all unweighted and all acyclic input.
+//
+// With opts.num_threads > 1, the subsets of each breadth-first frontier are
+// constructed on that many threads, giving the same result. Pruned acceptor
+// determinization, which expands only the states it keeps, stays sequential.
 template <class Arc>
 void Determinize(
     const Fst<Arc> &ifst, MutableFst<Arc> *ofst,
@@ -1097,9 +1430,15 @@ void Determinize(
           &odistance);
       Prune(dfst, ofst, popts);
     } else {
-      *ofst = DeterminizeFst<Arc>(ifst, nopts);
+      if (opts.num_threads > 1) {
+        internal::ParallelDeterminize(ifst, ofst, nopts, opts.num_threads);
+      } else {
+        *ofst = DeterminizeFst<Arc>(ifst, nopts);
+      }
       Prune(ofst, opts.weight_threshold, opts.state_threshold);
     }
+  } else if (opts.num_threads > 1) {
+    internal::ParallelDeterminize(ifst, ofst, nopts, opts.num_threads);
   } else {
     *ofst = DeterminizeFst<Arc>(ifst, nopts);
   }
@@ -35,10 +35,15 @@
 // behavior when its Copy(true) method is invoked, where consistent means
 // the graph structure, graph properties and state numbering and do not change.
 // VectorFst and CompactFst, for example, are both well-behaved in this regard.
+//
+// WriteFrozenFst and ReadFrozenFst use this class to provide a "frozen" FST
+// file that loads without parsing: the state and arc arrays are memory-mapped
+// read-only, and states are only copied when they are first modified.
 
 #ifndef FST_EDIT_FST_H_
 #define FST_EDIT_FST_H_
 
+#include <fstream>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -47,6 +52,7 @@
 #include <fst/log.h>
 
 #include <fst/cache.h>
+#include <fst/const-fst.h>
 
 namespace fst {
 namespace internal {
@@ -716,6 +722,37 @@ class EditFst : public ImplToMutableFst<
   using ImplToFst<Impl, MutableFst<Arc>>::SetImpl;
 };
 
+// Writes an FST in the frozen layout: an unedited EditFst wrapping an aligned
+// ConstFst. Returns false on error.
+template <class Arc>
+bool WriteFrozenFst(const Fst<Arc> &fst, const std::string &source) {
+  const EditFst<Arc> efst{ConstFst<Arc>(fst)};
+  std::ofstream strm(source, std::ios_base::out | std::ios_base::binary);
+  if (!strm) {
+    LOG(ERROR) << "WriteFrozenFst: Can't open file: " << source;
+    return false;
+  }
+  FstWriteOptions opts(source);
+  opts.align = true;
+  return efst.Write(strm, opts);
+}
+
+// Reads an FST written by WriteFrozenFst, memory-mapping the wrapped ConstFst
+// rather than parsing it. The result is mutable; edited states are copied into
+// an internal VectorFst, leaving the mapping untouched. Returns nullptr on
+// error.
+template <class Arc>
+EditFst<Arc> *ReadFrozenFst(const std::string &source) {
+  std::ifstream strm(source, std::ios_base::in | std::ios_base::binary);
+  if (!strm) {
+    LOG(ERROR) << "ReadFrozenFst: Can't open file: " << source;
+    return nullptr;
+  }
+  FstReadOptions opts(source);
+  opts.mode = FstReadOptions::MAP;
+  return EditFst<Arc>::Read(strm, opts);
+}
+
 }  // namespace fst
 
 #endif  // FST_EDIT_FST_H_
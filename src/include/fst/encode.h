@@ -20,10 +20,11 @@
 #ifndef FST_ENCODE_H_
 #define FST_ENCODE_H_
 
+#include <climits>
 #include <iostream>
 #include <memory>
 #include <string>
-#include <unordered_map>
+#include <type_traits>
 #include <utility>
 #include <vector>
 
@@ -31,9 +32,9 @@
 #include <fst/log.h>
 #include <fst/arc-map.h>
 #include <fstream>
+#include <fst/mapped-file.h>
 #include <fst/properties.h>
 #include <fst/rmfinalepsilon.h>
-#include <unordered_map>
 
 namespace fst {
 
@@ -49,6 +50,8 @@ namespace internal {
 // tables, for internal use only.
 static constexpr uint8 kEncodeHasISymbols = 0x04;
 static constexpr uint8 kEncodeHasOSymbols = 0x08;
+// Bit set in the header of an encode table written in the aligned format.
+static constexpr uint8 kEncodeAligned = 0x10;
 
 // Identifies stream data as an encode table (and its endianity).
 static const int32 kEncodeMagicNumber = 2128178506;
@@ -96,6 +99,12 @@ namespace internal {
 // decoding of label/weight triples used for encoding and decoding of FSTs. The
 // EncodeTable is bidirectional, i.e, it stores both the Triple of encode labels
 // and weights to a unique label, and the reverse.
+//
+// Triples are stored contiguously, the one with label i at position i - 1, and
+// are indexed by an open-addressing hash table of labels. When the triples are
+// trivially copyable, the table can be written in an aligned format holding
+// both arrays verbatim; reading that format maps (or reads) them as is, and
+// they are only copied if the table is later extended.
 template <class Arc>
 class EncodeTable {
  public:
@@ -115,15 +124,14 @@ class EncodeTable {
           olabel(flags & kEncodeLabels ? arc.olabel : 0),
           weight(flags & kEncodeWeights ? arc.weight : Weight::One()) {}
 
-    static std::unique_ptr<Triple> Read(std::istream &strm) {
-      auto triple = fst::make_unique<Triple>();
-      ReadType(strm, &triple->ilabel);
-      ReadType(strm, &triple->olabel);
-      ReadType(strm, &triple->weight);
+    static Triple Read(std::istream &strm) {
+      Triple triple;
+      ReadType(strm, &triple.ilabel);
+      ReadType(strm, &triple.olabel);
+      ReadType(strm, &triple.weight);
       return triple;
     }
 
-    // Exploited below for TripleEqual functor.
     bool operator==(const Triple &other) const {
       return (ilabel == other.ilabel && olabel == other.olabel &&
               weight == other.weight);
@@ -134,25 +142,20 @@ class EncodeTable {
     Weight weight;
   };
 
-  // Equality functor for two Triple pointers.
-  struct TripleEqual {
-    bool operator()(const Triple *x, const Triple *y) const { return *x == *y; }
-  };
-
-  // Hash functor for one Triple pointer.
+  // Hash functor for a Triple.
   class TripleHash {
    public:
     explicit TripleHash(uint8 flags) : flags_(flags) {}
 
-    size_t operator()(const Triple *triple) const {
-      size_t hash = triple->ilabel;
+    size_t operator()(const Triple &triple) const {
+      size_t hash = triple.ilabel;
       static constexpr int lshift = 5;
       static constexpr int rshift = CHAR_BIT * sizeof(size_t) - 5;
       if (flags_ & kEncodeLabels) {
-        hash = hash << lshift ^ hash >> rshift ^ triple->olabel;
+        hash = hash << lshift ^ hash >> rshift ^ triple.olabel;
       }
       if (flags_ & kEncodeWeights) {
-        hash = hash << lshift ^ hash >> rshift ^ triple->weight.Hash();
+        hash = hash << lshift ^ hash >> rshift ^ triple.weight.Hash();
       }
       return hash;
     }
@@ -161,8 +164,9 @@ class EncodeTable {
     uint8 flags_;
   };
 
-  explicit EncodeTable(uint8 flags)
-      : flags_(flags), triple2label_(1024, TripleHash(flags)) {}
+  explicit EncodeTable(uint8 flags) : flags_(flags), hash_(flags) {
+    Rehash(kMinBuckets);
+  }
 
   // Given an arc, encodes either input/output labels or input/costs or both.
   Label Encode(const Arc &arc) {
@@ -170,26 +174,27 @@ class EncodeTable {
     // a clash with a true epsilon arc; to avoid this we hallucinate kNoLabel
     // labels instead.
     if (arc.nextstate == kNoStateId && (flags_ & kEncodeWeights)) {
-      return Encode(fst::make_unique<Triple>(kNoLabel, kNoLabel, arc.weight));
+      return Encode(Triple(kNoLabel, kNoLabel, arc.weight));
     } else {
-      return Encode(fst::make_unique<Triple>(arc, flags_));
+      return Encode(Triple(arc, flags_));
     }
   }
 
   // Given an encoded arc label, decodes back to input/output labels and costs.
+  // The result is invalidated by the next call to Encode().
   const Triple *Decode(Label label) const {
-    if (label < 1 || label > triples_.size()) {
+    if (label < 1 || label > size_) {
       LOG(ERROR) << "EncodeTable::Decode: Unknown decode label: " << label;
       return nullptr;
     }
-    return triples_[label - 1].get();
+    return Triples() + label - 1;
   }
 
-  size_t Size() const { return triples_.size(); }
+  size_t Size() const { return size_; }
 
-  static EncodeTable *Read(std::istream &strm, const std::string &source);
+  static EncodeTable *Read(std::istream &strm, const FstReadOptions &opts);
 
-  bool Write(std::ostream &strm, const std::string &source) const;
+  bool Write(std::ostream &strm, const FstWriteOptions &opts) const;
 
   // This is masked to hide internal-only isymbol and osymbol bits.
 
@@ -220,17 +225,85 @@ class EncodeTable {
   }
 
  private:
-  Label Encode(std::unique_ptr<Triple> triple) {
-    auto insert_result =
-        triple2label_.emplace(triple.get(), triples_.size() + 1);
-    if (insert_result.second) triples_.push_back(std::move(triple));
-    return insert_result.first->second;
+  // Whether triples can be written and read as raw memory.
+  static constexpr bool kFlatTriples = std::is_trivially_copyable_v<Triple>;
+
+  // Initial number of hash buckets; there are always at least twice as many
+  // buckets as triples.
+  static constexpr size_t kMinBuckets = 1024;
+
+  const Triple *Triples() const {
+    return triples_region_
+               ? static_cast<const Triple *>(triples_region_->data())
+               : triples_.data();
+  }
+
+  const Label *Buckets() const {
+    return buckets_region_
+               ? static_cast<const Label *>(buckets_region_->data())
+               : buckets_.data();
   }
 
+  // Fibonacci hashing spreads the low-entropy hashes of small labels and
+  // round weights over the table.
+  size_t Bucket(const Triple &triple) const {
+    return (static_cast<uint64>(hash_(triple)) * 0x9E3779B97F4A7C15ULL) >>
+           (64 - bucket_bits_);
+  }
+
+  Label Encode(const Triple &triple) {
+    const auto *triples = Triples();
+    const auto *buckets = Buckets();
+    auto i = Bucket(triple);
+    for (; buckets[i] != 0; i = (i + 1) & (nbuckets_ - 1)) {
+      if (triples[buckets[i] - 1] == triple) return buckets[i];
+    }
+    MakeMutable();
+    triples_.push_back(triple);
+    const Label label = ++size_;
+    buckets_[i] = label;
+    if (2 * size_ > nbuckets_) Rehash(2 * nbuckets_);
+    return label;
+  }
+
+  // Copies mapped triples and buckets so that they can be extended.
+  void MakeMutable() {
+    if (!triples_region_) return;
+    triples_.assign(Triples(), Triples() + size_);
+    buckets_.assign(Buckets(), Buckets() + nbuckets_);
+    triples_region_.reset();
+    buckets_region_.reset();
+  }
+
+  // Rebuilds the hash table with the given power-of-two number of buckets.
+  void Rehash(size_t nbuckets) {
+    SetNumBuckets(nbuckets);
+    buckets_.assign(nbuckets, 0);
+    for (Label label = 1; label <= size_; ++label) {
+      auto i = Bucket(triples_[label - 1]);
+      while (buckets_[i] != 0) i = (i + 1) & (nbuckets_ - 1);
+      buckets_[i] = label;
+    }
+  }
+
+  void SetNumBuckets(size_t nbuckets) {
+    nbuckets_ = nbuckets;
+    for (bucket_bits_ = 0; (size_t{1} << bucket_bits_) < nbuckets;
+         ++bucket_bits_) {
+    }
+  }
+
+  bool ReadAligned(std::istream &strm, const FstReadOptions &opts);
+
   uint8 flags_;
-  std::vector<std::unique_ptr<Triple>> triples_;
-  std::unordered_map<const Triple *, Label, TripleHash, TripleEqual>
-      triple2label_;
+  TripleHash hash_;
+  std::vector<Triple> triples_;
+  std::vector<Label> buckets_;  // Labels of triples; 0 for empty buckets.
+  std::unique_ptr<MappedFile> triples_region_;  // If read in aligned format.
+  std::unique_ptr<MappedFile> buckets_region_;  // If read in aligned format.
+  Label size_ = 0;                              // Number of triples.
+  size_t nbuckets_ = 0;                         // A power of two.
+  int bucket_bits_ = 0;                         // Log2 of nbuckets_.
   std::unique_ptr<SymbolTable> isymbols_;
   std::unique_ptr<SymbolTable> osymbols_;
 
@@ -240,47 +313,115 @@ class EncodeTable {
 
 template <class Arc>
 EncodeTable<Arc> *EncodeTable<Arc>::Read(std::istream &strm,
-                                         const std::string &source) {
+                                         const FstReadOptions &opts) {
   EncodeTableHeader hdr;
-  if (!hdr.Read(strm, source)) return nullptr;
+  if (!hdr.Read(strm, opts.source)) return nullptr;
   const auto flags = hdr.Flags();
   const auto size = hdr.Size();
-  auto table = fst::make_unique<EncodeTable>(flags);
-  for (int64 i = 0; i < size; ++i) {
-    table->triples_.emplace_back(std::move(Triple::Read(strm)));
-    table->triple2label_[table->triples_.back().get()] = table->triples_.size();
+  auto table = fst::make_unique<EncodeTable>(flags & ~kEncodeAligned);
+  table->size_ = size;
+  if (flags & kEncodeAligned) {
+    if (!table->ReadAligned(strm, opts)) return nullptr;
+  } else {
+    table->triples_.reserve(size);
+    for (int64 i = 0; i < size; ++i) {
+      table->triples_.push_back(Triple::Read(strm));
+    }
+    if (!strm) {
+      LOG(ERROR) << "EncodeTable::Read: Read failed: " << opts.source;
+      return nullptr;
+    }
+    auto nbuckets = kMinBuckets;
+    while (nbuckets < 2 * size) nbuckets *= 2;
+    table->Rehash(nbuckets);
   }
   if (flags & kEncodeHasISymbols) {
-    table->isymbols_.reset(SymbolTable::Read(strm, source));
+    table->isymbols_.reset(SymbolTable::Read(strm, opts.source));
   }
   if (flags & kEncodeHasOSymbols) {
-    table->osymbols_.reset(SymbolTable::Read(strm, source));
+    table->osymbols_.reset(SymbolTable::Read(strm, opts.source));
   }
   if (!strm) {
-    LOG(ERROR) << "EncodeTable::Read: Read failed: " << source;
+    LOG(ERROR) << "EncodeTable::Read: Read failed: " << opts.source;
     return nullptr;
   }
   return table.release();
 }
 
+template <class Arc>
+bool EncodeTable<Arc>::ReadAligned(std::istream &strm,
+                                   const FstReadOptions &opts) {
+  if (!kFlatTriples) {
+    LOG(ERROR) << "EncodeTable::Read: Aligned format not supported for arc "
+               << "type " << Arc::Type() << ": " << opts.source;
+    return false;
+  }
+  const bool memorymap = opts.mode == FstReadOptions::MAP;
+  if (!AlignInput(strm)) {
+    LOG(ERROR) << "EncodeTable::Read: Alignment failed: " << opts.source;
+    return false;
+  }
+  triples_region_.reset(
+      MappedFile::Map(&strm, memorymap, opts.source, size_ * sizeof(Triple)));
+  int64 nbuckets = 0;
+  ReadType(strm, &nbuckets);
+  if (!strm || !triples_region_ || nbuckets < 2 * size_ ||
+      (nbuckets & (nbuckets - 1)) != 0) {
+    LOG(ERROR) << "EncodeTable::Read: Read failed: " << opts.source;
+    return false;
+  }
+  if (!AlignInput(strm)) {
+    LOG(ERROR) << "EncodeTable::Read: Alignment failed: " << opts.source;
+    return false;
+  }
+  buckets_region_.reset(
+      MappedFile::Map(&strm, memorymap, opts.source, nbuckets * sizeof(Label)));
+  if (!strm || !buckets_region_) {
+    LOG(ERROR) << "EncodeTable::Read: Read failed: " << opts.source;
+    return false;
+  }
+  buckets_.clear();
+  SetNumBuckets(nbuckets);
+  return true;
+}
+
 template <class Arc>
 bool EncodeTable<Arc>::Write(std::ostream &strm,
-                             const std::string &source) const {
+                             const FstWriteOptions &opts) const {
+  const bool aligned = kFlatTriples && opts.align;
   EncodeTableHeader hdr;
   hdr.SetArcType(Arc::Type());
-  hdr.SetFlags(flags_);  // Real flags, not masked ones.
+  // Real flags, not masked ones.
+  hdr.SetFlags(aligned ? flags_ | kEncodeAligned : flags_);
   hdr.SetSize(Size());
-  if (!hdr.Write(strm, source)) return false;
-  for (const auto &triple : triples_) {
-    WriteType(strm, triple->ilabel);
-    WriteType(strm, triple->olabel);
-    WriteType(strm, triple->weight);
+  if (!hdr.Write(strm, opts.source)) return false;
+  if (aligned) {
+    if (!AlignOutput(strm)) {
+      LOG(ERROR) << "EncodeTable::Write: Alignment failed: " << opts.source;
+      return false;
+    }
+    strm.write(reinterpret_cast<const char *>(Triples()),
+               size_ * sizeof(Triple));
+    WriteType(strm, static_cast<int64>(nbuckets_));
+    if (!AlignOutput(strm)) {
+      LOG(ERROR) << "EncodeTable::Write: Alignment failed: " << opts.source;
+      return false;
+    }
+    strm.write(reinterpret_cast<const char *>(Buckets()),
+               nbuckets_ * sizeof(Label));
+  } else {
+    const auto *triples = Triples();
+    for (Label i = 0; i < size_; ++i) {
+      WriteType(strm, triples[i].ilabel);
+      WriteType(strm, triples[i].olabel);
+      WriteType(strm, triples[i].weight);
+    }
   }
   if (flags_ & kEncodeHasISymbols) isymbols_->Write(strm);
   if (flags_ & kEncodeHasOSymbols) osymbols_->Write(strm);
   strm.flush();
   if (!strm) {
-    LOG(ERROR) << "EncodeTable::Write: Write failed: " << source;
+    LOG(ERROR) << "EncodeTable::Write: Write failed: " << opts.source;
     return false;
   }
   return true;
@@ -365,12 +506,19 @@ class EncodeMapper {
 
   EncodeType Type() const { return type_; }
 
-  static EncodeMapper *Read(std::istream &strm, const std::string &source,
+  // Tables written in the aligned format are memory-mapped if opts.mode is
+  // FstReadOptions::MAP and the stream is a file.
+  static EncodeMapper *Read(std::istream &strm, const FstReadOptions &opts,
                             EncodeType type = ENCODE) {
-    auto *table = internal::EncodeTable<Arc>::Read(strm, source);
+    auto *table = internal::EncodeTable<Arc>::Read(strm, opts);
     return table ? new EncodeMapper(table->Flags(), type, table) : nullptr;
   }
 
+  static EncodeMapper *Read(std::istream &strm, const std::string &source,
+                            EncodeType type = ENCODE) {
+    return Read(strm, FstReadOptions(source), type);
+  }
+
   static EncodeMapper *Read(const std::string &source,
                             EncodeType type = ENCODE) {
     std::ifstream strm(source, std::ios_base::in | std::ios_base::binary);
@@ -381,8 +529,14 @@ class EncodeMapper {
     return Read(strm, source, type);
   }
 
+  // If opts.align is set, the table is written in the aligned format, which
+  // can be memory-mapped when read.
+  bool Write(std::ostream &strm, const FstWriteOptions &opts) const {
+    return table_->Write(strm, opts);
+  }
+
   bool Write(std::ostream &strm, const std::string &source) const {
-    return table_->Write(strm, source);
+    return Write(strm, FstWriteOptions(source));
   }
 
   bool Write(const std::string &source) const {
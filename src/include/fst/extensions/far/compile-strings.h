@@ -22,14 +22,37 @@
 
 #include <fstream>
 #include <istream>
+#include <memory>
 #include <string>
 #include <vector>
 
 #include <fst/extensions/far/far.h>
+#include <fst/extensions/far/parallel.h>
 #include <fstream>
 #include <fst/string.h>
 
 namespace fst {
+namespace internal {
+
+// Compiles content into a new FST of type FST (VectorFst or CompactStringFst),
+// with symbol tables syms unless null; returns null on error.
+template <class FST>
+FST *CompileString(const StringCompiler<typename FST::Arc> &compiler,
+                   const std::string &content, const SymbolTable *syms) {
+  std::unique_ptr<FST> fst;
+  if (syms) {
+    VectorFst<typename FST::Arc> tmp;
+    tmp.SetInputSymbols(syms);
+    tmp.SetOutputSymbols(syms);
+    fst = std::make_unique<FST>(tmp);
+  } else {
+    fst = std::make_unique<FST>();
+  }
+  if (!compiler(content, fst.get())) return nullptr;
+  return fst.release();
+}
+
+}  // namespace internal
 
 // Constructs a reader that provides FSTs from a file (stream) either on a
 // line-by-line basis or on a per-stream basis. Note that the freshly
@@ -86,35 +109,19 @@ class StringReader {
   }
 
   VectorFst<Arc> *GetVectorFst(bool keep_symbols = false) {
-    std::unique_ptr<VectorFst<Arc>> fst(new VectorFst<Arc>());
-    if (keep_symbols) {
-      fst->SetInputSymbols(symbols_);
-      fst->SetOutputSymbols(symbols_);
-    }
-    if (compiler_(content_, fst.get())) {
-      return fst.release();
-    } else {
-      return nullptr;
-    }
+    return internal::CompileString<VectorFst<Arc>>(
+        compiler_, content_, keep_symbols ? symbols_ : nullptr);
   }
 
   CompactStringFst<Arc> *GetCompactFst(bool keep_symbols = false) {
-    std::unique_ptr<CompactStringFst<Arc>> fst;
-    if (keep_symbols) {
-      VectorFst<Arc> tmp;
-      tmp.SetInputSymbols(symbols_);
-      tmp.SetOutputSymbols(symbols_);
-      fst.reset(new CompactStringFst<Arc>(tmp));
-    } else {
-      fst.reset(new CompactStringFst<Arc>());
-    }
-    if (compiler_(content_, fst.get())) {
-      return fst.release();
-    } else {
-      return nullptr;
-    }
+    return internal::CompileString<CompactStringFst<Arc>>(
+        compiler_, content_, keep_symbols ? symbols_ : nullptr);
   }
 
+  // Returns the uncompiled current input, e.g., to compile it on another
+  // thread.
+  const std::string &GetContent() const { return content_; }
+
  private:
   size_t nline_;
   std::istream &istrm_;
@@ -134,6 +141,9 @@ class StringReader {
 // number, or zero if the file is not seekable.
 int KeySize(const char *source);
 
+// Compiles the strings in the input files into an archive of string FSTs.
+// Strings are compiled using up to num_threads threads, while being read on
+// another thread, and are written in input order.
 template <class Arc>
 void FarCompileStrings(const std::vector<std::string> &in_sources,
                        const std::string &out_source,
@@ -143,7 +153,12 @@ void FarCompileStrings(const std::vector<std::string> &in_sources,
                        const std::string &unknown_symbol, bool keep_symbols,
                        bool initial_symbols, bool allow_negative_labels,
                        const std::string &key_prefix,
-                       const std::string &key_suffix) {
+                       const std::string &key_suffix, int num_threads = 1) {
+  struct Entry {
+    int n;           // One-based position in the input.
+    bool keep_syms;  // Whether to keep symbol tables in the FST.
+    std::string content;
+  };
   bool compact;
   if (fst_type.empty() || (fst_type == "vector")) {
     compact = false;
@@ -175,6 +190,20 @@ void FarCompileStrings(const std::vector<std::string> &in_sources,
   std::unique_ptr<FarWriter<Arc>> far_writer(
       FarWriter<Arc>::Create(out_source, far_type));
   if (!far_writer) return;
+  const StringCompiler<Arc> compiler(token_type, syms.get(), unknown_label,
+                                     allow_negative_labels);
+  const auto compile = [&](const Entry &entry) {
+    const auto *fst_syms = entry.keep_syms ? syms.get() : nullptr;
+    std::unique_ptr<const Fst<Arc>> fst;
+    if (compact) {
+      fst.reset(internal::CompileString<CompactStringFst<Arc>>(
+          compiler, entry.content, fst_syms));
+    } else {
+      fst.reset(internal::CompileString<VectorFst<Arc>>(
+          compiler, entry.content, fst_syms));
+    }
+    return fst;
+  };
   int n = 0;
   for (const auto &in_source : in_sources) {
     // Don't try to call KeySize("").
@@ -202,32 +231,33 @@ void FarCompileStrings(const std::vector<std::string> &in_sources,
     }
     std::istream &istrm = fstrm.is_open() ? fstrm : std::cin;
     bool keep_syms = keep_symbols;
-    for (StringReader<Arc> reader(
-             istrm, in_source.empty() ? "stdin" : in_source, entry_type,
-             token_type, allow_negative_labels, syms.get(), unknown_label);
-         !reader.Done(); reader.Next()) {
-      ++n;
-      std::unique_ptr<const Fst<Arc>> fst;
-      if (compact) {
-        fst.reset(reader.GetCompactFst(keep_syms));
-      } else {
-        fst.reset(reader.GetVectorFst(keep_syms));
-      }
+    StringReader<Arc> reader(istrm, in_source.empty() ? "stdin" : in_source,
+                             entry_type, token_type, allow_negative_labels,
+                             syms.get(), unknown_label);
+    const auto read = [&](Entry *entry) {
+      if (reader.Done()) return false;
+      entry->n = ++n;
+      entry->keep_syms = keep_syms;
+      entry->content = reader.GetContent();
       if (initial_symbols) keep_syms = false;
+      reader.Next();
+      return true;
+    };
+    const auto write = [&](Entry &entry, std::unique_ptr<const Fst<Arc>> &fst) {
       if (!fst) {
         FSTERROR()
-            << "FarCompileStrings: Compiling string number " << n << " in file "
-            << in_source << " failed with token_type = " << token_type
-            << " and entry_type = "
+            << "FarCompileStrings: Compiling string number " << entry.n
+            << " in file " << in_source << " failed with token_type = "
+            << token_type << " and entry_type = "
             << (entry_type == FarEntryType::LINE
                     ? "line"
                     : (entry_type == FarEntryType::FILE ? "file" : "unknown"));
-        return;
+        return false;
       }
       std::ostringstream keybuf;
       keybuf.width(key_size);
       keybuf.fill('0');
-      keybuf << n;
+      keybuf << entry.n;
       std::string key;
       if (generate_keys > 0) {
         key = keybuf.str();
@@ -242,7 +272,9 @@ void FarCompileStrings(const std::vector<std::string> &in_sources,
         delete[] source;
       }
       far_writer->Add(key_prefix + key + key_suffix, *fst);
-    }
+      return true;
+    };
+    if (!FarParallelMap<Entry>(read, compile, write, num_threads)) return;
     if (generate_keys == 0) n = 0;
   }
 }
@@ -20,43 +20,73 @@
 
 #include <fst/extensions/far/far.h>
 #include <fst/extensions/far/getters.h>
+#include <fst/extensions/far/parallel.h>
 #include <fst/register.h>
 
 namespace fst {
 
+// Converts the FSTs in the input FAR to the given FST type, if not empty, and
+// writes them, in the same order, to the output FAR. FSTs are converted using
+// up to num_threads threads. If num_shards or max_shard_size is positive, the
+// output is written as an STTable archive sharded by key hash or by key range
+// respectively (see STTableShardsFarWriter); converting such an archive
+// without sharding merges its shards.
 template <class Arc>
 void FarConvert(const std::string &in_source, const std::string &out_source,
-                const std::string &fst_type, const FarType &far_type) {
+                const std::string &fst_type, const FarType &far_type,
+                int num_threads = 1, int32 num_shards = 0,
+                int64 max_shard_size = 0) {
   std::unique_ptr<FarReader<Arc>> reader(FarReader<Arc>::Open(in_source));
   if (!reader) {
     FSTERROR() << "FarConvert: Cannot open input FAR: " << in_source;
     return;
   }
 
-  std::unique_ptr<FarWriter<Arc>> writer(
-      FarWriter<Arc>::Create(out_source, far_type));
+  std::unique_ptr<FarWriter<Arc>> writer;
+  if (num_shards > 0 || max_shard_size > 0) {
+    if (far_type != FarType::STTABLE) {
+      FSTERROR() << "FarConvert: Only STTable archives can be sharded";
+      return;
+    }
+    const FarShardOptions opts(max_shard_size > 0 ? STTableShardType::RANGE
+                                                  : STTableShardType::HASH,
+                               num_shards, max_shard_size);
+    writer.reset(STTableShardsFarWriter<Arc>::Create(out_source, opts));
+  } else {
+    writer.reset(FarWriter<Arc>::Create(out_source, far_type));
+  }
   if (!writer) {
     FSTERROR() << "FarConvert: Cannot open output FAR as type "
                << GetFarTypeString(far_type) << " : " << out_source;
     return;
   }
 
-  for (; !reader->Done(); reader->Next()) {
-    const std::string key = reader->GetKey();
-    const Fst<Arc> *const fst = reader->GetFst();
-
-    if (fst_type.empty() || fst->Type() == fst_type) {
-      writer->Add(key, *fst);
+  const auto read = [&reader](FarEntry<Arc> *entry) {
+    return ReadFarEntry(reader.get(), entry);
+  };
+  // Returns the converted FST, or null if no conversion is needed.
+  const auto convert = [&fst_type](const FarEntry<Arc> &entry) {
+    std::unique_ptr<Fst<Arc>> converted_fst;
+    if (!fst_type.empty() && entry.fst->Type() != fst_type) {
+      converted_fst.reset(Convert(*entry.fst, fst_type));
+    }
+    return converted_fst;
+  };
+  const auto write = [&](FarEntry<Arc> &entry,
+                         std::unique_ptr<Fst<Arc>> &converted_fst) {
+    if (fst_type.empty() || entry.fst->Type() == fst_type) {
+      writer->Add(entry.key, *entry.fst);
+    } else if (!converted_fst) {
+      FSTERROR() << "FarConvert: Cannot convert FST with key " << entry.key
+                 << " to " << fst_type;
+      return false;
     } else {
-      auto converted_fst = fst::WrapUnique(Convert(*fst, fst_type));
-      if (!converted_fst) {
-        FSTERROR() << "FarConvert: Cannot convert FST with key " << key
-                   << " to " << fst_type;
-        return;
-      }
-
-      writer->Add(key, *converted_fst);
+      writer->Add(entry.key, *converted_fst);
     }
+    return true;
+  };
+  if (!FarParallelMap<FarEntry<Arc>>(read, convert, write, num_threads)) {
+    return;
   }
 
   if (reader->Error()) {
@@ -22,15 +22,20 @@
 #include <string>
 
 #include <fst/extensions/far/far.h>
+#include <fst/extensions/far/parallel.h>
 #include <fst/equal.h>
 
 namespace fst {
 
+// Compares the FSTs with the same keys in the two archives, optionally
+// restricted to the keys from begin_key to end_key, using up to num_threads
+// threads.
 template <class Arc>
 bool FarEqual(const std::string &source1, const std::string &source2,
               float delta = kDelta,
               const std::string &begin_key = std::string(),
-              const std::string &end_key = std::string()) {
+              const std::string &end_key = std::string(),
+              int num_threads = 1) {
   std::unique_ptr<FarReader<Arc>> reader1(FarReader<Arc>::Open(source1));
   if (!reader1) {
     LOG(ERROR) << "FarEqual: Could not open FAR file " << source1;
@@ -53,22 +58,40 @@ bool FarEqual(const std::string &source1, const std::string &source2,
       return ret;
     }
   }
-  for (; !reader1->Done() && !reader2->Done();
-       reader1->Next(), reader2->Next()) {
-    const auto &key1 = reader1->GetKey();
-    const auto &key2 = reader2->GetKey();
-    if (!end_key.empty() && end_key < key1 && end_key < key2) {
-      return true;
+  struct Entry {
+    FarEntry<Arc> entry1;
+    FarEntry<Arc> entry2;
+  };
+  bool past_end_key = false;
+  const auto read = [&](Entry *entry) {
+    if (reader1->Done() || reader2->Done()) return false;
+    if (!end_key.empty() && end_key < reader1->GetKey() &&
+        end_key < reader2->GetKey()) {
+      past_end_key = true;
+      return false;
     }
+    return ReadFarEntry(reader1.get(), &entry->entry1) &&
+           ReadFarEntry(reader2.get(), &entry->entry2);
+  };
+  const auto compare = [delta](const Entry &entry) {
+    return entry.entry1.key == entry.entry2.key &&
+           Equal(*entry.entry1.fst, *entry.entry2.fst, delta);
+  };
+  const auto check = [](Entry &entry, bool &equal) {
+    const auto &key1 = entry.entry1.key;
+    const auto &key2 = entry.entry2.key;
     if (key1 != key2) {
       LOG(ERROR) << "FarEqual: Mismatched keys " << key1 << " and " << key2;
       return false;
     }
-    if (!Equal(*(reader1->GetFst()), *(reader2->GetFst()), delta)) {
+    if (!equal) {
       LOG(ERROR) << "FarEqual: FSTs for key " << key1 << " are not equal";
       return false;
     }
-  }
+    return true;
+  };
+  if (!FarParallelMap<Entry>(read, compare, check, num_threads)) return false;
+  if (past_end_key) return true;
   if (!reader1->Done() || !reader2->Done()) {
     LOG(ERROR) << "FarEqual: Key "
                << (reader1->Done() ? reader2->GetKey() : reader1->GetKey())
@@ -20,8 +20,13 @@
 #ifndef FST_EXTENSIONS_FAR_FAR_H_
 #define FST_EXTENSIONS_FAR_FAR_H_
 
+#include <atomic>
+#include <condition_variable>
+#include <deque>
 #include <iostream>
+#include <mutex>
 #include <sstream>
+#include <thread>
 
 #include <fst/log.h>
 #include <fst/extensions/far/stlist.h>
@@ -67,6 +72,17 @@ class FarHeader {
       if (!ReadSTTableHeader(source, &fsthdr)) return false;
       arctype_ = fsthdr.ArcType().empty() ? ErrorArc::Type() : fsthdr.ArcType();
       return true;
+    } else if (IsSTTableShards(source)) {  // Checks if sharded STTable.
+      fartype_ = "sttable";
+      STTableShards manifest;
+      if (!manifest.Read(source)) return false;
+      // Shards may be empty, having no FST header.
+      for (size_t i = 0; i < manifest.Size(); ++i) {
+        if (!ReadSTTableHeader(manifest.Source(i), &fsthdr)) return false;
+        if (!fsthdr.ArcType().empty()) break;
+      }
+      arctype_ = fsthdr.ArcType().empty() ? ErrorArc::Type() : fsthdr.ArcType();
+      return true;
     } else if (IsSTList(source)) {  // Checks if STList.
       fartype_ = "stlist";
       if (!ReadSTListHeader(source, &fsthdr)) return false;
@@ -171,13 +187,27 @@ class FstWriter {
   }
 };
 
+// Writes FSTs with their arrays aligned, so that STTable FARs read with
+// memory mapping can refer to the arrays of ConstFst and CompactFst entries in
+// place.
+template <class Arc>
+class AlignedFstWriter {
+ public:
+  void operator()(std::ostream &strm, const Fst<Arc> &fst) const {
+    FstWriteOptions opts;
+    opts.align = true;
+    fst.Write(strm, opts);
+  }
+};
+
 template <class A>
 class STTableFarWriter : public FarWriter<A> {
  public:
   using Arc = A;
 
   static STTableFarWriter *Create(const std::string &source) {
-    auto *writer = STTableWriter<Fst<Arc>, FstWriter<Arc>>::Create(source);
+    auto *writer =
+        STTableWriter<Fst<Arc>, AlignedFstWriter<Arc>>::Create(source);
     return new STTableFarWriter(writer);
   }
 
@@ -190,10 +220,197 @@ class STTableFarWriter : public FarWriter<A> {
   bool Error() const final { return writer_->Error(); }
 
  private:
-  explicit STTableFarWriter(STTableWriter<Fst<Arc>, FstWriter<Arc>> *writer)
+  explicit STTableFarWriter(
+      STTableWriter<Fst<Arc>, AlignedFstWriter<Arc>> *writer)
       : writer_(writer) {}
 
-  std::unique_ptr<STTableWriter<Fst<Arc>, FstWriter<Arc>>> writer_;
+  std::unique_ptr<STTableWriter<Fst<Arc>, AlignedFstWriter<Arc>>> writer_;
+};
+
+// Options for writing sharded STTable archives.
+struct FarShardOptions {
+  STTableShardType type;
+  size_t num_shards;     // Number of shards, with hash sharding.
+  int64 max_shard_size;  // Size in bytes of a full shard, with range sharding.
+
+  explicit FarShardOptions(STTableShardType type = STTableShardType::HASH,
+                           size_t num_shards = 1, int64 max_shard_size = 0)
+      : type(type), num_shards(num_shards), max_shard_size(max_shard_size) {}
+};
+
+// Writes an STTable archive as a set of shards and a manifest (see
+// STTableShards), which is written to the archive source when the writer is
+// destroyed. Each shard is an STTable file written on its own thread from a
+// bounded queue of entries. With hash sharding, entries are spread over
+// num_shards shards, all being written concurrently. With range sharding,
+// consecutive entries go to the same shard until it holds about
+// max_shard_size bytes, the next shard being started while the previous one
+// is still being written. Keys must be added in order, as for any FarWriter.
+template <class A>
+class STTableShardsFarWriter : public FarWriter<A> {
+ public:
+  using Arc = A;
+
+  static STTableShardsFarWriter *Create(const std::string &source,
+                                        const FarShardOptions &opts) {
+    if (source.empty()) {
+      LOG(ERROR) << "STTableShardsFarWriter: Writing to standard out "
+                 << "unsupported.";
+      return nullptr;
+    }
+    if (opts.type == STTableShardType::HASH ? opts.num_shards < 1
+                                            : opts.max_shard_size <= 0) {
+      LOG(ERROR) << "STTableShardsFarWriter: Bad shard options";
+      return nullptr;
+    }
+    return new STTableShardsFarWriter(source, opts);
+  }
+
+  void Add(const std::string &key, const Fst<Arc> &fst) final {
+    if (key < last_key_) {
+      FSTERROR() << "STTableShardsFarWriter::Add: Key out of order: " << key;
+      error_ = true;
+    }
+    if (error_) return;
+    if (opts_.type == STTableShardType::HASH) {
+      shards_[manifest_.Find(key)]->Add(key, fst);
+    } else {
+      if (shards_.empty() || (key != last_key_ &&
+                              shards_.back()->Size() >= opts_.max_shard_size)) {
+        if (!shards_.empty()) shards_.back()->Finish();
+        shards_.push_back(std::make_unique<Shard>(ShardSource(shards_.size())));
+        manifest_.AddShard(shards_.back()->Source(), key);
+      }
+      shards_.back()->Add(key, fst);
+    }
+    last_key_ = key;
+  }
+
+  FarType Type() const final { return FarType::STTABLE; }
+
+  bool Error() const final {
+    if (error_) return true;
+    for (const auto &shard : shards_) {
+      if (shard->Error()) return true;
+    }
+    return false;
+  }
+
+  ~STTableShardsFarWriter() final {
+    if (shards_.empty()) {  // Writes an empty shard, as tables have one.
+      shards_.push_back(std::make_unique<Shard>(ShardSource(0)));
+      manifest_.AddShard(shards_.back()->Source());
+    }
+    for (auto &shard : shards_) shard->Finish();
+    for (auto &shard : shards_) shard->Join();
+    if (!manifest_.Write(source_)) {
+      FSTERROR() << "STTableShardsFarWriter: Error writing manifest: "
+                 << source_;
+    }
+  }
+
+ private:
+  // A shard written on its own thread.
+  class Shard {
+   public:
+    explicit Shard(const std::string &source)
+        : source_(source),
+          writer_(STTableWriter<Fst<Arc>, AlignedFstWriter<Arc>>::Create(
+              source)),
+          thread_([this] { Write(); }) {}
+
+    // Queues an entry, blocking while the queue is full. The FST is copied so
+    // that it can be written on the shard thread.
+    void Add(const std::string &key, const Fst<Arc> &fst) {
+      std::unique_ptr<const Fst<Arc>> copy(fst.Copy(/*safe=*/true));
+      std::unique_lock<std::mutex> lock(mu_);
+      cv_.wait(lock, [this] { return queue_.size() < kMaxQueued; });
+      queue_.emplace_back(key, std::move(copy));
+      cv_.notify_all();
+    }
+
+    // Lets the shard thread finish writing once the queue is empty.
+    void Finish() {
+      std::lock_guard<std::mutex> lock(mu_);
+      finished_ = true;
+      cv_.notify_all();
+    }
+
+    // Waits for the shard to be fully written; requires Finish().
+    void Join() {
+      if (thread_.joinable()) thread_.join();
+    }
+
+    const std::string &Source() const { return source_; }
+
+    // Approximate number of bytes written, lagging behind queued entries.
+    int64 Size() const { return size_; }
+
+    bool Error() const { return error_; }
+
+    ~Shard() {
+      Finish();
+      Join();
+    }
+
+   private:
+    static constexpr size_t kMaxQueued = 64;
+
+    void Write() {
+      if (!writer_) error_ = true;
+      while (true) {
+        std::pair<std::string, std::unique_ptr<const Fst<Arc>>> entry;
+        {
+          std::unique_lock<std::mutex> lock(mu_);
+          cv_.wait(lock, [this] { return finished_ || !queue_.empty(); });
+          if (queue_.empty()) break;
+          entry = std::move(queue_.front());
+          queue_.pop_front();
+          cv_.notify_all();
+        }
+        if (error_) continue;
+        writer_->Add(entry.first, *entry.second);
+        size_ = writer_->Size();
+        if (writer_->Error()) error_ = true;
+      }
+      writer_.reset();  // Writes the index.
+    }
+
+    const std::string source_;
+    std::unique_ptr<STTableWriter<Fst<Arc>, AlignedFstWriter<Arc>>> writer_;
+    std::deque<std::pair<std::string, std::unique_ptr<const Fst<Arc>>>>
+        queue_;
+    bool finished_ = false;
+    std::atomic<int64> size_{0};
+    std::atomic<bool> error_{false};
+    std::mutex mu_;
+    std::condition_variable cv_;
+    std::thread thread_;  // Last, as it uses the other members.
+  };
+
+  STTableShardsFarWriter(const std::string &source,
+                         const FarShardOptions &opts)
+      : source_(source), opts_(opts), manifest_(opts.type), error_(false) {
+    if (opts.type != STTableShardType::HASH) return;
+    for (size_t i = 0; i < opts.num_shards; ++i) {
+      shards_.push_back(std::make_unique<Shard>(ShardSource(i)));
+      manifest_.AddShard(shards_.back()->Source());
+    }
+  }
+
+  // With range sharding, the final number of shards is unknown while writing.
+  std::string ShardSource(size_t i) const {
+    return STTableShards::ShardSource(
+        source_, i,
+        opts_.type == STTableShardType::HASH ? opts_.num_shards : 0);
+  }
+
+  const std::string source_;
+  const FarShardOptions opts_;
+  STTableShards manifest_;
+  std::vector<std::unique_ptr<Shard>> shards_;
+  std::string last_key_;
+  bool error_;
 };
 
 template <class A>
@@ -287,16 +504,19 @@ class STTableFarReader : public FarReader<A> {
  public:
   using Arc = A;
 
+  // The archive is mapped into memory when FSTs are read in map mode (see
+  // --fst_read_mode), in which case aligned ConstFst and CompactFst entries
+  // refer to the mapping rather than being copied.
   static STTableFarReader *Open(const std::string &source) {
-    auto reader =
-        fst::WrapUnique(STTableReader<Fst<Arc>, FstReader<Arc>>::Open(source));
+    auto reader = fst::WrapUnique(
+        STTableReader<Fst<Arc>, FstReader<Arc>>::Open(source, MemoryMap()));
     if (!reader || reader->Error()) return nullptr;
     return new STTableFarReader(std::move(reader));
   }
 
   static STTableFarReader *Open(const std::vector<std::string> &sources) {
     auto reader = fst::WrapUnique(
-        STTableReader<Fst<Arc>, FstReader<Arc>>::Open(sources));
+        STTableReader<Fst<Arc>, FstReader<Arc>>::Open(sources, MemoryMap()));
     if (!reader || reader->Error()) return nullptr;
     return new STTableFarReader(std::move(reader));
   }
@@ -318,6 +538,10 @@ class STTableFarReader : public FarReader<A> {
   bool Error() const final { return reader_->Error(); }
 
  private:
+  static bool MemoryMap() {
+    return FstReadOptions().mode == FstReadOptions::MAP;
+  }
+
   explicit STTableFarReader(
       std::unique_ptr<STTableReader<Fst<Arc>, FstReader<Arc>>> reader)
       : reader_(std::move(reader)) {}
@@ -325,6 +549,138 @@ class STTableFarReader : public FarReader<A> {
   std::unique_ptr<STTableReader<Fst<Arc>, FstReader<Arc>>> reader_;
 };
 
+// Reads a sharded STTable archive, given its manifest (see STTableShards),
+// opening shards only as needed. With range sharding, the shards are read one
+// after the other and Find() opens only the shard holding the key. With hash
+// sharding, iteration merges all the shards, but Find() for a key in the
+// archive opens only the shard holding it, until the reader is advanced.
+template <class A>
+class STTableShardsFarReader : public FarReader<A> {
+ public:
+  using Arc = A;
+
+  static STTableShardsFarReader *Open(const std::string &source) {
+    STTableShards manifest;
+    if (!manifest.Read(source)) return nullptr;
+    return new STTableShardsFarReader(std::move(manifest));
+  }
+
+  void Reset() final {
+    if (manifest_.Type() == STTableShardType::HASH) {
+      OpenAll();
+      if (reader_) reader_->Reset();
+    } else {
+      OpenShard(0);
+      SkipDone();
+    }
+  }
+
+  bool Find(const std::string &key) final {
+    OpenShard(manifest_.Find(key));
+    if (!reader_) return false;
+    const bool found = reader_->Find(key);
+    if (manifest_.Type() == STTableShardType::HASH) {
+      if (found) {
+        find_key_ = key;
+        return true;
+      }
+      OpenAll();
+      return reader_ && reader_->Find(key);
+    }
+    // The lower bound of the key may be the first entry of the next shard.
+    SkipDone();
+    return found;
+  }
+
+  bool Done() const final {
+    Start();
+    return !reader_ || reader_->Done();
+  }
+
+  void Next() final {
+    Start();
+    if (!reader_) return;
+    if (manifest_.Type() == STTableShardType::HASH && !merged_) {
+      // Continues in all the shards from the key found in one of them.
+      OpenAll();
+      if (!reader_) return;
+      reader_->Find(find_key_);
+    }
+    reader_->Next();
+    SkipDone();
+  }
+
+  const std::string &GetKey() const final {
+    Start();
+    return reader_->GetKey();
+  }
+
+  const Fst<Arc> *GetFst() const final {
+    Start();
+    return reader_->GetFst();
+  }
+
+  FarType Type() const final { return FarType::STTABLE; }
+
+  bool Error() const final { return error_ || (reader_ && reader_->Error()); }
+
+ private:
+  explicit STTableShardsFarReader(STTableShards manifest)
+      : manifest_(std::move(manifest)),
+        shard_(0),
+        merged_(false),
+        error_(false) {}
+
+  // Positions the reader at the start of the archive, if not yet positioned.
+  void Start() const {
+    if (reader_ || error_) return;
+    if (manifest_.Type() == STTableShardType::HASH) {
+      OpenAll();
+    } else {
+      OpenShard(0);
+      SkipDone();
+    }
+  }
+
+  // Opens a single shard.
+  void OpenShard(size_t i) const {
+    if (reader_ && !merged_ && shard_ == i) return;
+    shard_ = i;
+    merged_ = false;
+    reader_.reset(STTableFarReader<Arc>::Open(manifest_.Source(i)));
+    if (!reader_) error_ = true;
+  }
+
+  // Opens all the shards, merging their entries.
+  void OpenAll() const {
+    if (reader_ && merged_) return;
+    std::vector<std::string> sources;
+    for (size_t i = 0; i < manifest_.Size(); ++i) {
+      sources.push_back(manifest_.Source(i));
+    }
+    merged_ = true;
+    reader_.reset(STTableFarReader<Arc>::Open(sources));
+    if (!reader_) error_ = true;
+  }
+
+  // With range sharding, moves past the ends of shards.
+  void SkipDone() const {
+    while (manifest_.Type() == STTableShardType::RANGE && reader_ &&
+           reader_->Done() && !reader_->Error() &&
+           shard_ + 1 < manifest_.Size()) {
+      OpenShard(shard_ + 1);
+    }
+  }
+
+  const STTableShards manifest_;
+  // The readers are opened lazily, possibly from const methods.
+  mutable std::unique_ptr<FarReader<Arc>> reader_;
+  mutable size_t shard_;  // Current shard, if not merged.
+  mutable bool merged_;   // Whether reader_ reads all the shards.
+  mutable bool error_;
+  std::string find_key_;  // Key found in a single shard, with hash sharding.
+};
+
 template <class A>
 class STListFarReader : public FarReader<A> {
  public:
@@ -485,6 +841,8 @@ FarReader<Arc> *FarReader<Arc>::Open(const std::string &source) {
     return STListFarReader<Arc>::Open(source);
   else if (IsSTTable(source))
     return STTableFarReader<Arc>::Open(source);
+  else if (IsSTTableShards(source))
+    return STTableShardsFarReader<Arc>::Open(source);
   else if (IsSTList(source))
     return STListFarReader<Arc>::Open(source);
   else if (IsFst(source))
@@ -496,6 +854,8 @@ template <class Arc>
 FarReader<Arc> *FarReader<Arc>::Open(const std::vector<std::string> &sources) {
   if (!sources.empty() && sources[0].empty())
     return STListFarReader<Arc>::Open(sources);
+  else if (sources.size() == 1 && IsSTTableShards(sources[0]))
+    return STTableShardsFarReader<Arc>::Open(sources[0]);
   else if (!sources.empty() && IsSTTable(sources[0]))
     return STTableFarReader<Arc>::Open(sources);
   else if (!sources.empty() && IsSTList(sources[0]))
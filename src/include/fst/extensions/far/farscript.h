@@ -35,8 +35,10 @@
 #include <fst/extensions/far/info.h>
 #include <fst/extensions/far/isomorphic.h>
 #include <fst/extensions/far/print-strings.h>
+#include <fst/extensions/far/prune.h>
 #include <fst/extensions/far/script-impl.h>
 #include <fst/script/arg-packs.h>
+#include <fst/script/weight-class.h>
 
 namespace fst {
 namespace script {
@@ -59,6 +61,7 @@ struct FarCompileStringsArgs {
   const bool allow_negative_labels;
   const std::string &key_prefix;
   const std::string &key_suffix;
+  const int num_threads;
 };
 
 template <class Arc>
@@ -67,7 +70,8 @@ void FarCompileStrings(FarCompileStringsArgs *args) {
       args->in_sources, args->out_source, args->fst_type, args->far_type,
       args->generate_keys, args->fet, args->tt, args->symbols_source,
       args->unknown_symbol, args->keep_symbols, args->initial_symbols,
-      args->allow_negative_labels, args->key_prefix, args->key_suffix);
+      args->allow_negative_labels, args->key_prefix, args->key_suffix,
+      args->num_threads);
 }
 
 void FarCompileStrings(const std::vector<std::string> &in_sources,
@@ -79,24 +83,29 @@ void FarCompileStrings(const std::vector<std::string> &in_sources,
                        const std::string &unknown_symbol, bool keep_symbols,
                        bool initial_symbols, bool allow_negative_labels,
                        const std::string &key_prefix,
-                       const std::string &key_suffix);
+                       const std::string &key_suffix, int num_threads = 1);
 
 struct FarConvertArgs {
   const std::string &in_source;
   const std::string &out_source;
   const std::string &fst_type;
   const FarType &far_type;
+  const int num_threads;
+  const int32 num_shards;
+  const int64 max_shard_size;
 };
 
 template <class Arc>
 void FarConvert(FarConvertArgs *args) {
   FarConvert<Arc>(args->in_source, args->out_source, args->fst_type,
-                  args->far_type);
+                  args->far_type, args->num_threads, args->num_shards,
+                  args->max_shard_size);
 }
 
 void FarConvert(const std::string &in_source, const std::string &out_source,
                 const std::string &arc_type, const std::string &fst_type,
-                const FarType &far_type);
+                const FarType &far_type, int num_threads = 1,
+                int32 num_shards = 0, int64 max_shard_size = 0);
 
 // Note: it is safe to pass these strings as references because this struct is
 // only used to pass them deeper in the call graph. Be sure you understand why
@@ -123,7 +132,7 @@ void FarCreate(const std::vector<std::string> &in_sources,
 
 using FarEqualInnerArgs =
     std::tuple<const std::string &, const std::string &, float,
-               const std::string &, const std::string &>;
+               const std::string &, const std::string &, int>;
 
 using FarEqualArgs = WithReturnValue<bool, FarEqualInnerArgs>;
 
@@ -131,13 +140,15 @@ template <class Arc>
 void FarEqual(FarEqualArgs *args) {
   args->retval = fst::FarEqual<Arc>(
       std::get<0>(args->args), std::get<1>(args->args), std::get<2>(args->args),
-      std::get<3>(args->args), std::get<4>(args->args));
+      std::get<3>(args->args), std::get<4>(args->args),
+      std::get<5>(args->args));
 }
 
 bool FarEqual(const std::string &source1, const std::string &source2,
               const std::string &arc_type, float delta = kDelta,
               const std::string &begin_key = std::string(),
-              const std::string &end_key = std::string());
+              const std::string &end_key = std::string(),
+              int num_threads = 1);
 
 using FarExtractArgs =
     std::tuple<const std::vector<std::string> &, int32, const std::string &,
@@ -191,7 +202,7 @@ void GetFarInfo(const std::vector<std::string> &sources,
 
 using FarIsomorphicInnerArgs =
     std::tuple<const std::string &, const std::string &, float,
-               const std::string &, const std::string &>;
+               const std::string &, const std::string &, int>;
 
 using FarIsomorphicArgs = WithReturnValue<bool, FarIsomorphicInnerArgs>;
 
@@ -199,13 +210,15 @@ template <class Arc>
 void FarIsomorphic(FarIsomorphicArgs *args) {
   args->retval = fst::FarIsomorphic<Arc>(
       std::get<0>(args->args), std::get<1>(args->args), std::get<2>(args->args),
-      std::get<3>(args->args), std::get<4>(args->args));
+      std::get<3>(args->args), std::get<4>(args->args),
+      std::get<5>(args->args));
 }
 
 bool FarIsomorphic(const std::string &source1, const std::string &source2,
                    const std::string &arc_type, float delta = kDelta,
                    const std::string &begin_key = std::string(),
-                   const std::string &end_key = std::string());
+                   const std::string &end_key = std::string(),
+                   int num_threads = 1);
 
 struct FarPrintStringsArgs {
   const std::vector<std::string> &isources;
@@ -220,6 +233,7 @@ struct FarPrintStringsArgs {
   const int32 generate_sources;
   const std::string &source_prefix;
   const std::string &source_suffix;
+  const int num_threads;
 };
 
 template <class Arc>
@@ -228,7 +242,7 @@ void FarPrintStrings(FarPrintStringsArgs *args) {
       args->isources, args->entry_type, args->token_type, args->begin_key,
       args->end_key, args->print_key, args->print_weight, args->symbols_source,
       args->initial_symbols, args->generate_sources, args->source_prefix,
-      args->source_suffix);
+      args->source_suffix, args->num_threads);
 }
 
 void FarPrintStrings(const std::vector<std::string> &isources,
@@ -238,7 +252,47 @@ void FarPrintStrings(const std::vector<std::string> &isources,
                      const bool print_weight, const std::string &symbols_source,
                      const bool initial_symbols, const int32 generate_sources,
                      const std::string &source_prefix,
-                     const std::string &source_suffix);
+                     const std::string &source_suffix, int num_threads = 1);
+
+// The weight threshold is passed as a string, since the weight type is only
+// known once the arc type has been read from the FAR. An empty string means
+// Weight::Zero(), i.e., no weight threshold.
+struct FarPruneInnerArgs {
+  const std::string &in_source;
+  const std::string &out_source;
+  const std::string &weight_threshold;
+  const int64 state_threshold;
+  const float delta;
+  const FarType &far_type;
+  const int num_threads;
+};
+
+using FarPruneArgs = WithReturnValue<bool, FarPruneInnerArgs>;
+
+template <class Arc>
+void FarPrune(FarPruneArgs *args) {
+  using Weight = typename Arc::Weight;
+  const auto &inner = args->args;
+  const auto weight_class =
+      inner.weight_threshold.empty()
+          ? WeightClass::Zero(Weight::Type())
+          : WeightClass(Weight::Type(), inner.weight_threshold);
+  const auto *weight_threshold = weight_class.template GetWeight<Weight>();
+  if (!weight_threshold || !weight_threshold->Member()) {
+    FSTERROR() << "FarPrune: Bad weight threshold: " << inner.weight_threshold;
+    args->retval = false;
+    return;
+  }
+  args->retval = fst::FarPrune<Arc>(
+      inner.in_source, inner.out_source, *weight_threshold,
+      inner.state_threshold, inner.delta, inner.far_type, inner.num_threads);
+}
+
+// Returns false on error.
+bool FarPrune(const std::string &in_source, const std::string &out_source,
+              const std::string &arc_type, const std::string &weight_threshold,
+              int64 state_threshold, float delta, const FarType &far_type,
+              int num_threads);
 
 }  // namespace script
 }  // namespace fst
@@ -251,6 +305,7 @@ void FarPrintStrings(const std::vector<std::string> &isources,
   REGISTER_FST_OPERATION(FarInfo, ArcType, FarInfoArgs);                     \
   REGISTER_FST_OPERATION(FarIsomorphic, ArcType, FarIsomorphicArgs);         \
   REGISTER_FST_OPERATION(FarPrintStrings, ArcType, FarPrintStringsArgs);     \
+  REGISTER_FST_OPERATION(FarPrune, ArcType, FarPruneArgs);                   \
   REGISTER_FST_OPERATION(GetFarInfo, ArcType, GetFarInfoArgs)
 
 #endif  // FST_EXTENSIONS_FAR_FARSCRIPT_H_
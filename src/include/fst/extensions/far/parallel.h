@@ -0,0 +1,154 @@
+// Copyright 2005-2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// See www.openfst.org for extensive documentation on this weighted
+// finite-state transducer library.
+//
+// Ordered parallel processing of the entries of finite-state archives.
+
+#ifndef FST_EXTENSIONS_FAR_PARALLEL_H_
+#define FST_EXTENSIONS_FAR_PARALLEL_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <fst/extensions/far/far.h>
+#include <fst/thread-pool.h>
+
+namespace fst {
+
+// Number of entries per thread in each batch processed by FarParallelMap.
+inline constexpr size_t kFarParallelBatchSize = 256;
+
+// Processes a sequence of entries using up to num_threads threads, preserving
+// their order. The functors must provide the following interface:
+//
+//   // Fills in the next entry, returning false (then and on any later call)
+//   // when there are no more entries.
+//   bool read(Entry *entry);
+//
+//   // Computes the result for an entry; called concurrently on worker threads.
+//   Result map(const Entry &entry);
+//
+//   // Consumes an entry and its result, in input order, on the calling
+//   // thread; returns false to stop processing.
+//   bool emit(Entry &entry, Result &result);
+//
+// Entries are read in batches of kFarParallelBatchSize per thread. With more
+// than one thread, a long-lived reader thread reads each batch while the
+// previous one is mapped and emitted, so read must not share unsynchronized
+// state with map or emit. Returns false if processing was stopped by emit.
+template <class Entry, class Read, class Map, class Emit>
+bool FarParallelMap(Read read, Map map, Emit emit, int num_threads) {
+  using Result = std::invoke_result_t<Map &, const Entry &>;
+  ThreadPool pool(num_threads);
+  const size_t batch_size = kFarParallelBatchSize * pool.NumThreads();
+  const auto read_batch = [&read, batch_size](std::vector<Entry> *batch) {
+    batch->clear();
+    for (Entry entry; batch->size() < batch_size && read(&entry);) {
+      batch->push_back(std::move(entry));
+    }
+  };
+  // Hands batches over from the reader thread, one batch ahead.
+  std::mutex mu;
+  std::condition_variable cv;
+  std::vector<Entry> next;
+  bool next_ready = false;
+  bool stopped = false;
+  std::thread reader;
+  if (pool.NumThreads() > 1) {
+    reader = std::thread([&] {
+      for (bool last = false; !last;) {
+        {
+          std::unique_lock<std::mutex> lock(mu);
+          cv.wait(lock, [&] { return !next_ready || stopped; });
+          if (stopped) return;
+        }
+        std::vector<Entry> batch;
+        read_batch(&batch);
+        last = batch.size() < batch_size;
+        std::lock_guard<std::mutex> lock(mu);
+        next = std::move(batch);
+        next_ready = true;
+        cv.notify_all();
+      }
+    });
+  }
+  const auto next_batch = [&](std::vector<Entry> *batch) {
+    if (!reader.joinable()) {
+      read_batch(batch);
+      return;
+    }
+    batch->clear();  // Outside the lock.
+    std::unique_lock<std::mutex> lock(mu);
+    cv.wait(lock, [&] { return next_ready; });
+    std::swap(*batch, next);
+    next_ready = false;
+    cv.notify_all();
+  };
+  std::vector<Entry> batch;
+  std::vector<std::optional<Result>> results;
+  bool ok = true;
+  for (next_batch(&batch); !batch.empty();) {
+    results.clear();
+    results.resize(batch.size());
+    ParallelFor(&pool, 0, batch.size(), [&](size_t i) {
+      results[i].emplace(map(std::as_const(batch[i])));
+    });
+    for (size_t i = 0; ok && i < batch.size(); ++i) {
+      ok = emit(batch[i], *results[i]);
+    }
+    if (!ok || batch.size() < batch_size) break;
+    next_batch(&batch);
+  }
+  if (reader.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(mu);
+      stopped = true;
+    }
+    cv.notify_all();
+    reader.join();
+  }
+  return ok;
+}
+
+// An archive entry whose FST can be used on another thread than the reader's.
+template <class Arc>
+struct FarEntry {
+  std::string key;
+  std::unique_ptr<const Fst<Arc>> fst;
+};
+
+// Reads the current entry of the reader, if any, into entry and advances the
+// reader to the next one; returns false if the reader is done.
+template <class Arc>
+bool ReadFarEntry(FarReader<Arc> *reader, FarEntry<Arc> *entry) {
+  if (reader->Done()) return false;
+  entry->key = reader->GetKey();
+  entry->fst.reset(reader->GetFst()->Copy(/*safe=*/true));
+  reader->Next();
+  return true;
+}
+
+}  // namespace fst
+
+#endif  // FST_EXTENSIONS_FAR_PARALLEL_H_
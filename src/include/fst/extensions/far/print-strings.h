@@ -21,12 +21,16 @@
 #define FST_EXTENSIONS_FAR_PRINT_STRINGS_H_
 
 #include <iomanip>
+#include <iostream>
+#include <memory>
 #include <string>
 #include <vector>
 
 #include <fst/flags.h>
 #include <fst/extensions/far/far.h>
+#include <fst/extensions/far/parallel.h>
 #include <fstream>
+#include <fst/script/print-impl.h>
 #include <fst/shortest-distance.h>
 #include <fst/string.h>
 
@@ -34,6 +38,13 @@ DECLARE_string(far_field_separator);
 
 namespace fst {
 
+// Number of bytes of output buffered before being written.
+inline constexpr size_t kFarPrintStringsBufferSize = 1 << 16;
+
+// Prints the string FSTs in the archives as strings. The strings (and weights,
+// if requested) are computed using up to num_threads threads while entries are
+// read on another thread; they are then printed in archive order, lines being
+// written to standard output in blocks.
 template <class Arc>
 void FarPrintStrings(const std::vector<std::string> &isources,
                      FarEntryType entry_type, TokenType token_type,
@@ -41,7 +52,17 @@ void FarPrintStrings(const std::vector<std::string> &isources,
                      bool print_key, bool print_weight,
                      const std::string &symbols_source, bool initial_symbols,
                      int32 generate_sources, const std::string &source_prefix,
-                     const std::string &source_suffix) {
+                     const std::string &source_suffix, int num_threads = 1) {
+  using Weight = typename Arc::Weight;
+  struct Entry {
+    FarEntry<Arc> entry;
+    int index;  // One-based position in the archive.
+    int nrep;   // Number of preceding entries with the same key.
+  };
+  struct Result {
+    std::string str;
+    Weight weight;
+  };
   std::unique_ptr<const SymbolTable> syms;
   if (!symbols_source.empty()) {
     // TODO(kbg): Allow negative flag?
@@ -58,9 +79,13 @@ void FarPrintStrings(const std::vector<std::string> &isources,
   if (!begin_key.empty()) far_reader->Find(begin_key);
   std::string okey;
   int nrep = 0;
-  for (int i = 1; !far_reader->Done(); far_reader->Next(), ++i) {
+  int i = 0;
+  // Symbols are only taken from the first FST, which is read before any is
+  // printed.
+  const auto read = [&](Entry *entry) {
+    if (far_reader->Done()) return false;
     const auto &key = far_reader->GetKey();
-    if (!end_key.empty() && end_key < key) break;
+    if (!end_key.empty() && end_key < key) return false;
     if (okey == key) {
       ++nrep;
     } else {
@@ -68,42 +93,65 @@ void FarPrintStrings(const std::vector<std::string> &isources,
     }
     okey = key;
     const auto *fst = far_reader->GetFst();
-    if (i == 1 && initial_symbols && !syms && fst->InputSymbols()) {
+    if (++i == 1 && initial_symbols && !syms && fst->InputSymbols()) {
       syms.reset(fst->InputSymbols()->Copy());
     }
-    std::string str;
     VLOG(2) << "Handling key: " << key;
-    const StringPrinter<Arc> printer(token_type,
-                                     syms ? syms.get() : fst->InputSymbols(),
-                                     /*omit_epsilon=*/false);
-    printer(*fst, &str);
+    entry->index = i;
+    entry->nrep = nrep;
+    return ReadFarEntry(far_reader.get(), &entry->entry);
+  };
+  const auto print = [&](const Entry &entry) {
+    const auto &fst = *entry.entry.fst;
+    const StringPrinter<Arc> printer(
+        token_type, syms ? syms.get() : fst.InputSymbols(),
+        /*omit_epsilon=*/false);
+    Result result;
+    printer(fst, &result.str);
+    if (entry_type == FarEntryType::LINE && print_weight) {
+      result.weight = ShortestDistance(fst);
+    }
+    return result;
+  };
+  internal::PrintBuffer buffer(std::cout);
+  const std::string sep(1, FLAGS_far_field_separator[0]);
+  const auto write = [&](Entry &entry, Result &result) {
     if (entry_type == FarEntryType::LINE) {
-      if (print_key) std::cout << key << FLAGS_far_field_separator[0];
-      std::cout << str;
+      if (print_key) {
+        buffer.Append(entry.entry.key);
+        buffer.Append(sep);
+      }
+      buffer.Append(result.str);
       if (print_weight) {
-        std::cout << FLAGS_far_field_separator[0] << ShortestDistance(*fst);
+        buffer.Append(sep);
+        buffer.AppendWeight(result.weight);
       }
-      std::cout << std::endl;
+      buffer.Append("\n");
+      if (buffer.Size() >= kFarPrintStringsBufferSize) buffer.Write(std::cout);
     } else if (entry_type == FarEntryType::FILE) {
       std::stringstream sstrm;
       if (generate_sources) {
         sstrm.fill('0');
-        sstrm << std::right << std::setw(generate_sources) << i;
+        sstrm << std::right << std::setw(generate_sources) << entry.index;
       } else {
-        sstrm << key;
-        if (nrep > 0) sstrm << "." << nrep;
+        sstrm << entry.entry.key;
+        if (entry.nrep > 0) sstrm << "." << entry.nrep;
       }
       std::string source;
       source = source_prefix + sstrm.str() + source_suffix;
       std::ofstream ostrm(source);
       if (!ostrm) {
         LOG(ERROR) << "FarPrintStrings: Can't open file: " << source;
-        return;
+        return false;
       }
-      ostrm << str;
+      ostrm << result.str;
       if (token_type == TokenType::SYMBOL) ostrm << "\n";
     }
-  }
+    return true;
+  };
+  if (!FarParallelMap<Entry>(read, print, write, num_threads)) return;
+  buffer.Write(std::cout);
+  std::cout.flush();
 }
 
 }  // namespace fst
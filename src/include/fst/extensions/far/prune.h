@@ -0,0 +1,94 @@
+// Copyright 2005-2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the 'License');
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an 'AS IS' BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// See www.openfst.org for extensive documentation on this weighted
+// finite-state transducer library.
+//
+// Prunes all FSTs in a FAR, in parallel.
+
+#ifndef FST_EXTENSIONS_FAR_PRUNE_H_
+#define FST_EXTENSIONS_FAR_PRUNE_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <fst/extensions/far/far.h>
+#include <fst/prune.h>
+#include <fst/vector-fst.h>
+
+namespace fst {
+
+// Number of FSTs read per thread before each batch is pruned and written.
+inline constexpr size_t kFarPruneBatchSize = 256;
+
+// Prunes each FST in the input FAR, as Prune() does, and writes the results,
+// in the same order, to the output FAR. FSTs are read and pruned in batches
+// using up to num_threads threads; each thread reuses its pruning buffers for
+// all the FSTs in its share of a batch. Returns false on error.
+template <class Arc>
+bool FarPrune(const std::string &in_source, const std::string &out_source,
+              const typename Arc::Weight &weight_threshold,
+              typename Arc::StateId state_threshold, float delta,
+              const FarType &far_type, int num_threads) {
+  if constexpr (!IsPath<typename Arc::Weight>::value) {
+    FSTERROR() << "FarPrune: Weight needs to have the path property: "
+               << Arc::Weight::Type();
+    return false;
+  } else {
+    std::unique_ptr<FarReader<Arc>> reader(FarReader<Arc>::Open(in_source));
+    if (!reader) {
+      FSTERROR() << "FarPrune: Cannot open input FAR: " << in_source;
+      return false;
+    }
+    std::unique_ptr<FarWriter<Arc>> writer(
+        FarWriter<Arc>::Create(out_source, far_type));
+    if (!writer) {
+      FSTERROR() << "FarPrune: Cannot open output FAR: " << out_source;
+      return false;
+    }
+    const PruneOptions<Arc, AnyArcFilter<Arc>> opts(
+        weight_threshold, state_threshold, AnyArcFilter<Arc>(), nullptr,
+        delta);
+    const size_t batch_size = kFarPruneBatchSize * std::max(1, num_threads);
+    std::vector<std::string> keys;
+    std::vector<VectorFst<Arc>> fsts(batch_size);
+    std::vector<MutableFst<Arc> *> batch;
+    while (!reader->Done()) {
+      keys.clear();
+      batch.clear();
+      for (; !reader->Done() && keys.size() < batch_size; reader->Next()) {
+        keys.push_back(reader->GetKey());
+        auto &fst = fsts[batch.size()];
+        fst = *reader->GetFst();
+        batch.push_back(&fst);
+      }
+      Prune(batch, opts, num_threads);
+      for (size_t i = 0; i < keys.size(); ++i) writer->Add(keys[i], fsts[i]);
+    }
+    if (reader->Error()) {
+      FSTERROR() << "FarPrune: Error reading FAR: " << in_source;
+      return false;
+    }
+    if (writer->Error()) {
+      FSTERROR() << "FarPrune: Error writing FAR: " << out_source;
+      return false;
+    }
+    return true;
+  }
+}
+
+}  // namespace fst
+
+#endif  // FST_EXTENSIONS_FAR_PRUNE_H_
@@ -27,14 +27,74 @@
 #include <algorithm>
 #include <istream>
 #include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
 
 #include <fstream>
+#include <fst/mapped-file.h>
 #include <fst/util.h>
 
 namespace fst {
 
 static constexpr int32 kSTTableMagicNumber = 2125656924;
-static constexpr int32 kSTTableFileVersion = 1;
+// Version 2 adds the key index; version 1 tables only index entry positions.
+static constexpr int32 kSTTableFileVersion = 2;
+static constexpr int32 kSTTableMinFileVersion = 1;
+
+// Index of the entries of a string-type table, stored at the end of the file.
+//
+// Version 1 tables only store the file positions of the entries, followed by
+// their number. Version 2 tables store an aligned index region with the
+// positions, the offsets of the keys in a blob of concatenated keys, an
+// open-addressing hash table from keys to the first entry with that key, and
+// the blob itself; this is followed by the region position, the number of
+// hash buckets and the number of entries. The region is memory-mapped when
+// possible, so that keys are looked up without reading from the file.
+class STTableIndex {
+ public:
+  STTableIndex() = default;
+
+  // Reads the index of a table of the given file version.
+  bool Read(std::istream &strm, const std::string &source, int32 version);
+
+  // Writes a version 2 index for the entries at the given positions, whose
+  // keys are key_blob[key_offsets[i], key_offsets[i + 1]) and sorted.
+  static bool Write(std::ostream &strm, const std::vector<int64> &positions,
+                    const std::string &key_blob,
+                    const std::vector<int64> &key_offsets);
+
+  size_t Size() const { return size_; }
+
+  int64 Position(size_t i) const { return positions_[i]; }
+
+  // Whether keys are stored in the index, as in version 2 tables.
+  bool HasKeys() const { return key_offsets_ != nullptr; }
+
+  // Requires HasKeys().
+  std::string_view Key(size_t i) const {
+    return std::string_view(keys_ + key_offsets_[i],
+                            key_offsets_[i + 1] - key_offsets_[i]);
+  }
+
+  // Returns the index of the first entry whose key is not less than key, or
+  // Size() if there is none. Requires HasKeys().
+  size_t LowerBound(std::string_view key) const;
+
+  // FNV-1a hash, fixed by the file formats.
+  static uint64 Hash(std::string_view key);
+
+ private:
+
+  std::vector<int64> v1_positions_;     // Positions read from version 1 tables.
+  std::unique_ptr<MappedFile> region_;  // Version 2 index region.
+  const int64 *positions_ = nullptr;
+  const int64 *key_offsets_ = nullptr;
+  const uint32 *buckets_ = nullptr;  // Entry index plus one; 0 if empty.
+  const char *keys_ = nullptr;
+  size_t size_ = 0;
+  size_t nbuckets_ = 0;  // Zero or a power of two.
+};
 
 // String-type table writing class for an object of type T using a functor
 // Writer. The Writer functor must provide at least the following interface:
@@ -69,35 +129,53 @@ class STTableWriter {
     if (key.empty()) {
       FSTERROR() << "STTableWriter::Add: Key empty: " << key;
       error_ = true;
-    } else if (key < last_key_) {
+    } else if (key < LastKey()) {
       FSTERROR() << "STTableWriter::Add: Key out of order: " << key;
       error_ = true;
     }
     if (error_) return;
-    last_key_ = key;
     positions_.push_back(stream_.tellp());
+    key_blob_.append(key);
+    key_offsets_.push_back(key_blob_.size());
     WriteType(stream_, key);
     entry_writer_(stream_, t);
   }
 
   bool Error() const { return error_; }
 
+  // Returns the number of bytes written so far, excluding the index.
+  int64 Size() { return stream_.tellp(); }
+
   ~STTableWriter() {
-    WriteType(stream_, positions_);
-    WriteType(stream_, static_cast<int64>(positions_.size()));
+    if (!STTableIndex::Write(stream_, positions_, key_blob_, key_offsets_)) {
+      FSTERROR() << "STTableWriter: Error writing index";
+    }
   }
 
  private:
+  std::string_view LastKey() const {
+    if (positions_.empty()) return std::string_view();
+    const auto begin = key_offsets_[key_offsets_.size() - 2];
+    return std::string_view(key_blob_.data() + begin,
+                            key_blob_.size() - begin);
+  }
+
   Writer entry_writer_;
   std::ofstream stream_;
   std::vector<int64> positions_;  // Position in file of each key-entry pair.
-  std::string last_key_;          // Last key.
+  std::string key_blob_;          // Concatenated keys.
+  std::vector<int64> key_offsets_ = {0};  // Offset of each key in key_blob_.
   bool error_;
 
   STTableWriter(const STTableWriter &) = delete;
   STTableWriter &operator=(const STTableWriter &) = delete;
 };
 
+// Opens a string-type table file for reading. If memorymap is true, the file is
+// mapped into memory and read through a MappedFileInputStream; if it cannot be
+// mapped, it is read into memory instead. Returns nullptr on error.
+std::istream *OpenSTTableStream(const std::string &source, bool memorymap);
+
 // String-type table reading class for object of type T using a functor Reader.
 // Reader must provide at least the following interface:
 //
@@ -108,16 +186,19 @@ class STTableWriter {
 template <class T, class Reader>
 class STTableReader {
  public:
-  explicit STTableReader(const std::vector<std::string> &sources)
+  // If memorymap is true, each file is mapped into memory once and entries
+  // are read from the mapping, so that entries using MappedFile for their
+  // storage (e.g., ConstFst and CompactFst) refer to it without copying.
+  explicit STTableReader(const std::vector<std::string> &sources,
+                         bool memorymap = false)
       : sources_(sources), error_(false) {
     compare_.reset(new Compare(&keys_));
     keys_.resize(sources.size());
     streams_.resize(sources.size(), nullptr);
-    positions_.resize(sources.size());
+    indices_.resize(sources.size());
     for (size_t i = 0; i < sources.size(); ++i) {
-      streams_[i] = new std::ifstream(
-          sources[i], std::ios_base::in | std::ios_base::binary);
-      if (streams_[i]->fail()) {
+      streams_[i] = OpenSTTableStream(sources[i], memorymap);
+      if (!streams_[i] || streams_[i]->fail()) {
         FSTERROR() << "STTableReader::STTableReader: Error reading file: "
                    << sources[i];
         error_ = true;
@@ -133,23 +214,21 @@ class STTableReader {
         error_ = true;
         return;
       }
-      if (file_version != kSTTableFileVersion) {
+      if (file_version < kSTTableMinFileVersion ||
+          file_version > kSTTableFileVersion) {
         FSTERROR() << "STTableReader::STTableReader: Wrong file version: "
                    << sources[i];
         error_ = true;
         return;
       }
-      int64 num_entries;
-      streams_[i]->seekg(-static_cast<int>(sizeof(int64)), std::ios_base::end);
-      ReadType(*streams_[i], &num_entries);
-      if (num_entries > 0) {
-        streams_[i]->seekg(-static_cast<int>(sizeof(int64)) * (num_entries + 1),
-                           std::ios_base::end);
-        positions_[i].resize(num_entries);
-        for (size_t j = 0; (j < num_entries) && (!streams_[i]->fail()); ++j) {
-          ReadType(*streams_[i], &(positions_[i][j]));
-        }
-        streams_[i]->seekg(positions_[i][0]);
+      if (!indices_[i].Read(*streams_[i], sources[i], file_version)) {
+        FSTERROR() << "STTableReader::STTableReader: Error reading file: "
+                   << sources[i];
+        error_ = true;
+        return;
+      }
+      if (indices_[i].Size() > 0) {
+        streams_[i]->seekg(indices_[i].Position(0));
         if (streams_[i]->fail()) {
           FSTERROR() << "STTableReader::STTableReader: Error reading file: "
                      << sources[i];
@@ -165,32 +244,34 @@ class STTableReader {
     for (auto &stream : streams_) delete stream;
   }
 
-  static STTableReader<T, Reader> *Open(const std::string &source) {
+  static STTableReader<T, Reader> *Open(const std::string &source,
+                                        bool memorymap = false) {
     if (source.empty()) {
       LOG(ERROR) << "STTableReader: Operation not supported on standard input";
       return nullptr;
     }
     std::vector<std::string> sources;
     sources.push_back(source);
-    return new STTableReader<T, Reader>(sources);
+    return new STTableReader<T, Reader>(sources, memorymap);
   }
 
-  static STTableReader<T, Reader> *Open(
-      const std::vector<std::string> &sources) {
-    return new STTableReader<T, Reader>(sources);
+  static STTableReader<T, Reader> *Open(const std::vector<std::string> &sources,
+                                        bool memorymap = false) {
+    return new STTableReader<T, Reader>(sources, memorymap);
   }
 
   void Reset() {
     if (error_) return;
-    for (size_t i = 0; i < streams_.size(); ++i)
-      streams_[i]->seekg(positions_[i].front());
+    for (size_t i = 0; i < streams_.size(); ++i) {
+      if (indices_[i].Size() > 0) streams_[i]->seekg(indices_[i].Position(0));
+    }
     MakeHeap();
   }
 
   bool Find(const std::string &key) {
     if (error_) return false;
     for (size_t i = 0; i < streams_.size(); ++i) LowerBound(i, key);
-    MakeHeap();
+    MakeHeap(key);
     if (heap_.empty()) return false;
     return keys_[current_] == key;
   }
@@ -199,7 +280,8 @@ class STTableReader {
 
   void Next() {
     if (error_) return;
-    if (streams_[current_]->tellg() <= positions_[current_].back()) {
+    const auto &index = indices_[current_];
+    if (streams_[current_]->tellg() <= index.Position(index.Size() - 1)) {
       ReadType(*(streams_[current_]), &(keys_[current_]));
       if (streams_[current_]->fail()) {
         FSTERROR() << "STTableReader: Error reading file: "
@@ -234,16 +316,24 @@ class STTableReader {
   };
 
   // Positions the stream at the position corresponding to the lower bound for
-  // the specified key.
+  // the specified key, or at the last entry if all keys are less than it, in
+  // which case MakeHeap() leaves the stream out of the heap. With
+  // a key index this is a lookup in memory; otherwise keys are read from the
+  // stream by binary search.
   void LowerBound(size_t id, const std::string &find_key) {
     auto *strm = streams_[id];
-    const auto &positions = positions_[id];
-    if (positions.empty()) return;
+    const auto &index = indices_[id];
+    if (index.Size() == 0) return;
+    if (index.HasKeys()) {
+      const auto i = std::min(index.LowerBound(find_key), index.Size() - 1);
+      strm->seekg(index.Position(i));
+      return;
+    }
     size_t low = 0;
-    size_t high = positions.size() - 1;
+    size_t high = index.Size() - 1;
     while (low < high) {
       size_t mid = (low + high) / 2;
-      strm->seekg(positions[mid]);
+      strm->seekg(index.Position(mid));
       std::string key;
       ReadType(*strm, &key);
       if (key > find_key) {
@@ -252,31 +342,33 @@ class STTableReader {
         low = mid + 1;
       } else {
         for (size_t i = mid; i > low; --i) {
-          strm->seekg(positions[i - 1]);
+          strm->seekg(index.Position(i - 1));
           ReadType(*strm, &key);
           if (key != find_key) {
-            strm->seekg(positions[i]);
+            strm->seekg(index.Position(i));
             return;
           }
         }
-        strm->seekg(positions[low]);
+        strm->seekg(index.Position(low));
         return;
       }
     }
-    strm->seekg(positions[low]);
+    strm->seekg(index.Position(low));
   }
 
-  // Adds all streams to the heap.
-  void MakeHeap() {
+  // Adds to the heap all streams whose next key is not less than min_key;
+  // the others, positioned at their last entry by LowerBound(), are done.
+  void MakeHeap(const std::string &min_key = "") {
     heap_.clear();
     for (size_t i = 0; i < streams_.size(); ++i) {
-      if (positions_[i].empty()) continue;
+      if (indices_[i].Size() == 0) continue;
       ReadType(*streams_[i], &(keys_[i]));
       if (streams_[i]->fail()) {
         FSTERROR() << "STTableReader: Error reading file: " << sources_[i];
         error_ = true;
         return;
       }
+      if (keys_[i] < min_key) continue;
       heap_.push_back(i);
     }
     if (heap_.empty()) return;
@@ -302,7 +394,7 @@ class STTableReader {
   Reader entry_reader_;
   std::vector<std::istream *> streams_;        // Input streams.
   std::vector<std::string> sources_;           // Corresponding file names.
-  std::vector<std::vector<int64>> positions_;  // Index of positions.
+  std::vector<STTableIndex> indices_;          // Index of each stream.
   std::vector<std::string> keys_;  // Lowest unread key for each stream.
   std::vector<int64> heap_;  // Heap containing ID of streams with unread keys.
   int64 current_;            // ID of current stream to be read.
@@ -336,21 +428,18 @@ bool ReadSTTableHeader(const std::string &source, Header *header) {
     LOG(ERROR) << "ReadSTTableHeader: Wrong file type: " << source;
     return false;
   }
-  if (file_version != kSTTableFileVersion) {
+  if (file_version < kSTTableMinFileVersion ||
+      file_version > kSTTableFileVersion) {
     LOG(ERROR) << "ReadSTTableHeader: Wrong file version: " << source;
     return false;
   }
-  int64 i = -1;
-  strm.seekg(-static_cast<int>(sizeof(int64)), std::ios_base::end);
-  ReadType(strm, &i);  // Reads number of entries
-  if (strm.fail()) {
+  STTableIndex index;
+  if (!index.Read(strm, source, file_version)) {
     LOG(ERROR) << "ReadSTTableHeader: Error reading file: " << source;
     return false;
   }
-  if (i == 0) return true;  // No entry header to read.
-  strm.seekg(-2 * static_cast<int>(sizeof(int64)), std::ios_base::end);
-  ReadType(strm, &i);  // Reads position for last entry in file.
-  strm.seekg(i);
+  if (index.Size() == 0) return true;  // No entry header to read.
+  strm.seekg(index.Position(index.Size() - 1));
   std::string key;
   ReadType(strm, &key);
   if (!header->Read(strm, source + ":" + key)) {
@@ -366,6 +455,59 @@ bool ReadSTTableHeader(const std::string &source, Header *header) {
 
 bool IsSTTable(const std::string &source);
 
+static constexpr int32 kSTTableShardsMagicNumber = 2125656925;
+static constexpr int32 kSTTableShardsFileVersion = 1;
+
+// How the keys of a sharded string-type table are assigned to its shards.
+enum class STTableShardType : int32 {
+  HASH = 0,   // By key hash, so that all shards are written to concurrently.
+  RANGE = 1,  // By ranges of consecutive keys.
+};
+
+// Manifest of a sharded string-type table, whose entries are split among
+// several string-type table files, each holding sorted keys. The manifest file
+// stores the shard type and, for each shard, its file name relative to the
+// directory of the manifest and, for range sharding, its first key.
+class STTableShards {
+ public:
+  explicit STTableShards(STTableShardType type = STTableShardType::HASH)
+      : type_(type) {}
+
+  bool Read(const std::string &source);
+
+  bool Write(const std::string &source) const;
+
+  // Appends a shard; first_key is only used with range sharding, in which
+  // shards must be added in key order.
+  void AddShard(const std::string &source,
+                const std::string &first_key = std::string()) {
+    sources_.push_back(source);
+    first_keys_.push_back(first_key);
+  }
+
+  STTableShardType Type() const { return type_; }
+
+  size_t Size() const { return sources_.size(); }
+
+  const std::string &Source(size_t i) const { return sources_[i]; }
+
+  // Returns the shard holding key, if present in the table. Requires Size() >
+  // 0.
+  size_t Find(std::string_view key) const;
+
+  // Returns the file name of shard i out of n, or of shard i if n is zero,
+  // for the table with the given manifest file name.
+  static std::string ShardSource(const std::string &source, size_t i,
+                                 size_t n);
+
+ private:
+  STTableShardType type_;
+  std::vector<std::string> sources_;
+  std::vector<std::string> first_keys_;
+};
+
+bool IsSTTableShards(const std::string &source);
+
 }  // namespace fst
 
 #endif  // FST_EXTENSIONS_FAR_STTABLE_H_
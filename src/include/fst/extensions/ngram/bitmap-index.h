@@ -18,6 +18,8 @@
 #ifndef FST_EXTENSIONS_NGRAM_BITMAP_INDEX_H_
 #define FST_EXTENSIONS_NGRAM_BITMAP_INDEX_H_
 
+#include <cstddef>
+#include <iostream>
 #include <utility>
 #include <vector>
 
@@ -85,6 +87,10 @@
 // for a 18.75% space overhead.
 //
 // The select indices have 6.25% overhead together.
+//
+// The rank and select indices can be written out with WriteIndex and later
+// used in place, for instance from a memory-mapped file, with BorrowIndex,
+// which avoids rebuilding them.
 
 namespace fst {
 
@@ -188,6 +194,20 @@ class BitmapIndex {
                   bool enable_select_0_index = false,
                   bool enable_select_1_index = false);
 
+  // Number of bytes written by WriteIndex; always a multiple of 8.
+  size_t SerializedIndexBytes() const;
+
+  // Writes the rank and select indices, to be used by BorrowIndex.
+  bool WriteIndex(std::ostream& strm) const;
+
+  // Uses the rank and select indices for the bitmap as written by WriteIndex
+  // at index, without copying them; the data must outlive this object.
+  // Returns the number of bytes of index used, or 0, leaving this object
+  // unchanged, if the index is inconsistent with the bitmap or larger than
+  // size.
+  size_t BorrowIndex(const uint64* bits, size_t num_bits, const char* index,
+                     size_t size);
+
   static constexpr uint64 kOne = 1;
   static constexpr uint32 kStorageBitSize = 64;
   static constexpr uint32 kStorageLogBitSize = 6;
@@ -320,24 +340,50 @@ class BitmapIndex {
            1;
   }
 
+  // A read-only view of an index array, either owned by this object or
+  // borrowed from serialized data.
+  template <class T>
+  class IndexArray {
+   public:
+    IndexArray() = default;
+    explicit IndexArray(const std::vector<T>& v)
+        : data_(v.data()), size_(v.size()) {}
+    IndexArray(const T* data, size_t size) : data_(data), size_(size) {}
+
+    const T* data() const { return data_; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    const T& back() const { return data_[size_ - 1]; }
+    const T& operator[](size_t i) const { return data_[i]; }
+
+   private:
+    const T* data_ = nullptr;
+    size_t size_ = 0;
+  };
+
   const uint64* bits_ = nullptr;
   size_t num_bits_ = 0;
 
-  std::vector<RankIndexEntry> rank_index_;
+  // Storage for the indices when built rather than borrowed.
+  std::vector<RankIndexEntry> rank_index_storage_;
+  std::vector<uint32> select_0_index_storage_;
+  std::vector<uint32> select_1_index_storage_;
+
+  IndexArray<RankIndexEntry> rank_index_;
 
   // Index of positions for Select0
   // select_0_index_[i] == Select0(kBitsPerSelect0Block * i).
   // Empty means there is no index, otherwise, we always add an extra entry
   // with num_bits_. Overhead is 4 bytes / 64 bytes of zeros,
   // so 4/64 times the density of zeros. This is 6.25% * zeros_density.
-  std::vector<uint32> select_0_index_;
+  IndexArray<uint32> select_0_index_;
 
   // Index of positions for Select1
   // select_1_index_[i] == Select1(kBitsPerSelect1Block * i).
   // Empty means there is no index, otherwise, we always add an extra entry
   // with num_bits_. Overhead is 4 bytes / 64 bytes of ones,
   // so 4/64 times the density of ones. This is 6.25% * ones_density.
-  std::vector<uint32> select_1_index_;
+  IndexArray<uint32> select_1_index_;
 };
 
 }  // end namespace fst
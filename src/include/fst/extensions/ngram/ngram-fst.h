@@ -26,6 +26,7 @@
 #include <cstddef>
 #include <cstring>
 #include <iostream>
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
@@ -114,25 +115,47 @@ class NGramFstImpl : public FstImpl<A> {
     auto impl = fst::make_unique<NGramFstImpl<A>>();
     FstHeader hdr;
     if (!impl->ReadHeader(strm, opts, kMinFileVersion, &hdr)) return nullptr;
-    uint64 num_states, num_futures, num_final;
-    const size_t offset =
-        sizeof(num_states) + sizeof(num_futures) + sizeof(num_final);
-    // Peek at num_states and num_futures to see how much more needs to be read.
-    strm.read(reinterpret_cast<char *>(&num_states), sizeof(num_states));
-    strm.read(reinterpret_cast<char *>(&num_futures), sizeof(num_futures));
-    strm.read(reinterpret_cast<char *>(&num_final), sizeof(num_final));
-    size_t size = Storage(num_states, num_futures, num_final);
-    MappedFile *data_region = MappedFile::Allocate(size);
-    char *data = static_cast<char *>(data_region->mutable_data());
-    // Copy num_states, num_futures and num_final back into data.
-    memcpy(data, reinterpret_cast<char *>(&num_states), sizeof(num_states));
-    memcpy(data + sizeof(num_states), reinterpret_cast<char *>(&num_futures),
-           sizeof(num_futures));
-    memcpy(data + sizeof(num_states) + sizeof(num_futures),
-           reinterpret_cast<char *>(&num_final), sizeof(num_final));
-    strm.read(data + offset, size - offset);
-    if (strm.fail()) return nullptr;
-    impl->Init(data, false, data_region);
+    if (hdr.Version() < kIndexFileVersion) {
+      return ReadData(strm, std::move(impl));
+    }
+    // The data and the rank/select indices of its bitmaps are mapped as is.
+    uint64 data_size, index_size;
+    ReadType(strm, &data_size);
+    ReadType(strm, &index_size);
+    if (!strm) {
+      LOG(ERROR) << "NGramFst::Read: Read failed: " << opts.source;
+      return nullptr;
+    }
+    const bool aligned = hdr.GetFlags() & FstHeader::IS_ALIGNED;
+    if (aligned && !AlignInput(strm)) {
+      LOG(ERROR) << "NGramFst::Read: Alignment failed: " << opts.source;
+      return nullptr;
+    }
+    std::unique_ptr<MappedFile> data_region(
+        MappedFile::Map(&strm, opts.mode == FstReadOptions::MAP, opts.source,
+                        data_size));
+    if (!data_region) return nullptr;
+    if (aligned && !AlignInput(strm)) {
+      LOG(ERROR) << "NGramFst::Read: Alignment failed: " << opts.source;
+      return nullptr;
+    }
+    std::unique_ptr<MappedFile> index_region(
+        MappedFile::Map(&strm, opts.mode == FstReadOptions::MAP, opts.source,
+                        index_size));
+    if (!index_region) return nullptr;
+    const auto *data = static_cast<const char *>(data_region->data());
+    uint64 counts[3];
+    if (data_size < sizeof(counts)) {
+      LOG(ERROR) << "NGramFst::Read: Malformed file: " << opts.source;
+      return nullptr;
+    }
+    memcpy(counts, data, sizeof(counts));
+    if (Storage(counts[0], counts[1], counts[2]) != data_size) {
+      LOG(ERROR) << "NGramFst::Read: Malformed file: " << opts.source;
+      return nullptr;
+    }
+    impl->Init(data, false, data_region.release(), index_region.release(),
+               index_size);
     return impl.release();
   }
 
@@ -140,8 +163,24 @@ class NGramFstImpl : public FstImpl<A> {
     FstHeader hdr;
     hdr.SetStart(Start());
     hdr.SetNumStates(num_states_);
-    WriteHeader(strm, opts, kFileVersion, &hdr);
-    strm.write(data_, StorageSize());
+    // Aligns the data and indices for mapping unless the position of the
+    // output stream is unknown, as when writing to a pipe.
+    const bool aligned = strm.tellp() >= 0;
+    FstWriteOptions header_opts(opts);
+    header_opts.align = aligned;
+    WriteHeader(strm, header_opts, kFileVersion, &hdr);
+    const uint64 data_size = StorageSize();
+    const uint64 index_size = context_index_.SerializedIndexBytes() +
+                              future_index_.SerializedIndexBytes() +
+                              final_index_.SerializedIndexBytes();
+    WriteType(strm, data_size);
+    WriteType(strm, index_size);
+    if (aligned && !AlignOutput(strm)) return false;
+    strm.write(data_, data_size);
+    if (aligned && !AlignOutput(strm)) return false;
+    context_index_.WriteIndex(strm);
+    future_index_.WriteIndex(strm);
+    final_index_.WriteIndex(strm);
     return !strm.fail();
   }
 
@@ -237,7 +276,11 @@ class NGramFstImpl : public FstImpl<A> {
     return data_;
   }
 
-  void Init(const char *data, bool owned, MappedFile *file = nullptr);
+  // Sets up the FST from its data, as returned by GetData. The rank and select
+  // indices of the bitmaps are used as is from index_file, of index_size
+  // bytes, if provided, and otherwise built.
+  void Init(const char *data, bool owned, MappedFile *file = nullptr,
+            MappedFile *index_file = nullptr, size_t index_size = 0);
 
   const std::vector<Label> &GetContext(StateId s, NGramFstInst<A> *inst) const {
     SetInstFuture(s, inst);
@@ -253,6 +296,31 @@ class NGramFstImpl : public FstImpl<A> {
                  std::vector<StateId> *states) const;
 
  private:
+  // Reads the data of a file without indices, which are built by Init.
+  static NGramFstImpl<A> *ReadData(std::istream &strm,
+                                   std::unique_ptr<NGramFstImpl<A>> impl) {
+    uint64 num_states, num_futures, num_final;
+    const size_t offset =
+        sizeof(num_states) + sizeof(num_futures) + sizeof(num_final);
+    // Peek at num_states and num_futures to see how much more needs to be read.
+    strm.read(reinterpret_cast<char *>(&num_states), sizeof(num_states));
+    strm.read(reinterpret_cast<char *>(&num_futures), sizeof(num_futures));
+    strm.read(reinterpret_cast<char *>(&num_final), sizeof(num_final));
+    size_t size = Storage(num_states, num_futures, num_final);
+    MappedFile *data_region = MappedFile::Allocate(size);
+    char *data = static_cast<char *>(data_region->mutable_data());
+    // Copy num_states, num_futures and num_final back into data.
+    memcpy(data, reinterpret_cast<char *>(&num_states), sizeof(num_states));
+    memcpy(data + sizeof(num_states), reinterpret_cast<char *>(&num_futures),
+           sizeof(num_futures));
+    memcpy(data + sizeof(num_states) + sizeof(num_futures),
+           reinterpret_cast<char *>(&num_final), sizeof(num_final));
+    strm.read(data + offset, size - offset);
+    if (strm.fail()) return nullptr;
+    impl->Init(data, false, data_region);
+    return impl.release();
+  }
+
   StateId Transition(const std::vector<Label> &context, Label future) const;
 
   // Properties always true for this Fst class.
@@ -262,11 +330,14 @@ class NGramFstImpl : public FstImpl<A> {
       kInitialAcyclic | kNotTopSorted | kAccessible | kCoAccessible |
       kNotString | kExpanded;
   // Current file format version.
-  static constexpr int kFileVersion = 4;
+  static constexpr int kFileVersion = 5;
   // Minimum file format version supported.
   static constexpr int kMinFileVersion = 4;
+  // First file format version with serialized rank and select indices.
+  static constexpr int kIndexFileVersion = 5;
 
   std::unique_ptr<MappedFile> data_region_;
+  std::unique_ptr<MappedFile> index_region_;
   const char *data_ = nullptr;
   bool owned_ = false;  // True if we own data_
   StateId start_ = fst::kNoStateId;
@@ -713,11 +784,14 @@ NGramFstImpl<A>::NGramFstImpl(const Fst<A> &fst,
 
 template <typename A>
 inline void NGramFstImpl<A>::Init(const char *data, bool owned,
-                                  MappedFile *data_region) {
+                                  MappedFile *data_region,
+                                  MappedFile *index_region,
+                                  size_t index_size) {
   if (owned_) {
     delete[] data_;
   }
   data_region_.reset(data_region);
+  index_region_.reset(index_region);
   owned_ = owned;
   data_ = data;
   size_t offset = 0;
@@ -747,13 +821,33 @@ inline void NGramFstImpl<A>::Init(const char *data, bool owned,
   offset += num_final_ * sizeof(*final_probs_);
   future_probs_ = reinterpret_cast<const Weight *>(data_ + offset);
 
-  context_index_.BuildIndex(context_, context_bits,
-                            /*enable_select_0_index=*/true,
-                            /*enable_select_1_index=*/true);
-  future_index_.BuildIndex(future_, future_bits,
-                           /*enable_select_0_index=*/true,
-                           /*enable_select_1_index=*/false);
-  final_index_.BuildIndex(final_, num_states_);
+  if (index_region_) {
+    const auto *index = static_cast<const char *>(index_region_->data());
+    size_t pos = 0;
+    const auto borrow = [&](BitmapIndex *bitmap_index, const uint64 *bits,
+                            size_t num_bits) {
+      const size_t size = bitmap_index->BorrowIndex(bits, num_bits,
+                                                    index + pos,
+                                                    index_size - pos);
+      pos += size;
+      return size > 0;
+    };
+    if (!borrow(&context_index_, context_, context_bits) ||
+        !borrow(&future_index_, future_, future_bits) ||
+        !borrow(&final_index_, final_, num_states_)) {
+      FSTERROR() << "Malformed file";
+      SetProperties(kError, kError);
+      return;
+    }
+  } else {
+    context_index_.BuildIndex(context_, context_bits,
+                              /*enable_select_0_index=*/true,
+                              /*enable_select_1_index=*/true);
+    future_index_.BuildIndex(future_, future_bits,
+                             /*enable_select_0_index=*/true,
+                             /*enable_select_1_index=*/false);
+    final_index_.BuildIndex(final_, num_states_);
+  }
 
   select_root_ = context_index_.Select0s(0);
   if (context_index_.Rank1(0) != 0 || select_root_.first != 1 ||
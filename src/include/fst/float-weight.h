@@ -186,6 +186,21 @@ inline std::istream &operator>>(std::istream &strm, FloatWeightTpl<T> &w) {
   return strm;
 }
 
+namespace internal {
+
+template <class T>
+std::true_type IsFloatWeightHelper(const FloatWeightTpl<T> *);
+
+std::false_type IsFloatWeightHelper(const void *);
+
+}  // namespace internal
+
+// Whether W is derived from FloatWeightTpl, and so is read and written by the
+// stream operators above.
+template <class W>
+using IsFloatWeight = decltype(
+    internal::IsFloatWeightHelper(static_cast<const W *>(nullptr)));
+
 // Tropical semiring: (min, +, inf, 0).
 template <class T>
 class TropicalWeightTpl : public FloatWeightTpl<T> {
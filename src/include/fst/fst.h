@@ -61,6 +61,7 @@
 
 
 DECLARE_bool(fst_align);
+DECLARE_bool(fst_intern_symbols);
 
 namespace fst {
 
@@ -94,6 +95,9 @@ struct FstReadOptions {
   FileReadMode mode;            // Read or map files (advisory, if possible)
   bool read_isymbols;           // Read isymbols, if any (default: true).
   bool read_osymbols;           // Read osymbols, if any (default: true).
+  SymbolTableInterner *symbols_interner;  // If non-null, share the symbols
+                                          // read (default: the global
+                                          // interner if --fst_intern_symbols).
 
   explicit FstReadOptions(const std::string_view source = "<unspecified>",
                           const FstHeader *header = nullptr,
@@ -924,13 +928,17 @@ bool FstImpl<Arc>::ReadHeader(std::istream &strm, const FstReadOptions &opts,
     return false;
   }
   properties_.store(hdr->Properties(), std::memory_order_relaxed);
+  SymbolTableReadOptions symbols_opts;
+  symbols_opts.source = opts.source;
+  symbols_opts.memory_map = opts.mode == FstReadOptions::MAP;
+  symbols_opts.interner = opts.symbols_interner;
   if (hdr->GetFlags() & FstHeader::HAS_ISYMBOLS) {
-    isymbols_.reset(SymbolTable::Read(strm, opts.source));
+    isymbols_.reset(SymbolTable::Read(strm, symbols_opts));
   }
   // Deletes input symbol table.
   if (!opts.read_isymbols) SetInputSymbols(nullptr);
   if (hdr->GetFlags() & FstHeader::HAS_OSYMBOLS) {
-    osymbols_.reset(SymbolTable::Read(strm, opts.source));
+    osymbols_.reset(SymbolTable::Read(strm, symbols_opts));
   }
   // Deletes output symbol table.
   if (!opts.read_osymbols) SetOutputSymbols(nullptr);
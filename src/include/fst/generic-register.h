@@ -56,7 +56,7 @@ class GenericRegister {
   }
 
   void SetEntry(const KeyType &key, const EntryType &entry) {
-    MutexLock l(&register_lock_);
+    WriterMutexLock l(&register_lock_);
     register_table_.emplace(key, entry);
   }
 
@@ -104,7 +104,7 @@ class GenericRegister {
   virtual std::string ConvertKeyToSoFilename(const KeyType &key) const = 0;
 
   virtual const EntryType *LookupEntry(const KeyType &key) const {
-    MutexLock l(&register_lock_);
+    ReaderMutexLock l(&register_lock_);
     const auto it = register_table_.find(key);
     if (it != register_table_.end()) {
       return &it->second;
@@ -114,7 +114,7 @@ class GenericRegister {
   }
 
  private:
-  mutable Mutex register_lock_;
+  mutable SharedMutex register_lock_;
   std::map<KeyType, EntryType> register_table_;
 };
 
@@ -27,12 +27,17 @@ namespace fst {
 using absl::Mutex;
 using absl::MutexLock;
 using absl::ReaderMutexLock;
+using absl::WriterMutexLock;
+
+// absl::Mutex already supports shared (reader) locking.
+using SharedMutex = absl::Mutex;
 
 }  // namespace fst
 
 #else  // OPENFST_HAS_ABSL
 
 #include <mutex>
+#include <shared_mutex>
 
 namespace fst {
 
@@ -64,10 +69,52 @@ class MutexLock {
   MutexLock &operator=(const MutexLock &) = delete;
 };
 
-// Currently, we don't use a separate reader lock.
-// TODO(kbg): Implement this with std::shared_mutex once C++17 becomes widely
-// available.
-using ReaderMutexLock = MutexLock;
+// A mutex which may be held either exclusively by one writer or shared by any
+// number of readers.
+class SharedMutex {
+ public:
+  SharedMutex() {}
+
+  inline void Lock() { mu_.lock(); }
+
+  inline void Unlock() { mu_.unlock(); }
+
+  inline void ReaderLock() { mu_.lock_shared(); }
+
+  inline void ReaderUnlock() { mu_.unlock_shared(); }
+
+ private:
+  std::shared_mutex mu_;
+
+  SharedMutex(const SharedMutex &) = delete;
+  SharedMutex &operator=(const SharedMutex &) = delete;
+};
+
+class ReaderMutexLock {
+ public:
+  explicit ReaderMutexLock(SharedMutex *mu) : mu_(mu) { mu_->ReaderLock(); }
+
+  ~ReaderMutexLock() { mu_->ReaderUnlock(); }
+
+ private:
+  SharedMutex *mu_;
+
+  ReaderMutexLock(const ReaderMutexLock &) = delete;
+  ReaderMutexLock &operator=(const ReaderMutexLock &) = delete;
+};
+
+class WriterMutexLock {
+ public:
+  explicit WriterMutexLock(SharedMutex *mu) : mu_(mu) { mu_->Lock(); }
+
+  ~WriterMutexLock() { mu_->Unlock(); }
+
+ private:
+  SharedMutex *mu_;
+
+  WriterMutexLock(const WriterMutexLock &) = delete;
+  WriterMutexLock &operator=(const WriterMutexLock &) = delete;
+};
 
 }  // namespace fst
 
@@ -0,0 +1,221 @@
+// Copyright 2005-2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the 'License');
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an 'AS IS' BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// See www.openfst.org for extensive documentation on this weighted
+// finite-state transducer library.
+//
+// Batch log-sum-exp kernels for the log semiring. A single call sums many
+// log weights using SIMD instructions when the target supports them (AVX2, or
+// SSE2), and a scalar fallback otherwise. The exponential is evaluated by
+// range reduction and a polynomial, so all paths use the same arithmetic.
+
+#ifndef FST_LOG_SUM_EXP_H_
+#define FST_LOG_SUM_EXP_H_
+
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <type_traits>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include <fst/types.h>
+
+#include <fst/float-weight.h>
+#include <fst/weight.h>
+
+namespace fst {
+namespace internal {
+
+// Constants for ExpNonPositive().
+inline constexpr double kExpMinArg = -708.0;  // exp() underflows below this.
+inline constexpr double kExpLog2E = 1.44269504088896340736;
+inline constexpr double kExpLn2Hi = 6.93147180369123816490e-01;
+inline constexpr double kExpLn2Lo = 1.90821492927058770002e-10;
+// Adding and subtracting 1.5 * 2^52 rounds to the nearest integer, which is
+// left in the low mantissa bits.
+inline constexpr double kExpRound = 6755399441055744.0;
+// Taylor coefficients 1/i! of e^r, highest degree first; the truncation error
+// is below 2^-52 for |r| <= ln(2)/2.
+inline constexpr double kExpPoly[] = {
+    1.0 / 6227020800.0, 1.0 / 479001600.0, 1.0 / 39916800.0,
+    1.0 / 3628800.0,    1.0 / 362880.0,    1.0 / 40320.0,
+    1.0 / 5040.0,       1.0 / 720.0,       1.0 / 120.0,
+    1.0 / 24.0,         1.0 / 6.0,         1.0 / 2.0,
+    1.0,                1.0};
+
+// Returns e^x for x <= 0 (and 0 for x < kExpMinArg or NaN), computed as
+// 2^k e^r with x = k ln(2) + r.
+inline double ExpNonPositive(double x) {
+  if (!(x >= kExpMinArg)) return 0.0;
+  const double k = std::nearbyint(x * kExpLog2E);
+  const double r = x - k * kExpLn2Hi - k * kExpLn2Lo;
+  double p = kExpPoly[0];
+  for (size_t i = 1; i < sizeof(kExpPoly) / sizeof(kExpPoly[0]); ++i) {
+    p = p * r + kExpPoly[i];
+  }
+  return std::ldexp(p, static_cast<int>(k));
+}
+
+#if defined(__AVX2__)
+
+inline __m256d LoadPd4(const double *x) { return _mm256_loadu_pd(x); }
+
+inline __m256d LoadPd4(const float *x) {
+  return _mm256_cvtps_pd(_mm_loadu_ps(x));
+}
+
+// Four-way version of ExpNonPositive().
+inline __m256d ExpNonPositive4(__m256d x) {
+  const __m256d valid =
+      _mm256_cmp_pd(x, _mm256_set1_pd(kExpMinArg), _CMP_GE_OQ);
+  x = _mm256_max_pd(x, _mm256_set1_pd(kExpMinArg));
+  const __m256d round = _mm256_set1_pd(kExpRound);
+  const __m256d kd =
+      _mm256_add_pd(_mm256_mul_pd(x, _mm256_set1_pd(kExpLog2E)), round);
+  const __m256d k = _mm256_sub_pd(kd, round);
+  const __m256d r = _mm256_sub_pd(
+      _mm256_sub_pd(x, _mm256_mul_pd(k, _mm256_set1_pd(kExpLn2Hi))),
+      _mm256_mul_pd(k, _mm256_set1_pd(kExpLn2Lo)));
+  __m256d p = _mm256_set1_pd(kExpPoly[0]);
+  for (size_t i = 1; i < sizeof(kExpPoly) / sizeof(kExpPoly[0]); ++i) {
+    p = _mm256_add_pd(_mm256_mul_pd(p, r), _mm256_set1_pd(kExpPoly[i]));
+  }
+  const __m256i kbits = _mm256_sub_epi64(_mm256_castpd_si256(kd),
+                                         _mm256_castpd_si256(round));
+  const __m256d scale = _mm256_castsi256_pd(_mm256_slli_epi64(
+      _mm256_add_epi64(kbits, _mm256_set1_epi64x(1023)), 52));
+  return _mm256_and_pd(_mm256_mul_pd(p, scale), valid);
+}
+
+// Returns the sum of e^(min - x[i]) over [begin, end), four at a time; sets
+// *begin to the first index not processed.
+template <class T>
+double SumExpSimd(const T *x, size_t *begin, size_t end, double min) {
+  const __m256d vmin = _mm256_set1_pd(min);
+  __m256d vsum = _mm256_setzero_pd();
+  auto i = *begin;
+  for (; i + 4 <= end; i += 4) {
+    vsum = _mm256_add_pd(
+        vsum, ExpNonPositive4(_mm256_sub_pd(vmin, LoadPd4(x + i))));
+  }
+  *begin = i;
+  alignas(32) double lanes[4];
+  _mm256_store_pd(lanes, vsum);
+  return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+}
+
+#elif defined(__SSE2__)
+
+inline __m128d LoadPd2(const double *x) { return _mm_loadu_pd(x); }
+
+inline __m128d LoadPd2(const float *x) {
+  return _mm_cvtps_pd(
+      _mm_castsi128_ps(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(x))));
+}
+
+// Two-way version of ExpNonPositive().
+inline __m128d ExpNonPositive2(__m128d x) {
+  const __m128d valid = _mm_cmpge_pd(x, _mm_set1_pd(kExpMinArg));
+  x = _mm_max_pd(x, _mm_set1_pd(kExpMinArg));
+  const __m128d round = _mm_set1_pd(kExpRound);
+  const __m128d kd = _mm_add_pd(_mm_mul_pd(x, _mm_set1_pd(kExpLog2E)), round);
+  const __m128d k = _mm_sub_pd(kd, round);
+  const __m128d r =
+      _mm_sub_pd(_mm_sub_pd(x, _mm_mul_pd(k, _mm_set1_pd(kExpLn2Hi))),
+                 _mm_mul_pd(k, _mm_set1_pd(kExpLn2Lo)));
+  __m128d p = _mm_set1_pd(kExpPoly[0]);
+  for (size_t i = 1; i < sizeof(kExpPoly) / sizeof(kExpPoly[0]); ++i) {
+    p = _mm_add_pd(_mm_mul_pd(p, r), _mm_set1_pd(kExpPoly[i]));
+  }
+  const __m128i kbits =
+      _mm_sub_epi64(_mm_castpd_si128(kd), _mm_castpd_si128(round));
+  const __m128d scale = _mm_castsi128_pd(
+      _mm_slli_epi64(_mm_add_epi64(kbits, _mm_set1_epi64x(1023)), 52));
+  return _mm_and_pd(_mm_mul_pd(p, scale), valid);
+}
+
+// Returns the sum of e^(min - x[i]) over [begin, end), two at a time; sets
+// *begin to the first index not processed.
+template <class T>
+double SumExpSimd(const T *x, size_t *begin, size_t end, double min) {
+  const __m128d vmin = _mm_set1_pd(min);
+  __m128d vsum = _mm_setzero_pd();
+  auto i = *begin;
+  for (; i + 2 <= end; i += 2) {
+    vsum = _mm_add_pd(vsum, ExpNonPositive2(_mm_sub_pd(vmin, LoadPd2(x + i))));
+  }
+  *begin = i;
+  alignas(16) double lanes[2];
+  _mm_store_pd(lanes, vsum);
+  return lanes[0] + lanes[1];
+}
+
+#else  // Scalar fallback.
+
+template <class T>
+double SumExpSimd(const T *x, size_t *begin, size_t end, double min) {
+  return 0.0;
+}
+
+#endif
+
+// Returns -log(sum_i e^-x[i]), i.e., the log semiring sum of the n weights
+// with values x[i]. Returns infinity (Zero) if n is zero and NaN (NoWeight) if
+// any value is NaN.
+template <class T>
+double LogSumExp(const T *x, size_t n) {
+  double min = std::numeric_limits<double>::infinity();
+  for (size_t i = 0; i < n; ++i) {
+    const double v = x[i];
+    if (v < min) {
+      min = v;
+    } else if (std::isnan(v)) {
+      return v;
+    }
+  }
+  if (std::isinf(min)) return min;
+  size_t i = 0;
+  double sum = SumExpSimd(x, &i, n, min);
+  for (; i < n; ++i) sum += ExpNonPositive(min - x[i]);
+  return min - std::log(sum);
+}
+
+}  // namespace internal
+
+// Sums n weights with Plus(), accurately.
+template <class Weight>
+Weight SumWeights(const Weight *weights, size_t n) {
+  Adder<Weight> adder;
+  for (size_t i = 0; i < n; ++i) adder.Add(weights[i]);
+  return adder.Sum();
+}
+
+// Log semiring specialization using the batch log-sum-exp kernels.
+template <class T>
+LogWeightTpl<T> SumWeights(const LogWeightTpl<T> *weights, size_t n) {
+  static_assert(std::is_standard_layout<LogWeightTpl<T>>::value &&
+                    sizeof(LogWeightTpl<T>) == sizeof(T),
+                "LogWeightTpl must hold only its value");
+  return LogWeightTpl<T>(
+      internal::LogSumExp(reinterpret_cast<const T *>(weights), n));
+}
+
+}  // namespace fst
+
+#endif  // FST_LOG_SUM_EXP_H_
@@ -25,6 +25,8 @@
 
 #include <cstddef>
 #include <istream>
+#include <memory>
+#include <streambuf>
 #include <string>
 
 #include <fst/flags.h>
@@ -60,7 +62,8 @@ class MappedFile {
   // strm starting from the current file position with size bytes. The memorymap
   // bool is advisory, and Map will default to allocating and reading. The
   // source argument needs to contain the filename that was used to open the
-  // input stream.
+  // input stream. If strm is a MappedFileInputStream positioned at an aligned
+  // address, a view of its contents is returned instead, whatever memorymap.
   static MappedFile *Map(std::istream *istrm, bool memorymap,
                          const std::string &source, size_t size);
 
@@ -91,6 +94,10 @@ class MappedFile {
   // releases.
   static MappedFile *Borrow(void *data);
 
+  // Creates a MappedFile object pointing to the data at pos in the contents of
+  // file, which are kept alive as long as the returned object.
+  static MappedFile *View(std::shared_ptr<const MappedFile> file, size_t pos);
+
   // Alignment required for mapping structures in bytes. Regions of memory that
   // are not aligned upon a 128-bit boundary are read from the file instead.
   // This is consistent with the alignment boundary set in ConstFst and
@@ -103,9 +110,37 @@ class MappedFile {
   explicit MappedFile(const MemoryRegion &region);
 
   MemoryRegion region_;
+  std::shared_ptr<const MappedFile> owner_;  // Set for views.
   MappedFile(const MappedFile &) = delete;
   MappedFile &operator=(const MappedFile &) = delete;
 };
+
+// An input stream over size bytes of the contents of a shared MappedFile,
+// typically a whole memory-mapped file. Objects read from it through
+// MappedFile::Map(), such as the arrays of ConstFst and CompactFst, refer to
+// its contents directly when suitably aligned.
+class MappedFileInputStream : public std::istream {
+ public:
+  MappedFileInputStream(std::shared_ptr<const MappedFile> file, size_t size);
+
+  const std::shared_ptr<const MappedFile> &File() const { return file_; }
+
+ private:
+  class StreamBuf : public std::streambuf {
+   public:
+    StreamBuf(const char *data, size_t size);
+
+   protected:
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir,
+                     std::ios_base::openmode which) override;
+
+    pos_type seekpos(pos_type pos, std::ios_base::openmode which) override;
+  };
+
+  std::shared_ptr<const MappedFile> file_;
+  StreamBuf buf_;
+};
+
 }  // namespace fst
 
 #endif  // FST_MAPPED_FILE_H_
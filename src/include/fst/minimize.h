@@ -23,7 +23,10 @@
 #include <algorithm>
 #include <cmath>
 #include <map>
+#include <memory>
+#include <numeric>
 #include <queue>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -43,6 +46,7 @@
 #include <fst/reverse.h>
 #include <fst/shortest-distance.h>
 #include <fst/state-map.h>
+#include <fst/thread-pool.h>
 
 namespace fst {
 namespace internal {
@@ -312,9 +316,11 @@ class AcyclicMinimizer {
   using ClassId = typename Arc::StateId;
   using Weight = typename Arc::Weight;
 
-  explicit AcyclicMinimizer(const ExpandedFst<Arc> &fst) {
+  // With num_threads > 1, large heights are refined in parallel, giving the
+  // same partition.
+  explicit AcyclicMinimizer(const ExpandedFst<Arc> &fst, int num_threads = 1) {
     Initialize(fst);
-    Refine(fst);
+    Refine(fst, num_threads);
   }
 
   const Partition<StateId> &GetPartition() { return partition_; }
@@ -389,12 +395,18 @@ class AcyclicMinimizer {
   }
 
   // Refines states based on arc sort (out degree, arc equivalence).
-  void Refine(const Fst<Arc> &fst) {
+  void Refine(const Fst<Arc> &fst, int num_threads) {
     using EquivalenceMap = std::map<StateId, StateId, StateComparator<Arc>>;
     StateComparator<Arc> comp(fst, partition_);
+    std::unique_ptr<ThreadPool> pool(
+        num_threads > 1 ? new ThreadPool(num_threads) : nullptr);
     // Starts with tail (height = 0).
     auto height = partition_.NumClasses();
     for (StateId h = 0; h < height; ++h) {
+      if (pool && partition_.ClassSize(h) >= kMinParallelStates) {
+        RefineParallel(fst, comp, h, pool.get());
+        continue;
+      }
       EquivalenceMap equiv_classes(comp);
       // Sorts states within equivalence class.
       PartitionIterator<StateId> siter(partition_, h);
@@ -419,10 +431,244 @@ class AcyclicMinimizer {
     }
   }
 
- private:
+  // Refines the states of height h as Refine() does, sorting them on one shard
+  // per thread. Equivalent states hash alike and so share a shard; the new
+  // classes are then allocated and the states moved in partition order, which
+  // gives the same partition.
+  void RefineParallel(const Fst<Arc> &fst, const StateComparator<Arc> &comp,
+                      StateId h, ThreadPool *pool) {
+    std::vector<StateId> states;
+    states.reserve(partition_.ClassSize(h));
+    for (PartitionIterator<StateId> siter(partition_, h); !siter.Done();
+         siter.Next()) {
+      states.push_back(siter.Value());
+    }
+    const size_t nshards = pool->NumThreads();
+    std::vector<size_t> hashes(states.size());
+    ParallelFor(
+        pool, 0, states.size(),
+        [&](size_t i) { hashes[i] = Hash(fst, states[i]); }, kMinChunk);
+    std::vector<std::vector<size_t>> shards(nshards);
+    for (size_t i = 0; i < states.size(); ++i) {
+      shards[hashes[i] % nshards].push_back(i);
+    }
+    // Index of the first state equivalent to each state.
+    std::vector<size_t> first(states.size());
+    ParallelFor(pool, 0, nshards, [&](size_t shard) {
+      std::map<StateId, size_t, StateComparator<Arc>> equiv_classes(comp);
+      for (const auto i : shards[shard]) {
+        first[i] = equiv_classes.emplace(states[i], i).first->second;
+      }
+    });
+    std::vector<StateId> new_classes(states.size());
+    for (size_t i = 0; i < states.size(); ++i) {
+      if (first[i] != i) {
+        new_classes[i] = new_classes[first[i]];
+      } else {
+        new_classes[i] = i == 0 ? h : partition_.AddClass();
+      }
+      if (new_classes[i] != h) partition_.Move(states[i], new_classes[i]);
+    }
+  }
+
+  // Hashes a state consistently with the equivalence of StateComparator.
+  size_t Hash(const Fst<Arc> &fst, StateId s) const {
+    static constexpr size_t p = 7603;
+    size_t result = fst.Final(s).Hash();
+    for (ArcIterator<Fst<Arc>> aiter(fst, s); !aiter.Done(); aiter.Next()) {
+      const auto &arc = aiter.Value();
+      result = p * result + arc.ilabel;
+      result = p * result + partition_.ClassId(arc.nextstate);
+    }
+    return result;
+  }
+
+  // Minimum number of states of a height refined in parallel.
+  static constexpr StateId kMinParallelStates = 4096;
+  // Minimum number of states hashed by a thread.
+  static constexpr size_t kMinChunk = 1024;
+
   Partition<StateId> partition_;
 };
 
+// Computes equivalence classes for deterministic acceptors on several threads,
+// using Moore's algorithm since the worklist of Hopcroft's is inherently
+// sequential. Each round computes the signature of every state (its class and
+// the ilabels and destination classes of its arcs) in parallel and splits the
+// classes into states with equal signatures, until a round splits no class.
+// A round takes O(E) time, and there are at most V rounds though usually far
+// fewer. The arcs must be sorted by ilabel.
+//
+// The partition is the one Hopcroft's algorithm computes, but each class is
+// listed from its lowest state, so the merged states may be numbered
+// differently from CyclicMinimizer.
+//
+// For more information, see:
+//
+//  Moore, E. 1956. Gedanken-experiments on sequential machines. In C. Shannon
+//  and J. McCarthy, ed., Automata Studies, pages 129-153. Princeton
+//  University Press.
+template <class Arc>
+class ParallelCyclicMinimizer {
+ public:
+  using StateId = typename Arc::StateId;
+  using ClassId = typename Arc::StateId;
+  using Weight = typename Arc::Weight;
+
+  ParallelCyclicMinimizer(const ExpandedFst<Arc> &fst, int num_threads)
+      : fst_(fst), pool_(num_threads) {
+    Compute();
+  }
+
+  const Partition<StateId> &GetPartition() const { return P_; }
+
+ private:
+  // Minimum number of states handled by a thread.
+  static constexpr size_t kMinChunk = 1024;
+
+  // Hashing and comparison objects for state signatures.
+  class SignatureHash {
+   public:
+    explicit SignatureHash(const ParallelCyclicMinimizer &minimizer)
+        : minimizer_(minimizer) {}
+
+    // The low part of the hash chooses the shard.
+    size_t operator()(StateId s) const {
+      return minimizer_.hashes_[s] / minimizer_.nshards_;
+    }
+
+   private:
+    const ParallelCyclicMinimizer &minimizer_;
+  };
+
+  class SignatureEqual {
+   public:
+    explicit SignatureEqual(const ParallelCyclicMinimizer &minimizer)
+        : minimizer_(minimizer) {}
+
+    bool operator()(StateId s, StateId t) const {
+      return minimizer_.Equal(s, t);
+    }
+
+   private:
+    const ParallelCyclicMinimizer &minimizer_;
+  };
+
+  size_t Hash(StateId s) const {
+    static constexpr size_t p = 7603;
+    size_t result = classes_[s];
+    for (ArcIterator<Fst<Arc>> aiter(fst_, s); !aiter.Done(); aiter.Next()) {
+      const auto &arc = aiter.Value();
+      result = p * result + arc.ilabel;
+      result = p * result + classes_[arc.nextstate];
+    }
+    return result;
+  }
+
+  bool Equal(StateId s, StateId t) const {
+    if (classes_[s] != classes_[t]) return false;
+    if (fst_.NumArcs(s) != fst_.NumArcs(t)) return false;
+    for (ArcIterator<Fst<Arc>> aiter1(fst_, s), aiter2(fst_, t);
+         !aiter1.Done(); aiter1.Next(), aiter2.Next()) {
+      const auto &arc1 = aiter1.Value();
+      const auto &arc2 = aiter2.Value();
+      if (arc1.ilabel != arc2.ilabel ||
+          classes_[arc1.nextstate] != classes_[arc2.nextstate]) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  size_t Shard(StateId s) const { return hashes_[s] % nshards_; }
+
+  // Splits the classes by signature, renumbering them; returns the number of
+  // classes.
+  ClassId Refine() {
+    const size_t num_states = classes_.size();
+    ParallelFor(
+        &pool_, 0, num_states, [this](size_t s) { hashes_[s] = Hash(s); },
+        kMinChunk);
+    // Lists the states of each shard in increasing order, counting those of
+    // each shard in each of as many chunks of states.
+    const size_t chunk = (num_states + nshards_ - 1) / nshards_;
+    std::vector<size_t> offsets(nshards_ * nshards_ + 1, 0);
+    ParallelFor(&pool_, 0, nshards_, [&](size_t c) {
+      const auto end = std::min(num_states, (c + 1) * chunk);
+      for (auto s = c * chunk; s < end; ++s) {
+        ++offsets[Shard(s) * nshards_ + c + 1];
+      }
+    });
+    std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+    std::vector<size_t> bounds(nshards_ + 1);
+    for (size_t shard = 0; shard <= nshards_; ++shard) {
+      bounds[shard] = offsets[shard * nshards_];
+    }
+    ParallelFor(&pool_, 0, nshards_, [&](size_t c) {
+      const auto end = std::min(num_states, (c + 1) * chunk);
+      for (auto s = c * chunk; s < end; ++s) {
+        order_[offsets[Shard(s) * nshards_ + c]++] = s;
+      }
+    });
+    // Numbers the signatures of each shard.
+    std::vector<ClassId> sizes(nshards_ + 1, 0);
+    ParallelFor(&pool_, 0, nshards_, [&](size_t shard) {
+      std::unordered_map<StateId, ClassId, SignatureHash, SignatureEqual> ids(
+          bounds[shard + 1] - bounds[shard], SignatureHash(*this),
+          SignatureEqual(*this));
+      for (auto i = bounds[shard]; i < bounds[shard + 1]; ++i) {
+        const StateId s = order_[i];
+        new_classes_[s] = ids.emplace(s, ids.size()).first->second;
+      }
+      sizes[shard + 1] = ids.size();
+    });
+    std::partial_sum(sizes.begin(), sizes.end(), sizes.begin());
+    ParallelFor(
+        &pool_, 0, num_states,
+        [&](size_t s) { new_classes_[s] += sizes[Shard(s)]; }, kMinChunk);
+    classes_.swap(new_classes_);
+    return sizes.back();
+  }
+
+  void Compute() {
+    const auto num_states = fst_.NumStates();
+    nshards_ = num_states >= kMinChunk ? pool_.NumThreads() : 1;
+    classes_.resize(num_states);
+    new_classes_.resize(num_states);
+    hashes_.resize(num_states);
+    order_.resize(num_states);
+    // Starts from the final and non-final states.
+    ParallelFor(
+        &pool_, 0, num_states,
+        [this](size_t s) { classes_[s] = fst_.Final(s) != Weight::Zero(); },
+        kMinChunk);
+    ClassId num_classes = kNoStateId;
+    for (auto n = Refine(); n != num_classes; n = Refine()) num_classes = n;
+    // Numbers the classes in order of their lowest states, and lists each
+    // class starting from that state.
+    std::vector<ClassId> ids(num_classes, kNoStateId);
+    ClassId next_class = 0;
+    for (StateId s = 0; s < num_states; ++s) {
+      if (ids[classes_[s]] == kNoStateId) ids[classes_[s]] = next_class++;
+    }
+    P_.Initialize(num_states);
+    P_.AllocateClasses(num_classes);
+    for (auto s = num_states - 1; s >= 0; --s) P_.Add(s, ids[classes_[s]]);
+  }
+
+  const ExpandedFst<Arc> &fst_;
+  ThreadPool pool_;
+  size_t nshards_;
+  // Current and next class of each state.
+  std::vector<ClassId> classes_;
+  std::vector<ClassId> new_classes_;
+  // Signature hash of each state.
+  std::vector<size_t> hashes_;
+  // States grouped by shard.
+  std::vector<StateId> order_;
+  Partition<StateId> P_;
+};
+
 // Given a partition and a Mutable FST, merges states of Fst in place (i.e.,
 // destructively). Merging works by taking the first state in a class of the
 // partition to be the representative state for the class. Each arc is then
@@ -459,7 +705,7 @@ void MergeStates(const Partition<typename Arc::StateId> &partition,
 }
 
 template <class Arc>
-void AcceptorMinimize(MutableFst<Arc> *fst) {
+void AcceptorMinimize(MutableFst<Arc> *fst, int num_threads = 1) {
   // Connects FST before minimization, handles disconnected states.
   Connect(fst);
   if (fst->Start() == kNoStateId) return;
@@ -467,12 +713,20 @@ void AcceptorMinimize(MutableFst<Arc> *fst) {
   // the input is nondeterministic, we force the use of the Hopcroft cyclic
   // algorithm instead.
   static constexpr auto revuz_props = kAcyclic | kIDeterministic;
-  if (fst->Properties(revuz_props, true) == revuz_props) {
+  const auto props = fst->Properties(revuz_props, true);
+  if (props == revuz_props) {
     // Acyclic minimization (Revuz).
     VLOG(2) << "Acyclic minimization";
     static const ILabelCompare<Arc> comp;
     ArcSort(fst, comp);
-    AcyclicMinimizer<Arc> minimizer(*fst);
+    AcyclicMinimizer<Arc> minimizer(*fst, num_threads);
+    MergeStates(minimizer.GetPartition(), fst);
+  } else if (num_threads > 1 && (props & kIDeterministic)) {
+    // Cyclic deterministic minimization (Moore).
+    VLOG(2) << "Parallel cyclic minimization";
+    static const ILabelCompare<Arc> comp;
+    ArcSort(fst, comp);
+    ParallelCyclicMinimizer<Arc> minimizer(*fst, num_threads);
     MergeStates(minimizer.GetPartition(), fst);
   } else {
     // Either the FST has cycles, or it's generated from non-deterministic input
@@ -499,9 +753,15 @@ void AcceptorMinimize(MutableFst<Arc> *fst) {
 // In cyclic and non-deterministic cases, we use the classical Hopcroft
 // minimization (which was presented for the deterministic case but which
 // also works for non-deterministic FSTs); this has complexity O(e log v).
+//
+// With num_threads > 1, the acyclic deterministic case refines each height on
+// that many threads, giving the same result, and the cyclic deterministic case
+// uses a parallel version of Moore's algorithm, giving the same result up to
+// state numbering. Non-deterministic FSTs are minimized sequentially.
 template <class Arc>
 void Minimize(MutableFst<Arc> *fst, MutableFst<Arc> *sfst = nullptr,
-              float delta = kShortestDelta, bool allow_nondet = false) {
+              float delta = kShortestDelta, bool allow_nondet = false,
+              int num_threads = 1) {
   using Weight = typename Arc::Weight;
   static constexpr auto minimize_props =
       kAcceptor | kIDeterministic | kWeighted | kUnweighted;
@@ -533,7 +793,7 @@ void Minimize(MutableFst<Arc> *fst, MutableFst<Arc> *sfst = nullptr,
     EncodeMapper<GallicArc<Arc, GALLIC_LEFT>> encoder(kEncodeLabels |
                                                       kEncodeWeights);
     Encode(&gfst, &encoder);
-    internal::AcceptorMinimize(&gfst);
+    internal::AcceptorMinimize(&gfst, num_threads);
     Decode(&gfst, encoder);
     if (!sfst) {
       FactorWeightFst<GallicArc<Arc, GALLIC_LEFT>,
@@ -556,10 +816,10 @@ void Minimize(MutableFst<Arc> *fst, MutableFst<Arc> *sfst = nullptr,
     // encoding gives us a transducer.
     EncodeMapper<Arc> encoder(kEncodeLabels | kEncodeWeights);
     Encode(fst, &encoder);
-    internal::AcceptorMinimize(fst);
+    internal::AcceptorMinimize(fst, num_threads);
     Decode(fst, encoder);
   } else {  // Unweighted acceptor.
-    internal::AcceptorMinimize(fst);
+    internal::AcceptorMinimize(fst, num_threads);
   }
 }
 
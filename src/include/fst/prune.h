@@ -20,6 +20,8 @@
 #ifndef FST_PRUNE_H_
 #define FST_PRUNE_H_
 
+#include <algorithm>
+#include <atomic>
 #include <type_traits>
 #include <utility>
 #include <vector>
@@ -28,7 +30,10 @@
 
 #include <fst/arcfilter.h>
 #include <fst/heap.h>
+#include <fst/reverse.h>
 #include <fst/shortest-distance.h>
+#include <fst/thread-pool.h>
+#include <fst/vector-fst.h>
 
 
 namespace fst {
@@ -98,96 +103,155 @@ struct PruneOptions {
   bool threshold_initial;
 };
 
-// Pruning algorithm: this version modifies its input and it takes an options
-// class as an argument. After pruning the FST contains states and arcs that
-// belong to a successful path in the FST whose weight is no more than the
-// weight of the shortest path Times() the provided weight threshold. When the
-// state threshold is not kNoStateId, the output FST is further restricted to
-// have no more than the number of states in opts.state_threshold. Weights must
-// have the path property. The weight of any cycle needs to be bounded; i.e.,
-//
-//   Plus(weight, Weight::One()) == Weight::One()
-template <class Arc, class ArcFilter,
-          typename std::enable_if<(Arc::Weight::Properties() & kPath) ==
-                                  kPath>::type * = nullptr>
-void Prune(MutableFst<Arc> *fst, const PruneOptions<Arc, ArcFilter> &opts =
-                                     PruneOptions<Arc, ArcFilter>()) {
+// Reusable pruner. Pruner(opts)(fst) prunes an FST in place exactly as
+// Prune(fst, opts) below does, but keeps the shortest-distance vectors, the
+// heap, and other per-state scratch vectors between calls, so that pruning a
+// stream of small FSTs with the same options does not reallocate them every
+// time. The reversed FST and the queue used to compute the shortest distance
+// to the final states are still built anew for each FST. If opts.distance is
+// non-null, it is used for every FST. Weights must have the
+// path property. This class is not thread-safe; use one instance per thread.
+template <class Arc, class ArcFilter = AnyArcFilter<Arc>>
+class Pruner {
+ public:
   using StateId = typename Arc::StateId;
   using Weight = typename Arc::Weight;
+
+  static_assert(IsPath<Weight>::value, "Weight must have the path property");
+
+  explicit Pruner(const PruneOptions<Arc, ArcFilter> &opts)
+      : opts_(opts),
+        fdistance_(opts.distance ? *opts.distance : tmp_),
+        heap_(internal::PruneCompare<StateId, Weight>(idistance_,
+                                                      fdistance_)) {}
+
+  void operator()(MutableFst<Arc> *fst);
+
+ private:
+  using ReverseArc = fst::ReverseArc<Arc>;
   using StateHeap = Heap<StateId, internal::PruneCompare<StateId, Weight>>;
+
+  // Computes the shortest distance to the final states into tmp_.
+  void ComputeDistance(const Fst<Arc> &fst);
+
+  const PruneOptions<Arc, ArcFilter> opts_;
+  std::vector<Weight> idistance_;
+  std::vector<Weight> tmp_;
+  const std::vector<Weight> &fdistance_;
+  StateHeap heap_;
+  std::vector<bool> visited_;
+  std::vector<size_t> enqueued_;
+  std::vector<StateId> dead_;
+  std::vector<typename ReverseArc::Weight> rdistance_;
+};
+
+template <class Arc, class ArcFilter>
+void Pruner<Arc, ArcFilter>::ComputeDistance(const Fst<Arc> &fst) {
+  AnyArcFilter<ReverseArc> rarc_filter;
+  VectorFst<ReverseArc> rfst;
+  Reverse(fst, &rfst);
+  AutoQueue<StateId> state_queue(rfst, &rdistance_, rarc_filter);
+  const ShortestDistanceOptions<ReverseArc, AutoQueue<StateId>,
+                                AnyArcFilter<ReverseArc>>
+      ropts(&state_queue, rarc_filter, kNoStateId, opts_.delta);
+  ShortestDistance(rfst, &rdistance_, ropts);
+  tmp_.clear();
+  if (rdistance_.size() == 1 && !rdistance_[0].Member()) {
+    tmp_.push_back(Weight::NoWeight());
+    return;
+  }
+  for (size_t s = 1; s < rdistance_.size(); ++s) {
+    tmp_.push_back(rdistance_[s].Reverse());
+  }
+}
+
+template <class Arc, class ArcFilter>
+void Pruner<Arc, ArcFilter>::operator()(MutableFst<Arc> *fst) {
   auto ns = fst->NumStates();
   if (ns < 1) return;
-  std::vector<Weight> idistance(ns, Weight::Zero());
-  std::vector<Weight> tmp;
-  if (!opts.distance) {
-    tmp.reserve(ns);
-    ShortestDistance(*fst, &tmp, true, opts.delta);
-  }
-  const auto *fdistance = opts.distance ? opts.distance : &tmp;
-  if ((opts.state_threshold == 0) || (fdistance->size() <= fst->Start()) ||
-      ((*fdistance)[fst->Start()] == Weight::Zero())) {
+  idistance_.assign(ns, Weight::Zero());
+  if (!opts_.distance) ComputeDistance(*fst);
+  if ((opts_.state_threshold == 0) || (fdistance_.size() <= fst->Start()) ||
+      (fdistance_[fst->Start()] == Weight::Zero())) {
     fst->DeleteStates();
     return;
   }
-  internal::PruneCompare<StateId, Weight> compare(idistance, *fdistance);
-  StateHeap heap(compare);
-  std::vector<bool> visited(ns, false);
-  std::vector<size_t> enqueued(ns, StateHeap::kNoKey);
-  std::vector<StateId> dead;
-  dead.push_back(fst->AddState());
+  heap_.Clear();
+  visited_.assign(ns, false);
+  enqueued_.assign(ns, StateHeap::kNoKey);
+  dead_.clear();
+  dead_.push_back(fst->AddState());
   NaturalLess<Weight> less;
   auto s = fst->Start();
-  const auto limit = opts.threshold_initial
-                         ? Times(opts.weight_threshold, (*fdistance)[s])
-                         : Times((*fdistance)[s], opts.weight_threshold);
+  const auto limit = opts_.threshold_initial
+                         ? Times(opts_.weight_threshold, fdistance_[s])
+                         : Times(fdistance_[s], opts_.weight_threshold);
   StateId num_visited = 0;
 
-  if (!less(limit, (*fdistance)[s])) {
-    idistance[s] = Weight::One();
-    enqueued[s] = heap.Insert(s);
+  if (!less(limit, fdistance_[s])) {
+    idistance_[s] = Weight::One();
+    enqueued_[s] = heap_.Insert(s);
     ++num_visited;
   }
-  while (!heap.Empty()) {
-    s = heap.Top();
-    heap.Pop();
-    enqueued[s] = StateHeap::kNoKey;
-    visited[s] = true;
-    if (less(limit, Times(idistance[s], fst->Final(s)))) {
+  while (!heap_.Empty()) {
+    s = heap_.Top();
+    heap_.Pop();
+    enqueued_[s] = StateHeap::kNoKey;
+    visited_[s] = true;
+    if (less(limit, Times(idistance_[s], fst->Final(s)))) {
       fst->SetFinal(s, Weight::Zero());
     }
     for (MutableArcIterator<MutableFst<Arc>> aiter(fst, s); !aiter.Done();
          aiter.Next()) {
       auto arc = aiter.Value();  // Copy intended.
-      if (!opts.filter(arc)) continue;
+      if (!opts_.filter(arc)) continue;
       const auto weight =
-          Times(Times(idistance[s], arc.weight),
-                arc.nextstate < fdistance->size() ? (*fdistance)[arc.nextstate]
+          Times(Times(idistance_[s], arc.weight),
+                arc.nextstate < fdistance_.size() ? fdistance_[arc.nextstate]
                                                   : Weight::Zero());
       if (less(limit, weight)) {
-        arc.nextstate = dead[0];
+        arc.nextstate = dead_[0];
         aiter.SetValue(arc);
         continue;
       }
-      if (less(Times(idistance[s], arc.weight), idistance[arc.nextstate])) {
-        idistance[arc.nextstate] = Times(idistance[s], arc.weight);
+      if (less(Times(idistance_[s], arc.weight), idistance_[arc.nextstate])) {
+        idistance_[arc.nextstate] = Times(idistance_[s], arc.weight);
       }
-      if (visited[arc.nextstate]) continue;
-      if ((opts.state_threshold != kNoStateId) &&
-          (num_visited >= opts.state_threshold)) {
+      if (visited_[arc.nextstate]) continue;
+      if ((opts_.state_threshold != kNoStateId) &&
+          (num_visited >= opts_.state_threshold)) {
         continue;
       }
-      if (enqueued[arc.nextstate] == StateHeap::kNoKey) {
-        enqueued[arc.nextstate] = heap.Insert(arc.nextstate);
+      if (enqueued_[arc.nextstate] == StateHeap::kNoKey) {
+        enqueued_[arc.nextstate] = heap_.Insert(arc.nextstate);
         ++num_visited;
       } else {
-        heap.Update(enqueued[arc.nextstate], arc.nextstate);
+        heap_.Update(enqueued_[arc.nextstate], arc.nextstate);
       }
     }
   }
-  for (StateId i = 0; i < visited.size(); ++i) {
-    if (!visited[i]) dead.push_back(i);
+  for (StateId i = 0; i < visited_.size(); ++i) {
+    if (!visited_[i]) dead_.push_back(i);
   }
-  fst->DeleteStates(dead);
+  fst->DeleteStates(dead_);
+}
+
+// Pruning algorithm: this version modifies its input and it takes an options
+// class as an argument. After pruning the FST contains states and arcs that
+// belong to a successful path in the FST whose weight is no more than the
+// weight of the shortest path Times() the provided weight threshold. When the
+// state threshold is not kNoStateId, the output FST is further restricted to
+// have no more than the number of states in opts.state_threshold. Weights must
+// have the path property. The weight of any cycle needs to be bounded; i.e.,
+//
+//   Plus(weight, Weight::One()) == Weight::One()
+template <class Arc, class ArcFilter,
+          typename std::enable_if<(Arc::Weight::Properties() & kPath) ==
+                                  kPath>::type * = nullptr>
+void Prune(MutableFst<Arc> *fst, const PruneOptions<Arc, ArcFilter> &opts =
+                                     PruneOptions<Arc, ArcFilter>()) {
+  Pruner<Arc, ArcFilter> pruner(opts);
+  pruner(fst);
 }
 
 template <class Arc, class ArcFilter,
@@ -200,6 +264,33 @@ void Prune(MutableFst<Arc> *fst, const PruneOptions<Arc, ArcFilter> &opts =
   fst->SetProperties(kError, kError);
 }
 
+// Pruning algorithm: this version prunes a batch of FSTs in place, each as
+// Prune(fst, opts) would, using up to num_threads threads. Each thread reuses
+// a single Pruner, and hence its buffers, for all the FSTs it processes.
+// opts.distance must be null.
+template <class Arc, class ArcFilter>
+void Prune(const std::vector<MutableFst<Arc> *> &fsts,
+           const PruneOptions<Arc, ArcFilter> &opts, int num_threads = 1) {
+  if constexpr (IsPath<typename Arc::Weight>::value) {
+    DCHECK(!opts.distance);
+    num_threads = std::max(1, std::min<int>(num_threads, fsts.size()));
+    std::atomic<size_t> next(0);
+    const auto work = [&fsts, &opts, &next]() {
+      Pruner<Arc, ArcFilter> pruner(opts);
+      for (auto i = next++; i < fsts.size(); i = next++) pruner(fsts[i]);
+    };
+    if (num_threads == 1) {
+      work();
+      return;
+    }
+    ThreadPool pool(num_threads);
+    for (int i = 0; i < num_threads; ++i) pool.Schedule(work);
+    pool.Wait();
+  } else {
+    for (auto *fst : fsts) Prune(fst, opts);
+  }
+}
+
 // Pruning algorithm: this version modifies its input and takes the
 // pruning threshold as an argument. It deletes states and arcs in the
 // FST that do not belong to a successful path whose weight is more
@@ -1025,6 +1025,9 @@ class ReplaceFst
     return *GetImpl()->GetFst(GetImpl()->GetFstId(nonterminal));
   }
 
+  // Returns statistics on the state cache of this FST.
+  CacheStats GetCacheStats() const { return GetImpl()->GetCacheStats(); }
+
  private:
   using ImplToFst<Impl>::GetImpl;
   using ImplToFst<Impl>::GetMutableImpl;
@@ -525,6 +525,9 @@ class RmEpsilonFst : public ImplToFst<internal::RmEpsilonFstImpl<A>> {
     GetMutableImpl()->InitArcIterator(s, data);
   }
 
+  // Returns statistics on the state cache of this FST.
+  CacheStats GetCacheStats() const { return GetImpl()->GetCacheStats(); }
+
  private:
   using ImplToFst<Impl>::GetImpl;
   using ImplToFst<Impl>::GetMutableImpl;
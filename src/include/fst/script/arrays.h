@@ -0,0 +1,237 @@
+// Copyright 2005-2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the 'License');
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an 'AS IS' BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// See www.openfst.org for extensive documentation on this weighted
+// finite-state transducer library.
+//
+// Conversion between FSTs and flat, column-wise arrays, for exchange with
+// array libraries such as NumPy.
+
+#ifndef FST_SCRIPT_ARRAYS_H_
+#define FST_SCRIPT_ARRAYS_H_
+
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <fst/types.h>
+#include <fst/log.h>
+#include <fst/expanded-fst.h>
+#include <fst/mutable-fst.h>
+#include <fst/vector-fst.h>
+#include <fst/script/arg-packs.h>
+#include <fst/script/fst-class.h>
+
+namespace fst {
+namespace script {
+
+// A column of values, the i-th of which is stored at data + i * stride, e.g.,
+// one field of a NumPy record array. Real-valued columns hold float or double
+// values, as given by size.
+struct FstArrayColumn {
+  const char *data = nullptr;
+  ptrdiff_t stride = 0;
+  size_t size = 0;
+
+  FstArrayColumn() = default;
+
+  FstArrayColumn(const void *data, ptrdiff_t stride, size_t size)
+      : data(static_cast<const char *>(data)), stride(stride), size(size) {}
+
+  template <class T>
+  T Get(size_t i) const {
+    T value;
+    std::memcpy(&value, data + i * stride, sizeof(value));
+    return value;
+  }
+
+  double GetReal(size_t i) const {
+    return size == sizeof(float) ? Get<float>(i) : Get<double>(i);
+  }
+};
+
+// An FST as columns: state s has final weight finals[s] and the arcs
+// [offsets[s], offsets[s + 1]). Final weights and offsets have double and
+// int64 values, labels and next states int32 values, and arc weights the
+// native floating-point type of the arc type's weight. When filled in by
+// FstToArrays, the arc columns share the arcs of FSTs that store them
+// contiguously (e.g., ConstFst) and point into arc_storage otherwise.
+struct FstArrays {
+  int64 start = kNoStateId;
+  size_t num_states = 0;
+  size_t num_arcs = 0;
+  FstArrayColumn finals;
+  FstArrayColumn offsets;
+  FstArrayColumn ilabels;
+  FstArrayColumn olabels;
+  FstArrayColumn weights;
+  FstArrayColumn nextstates;
+  // Storage owned by the arrays, if any.
+  std::vector<double> final_storage;
+  std::vector<int64> offset_storage;
+  std::unique_ptr<char[]> arc_storage;
+};
+
+namespace internal {
+
+// Returns the arcs of an expanded, immutable FST if they are stored in one
+// contiguous array in state order, and nullptr otherwise.
+template <class Arc>
+const Arc *ContiguousArcs(const ExpandedFst<Arc> &fst,
+                          const std::vector<int64> &offsets) {
+  if (fst.Properties(kMutable, false)) return nullptr;
+  const Arc *arcs = nullptr;
+  for (typename Arc::StateId s = 0; s < fst.NumStates(); ++s) {
+    ArcIteratorData<Arc> data;
+    fst.InitArcIterator(s, &data);
+    if (data.base) return nullptr;
+    if (s == 0) {
+      arcs = data.arcs;
+    } else if (data.narcs > 0 && data.arcs != arcs + offsets[s]) {
+      return nullptr;
+    }
+  }
+  return arcs;
+}
+
+}  // namespace internal
+
+using FstToArraysArgs = std::pair<const FstClass &, FstArrays *>;
+
+template <class Arc>
+void FstToArrays(FstToArraysArgs *args) {
+  using Weight = typename Arc::Weight;
+  using Value = typename Weight::ValueType;
+  static_assert(std::is_trivially_copyable<Arc>::value &&
+                    std::is_standard_layout<Arc>::value &&
+                    sizeof(Weight) == sizeof(Value),
+                "Arc must be a plain record with a floating-point weight");
+  static_assert(sizeof(typename Arc::Label) == sizeof(int32) &&
+                    sizeof(typename Arc::StateId) == sizeof(int32),
+                "Labels and state IDs must be 32-bit");
+  const Fst<Arc> &ifst = *args->first.GetFst<Arc>();
+  auto *arrays = args->second;
+  std::unique_ptr<const ExpandedFst<Arc>> copy;
+  if (!ifst.Properties(kExpanded, false)) copy.reset(new VectorFst<Arc>(ifst));
+  const auto &fst = copy ? *copy : *down_cast<const ExpandedFst<Arc> *>(&ifst);
+  arrays->start = fst.Start();
+  arrays->num_states = fst.NumStates();
+  arrays->final_storage.clear();
+  arrays->offset_storage.assign(1, 0);
+  for (typename Arc::StateId s = 0; s < fst.NumStates(); ++s) {
+    arrays->final_storage.push_back(fst.Final(s).Value());
+    arrays->offset_storage.push_back(arrays->offset_storage.back() +
+                                     fst.NumArcs(s));
+  }
+  arrays->num_arcs = arrays->offset_storage.back();
+  arrays->finals = FstArrayColumn(arrays->final_storage.data(), sizeof(double),
+                                  sizeof(double));
+  arrays->offsets = FstArrayColumn(arrays->offset_storage.data(),
+                                   sizeof(int64), sizeof(int64));
+  const Arc *arcs = copy ? nullptr
+                         : internal::ContiguousArcs(fst,
+                                                    arrays->offset_storage);
+  arrays->arc_storage.reset();
+  if (!arcs) {
+    arrays->arc_storage.reset(new char[arrays->num_arcs * sizeof(Arc)]);
+    char *data = arrays->arc_storage.get();
+    for (typename Arc::StateId s = 0; s < fst.NumStates(); ++s) {
+      for (ArcIterator<ExpandedFst<Arc>> aiter(fst, s); !aiter.Done();
+           aiter.Next(), data += sizeof(Arc)) {
+        std::memcpy(data, &aiter.Value(), sizeof(Arc));
+      }
+    }
+    arcs = reinterpret_cast<const Arc *>(arrays->arc_storage.get());
+  }
+  const char *base = reinterpret_cast<const char *>(arcs);
+  arrays->ilabels = FstArrayColumn(base + offsetof(Arc, ilabel), sizeof(Arc),
+                                   sizeof(int32));
+  arrays->olabels = FstArrayColumn(base + offsetof(Arc, olabel), sizeof(Arc),
+                                   sizeof(int32));
+  arrays->weights = FstArrayColumn(base + offsetof(Arc, weight), sizeof(Arc),
+                                   sizeof(Value));
+  arrays->nextstates = FstArrayColumn(base + offsetof(Arc, nextstate),
+                                      sizeof(Arc), sizeof(int32));
+}
+
+// Fills in arrays describing the FST; the arrays may share memory with the
+// FST, which must then outlive them. Like ArraysToFst, this is registered for
+// the standard, log and log64 arcs only, since other arcs need not be plain
+// records with floating-point weights; REGISTER_FST_OPERATIONS omits both.
+void FstToArrays(const FstClass &fst, FstArrays *arrays);
+
+using ArraysToFstInnerArgs = std::pair<const FstArrays &, MutableFstClass *>;
+
+using ArraysToFstArgs = WithReturnValue<bool, ArraysToFstInnerArgs>;
+
+template <class Arc>
+void ArraysToFst(ArraysToFstArgs *args) {
+  using StateId = typename Arc::StateId;
+  using Weight = typename Arc::Weight;
+  const FstArrays &arrays = args->args.first;
+  MutableFst<Arc> *fst = args->args.second->GetMutableFst<Arc>();
+  args->retval = false;
+  const auto num_states = static_cast<int64>(arrays.num_states);
+  const auto num_arcs = static_cast<int64>(arrays.num_arcs);
+  if (arrays.start < kNoStateId || arrays.start >= num_states) {
+    FSTERROR() << "ArraysToFst: Start state out of range: " << arrays.start;
+    return;
+  }
+  if (arrays.offsets.Get<int64>(0) != 0 ||
+      arrays.offsets.Get<int64>(num_states) != num_arcs) {
+    FSTERROR() << "ArraysToFst: Offsets do not span the arcs";
+    return;
+  }
+  fst->DeleteStates();
+  fst->ReserveStates(num_states);
+  for (StateId s = 0; s < num_states; ++s) {
+    fst->AddState();
+    fst->SetFinal(s, Weight(arrays.finals.GetReal(s)));
+  }
+  for (StateId s = 0; s < num_states; ++s) {
+    const auto begin = arrays.offsets.Get<int64>(s);
+    const auto end = arrays.offsets.Get<int64>(s + 1);
+    if (begin > end || end > num_arcs) {
+      FSTERROR() << "ArraysToFst: Offsets of state " << s << " out of range";
+      fst->DeleteStates();
+      return;
+    }
+    fst->ReserveArcs(s, end - begin);
+    for (auto i = begin; i < end; ++i) {
+      const auto nextstate = arrays.nextstates.Get<int32>(i);
+      if (nextstate < 0 || nextstate >= num_states) {
+        FSTERROR() << "ArraysToFst: Next state out of range: " << nextstate;
+        fst->DeleteStates();
+        return;
+      }
+      fst->AddArc(s, Arc(arrays.ilabels.Get<int32>(i),
+                         arrays.olabels.Get<int32>(i),
+                         Weight(arrays.weights.GetReal(i)), nextstate));
+    }
+  }
+  fst->SetStart(arrays.start);
+  args->retval = true;
+}
+
+// Replaces the contents of the FST with those described by the arrays,
+// returning false if they are inconsistent.
+bool ArraysToFst(const FstArrays &arrays, MutableFstClass *fst);
+
+}  // namespace script
+}  // namespace fst
+
+#endif  // FST_SCRIPT_ARRAYS_H_
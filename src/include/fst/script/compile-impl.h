@@ -20,13 +20,27 @@
 #ifndef FST_SCRIPT_COMPILE_IMPL_H_
 #define FST_SCRIPT_COMPILE_IMPL_H_
 
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <memory>
+#include <numeric>
 #include <sstream>
 #include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
+#include <fst/const-fst.h>
+#include <fst/expanded-fst.h>
+#include <fst/float-weight.h>
 #include <fst/fst.h>
+#include <fst/mapped-file.h>
+#include <fst/test-properties.h>
+#include <fst/thread-pool.h>
 #include <fst/util.h>
 #include <fst/vector-fst.h>
 #include <unordered_map>
@@ -34,10 +48,234 @@
 DECLARE_string(fst_field_separator);
 
 namespace fst {
+namespace internal {
+
+// Splits lines of text into fields separated by runs of separator characters,
+// without copying them.
+class FieldSplitter {
+ public:
+  // Maximum number of fields returned.
+  static constexpr size_t kMaxFields = 5;
+
+  explicit FieldSplitter(const std::string &separators) {
+    for (const auto c : separators) {
+      separator_[static_cast<unsigned char>(c)] = true;
+    }
+    separator_[static_cast<unsigned char>('\n')] = true;
+  }
+
+  // Splits the line [begin, end) into fields, returning their number, which is
+  // greater than kMaxFields if there are too many.
+  size_t Split(const char *begin, const char *end,
+               std::string_view *fields) const {
+    size_t nfields = 0;
+    for (auto p = begin;;) {
+      while (p < end && IsSeparator(*p)) ++p;
+      if (p == end) return nfields;
+      if (nfields == kMaxFields) return nfields + 1;
+      const auto field = p;
+      while (p < end && !IsSeparator(*p)) ++p;
+      fields[nfields++] = std::string_view(field, p - field);
+    }
+  }
+
+ private:
+  bool IsSeparator(char c) const {
+    return separator_[static_cast<unsigned char>(c)];
+  }
+
+  bool separator_[256] = {};
+};
+
+// Copies a field into a null-terminated buffer for the C conversion functions,
+// on the stack unless the field is long.
+class FieldBuffer {
+ public:
+  explicit FieldBuffer(std::string_view field) {
+    if (field.size() < sizeof(buffer_)) {
+      std::memcpy(buffer_, field.data(), field.size());
+      buffer_[field.size()] = '\0';
+      data_ = buffer_;
+    } else {
+      string_.assign(field.data(), field.size());
+      data_ = string_.c_str();
+    }
+  }
+
+  const char *c_str() const { return data_; }
+
+ private:
+  char buffer_[64];
+  std::string string_;
+  const char *data_;
+};
+
+// Parses a weight, returning false if it is malformed. Weights derived from
+// FloatWeightTpl, which make up the common arc types, are parsed as their
+// stream operator does but without constructing a stream.
+template <class Weight>
+bool ParseWeight(std::string_view field, Weight *weight) {
+  if constexpr (IsFloatWeight<Weight>::value) {
+    using T = typename Weight::ValueType;
+    // Extracts the first whitespace-delimited token, as the stream does.
+    const auto is_space = [](char c) {
+      return std::isspace(static_cast<unsigned char>(c));
+    };
+    const auto begin = std::find_if_not(field.begin(), field.end(), is_space);
+    const auto end = std::find_if(begin, field.end(), is_space);
+    const std::string_view token(field.data() + (begin - field.begin()),
+                                 end - begin);
+    if (token.empty()) return false;
+    if (token == "Infinity") {
+      *weight = Weight(FloatLimits<T>::PosInfinity());
+    } else if (token == "-Infinity") {
+      *weight = Weight(FloatLimits<T>::NegInfinity());
+    } else {
+      const FieldBuffer buffer(token);
+      char *p;
+      const T f = strtod(buffer.c_str(), &p);
+      if (p < buffer.c_str() + token.size()) return false;
+      *weight = Weight(f);
+    }
+    return true;
+  } else {
+    std::istringstream strm{std::string(field)};
+    strm >> *weight;
+    return static_cast<bool>(strm);
+  }
+}
+
+// Immutable FST over an array of final weights and an array of arcs grouped by
+// state, which FstCompiler fills to produce a ConstFst without an intermediate
+// mutable FST. It is written in the ConstFst format, so that a compiled FST can
+// be written directly, and its arcs are read from the arrays without copying.
+template <class A>
+class ArrayFst : public ExpandedFst<A> {
+ public:
+  using Arc = A;
+  using StateId = typename Arc::StateId;
+  using Weight = typename Arc::Weight;
+
+  // The arcs of state s are arcs[offsets[s]] to arcs[offsets[s + 1] - 1].
+  ArrayFst(StateId start, std::vector<Weight> finals,
+           std::vector<size_t> offsets, std::vector<Arc> arcs,
+           const SymbolTable *isyms, const SymbolTable *osyms, bool error)
+      : data_(std::make_shared<Data>()),
+        properties_(kExpanded | (error ? kError : 0)) {
+    data_->start = start;
+    data_->finals = std::move(finals);
+    data_->offsets = std::move(offsets);
+    data_->arcs = std::move(arcs);
+    if (isyms) data_->isyms.reset(isyms->Copy());
+    if (osyms) data_->osyms.reset(osyms->Copy());
+  }
+
+  ArrayFst(const ArrayFst &fst, bool safe = false)
+      : data_(fst.data_), properties_(fst.properties_) {}
+
+  StateId Start() const override { return data_->start; }
+
+  Weight Final(StateId s) const override { return data_->finals[s]; }
+
+  StateId NumStates() const override { return data_->finals.size(); }
+
+  size_t NumArcs(StateId s) const override {
+    return data_->offsets[s + 1] - data_->offsets[s];
+  }
+
+  size_t NumInputEpsilons(StateId s) const override {
+    return std::count_if(Begin(s), End(s),
+                         [](const Arc &arc) { return arc.ilabel == 0; });
+  }
+
+  size_t NumOutputEpsilons(StateId s) const override {
+    return std::count_if(Begin(s), End(s),
+                         [](const Arc &arc) { return arc.olabel == 0; });
+  }
+
+  uint64 Properties(uint64 mask, bool test) const override {
+    if (test) {
+      uint64 known;
+      const auto props = TestProperties(*this, mask, &known);
+      properties_ = (properties_ & ~known) | (props & known);
+      return props & mask;
+    }
+    return properties_ & mask;
+  }
+
+  const std::string &Type() const override {
+    static const std::string *const type = new std::string("array");
+    return *type;
+  }
+
+  ArrayFst *Copy(bool safe = false) const override {
+    return new ArrayFst(*this, safe);
+  }
+
+  const SymbolTable *InputSymbols() const override {
+    return data_->isyms.get();
+  }
+
+  const SymbolTable *OutputSymbols() const override {
+    return data_->osyms.get();
+  }
+
+  bool Write(std::ostream &strm, const FstWriteOptions &opts) const override {
+    return ConstFst<Arc>::WriteFst(*this, strm, opts);
+  }
+
+  bool Write(const std::string &source) const override {
+    return Fst<Arc>::WriteFile(source);
+  }
+
+  void InitStateIterator(StateIteratorData<Arc> *data) const override {
+    data->base = nullptr;
+    data->nstates = NumStates();
+  }
+
+  void InitArcIterator(StateId s, ArcIteratorData<Arc> *data) const override {
+    data->base = nullptr;
+    data->arcs = Begin(s);
+    data->narcs = NumArcs(s);
+    data->ref_count = nullptr;
+  }
+
+ private:
+  struct Data {
+    StateId start;
+    std::vector<Weight> finals;
+    std::vector<size_t> offsets;
+    std::vector<Arc> arcs;
+    std::unique_ptr<SymbolTable> isyms;
+    std::unique_ptr<SymbolTable> osyms;
+  };
+
+  const Arc *Begin(StateId s) const {
+    return data_->arcs.data() + data_->offsets[s];
+  }
+
+  const Arc *End(StateId s) const {
+    return data_->arcs.data() + data_->offsets[s + 1];
+  }
+
+  std::shared_ptr<Data> data_;
+  mutable uint64 properties_;
+};
+
+}  // namespace internal
 
 // Compile a binary Fst from textual input, helper class for fstcompile.cc
 // WARNING: Stand-alone use of this class not recommended, most code should
 // read/write using the binary format which is much more efficient.
+//
+// If map_source is true, istrm must be a file stream opened on the file named
+// source, which is then memory-mapped; other input is read in blocks, so the
+// text is never held in memory as a whole. Each block of lines is split
+// into chunks which are parsed on num_threads threads without allocating
+// memory per field, and then added to the FST in order. Symbols are added to
+// the symbol tables in order, so add_symbols disables the parallel parsing.
+// If const_output is true, the FST is built in arrays with the ConstFst
+// layout instead of a VectorFst and returned by GetArrayFst().
 template <class Arc>
 class FstCompiler {
  public:
@@ -53,163 +291,415 @@ class FstCompiler {
   FstCompiler(std::istream &istrm, const std::string &source,
               const SymbolTable *isyms, const SymbolTable *osyms,
               const SymbolTable *ssyms, bool accep, bool ikeep, bool okeep,
-              bool nkeep, bool allow_negative_labels = false) {
+              bool nkeep, bool allow_negative_labels = false,
+              int num_threads = 1, bool const_output = false,
+              bool map_source = false) {
     std::unique_ptr<SymbolTable> misyms(isyms ? isyms->Copy() : nullptr);
     std::unique_ptr<SymbolTable> mosyms(osyms ? osyms->Copy() : nullptr);
     std::unique_ptr<SymbolTable> mssyms(ssyms ? ssyms->Copy() : nullptr);
     Init(istrm, source, misyms.get(), mosyms.get(), mssyms.get(), accep, ikeep,
-         okeep, nkeep, allow_negative_labels, false);
+         okeep, nkeep, allow_negative_labels, false, num_threads, const_output,
+         map_source);
   }
 
   FstCompiler(std::istream &istrm, const std::string &source,
               SymbolTable *isyms, SymbolTable *osyms, SymbolTable *ssyms,
               bool accep, bool ikeep, bool okeep, bool nkeep,
-              bool allow_negative_labels, bool add_symbols) {
+              bool allow_negative_labels, bool add_symbols,
+              int num_threads = 1, bool const_output = false,
+              bool map_source = false) {
     Init(istrm, source, isyms, osyms, ssyms, accep, ikeep, okeep, nkeep,
-         allow_negative_labels, add_symbols);
+         allow_negative_labels, add_symbols, num_threads, const_output,
+         map_source);
   }
 
   void Init(std::istream &istrm, const std::string &source, SymbolTable *isyms,
             SymbolTable *osyms, SymbolTable *ssyms, bool accep, bool ikeep,
             bool okeep, bool nkeep, bool allow_negative_labels,
-            bool add_symbols) {
+            bool add_symbols, int num_threads = 1, bool const_output = false,
+            bool map_source = false) {
     nline_ = 0;
     source_ = source;
     isyms_ = isyms;
     osyms_ = osyms;
     ssyms_ = ssyms;
     nstates_ = 0;
+    accep_ = accep;
     keep_state_numbering_ = nkeep;
     allow_negative_labels_ = allow_negative_labels;
     add_symbols_ = add_symbols;
-    bool start_state_populated = false;
-    char line[kLineLen];
-    const std::string separator = FLAGS_fst_field_separator + "\n";
-    while (istrm.getline(line, kLineLen)) {
-      ++nline_;
-      std::vector<char *> col;
-      SplitString(line, separator.c_str(), &col, true);
-      if (col.empty() || col[0][0] == '\0') continue;
-      if (col.size() > 5 || (col.size() > 4 && accep) ||
-          (col.size() == 3 && !accep)) {
-        FSTERROR() << "FstCompiler: Bad number of columns, source = " << source_
-                   << ", line = " << nline_;
-        fst_.SetProperties(kError, kError);
-        return;
+    const_output_ = const_output;
+    map_source_ = map_source;
+    start_ = kNoStateId;
+    error_ = false;
+    if (!add_symbols_ && num_threads > 1) {
+      pool_.reset(new ThreadPool(num_threads));
+    }
+    splitter_.reset(new internal::FieldSplitter(FLAGS_fst_field_separator));
+    const bool complete = Compile(istrm);
+    pool_.reset();
+    if (complete) {
+      if (ikeep) fst_.SetInputSymbols(isyms);
+      if (okeep) fst_.SetOutputSymbols(osyms);
+    }
+    if (const_output_) {
+      MakeArrayFst(complete && ikeep ? isyms : nullptr,
+                   complete && okeep ? osyms : nullptr);
+    } else if (error_) {
+      fst_.SetProperties(kError, kError);
+    }
+  }
+
+  // Returns the compiled FST, which is empty if const_output was set.
+  const VectorFst<Arc> &Fst() const { return fst_; }
+
+  // Returns the compiled FST if const_output was set; ConstFst can copy or
+  // write it (as can its own Write methods) without another copy of the arcs.
+  const ExpandedFst<Arc> &GetArrayFst() const { return *array_fst_; }
+
+ private:
+  // Maximum size of the blocks in which the input is parsed.
+  static constexpr size_t kBlockSize = 1 << 24;
+  // Minimum size of the chunks parsed by each thread.
+  static constexpr size_t kMinChunkSize = 1 << 16;
+
+  // A non-empty line parsed with its state IDs not yet renumbered.
+  struct Line {
+    enum Type : uint8 { FINAL, ARC, BAD_COLUMNS };
+
+    StateId state;
+    Arc arc;  // For final lines, only the weight is set.
+    Type type;
+  };
+
+  // Lines parsed from a chunk of the input, with the errors found; each error
+  // is reported before the line with its index.
+  struct Chunk {
+    struct Error {
+      size_t index;  // Index of the line in lines.
+      size_t line;   // Line number in the chunk.
+      std::string message;
+    };
+
+    std::vector<Line> lines;
+    std::vector<Error> errors;
+    size_t nlines = 0;  // Number of lines, including empty ones.
+
+    void AddError(std::string message) {
+      errors.push_back({lines.size(), nlines, std::move(message)});
+    }
+  };
+
+  // Compiles the input, returning false if it stopped at a bad line.
+  bool Compile(std::istream &istrm) {
+    const auto pos = istrm.tellg();
+    if (pos != -1 && pos % MappedFile::kArchAlignment == 0 && map_source_ &&
+        istrm.seekg(0, std::ios::end)) {
+      size_t size = istrm.tellg() - pos;
+      istrm.seekg(pos);
+      if (size == 0) return true;
+      const std::unique_ptr<MappedFile> mapped(
+          MappedFile::Map(&istrm, true, source_, size));
+      if (mapped) {
+        const auto *begin = static_cast<const char *>(mapped->data());
+        const auto *end = begin + size;
+        while (begin < end) {
+          const auto *block_end =
+              NextLine(begin + std::min(kBlockSize, size) - 1, end);
+          if (!CompileBlock(begin, block_end, end - begin)) return false;
+          size -= block_end - begin;
+          begin = block_end;
+        }
+        return true;
       }
-      StateId s = StrToStateId(col[0]);
-      while (s >= fst_.NumStates()) fst_.AddState();
-      if (!start_state_populated) {
-        fst_.SetStart(s);
-        start_state_populated = true;
+      istrm.clear();
+      istrm.seekg(pos);
+    }
+    // Reads the input in blocks, carrying an incomplete last line over to the
+    // next block.
+    size_t capacity = kBlockSize;
+    std::unique_ptr<char[]> buffer(new char[capacity]);
+    size_t carry = 0;
+    while (istrm) {
+      if (carry == capacity) {
+        std::unique_ptr<char[]> larger(new char[2 * capacity]);
+        std::memcpy(larger.get(), buffer.get(), capacity);
+        buffer = std::move(larger);
+        capacity *= 2;
       }
+      istrm.read(buffer.get() + carry, capacity - carry);
+      const auto *begin = buffer.get();
+      const auto *end = begin + carry + istrm.gcount();
+      // At the end of the input, the last line need not end in a newline.
+      const auto *block_end = istrm ? LastLine(begin, end) : end;
+      if (!CompileBlock(begin, block_end, 0)) return false;
+      carry = end - block_end;
+      std::memmove(buffer.get(), block_end, carry);
+    }
+    return true;
+  }
+
+  // Returns the start of the line after the one containing p, or end.
+  static const char *NextLine(const char *p, const char *end) {
+    p = static_cast<const char *>(std::memchr(p, '\n', end - p));
+    return p ? p + 1 : end;
+  }
 
-      Arc arc;
-      StateId d = s;
-      switch (col.size()) {
-        case 1:
-          fst_.SetFinal(s, Weight::One());
-          break;
-        case 2:
-          fst_.SetFinal(s, StrToWeight(col[1], true));
-          break;
-        case 3:
-          arc.nextstate = d = StrToStateId(col[1]);
-          arc.ilabel = StrToILabel(col[2]);
+  // Returns the start of the last line in [begin, end), which is end if the
+  // text ends in a newline.
+  static const char *LastLine(const char *begin, const char *end) {
+    auto p = end;
+    while (p > begin && p[-1] != '\n') --p;
+    return p;
+  }
+
+  // Parses the lines [begin, end) and adds them to the FST. If remaining is
+  // nonzero, it is the size of the input from begin, used to reserve memory
+  // for the arcs after the first block.
+  bool CompileBlock(const char *begin, const char *end, size_t remaining) {
+    const size_t size = end - begin;
+    const size_t nchunks =
+        pool_ ? std::max<size_t>(
+                    1, std::min<size_t>(pool_->NumThreads(),
+                                        size / kMinChunkSize))
+              : 1;
+    std::vector<Chunk> chunks(nchunks);
+    std::vector<const char *> bounds(nchunks + 1, end);
+    bounds[0] = begin;
+    for (size_t i = 1; i < nchunks; ++i) {
+      bounds[i] = NextLine(begin + i * (size / nchunks), end);
+    }
+    ParallelFor(pool_.get(), 0, nchunks, [&](size_t i) {
+      ParseChunk(bounds[i], bounds[i + 1], &chunks[i]);
+    });
+    if (const_output_ && remaining > size && arcs_.empty()) {
+      size_t narcs = 0;
+      for (const auto &chunk : chunks) narcs += chunk.lines.size();
+      narcs = narcs * (remaining / size + 1);
+      arcs_.reserve(narcs);
+      arc_states_.reserve(narcs);
+    }
+    for (const auto &chunk : chunks) {
+      if (!AddLines(chunk)) return false;
+    }
+    return true;
+  }
+
+  void ParseChunk(const char *begin, const char *end, Chunk *chunk) const {
+    std::string_view fields[internal::FieldSplitter::kMaxFields];
+    while (begin < end) {
+      const auto *p =
+          static_cast<const char *>(std::memchr(begin, '\n', end - begin));
+      const auto *line_end = p ? p : end;
+      const auto nfields = splitter_->Split(begin, line_end, fields);
+      begin = p ? p + 1 : end;
+      if (nfields > 0) ParseLine(fields, nfields, chunk);
+      ++chunk->nlines;
+    }
+  }
+
+  void ParseLine(const std::string_view *fields, size_t nfields,
+                 Chunk *chunk) const {
+    Line line;
+    if (nfields > 5 || (nfields > 4 && accep_) || (nfields == 3 && !accep_)) {
+      chunk->AddError("FstCompiler: Bad number of columns");
+      line.type = Line::BAD_COLUMNS;
+      chunk->lines.push_back(line);
+      return;
+    }
+    line.state = StrToStateId(fields[0], chunk);
+    auto &arc = line.arc;
+    line.type = nfields > 2 ? Line::ARC : Line::FINAL;
+    switch (nfields) {
+      case 1:
+        arc.weight = Weight::One();
+        break;
+      case 2:
+        arc.weight = StrToWeight(fields[1], true, chunk);
+        break;
+      case 3:
+        arc.nextstate = StrToStateId(fields[1], chunk);
+        arc.ilabel = StrToILabel(fields[2], chunk);
+        arc.olabel = arc.ilabel;
+        arc.weight = Weight::One();
+        break;
+      case 4:
+        arc.nextstate = StrToStateId(fields[1], chunk);
+        arc.ilabel = StrToILabel(fields[2], chunk);
+        if (accep_) {
           arc.olabel = arc.ilabel;
+          arc.weight = StrToWeight(fields[3], true, chunk);
+        } else {
+          arc.olabel = StrToOLabel(fields[3], chunk);
           arc.weight = Weight::One();
-          fst_.AddArc(s, arc);
-          break;
-        case 4:
-          arc.nextstate = d = StrToStateId(col[1]);
-          arc.ilabel = StrToILabel(col[2]);
-          if (accep) {
-            arc.olabel = arc.ilabel;
-            arc.weight = StrToWeight(col[3], true);
-          } else {
-            arc.olabel = StrToOLabel(col[3]);
-            arc.weight = Weight::One();
-          }
-          fst_.AddArc(s, arc);
-          break;
-        case 5:
-          arc.nextstate = d = StrToStateId(col[1]);
-          arc.ilabel = StrToILabel(col[2]);
-          arc.olabel = StrToOLabel(col[3]);
-          arc.weight = StrToWeight(col[4], true);
-          fst_.AddArc(s, arc);
+        }
+        break;
+      case 5:
+        arc.nextstate = StrToStateId(fields[1], chunk);
+        arc.ilabel = StrToILabel(fields[2], chunk);
+        arc.olabel = StrToOLabel(fields[3], chunk);
+        arc.weight = StrToWeight(fields[4], true, chunk);
+    }
+    chunk->lines.push_back(line);
+  }
+
+  // Adds the lines of a chunk to the FST, reporting its errors; returns false
+  // on a line with a bad number of columns.
+  bool AddLines(const Chunk &chunk) {
+    auto error = chunk.errors.begin();
+    const auto &lines = chunk.lines;
+    for (size_t i = 0; i < lines.size(); ++i) {
+      for (; error != chunk.errors.end() && error->index == i; ++error) {
+        FSTERROR() << error->message << ", source = " << source_
+                   << ", line = " << nline_ + error->line + 1;
+        error_ = true;
+      }
+      const auto &line = lines[i];
+      if (line.type == Line::BAD_COLUMNS) return false;
+      const auto s = RenumberState(line.state);
+      if (s < 0) continue;  // Only with a reported error.
+      AddStates(s + 1);
+      if (start_ == kNoStateId) SetStart(s);
+      if (line.type == Line::FINAL) {
+        SetFinal(s, line.arc.weight);
+        continue;
       }
-      while (d >= fst_.NumStates()) fst_.AddState();
+      auto arc = line.arc;
+      arc.nextstate = RenumberState(arc.nextstate);
+      if (arc.nextstate < 0) continue;
+      if (!const_output_ && (i == 0 || lines[i - 1].state != line.state)) {
+        // Reserves room for the run of arcs leaving the same state.
+        size_t narcs = 1;
+        while (i + narcs < lines.size() &&
+               lines[i + narcs].type == Line::ARC &&
+               lines[i + narcs].state == line.state) {
+          ++narcs;
+        }
+        fst_.ReserveArcs(s, fst_.NumArcs(s) + narcs);
+      }
+      const auto d = arc.nextstate;
+      AddArc(s, std::move(arc));
+      AddStates(d + 1);
     }
-    if (ikeep) fst_.SetInputSymbols(isyms);
-    if (okeep) fst_.SetOutputSymbols(osyms);
+    nline_ += chunk.nlines;
+    return true;
   }
 
-  const VectorFst<Arc> &Fst() const { return fst_; }
+  StateId NumStates() const {
+    return const_output_ ? finals_.size() : fst_.NumStates();
+  }
 
- private:
-  // Maximum line length in text file.
-  static constexpr int kLineLen = 8096;
+  void AddStates(StateId n) {
+    if (n <= NumStates()) return;
+    if (const_output_) {
+      finals_.resize(n, Weight::Zero());
+    } else {
+      fst_.AddStates(n - fst_.NumStates());
+    }
+  }
+
+  void SetStart(StateId s) {
+    start_ = s;
+    if (!const_output_) fst_.SetStart(s);
+  }
 
-  StateId StrToId(const char *s, SymbolTable *syms, const char *name,
-                  bool allow_negative = false) const {
+  void SetFinal(StateId s, Weight weight) {
+    if (const_output_) {
+      finals_[s] = std::move(weight);
+    } else {
+      fst_.SetFinal(s, std::move(weight));
+    }
+  }
+
+  void AddArc(StateId s, Arc arc) {
+    if (const_output_) {
+      arcs_.push_back(std::move(arc));
+      arc_states_.push_back(s);
+    } else {
+      fst_.AddArc(s, std::move(arc));
+    }
+  }
+
+  // Groups the arcs by state, stably, and moves the arrays to array_fst_.
+  void MakeArrayFst(const SymbolTable *isyms, const SymbolTable *osyms) {
+    const auto nstates = NumStates();
+    std::vector<size_t> offsets(nstates + 1, 0);
+    for (const auto s : arc_states_) ++offsets[s + 1];
+    const bool grouped =
+        std::is_sorted(arc_states_.begin(), arc_states_.end());
+    std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+    if (!grouped) {
+      std::vector<size_t> next(offsets.begin(), offsets.end() - 1);
+      std::vector<Arc> arcs(arcs_.size());
+      for (size_t i = 0; i < arcs_.size(); ++i) {
+        arcs[next[arc_states_[i]]++] = std::move(arcs_[i]);
+      }
+      arcs_.swap(arcs);
+    }
+    std::vector<StateId>().swap(arc_states_);
+    array_fst_.reset(new internal::ArrayFst<Arc>(
+        start_, std::move(finals_), std::move(offsets), std::move(arcs_),
+        isyms, osyms, error_));
+  }
+
+  StateId StrToId(std::string_view s, SymbolTable *syms, const char *name,
+                  Chunk *chunk, bool allow_negative = false) const {
     StateId n = 0;
     if (syms) {
       n = (add_symbols_) ? syms->AddSymbol(s) : syms->Find(s);
       if (n == -1 || (!allow_negative && n < 0)) {
-        FSTERROR() << "FstCompiler: Symbol \"" << s
-                   << "\" is not mapped to any integer " << name
-                   << ", symbol table = " << syms->Name()
-                   << ", source = " << source_ << ", line = " << nline_;
-        fst_.SetProperties(kError, kError);
+        std::ostringstream strm;
+        strm << "FstCompiler: Symbol \"" << s
+             << "\" is not mapped to any integer " << name
+             << ", symbol table = " << syms->Name();
+        chunk->AddError(strm.str());
       }
     } else {
+      const internal::FieldBuffer buffer(s);
       char *p;
-      n = strtoll(s, &p, 10);
+      n = strtoll(buffer.c_str(), &p, 10);
       if (*p != '\0' || (!allow_negative && n < 0)) {
-        FSTERROR() << "FstCompiler: Bad " << name << " integer = \"" << s
-                   << "\", source = " << source_ << ", line = " << nline_;
-        fst_.SetProperties(kError, kError);
+        std::ostringstream strm;
+        strm << "FstCompiler: Bad " << name << " integer = \"" << s << "\"";
+        chunk->AddError(strm.str());
       }
     }
     return n;
   }
 
-  StateId StrToStateId(const char *s) {
-    StateId n = StrToId(s, ssyms_, "state ID");
+  StateId StrToStateId(std::string_view s, Chunk *chunk) const {
+    return StrToId(s, ssyms_, "state ID", chunk);
+  }
+
+  // Remaps state IDs to make dense set, unless keeping the state numbering.
+  StateId RenumberState(StateId n) {
     if (keep_state_numbering_) return n;
-    // Remaps state IDs to make dense set.
-    const auto it = states_.find(n);
-    if (it == states_.end()) {
-      states_[n] = nstates_;
-      return nstates_++;
-    } else {
-      return it->second;
-    }
+    const auto result = states_.emplace(n, nstates_);
+    if (result.second) ++nstates_;
+    return result.first->second;
   }
 
-  StateId StrToILabel(const char *s) const {
-    return StrToId(s, isyms_, "arc ilabel", allow_negative_labels_);
+  StateId StrToILabel(std::string_view s, Chunk *chunk) const {
+    return StrToId(s, isyms_, "arc ilabel", chunk, allow_negative_labels_);
   }
 
-  StateId StrToOLabel(const char *s) const {
-    return StrToId(s, osyms_, "arc olabel", allow_negative_labels_);
+  StateId StrToOLabel(std::string_view s, Chunk *chunk) const {
+    return StrToId(s, osyms_, "arc olabel", chunk, allow_negative_labels_);
   }
 
-  Weight StrToWeight(const char *s, bool allow_zero) const {
+  Weight StrToWeight(std::string_view s, bool allow_zero, Chunk *chunk) const {
     Weight w;
-    std::istringstream strm(s);
-    strm >> w;
-    if (!strm || (!allow_zero && w == Weight::Zero())) {
-      FSTERROR() << "FstCompiler: Bad weight = \"" << s
-                 << "\", source = " << source_ << ", line = " << nline_;
-      fst_.SetProperties(kError, kError);
+    if (!internal::ParseWeight(s, &w) ||
+        (!allow_zero && w == Weight::Zero())) {
+      std::ostringstream strm;
+      strm << "FstCompiler: Bad weight = \"" << s << "\"";
+      chunk->AddError(strm.str());
       w = Weight::NoWeight();
     }
     return w;
   }
 
-  mutable VectorFst<Arc> fst_;
+  VectorFst<Arc> fst_;
   size_t nline_;
   std::string source_;  // Text FST source name.
   SymbolTable *isyms_;  // ilabel symbol table (not owned).
@@ -217,9 +707,21 @@ class FstCompiler {
   SymbolTable *ssyms_;  // slabel symbol table (not owned).
   std::unordered_map<StateId, StateId> states_;  // State ID map.
   StateId nstates_;                               // Number of seen states.
+  bool accep_;
   bool keep_state_numbering_;
   bool allow_negative_labels_;  // Not recommended; may cause conflicts.
   bool add_symbols_;            // Add to symbol tables on-the fly.
+  bool const_output_;           // Build array_fst_ rather than fst_.
+  bool map_source_;             // Map the file named source_ for istrm.
+  StateId start_;
+  bool error_;
+  std::unique_ptr<ThreadPool> pool_;  // Null unless parsing in parallel.
+  std::unique_ptr<internal::FieldSplitter> splitter_;
+  // With const_output, the final weights, and the arcs with their states.
+  std::vector<Weight> finals_;
+  std::vector<Arc> arcs_;
+  std::vector<StateId> arc_states_;
+  std::unique_ptr<internal::ArrayFst<Arc>> array_fst_;
 
   FstCompiler(const FstCompiler &) = delete;
   FstCompiler &operator=(const FstCompiler &) = delete;
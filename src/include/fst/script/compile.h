@@ -20,6 +20,7 @@
 
 #include <istream>
 #include <memory>
+#include <utility>
 
 #include <fst/script/arg-packs.h>
 #include <fst/script/compile-impl.h>
@@ -29,9 +30,10 @@ namespace fst {
 namespace script {
 
 // This operation exists in two forms. 1 is a void operation which writes the
-// compiled machine to disk; 2 returns an FstClass. I/O should normally be done
-// using the binary format for efficiency, so users are STRONGLY ENCOURAGED to
-// use 1 or to construct FSTs using the C++ FST mutation operations.
+// compiled machine to disk (a ConstFst without building it in memory); 2
+// returns an FstClass. I/O should normally be done using the binary format for
+// efficiency, so users are STRONGLY ENCOURAGED to use 1 or to construct FSTs
+// using the C++ FST mutation operations.
 
 // Note: it is safe to pass these strings as references because
 // this struct is only used to pass them deeper in the call graph.
@@ -49,6 +51,8 @@ struct CompileFstInnerArgs {
   const bool okeep;
   const bool nkeep;
   const bool allow_negative_labels;
+  const int num_threads;
+  const bool map_source;
 };
 
 using CompileFstArgs =
@@ -59,17 +63,23 @@ void CompileFstInternal(CompileFstArgs *args) {
   using fst::Convert;
   using fst::Fst;
   using fst::FstCompiler;
+  const auto &iargs = args->args;
+  // Builds a ConstFst directly rather than converting a VectorFst.
+  const bool const_output = iargs.fst_type == "const";
   FstCompiler<Arc> fstcompiler(
-      args->args.istrm, args->args.source, args->args.isyms, args->args.osyms,
-      args->args.ssyms, args->args.accep, args->args.ikeep, args->args.okeep,
-      args->args.nkeep, args->args.allow_negative_labels);
+      iargs.istrm, iargs.source, iargs.isyms, iargs.osyms, iargs.ssyms,
+      iargs.accep, iargs.ikeep, iargs.okeep, iargs.nkeep,
+      iargs.allow_negative_labels, iargs.num_threads, const_output,
+      iargs.map_source);
   std::unique_ptr<Fst<Arc>> fst;
-  if (args->args.fst_type != "vector") {
+  if (const_output) {
+    fst = fst::make_unique<fst::ConstFst<Arc>>(fstcompiler.GetArrayFst());
+  } else if (iargs.fst_type != "vector") {
     std::unique_ptr<Fst<Arc>> tmp_fst(
-        Convert<Arc>(fstcompiler.Fst(), args->args.fst_type));
+        Convert<Arc>(fstcompiler.Fst(), iargs.fst_type));
     if (!tmp_fst) {
       FSTERROR() << "Failed to convert FST to desired type: "
-                 << args->args.fst_type;
+                 << iargs.fst_type;
     }
     fst = std::move(tmp_fst);
   } else {
@@ -78,17 +88,41 @@ void CompileFstInternal(CompileFstArgs *args) {
   args->retval = fst ? fst::make_unique<FstClass>(std::move(fst)) : nullptr;
 }
 
+// Form 1, which writes a ConstFst without building one in memory. If
+// map_source is true, istrm is a file stream on the file named source, which
+// is memory-mapped rather than read.
+using CompileFstToFileArgs =
+    std::pair<const CompileFstInnerArgs &, const std::string &>;
+
+template <class Arc>
+void CompileFst(CompileFstToFileArgs *args) {
+  const auto &iargs = args->first;
+  const auto &dest = args->second;
+  if (iargs.fst_type == "const") {
+    fst::FstCompiler<Arc> fstcompiler(
+        iargs.istrm, iargs.source, iargs.isyms, iargs.osyms, iargs.ssyms,
+        iargs.accep, iargs.ikeep, iargs.okeep, iargs.nkeep,
+        iargs.allow_negative_labels, iargs.num_threads, true, iargs.map_source);
+    fstcompiler.GetArrayFst().Write(dest);
+    return;
+  }
+  CompileFstArgs cargs(iargs);
+  CompileFstInternal<Arc>(&cargs);
+  if (cargs.retval) cargs.retval->Write(dest);
+}
+
 void CompileFst(std::istream &istrm, const std::string &source,
                 const std::string &dest, const std::string &fst_type,
                 const std::string &arc_type, const SymbolTable *isyms,
                 const SymbolTable *osyms, const SymbolTable *ssyms, bool accep,
-                bool ikeep, bool okeep, bool nkeep, bool allow_negative_labels);
+                bool ikeep, bool okeep, bool nkeep, bool allow_negative_labels,
+                int num_threads = 1, bool map_source = false);
 
 std::unique_ptr<FstClass> CompileFstInternal(
     std::istream &istrm, const std::string &source, const std::string &fst_type,
     const std::string &arc_type, const SymbolTable *isyms,
     const SymbolTable *osyms, const SymbolTable *ssyms, bool accep, bool ikeep,
-    bool okeep, bool nkeep, bool allow_negative_labels);
+    bool okeep, bool nkeep, bool allow_negative_labels, int num_threads = 1);
 
 }  // namespace script
 }  // namespace fst
@@ -34,18 +34,21 @@ struct DeterminizeOptions {
   const int64 subsequential_label;
   const DeterminizeType det_type;
   const bool increment_subsequential_label;
+  const int num_threads;
 
   DeterminizeOptions(float delta, const WeightClass &weight_threshold,
                      int64 state_threshold = kNoStateId,
                      int64 subsequential_label = 0,
                      DeterminizeType det_type = DETERMINIZE_FUNCTIONAL,
-                     bool increment_subsequential_label = false)
+                     bool increment_subsequential_label = false,
+                     int num_threads = 1)
       : delta(delta),
         weight_threshold(weight_threshold),
         state_threshold(state_threshold),
         subsequential_label(subsequential_label),
         det_type(det_type),
-        increment_subsequential_label(increment_subsequential_label) {}
+        increment_subsequential_label(increment_subsequential_label),
+        num_threads(num_threads) {}
 };
 
 using DeterminizeArgs =
@@ -61,7 +64,7 @@ void Determinize(DeterminizeArgs *args) {
   const fst::DeterminizeOptions<Arc> detargs(
       opts.delta, weight_threshold, opts.state_threshold,
       opts.subsequential_label, opts.det_type,
-      opts.increment_subsequential_label);
+      opts.increment_subsequential_label, opts.num_threads);
   Determinize(ifst, ofst, detargs);
 }
 
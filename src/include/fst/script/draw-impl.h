@@ -24,6 +24,7 @@
 #include <ostream>
 #include <sstream>
 #include <string>
+#include <string_view>
 
 #include <fst/fst.h>
 #include <fst/util.h>
@@ -118,7 +119,7 @@ class FstDrawer {
 
   // Escapes backslash and double quote if these occur in the string. Dot
   // will not deal gracefully with these if they are not escaped.
-  static std::string Escape(const std::string &str) {
+  static std::string Escape(std::string_view str) {
     std::string ns;
     for (char c : str) {
       if (c == '\\' || c == '"') ns.push_back('\\');
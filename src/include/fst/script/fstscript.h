@@ -46,6 +46,7 @@
 
 // Operations.
 #include <fst/script/arcsort.h>
+#include <fst/script/arrays.h>
 #include <fst/script/closure.h>
 #include <fst/script/compile.h>
 #include <fst/script/compose.h>
@@ -102,6 +103,7 @@ class AllFstOperationsRegisterer {
   void RegisterBatch1() {
     REGISTER_FST_OPERATION(ArcSort, Arc, ArcSortArgs);
     REGISTER_FST_OPERATION(Closure, Arc, ClosureArgs);
+    REGISTER_FST_OPERATION(CompileFst, Arc, CompileFstToFileArgs);
     REGISTER_FST_OPERATION(CompileFstInternal, Arc, CompileFstArgs);
     REGISTER_FST_OPERATION(Compose, Arc, ComposeArgs);
     REGISTER_FST_OPERATION(Concat, Arc, ConcatArgs1);
@@ -27,18 +27,20 @@ namespace fst {
 namespace script {
 
 using MinimizeArgs =
-    std::tuple<MutableFstClass *, MutableFstClass *, float, bool>;
+    std::tuple<MutableFstClass *, MutableFstClass *, float, bool, int>;
 
 template <class Arc>
 void Minimize(MinimizeArgs *args) {
   MutableFst<Arc> *ofst1 = std::get<0>(*args)->GetMutableFst<Arc>();
   MutableFst<Arc> *ofst2 =
       std::get<1>(*args) ? std::get<1>(*args)->GetMutableFst<Arc>() : nullptr;
-  Minimize(ofst1, ofst2, std::get<2>(*args), std::get<3>(*args));
+  Minimize(ofst1, ofst2, std::get<2>(*args), std::get<3>(*args),
+           std::get<4>(*args));
 }
 
 void Minimize(MutableFstClass *ofst1, MutableFstClass *ofst2 = nullptr,
-              float delta = kShortestDelta, bool allow_nondet = false);
+              float delta = kShortestDelta, bool allow_nondet = false,
+              int num_threads = 1);
 
 }  // namespace script
 }  // namespace fst
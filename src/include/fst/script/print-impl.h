@@ -21,18 +21,125 @@
 #ifndef FST_SCRIPT_PRINT_IMPL_H_
 #define FST_SCRIPT_PRINT_IMPL_H_
 
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <locale>
+#include <memory>
 #include <ostream>
 #include <sstream>
 #include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
 
 #include <fst/fstlib.h>
+#include <fst/thread-pool.h>
 #include <fst/util.h>
 
 namespace fst {
+namespace internal {
+
+// Accumulates printer output. When the destination stream uses the default
+// formatting, integers and weights derived from FloatWeightTpl are converted
+// with std::to_chars (or, for weights, std::snprintf where the library lacks
+// floating-point std::to_chars), which produces exactly the characters the
+// stream would (the latter in the "%g" form at the stream's precision).
+// Anything else is formatted by a scratch stream that copies the
+// destination's format.
+class PrintBuffer {
+ public:
+  explicit PrintBuffer(const std::ostream &ostrm)
+      : precision_(ostrm.precision()), fast_(IsDefaultFormat(ostrm)) {
+    strm_.copyfmt(ostrm);
+  }
+
+  void Append(std::string_view str) { buf_.append(str.data(), str.size()); }
+
+  template <class T>
+  void AppendInt(T value) {
+    if (fast_) {
+      char chars[24];
+      const auto result = std::to_chars(chars, chars + sizeof(chars), value);
+      buf_.append(chars, result.ptr - chars);
+    } else {
+      AppendStream(value);
+    }
+  }
+
+  template <class Weight>
+  void AppendWeight(const Weight &weight) {
+    if constexpr (IsFloatWeight<Weight>::value) {
+      using T = typename Weight::ValueType;
+      const T value = weight.Value();
+      // Infinities and NaNs are spelled out by the stream operator.
+      if (fast_ && value == value && value != FloatLimits<T>::PosInfinity() &&
+          value != FloatLimits<T>::NegInfinity()) {
+        char chars[64];
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+        const auto result =
+            std::to_chars(chars, chars + sizeof(chars), value,
+                          std::chars_format::general, precision_);
+        if (result.ec == std::errc()) {
+          buf_.append(chars, result.ptr - chars);
+          return;
+        }
+#else
+        // Floating-point std::to_chars is missing before GCC 11.
+        const int size =
+            std::snprintf(chars, sizeof(chars), "%.*g", precision_,
+                          static_cast<double>(value));
+        if (size > 0 && size < static_cast<int>(sizeof(chars))) {
+          buf_.append(chars, size);
+          return;
+        }
+#endif
+      }
+    }
+    AppendStream(weight);
+  }
+
+  size_t Size() const { return buf_.size(); }
+
+  // Writes the accumulated output to the stream and clears it.
+  void Write(std::ostream &ostrm) {
+    ostrm.write(buf_.data(), buf_.size());
+    buf_.clear();
+  }
+
+ private:
+  static bool IsDefaultFormat(const std::ostream &strm) {
+    constexpr auto kFormatFlags =
+        std::ios_base::floatfield | std::ios_base::showpos |
+        std::ios_base::showpoint | std::ios_base::showbase |
+        std::ios_base::uppercase | std::ios_base::hex | std::ios_base::oct;
+    return (strm.flags() & kFormatFlags) == 0 && strm.width() == 0 &&
+           strm.precision() >= 0 && strm.getloc() == std::locale::classic();
+  }
+
+  template <class T>
+  void AppendStream(const T &value) {
+    strm_.str(std::string());
+    strm_ << value;
+    Append(strm_.str());
+  }
+
+  std::string buf_;
+  std::ostringstream strm_;
+  int precision_;
+  bool fast_;
+};
+
+}  // namespace internal
 
 // Print a binary FST in textual format (helper class for fstprint.cc).
 // WARNING: Stand-alone use of this class not recommended, most code should
 // read/write using the binary format which is much more efficient.
+//
+// Output is formatted into a buffer written to the stream in large blocks. If
+// num_threads is greater than one and the FST is expanded, blocks of states
+// are formatted concurrently, each thread reading its own copy of the FST;
+// the output is the same as when printing on a single thread.
 template <class Arc>
 class FstPrinter {
  public:
@@ -44,7 +151,8 @@ class FstPrinter {
                       const SymbolTable *osyms, const SymbolTable *ssyms,
                       bool accept, bool show_weight_one,
                       const std::string &field_separator,
-                      const std::string &missing_symbol = "")
+                      const std::string &missing_symbol = "",
+                      int num_threads = 1)
       : fst_(fst),
         isyms_(isyms),
         osyms_(osyms),
@@ -53,7 +161,8 @@ class FstPrinter {
         ostrm_(nullptr),
         show_weight_one_(show_weight_one),
         sep_(field_separator),
-        missing_symbol_(missing_symbol) {}
+        missing_symbol_(missing_symbol),
+        num_threads_(num_threads) {}
 
   // Prints FST to an output stream.
   void Print(std::ostream &ostrm, const std::string &dest) {
@@ -61,18 +170,63 @@ class FstPrinter {
     dest_ = dest;
     const auto start = fst_.Start();
     if (start == kNoStateId) return;
+    if (num_threads_ > 1 && fst_.Properties(kExpanded, false)) {
+      PrintParallel(start);
+      return;
+    }
+    internal::PrintBuffer buffer(ostrm);
     // Initial state first.
-    PrintState(start);
+    PrintState(fst_, start, &buffer);
     for (StateIterator<Fst<Arc>> siter(fst_); !siter.Done(); siter.Next()) {
       const auto s = siter.Value();
-      if (s != start) PrintState(s);
+      if (s != start) PrintState(fst_, s, &buffer);
+      if (buffer.Size() >= kBufferSize) buffer.Write(ostrm);
     }
+    buffer.Write(ostrm);
   }
 
  private:
-  void PrintId(StateId id, const SymbolTable *syms, const char *name) const {
+  // Output size at which the buffer is written to the stream.
+  static constexpr size_t kBufferSize = 1 << 16;
+
+  // Number of states formatted by each thread between writes.
+  static constexpr StateId kParallelBlockStates = 4096;
+
+  // Prints the states of an expanded FST, which are numbered from zero, in
+  // rounds: each thread formats one block of states into its own buffer, then
+  // the buffers are written in state order.
+  void PrintParallel(StateId start) {
+    const StateId nstates = CountStates(fst_);
+    ThreadPool pool(num_threads_);
+    const size_t nthreads = pool.NumThreads();
+    std::vector<std::unique_ptr<const Fst<Arc>>> fsts;
+    std::vector<internal::PrintBuffer> buffers;
+    fsts.reserve(nthreads);
+    buffers.reserve(nthreads);
+    for (size_t i = 0; i < nthreads; ++i) {
+      fsts.emplace_back(fst_.Copy(true));
+      buffers.emplace_back(*ostrm_);
+    }
+    // Initial state first.
+    PrintState(*fsts[0], start, &buffers[0]);
+    buffers[0].Write(*ostrm_);
+    const StateId round = kParallelBlockStates * nthreads;
+    for (StateId begin = 0; begin < nstates; begin += round) {
+      ParallelFor(&pool, 0, nthreads, [&](size_t i) {
+        const StateId lo = begin + i * kParallelBlockStates;
+        const StateId hi = std::min(nstates, lo + kParallelBlockStates);
+        for (auto s = lo; s < hi; ++s) {
+          if (s != start) PrintState(*fsts[i], s, &buffers[i]);
+        }
+      });
+      for (auto &buffer : buffers) buffer.Write(*ostrm_);
+    }
+  }
+
+  void PrintId(StateId id, const SymbolTable *syms, const char *name,
+               internal::PrintBuffer *buffer) const {
     if (syms) {
-      std::string symbol = syms->Find(id);
+      std::string_view symbol = syms->Find(id);
       if (symbol.empty()) {
         if (missing_symbol_.empty()) {
           FSTERROR() << "FstPrinter: Integer " << id
@@ -84,43 +238,53 @@ class FstPrinter {
           symbol = missing_symbol_;
         }
       }
-      *ostrm_ << symbol;
+      buffer->Append(symbol);
     } else {
-      *ostrm_ << id;
+      buffer->AppendInt(id);
     }
   }
 
-  void PrintStateId(StateId s) const { PrintId(s, ssyms_, "state ID"); }
+  void PrintStateId(StateId s, internal::PrintBuffer *buffer) const {
+    PrintId(s, ssyms_, "state ID", buffer);
+  }
 
-  void PrintILabel(Label l) const { PrintId(l, isyms_, "arc input label"); }
+  void PrintILabel(Label l, internal::PrintBuffer *buffer) const {
+    PrintId(l, isyms_, "arc input label", buffer);
+  }
 
-  void PrintOLabel(Label l) const { PrintId(l, osyms_, "arc output label"); }
+  void PrintOLabel(Label l, internal::PrintBuffer *buffer) const {
+    PrintId(l, osyms_, "arc output label", buffer);
+  }
 
-  void PrintState(StateId s) const {
+  void PrintState(const Fst<Arc> &fst, StateId s,
+                  internal::PrintBuffer *buffer) const {
     bool output = false;
-    for (ArcIterator<Fst<Arc>> aiter(fst_, s); !aiter.Done(); aiter.Next()) {
+    for (ArcIterator<Fst<Arc>> aiter(fst, s); !aiter.Done(); aiter.Next()) {
       const auto &arc = aiter.Value();
-      PrintStateId(s);
-      *ostrm_ << sep_;
-      PrintStateId(arc.nextstate);
-      *ostrm_ << sep_;
-      PrintILabel(arc.ilabel);
+      PrintStateId(s, buffer);
+      buffer->Append(sep_);
+      PrintStateId(arc.nextstate, buffer);
+      buffer->Append(sep_);
+      PrintILabel(arc.ilabel, buffer);
       if (!accept_) {
-        *ostrm_ << sep_;
-        PrintOLabel(arc.olabel);
+        buffer->Append(sep_);
+        PrintOLabel(arc.olabel, buffer);
+      }
+      if (show_weight_one_ || arc.weight != Weight::One()) {
+        buffer->Append(sep_);
+        buffer->AppendWeight(arc.weight);
       }
-      if (show_weight_one_ || arc.weight != Weight::One())
-        *ostrm_ << sep_ << arc.weight;
-      *ostrm_ << "\n";
+      buffer->Append("\n");
       output = true;
     }
-    const auto weight = fst_.Final(s);
+    const auto weight = fst.Final(s);
     if (weight != Weight::Zero() || !output) {
-      PrintStateId(s);
+      PrintStateId(s, buffer);
       if (show_weight_one_ || weight != Weight::One()) {
-        *ostrm_ << sep_ << weight;
+        buffer->Append(sep_);
+        buffer->AppendWeight(weight);
       }
-      *ostrm_ << "\n";
+      buffer->Append("\n");
     }
   }
 
@@ -135,6 +299,7 @@ class FstPrinter {
   std::string sep_;             // Separator character between fields.
   std::string missing_symbol_;  // Symbol to print when lookup fails (default
                                 // "" means raise error).
+  int num_threads_;             // Threads used to format expanded FSTs.
 
   FstPrinter(const FstPrinter &) = delete;
   FstPrinter &operator=(const FstPrinter &) = delete;
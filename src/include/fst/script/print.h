@@ -43,6 +43,7 @@ struct PrintArgs {
   const std::string &dest;
   const std::string &sep;
   const std::string &missing_symbol;
+  const int num_threads;
 };
 
 template <class Arc>
@@ -50,7 +51,7 @@ void Print(PrintArgs *args) {
   const Fst<Arc> &fst = *args->fst.GetFst<Arc>();
   FstPrinter<Arc> fstprinter(fst, args->isyms, args->osyms, args->ssyms,
                              args->accept, args->show_weight_one, args->sep,
-                             args->missing_symbol);
+                             args->missing_symbol, args->num_threads);
   fstprinter.Print(args->ostrm, args->dest);
 }
 
@@ -58,7 +59,8 @@ void Print(const FstClass &fst, std::ostream &ostrm, const std::string &dest,
            const SymbolTable *isyms = nullptr,
            const SymbolTable *osyms = nullptr,
            const SymbolTable *ssyms = nullptr, bool accept = true,
-           bool show_weight_one = true, const std::string &missing_sym = "");
+           bool show_weight_one = true, const std::string &missing_sym = "",
+           int num_threads = 1);
 
 // TODO(kbg,2019-09-01): Deprecated.
 void PrintFst(const FstClass &fst, std::ostream &ostrm, const std::string &dest,
@@ -45,13 +45,15 @@ struct ShortestDistanceOptions {
   const ArcFilterType arc_filter_type;
   const int64 source;
   const float delta;
+  const int num_threads;
 
   ShortestDistanceOptions(QueueType queue_type, ArcFilterType arc_filter_type,
-                          int64 source, float delta)
+                          int64 source, float delta, int num_threads = 1)
       : queue_type(queue_type),
         arc_filter_type(arc_filter_type),
         source(source),
-        delta(delta) {}
+        delta(delta),
+        num_threads(num_threads) {}
 };
 
 namespace internal {
@@ -112,7 +114,8 @@ void ShortestDistance(const Fst<Arc> &fst,
   std::unique_ptr<Queue> queue(
       QueueConstructor<Arc, Queue, ArcFilter>::Construct(fst, distance));
   const fst::ShortestDistanceOptions<Arc, Queue, ArcFilter> sopts(
-      queue.get(), ArcFilter(), opts.source, opts.delta);
+      queue.get(), ArcFilter(), opts.source, opts.delta, false,
+      opts.num_threads);
   ShortestDistance(fst, distance, sopts);
 }
 
@@ -211,7 +214,8 @@ void ShortestDistance(ShortestDistanceArgs1 *args) {
 }
 
 using ShortestDistanceArgs2 =
-    std::tuple<const FstClass &, std::vector<WeightClass> *, bool, double>;
+    std::tuple<const FstClass &, std::vector<WeightClass> *, bool, double,
+               int>;
 
 template <class Arc>
 void ShortestDistance(ShortestDistanceArgs2 *args) {
@@ -219,7 +223,7 @@ void ShortestDistance(ShortestDistanceArgs2 *args) {
   const Fst<Arc> &fst = *std::get<0>(*args).GetFst<Arc>();
   std::vector<Weight> typed_distance;
   ShortestDistance(fst, &typed_distance, std::get<2>(*args),
-                   std::get<3>(*args));
+                   std::get<3>(*args), std::get<4>(*args));
   internal::CopyWeights(typed_distance, std::get<1>(*args));
 }
 
@@ -239,7 +243,7 @@ void ShortestDistance(const FstClass &fst, std::vector<WeightClass> *distance,
 
 void ShortestDistance(const FstClass &ifst, std::vector<WeightClass> *distance,
                       bool reverse = false,
-                      double delta = fst::kShortestDelta);
+                      double delta = fst::kShortestDelta, int num_threads = 1);
 
 WeightClass ShortestDistance(const FstClass &ifst,
                              double delta = fst::kShortestDelta);
@@ -20,17 +20,23 @@
 #ifndef FST_SHORTEST_DISTANCE_H_
 #define FST_SHORTEST_DISTANCE_H_
 
+#include <algorithm>
+#include <atomic>
 #include <cstddef>
+#include <deque>
 #include <vector>
 
 #include <fst/log.h>
 
 #include <fst/arcfilter.h>
 #include <fst/cache.h>
+#include <fst/connect.h>
 #include <fst/equal.h>
+#include <fst/log-sum-exp.h>
 #include <fst/queue.h>
 #include <fst/reverse.h>
 #include <fst/test-properties.h>
+#include <fst/thread-pool.h>
 
 
 namespace fst {
@@ -55,15 +61,20 @@ struct ShortestDistanceOptions {
                          // queue discipline is shortest-first and all the
                          // weights in the FST are between One() and Zero()
                          // according to NaturalLess.
+  int num_threads;       // If greater than one, an expanded FST is processed
+                         // in parallel, one SCC condensation level at a time;
+                         // the queue is then unused. Ignored with first_path.
 
   ShortestDistanceOptions(Queue *state_queue, ArcFilter arc_filter,
                           StateId source = kNoStateId,
-                          float delta = kShortestDelta, bool first_path = false)
+                          float delta = kShortestDelta, bool first_path = false,
+                          int num_threads = 1)
       : state_queue(state_queue),
         arc_filter(arc_filter),
         source(source),
         delta(delta),
-        first_path(first_path) {}
+        first_path(first_path),
+        num_threads(num_threads) {}
 };
 
 namespace internal {
@@ -230,6 +241,172 @@ void ShortestDistanceState<Arc, Queue, ArcFilter,
   if (fst_.Properties(kError, false)) error_ = true;
 }
 
+// Parallel shortest distance over an expanded FST. The strongly connected
+// components of the filtered FST are grouped into levels such that every arc
+// between components leads to a higher level. Components in the same level
+// are independent and are processed concurrently: each state first sums the
+// distances pulled along its incoming arcs from lower levels, and then a
+// cyclic component is relaxed locally in FIFO order. By right distributivity,
+// the result equals that of the generic algorithm (up to delta). Returns false
+// on error.
+template <class Arc, class ArcFilter, class WeightEqual = WeightApproxEqual>
+bool ParallelShortestDistance(const Fst<Arc> &fst,
+                              std::vector<typename Arc::Weight> *distance,
+                              ArcFilter arc_filter,
+                              typename Arc::StateId source, float delta,
+                              int num_threads) {
+  using StateId = typename Arc::StateId;
+  using Weight = typename Arc::Weight;
+  distance->clear();
+  if (fst.Start() == kNoStateId) return !fst.Properties(kError, false);
+  if (!(Weight::Properties() & kRightSemiring)) {
+    FSTERROR() << "ShortestDistance: Weight needs to be right distributive: "
+               << Weight::Type();
+    return false;
+  }
+  if (source == kNoStateId) source = fst.Start();
+  const StateId nstates = CountStates(fst);
+  // Component of each state, numbered in topological order.
+  std::vector<StateId> scc;
+  uint64 props = 0;
+  SccVisitor<Arc> scc_visitor(&scc, nullptr, nullptr, &props);
+  DfsVisit(fst, &scc_visitor, arc_filter);
+  const StateId nscc =
+      nstates ? *std::max_element(scc.begin(), scc.end()) + 1 : 0;
+  // Incoming arcs of each state, as (source state, weight) pairs.
+  std::vector<size_t> in_begin(nstates + 1, 0);
+  std::vector<bool> cyclic(nscc, false);
+  for (StateId s = 0; s < nstates; ++s) {
+    for (ArcIterator<Fst<Arc>> aiter(fst, s); !aiter.Done(); aiter.Next()) {
+      const auto &arc = aiter.Value();
+      if (!arc_filter(arc)) continue;
+      ++in_begin[arc.nextstate + 1];
+      if (scc[arc.nextstate] == scc[s]) cyclic[scc[s]] = true;
+    }
+  }
+  for (StateId s = 0; s < nstates; ++s) in_begin[s + 1] += in_begin[s];
+  std::vector<std::pair<StateId, Weight>> in_arcs(in_begin[nstates]);
+  {
+    std::vector<size_t> pos(in_begin.begin(), in_begin.end() - 1);
+    for (StateId s = 0; s < nstates; ++s) {
+      for (ArcIterator<Fst<Arc>> aiter(fst, s); !aiter.Done(); aiter.Next()) {
+        const auto &arc = aiter.Value();
+        if (!arc_filter(arc)) continue;
+        in_arcs[pos[arc.nextstate]++] = std::make_pair(s, arc.weight);
+      }
+    }
+  }
+  // States of each component.
+  std::vector<StateId> scc_begin(nscc + 1, 0);
+  for (StateId s = 0; s < nstates; ++s) ++scc_begin[scc[s] + 1];
+  for (StateId c = 0; c < nscc; ++c) scc_begin[c + 1] += scc_begin[c];
+  std::vector<StateId> scc_states(nstates);
+  {
+    std::vector<StateId> pos(scc_begin.begin(), scc_begin.end() - 1);
+    for (StateId s = 0; s < nstates; ++s) scc_states[pos[scc[s]]++] = s;
+  }
+  // Components of each level.
+  std::vector<StateId> level(nscc, 0);
+  StateId nlevels = 0;
+  for (StateId c = 0; c < nscc; ++c) {
+    for (auto i = scc_begin[c]; i < scc_begin[c + 1]; ++i) {
+      const auto s = scc_states[i];
+      for (auto j = in_begin[s]; j < in_begin[s + 1]; ++j) {
+        const auto d = scc[in_arcs[j].first];
+        if (d != c) level[c] = std::max(level[c], level[d] + 1);
+      }
+    }
+    nlevels = std::max(nlevels, level[c] + 1);
+  }
+  std::vector<StateId> level_begin(nlevels + 1, 0);
+  for (StateId c = 0; c < nscc; ++c) ++level_begin[level[c] + 1];
+  for (StateId l = 0; l < nlevels; ++l) level_begin[l + 1] += level_begin[l];
+  std::vector<StateId> level_sccs(nscc);
+  {
+    std::vector<StateId> pos(level_begin.begin(), level_begin.end() - 1);
+    for (StateId c = 0; c < nscc; ++c) level_sccs[pos[level[c]]++] = c;
+  }
+  // Each state is written only by the task processing its component, and
+  // read by later levels, so no locking is needed.
+  distance->assign(nstates, Weight::Zero());
+  std::vector<Adder<Weight>> adder(nstates);
+  std::vector<Adder<Weight>> radder(nstates);
+  std::vector<uint8> enqueued(nstates, false);
+  std::vector<uint8> reached(nstates, false);
+  std::atomic<bool> error(false);
+  const WeightEqual weight_equal(delta);
+  const auto process_scc = [&](StateId c) {
+    // Incoming path weights of a state, summed in one batch.
+    thread_local std::vector<Weight> terms;
+    bool scc_reached = false;
+    for (auto i = scc_begin[c]; i < scc_begin[c + 1]; ++i) {
+      const auto s = scc_states[i];
+      terms.clear();
+      if (s == source) {
+        terms.push_back(Weight::One());
+        reached[s] = true;
+      }
+      for (auto j = in_begin[s]; j < in_begin[s + 1]; ++j) {
+        const auto p = in_arcs[j].first;
+        if (scc[p] == c || !reached[p]) continue;
+        terms.push_back(Times((*distance)[p], in_arcs[j].second));
+        reached[s] = true;
+      }
+      (*distance)[s] = SumWeights(terms.data(), terms.size());
+      adder[s].Reset((*distance)[s]);
+      if (reached[s]) scc_reached = true;
+    }
+    if (!cyclic[c] || !scc_reached) return;
+    std::deque<StateId> queue;
+    for (auto i = scc_begin[c]; i < scc_begin[c + 1]; ++i) {
+      const auto s = scc_states[i];
+      reached[s] = true;
+      if (adder[s].Sum() == Weight::Zero()) continue;
+      radder[s].Reset(adder[s].Sum());
+      enqueued[s] = true;
+      queue.push_back(s);
+    }
+    while (!queue.empty()) {
+      const auto s = queue.front();
+      queue.pop_front();
+      enqueued[s] = false;
+      const auto r = radder[s].Sum();
+      radder[s].Reset();
+      for (ArcIterator<Fst<Arc>> aiter(fst, s); !aiter.Done(); aiter.Next()) {
+        const auto &arc = aiter.Value();
+        const auto t = arc.nextstate;
+        if (!arc_filter(arc) || scc[t] != c) continue;
+        auto &nd = (*distance)[t];
+        const auto weight = Times(r, arc.weight);
+        if (!weight_equal(nd, Plus(nd, weight))) {
+          nd = adder[t].Add(weight);
+          radder[t].Add(weight);
+          if (!nd.Member() || !radder[t].Sum().Member()) {
+            error = true;
+            return;
+          }
+          if (!enqueued[t]) {
+            queue.push_back(t);
+            enqueued[t] = true;
+          }
+        }
+      }
+    }
+  };
+  ThreadPool pool(num_threads);
+  for (StateId l = 0; l < nlevels && !error; ++l) {
+    ParallelFor(&pool, level_begin[l], level_begin[l + 1],
+                [&](StateId i) { process_scc(level_sccs[i]); },
+                /*min_chunk=*/64);
+  }
+  if (error || fst.Properties(kError, false)) return false;
+  // As in the generic algorithm, only reached states are stored.
+  auto size = nstates;
+  while (size > 0 && !reached[size - 1]) --size;
+  distance->resize(size);
+  return true;
+}
+
 }  // namespace internal
 
 // Shortest-distance algorithm: this version allows fine control
@@ -241,7 +418,9 @@ void ShortestDistanceState<Arc, Queue, ArcFilter,
 // distance vector if S is less than the maximum visited state. The state
 // queue discipline, arc filter, and convergence delta are taken in the
 // options argument. The distance vector will contain a unique element for
-// which Member() is false if an error was encountered.
+// which Member() is false if an error was encountered. If opts.num_threads is
+// greater than one and the FST is expanded, independent strongly connected
+// components are processed concurrently and the queue is not used.
 //
 // The weights must must be right distributive and k-closed (i.e., 1 +
 // x + x^2 + ... + x^(k +1) = 1 + x + x^2 + ... + x^k).
@@ -259,6 +438,15 @@ template <class Arc, class Queue, class ArcFilter>
 void ShortestDistance(
     const Fst<Arc> &fst, std::vector<typename Arc::Weight> *distance,
     const ShortestDistanceOptions<Arc, Queue, ArcFilter> &opts) {
+  if (opts.num_threads > 1 && !opts.first_path &&
+      fst.Properties(kExpanded, false)) {
+    if (!internal::ParallelShortestDistance(fst, distance, opts.arc_filter,
+                                            opts.source, opts.delta,
+                                            opts.num_threads)) {
+      distance->assign(1, Arc::Weight::NoWeight());
+    }
+    return;
+  }
   internal::ShortestDistanceState<Arc, Queue, ArcFilter> sd_state(fst, distance,
                                                                   opts, false);
   sd_state.ShortestDistance(opts.source);
@@ -273,11 +461,12 @@ void ShortestDistance(
 // If reverse is false, this computes the shortest distance from the initial
 // state to each state S and stores the value in the distance vector. If
 // reverse is true, this computes the shortest distance from each state to the
-// final states. An unvisited state S has distance Zero(), which will be stored
-// in the distance vector if S is less than the maximum visited state. The
-// state queue discipline is automatically-selected. The distance vector will
-// contain a unique element for which Member() is false if an error was
-// encountered.
+// final states. If num_threads is greater than one, independent strongly
+// connected components are processed concurrently. An unvisited state S has
+// distance Zero(), which will be stored in the distance vector if S is less
+// than the maximum visited state. The state queue discipline is
+// automatically-selected. The distance vector will contain a unique element
+// for which Member() is false if an error was encountered.
 //
 // The weights must must be right (left) distributive if reverse is false (true)
 // and k-closed (i.e., 1 + x + x^2 + ... + x^(k +1) = 1 + x + x^2 + ... + x^k).
@@ -298,13 +487,14 @@ void ShortestDistance(
 template <class Arc>
 void ShortestDistance(const Fst<Arc> &fst,
                       std::vector<typename Arc::Weight> *distance,
-                      bool reverse = false, float delta = kShortestDelta) {
+                      bool reverse = false, float delta = kShortestDelta,
+                      int num_threads = 1) {
   using StateId = typename Arc::StateId;
   if (!reverse) {
     AnyArcFilter<Arc> arc_filter;
     AutoQueue<StateId> state_queue(fst, distance, arc_filter);
     const ShortestDistanceOptions<Arc, AutoQueue<StateId>, AnyArcFilter<Arc>>
-        opts(&state_queue, arc_filter, kNoStateId, delta);
+        opts(&state_queue, arc_filter, kNoStateId, delta, false, num_threads);
     ShortestDistance(fst, distance, opts);
   } else {
     using ReverseArc = ReverseArc<Arc>;
@@ -316,7 +506,8 @@ void ShortestDistance(const Fst<Arc> &fst,
     AutoQueue<StateId> state_queue(rfst, &rdistance, rarc_filter);
     const ShortestDistanceOptions<ReverseArc, AutoQueue<StateId>,
                                   AnyArcFilter<ReverseArc>>
-        ropts(&state_queue, rarc_filter, kNoStateId, delta);
+        ropts(&state_queue, rarc_filter, kNoStateId, delta, false,
+              num_threads);
     ShortestDistance(rfst, &rdistance, ropts);
     distance->clear();
     if (rdistance.size() == 1 && !rdistance[0].Member()) {
@@ -345,11 +536,12 @@ typename Arc::Weight ShortestDistance(const Fst<Arc> &fst,
     if (distance.size() == 1 && !distance[0].Member()) {
       return Arc::Weight::NoWeight();
     }
-    Adder<Weight> adder;  // maintains cumulative sum accurately
+    std::vector<Weight> terms;
+    terms.reserve(distance.size());
     for (StateId state = 0; state < distance.size(); ++state) {
-      adder.Add(Times(distance[state], fst.Final(state)));
+      terms.push_back(Times(distance[state], fst.Final(state)));
     }
-    return adder.Sum();
+    return SumWeights(terms.data(), terms.size());
   } else {
     ShortestDistance(fst, &distance, true, delta);
     const auto state = fst.Start();
@@ -144,7 +144,7 @@ bool LabelsToSymbolString(const std::vector<Label> &labels, std::string *str,
   for (auto label : labels) {
     if (omit_epsilon && !label) continue;
     ostrm << delim;
-    const std::string &symbol = syms.Find(label);
+    const auto symbol = syms.Find(label);
     if (symbol.empty()) {
       LOG(ERROR) << "LabelsToSymbolString: Label " << label
                  << " is not mapped onto any textual symbol in symbol table "
@@ -27,6 +27,7 @@
 #include <memory>
 #include <sstream>
 #include <string>
+#include <string_view>
 #include <type_traits>
 #include <utility>
 #include <vector>
@@ -36,23 +37,12 @@
 #include <fst/types.h>
 #include <fst/log.h>
 #include <fstream>
+#include <fst/lock.h>
+#include <fst/mapped-file.h>
 #include <fst/windows_defs.inc>
 #include <map>
 #include <functional>
 
-#ifndef OPENFST_HAVE_STD_STRING_VIEW
-#ifdef __has_include
-#if __has_include(<string_view>) && __cplusplus >= 201703L
-#define OPENFST_HAVE_STD_STRING_VIEW 1
-#endif
-#endif
-#endif
-#ifdef OPENFST_HAVE_STD_STRING_VIEW
-#include <string_view>
-#else
-#include <string>
-#endif
-
 
 DECLARE_bool(fst_compat_symbols);
 
@@ -61,6 +51,7 @@ namespace fst {
 constexpr int64 kNoSymbol = -1;
 
 class SymbolTable;
+class SymbolTableInterner;
 
 struct SymbolTableReadOptions {
   SymbolTableReadOptions() {}
@@ -72,6 +63,12 @@ struct SymbolTableReadOptions {
 
   std::vector<std::pair<int64, int64>> string_hash_ranges;
   std::string source;
+  // Memory-maps tables in the packed format rather than reading them, if
+  // possible.
+  bool memory_map = false;
+  // If non-null, tables read share the instance registered with the interner,
+  // if any; tables in the packed format are then skipped without being read.
+  SymbolTableInterner *interner = nullptr;
 };
 
 struct SymbolTableTextOptions {
@@ -86,16 +83,12 @@ namespace internal {
 extern const int kLineLen;
 
 // List of symbols with a dense hash for looking up symbol index, rehashing at
-// 75% occupancy.
+// 75% occupancy. The symbols are stored back to back in a single string pool,
+// rather than each in its own allocation.
 class DenseSymbolMap {
  public:
   // Argument type for symbol lookups and inserts.
-
-#ifdef OPENFST_HAVE_STD_STRING_VIEW
   using KeyType = std::string_view;
-#else
-  using KeyType = const std::string &;
-#endif  // OPENFST_HAVE_STD_STRING_VIEW
 
   DenseSymbolMap();
 
@@ -103,9 +96,13 @@ class DenseSymbolMap {
 
   int64 Find(KeyType key) const;
 
-  size_t Size() const { return symbols_.size(); }
+  size_t Size() const { return ends_.size(); }
 
-  const std::string &GetSymbol(size_t idx) const { return symbols_[idx]; }
+  // The result is invalidated by the next insertion or removal.
+  std::string_view GetSymbol(size_t idx) const {
+    const size_t begin = idx == 0 ? 0 : ends_[idx - 1];
+    return std::string_view(pool_.data() + begin, ends_[idx] - begin);
+  }
 
   void RemoveSymbol(size_t idx);
 
@@ -119,10 +116,10 @@ class DenseSymbolMap {
 
   size_t GetHash(KeyType key) const { return str_hash_(key) & hash_mask_; }
 
-  const std::hash<typename std::remove_const<
-      typename std::remove_reference<KeyType>::type>::type>
-      str_hash_;
-  std::vector<std::string> symbols_;
+  const std::hash<KeyType> str_hash_;
+  // Symbol idx occupies [ends_[idx - 1], ends_[idx]) in the pool.
+  std::string pool_;
+  std::vector<size_t> ends_;
   std::vector<int64> buckets_;
   uint64 hash_mask_;
 };
@@ -154,7 +151,8 @@ class SymbolTableImplBase {
   virtual void RemoveSymbol(int64 key) = 0;
 
   // Returns the symbol for the specified key, or the empty string if not found.
-  virtual std::string Find(int64 key) const = 0;
+  // The result is invalidated by the next mutation of the table.
+  virtual std::string_view Find(int64 key) const = 0;
   // Returns the key for the specified symbol, or kNoSymbol if not found.
   virtual int64 Find(SymbolType symbol) const = 0;
 
@@ -224,6 +222,11 @@ class SymbolTableImpl final : public MutableSymbolTableImpl {
     return fst::make_unique<SymbolTableImpl>(*this);
   }
 
+  // Returns a copy of any implementation, e.g., of an immutable one about to
+  // be mutated, keeping the order of its symbols.
+  static std::unique_ptr<SymbolTableImpl> CopyFrom(
+      const SymbolTableImplBase &impl);
+
   int64 AddSymbol(SymbolType symbol, int64 key) override;
 
   int64 AddSymbol(SymbolType symbol) override {
@@ -239,6 +242,7 @@ class SymbolTableImpl final : public MutableSymbolTableImpl {
       std::istream &strm, const std::string &name,
       const SymbolTableTextOptions &opts = SymbolTableTextOptions());
 
+  // Reads the binary format following its magic number.
   static SymbolTableImpl *Read(std::istream &strm,
                                const SymbolTableReadOptions &opts);
 
@@ -246,7 +250,7 @@ class SymbolTableImpl final : public MutableSymbolTableImpl {
 
   // Returns the string associated with the key. If the key is out of
   // range (<0, >max), return an empty string.
-  std::string Find(int64 key) const override;
+  std::string_view Find(int64 key) const override;
 
   // Returns the key associated with the symbol; if the symbol
   // does not exists, returns kNoSymbol.
@@ -307,7 +311,89 @@ class SymbolTableImpl final : public MutableSymbolTableImpl {
   mutable bool check_sum_finalized_;
   mutable std::string check_sum_string_;
   mutable std::string labeled_check_sum_string_;
-  mutable Mutex check_sum_mutex_;
+  mutable SharedMutex check_sum_mutex_;
+};
+
+// Immutable SymbolTable implementation keeping everything in one contiguous
+// region: the symbols in a string pool with an offset array, the key of each
+// symbol, a sorted index of the keys outside the dense range [0,
+// dense_key_limit_), and an open-addressing hash index from symbols to their
+// positions. The region is written as is, so reading it takes a single
+// allocation or, when reading from a file, a memory mapping. Holds at most
+// 2^31 - 1 symbols.
+class PackedSymbolTableImpl final : public ConstSymbolTableImpl {
+ public:
+  explicit PackedSymbolTableImpl(const SymbolTable &table);
+
+  // Reads the binary format following its magic number.
+  static PackedSymbolTableImpl *Read(std::istream &strm,
+                                     const SymbolTableReadOptions &opts);
+
+  // Reads the header of the binary format following its magic number. It
+  // must be followed by ReadRegion, or by SkipRegion and destruction.
+  static PackedSymbolTableImpl *ReadHeader(std::istream &strm,
+                                           const SymbolTableReadOptions &opts);
+
+  bool ReadRegion(std::istream &strm, const SymbolTableReadOptions &opts);
+
+  bool SkipRegion(std::istream &strm, const SymbolTableReadOptions &opts);
+
+  bool Write(std::ostream &strm) const override;
+
+  std::string_view Find(int64 key) const override;
+
+  int64 Find(SymbolType symbol) const override;
+
+  int64 GetNthKey(ssize_t pos) const override {
+    if (pos < 0 || pos >= num_symbols_) return kNoSymbol;
+    return keys_[pos];
+  }
+
+  const std::string &Name() const override { return name_; }
+
+  const std::string &CheckSum() const override { return check_sum_string_; }
+
+  const std::string &LabeledCheckSum() const override {
+    return labeled_check_sum_string_;
+  }
+
+  int64 AvailableKey() const override { return available_key_; }
+
+  size_t NumSymbols() const override { return num_symbols_; }
+
+ private:
+  static constexpr int32 kEmptyBucket = -1;
+
+  PackedSymbolTableImpl() = default;
+
+  // Size in bytes of the region, given the sizes below.
+  size_t RegionSize() const;
+
+  // Points the arrays into the region, returning false if it is inconsistent.
+  bool InitArrays();
+
+  std::string_view GetSymbol(int64 pos) const {
+    return std::string_view(pool_ + offsets_[pos],
+                            offsets_[pos + 1] - offsets_[pos]);
+  }
+
+  std::string name_;
+  int64 available_key_ = 0;
+  int64 num_symbols_ = 0;
+  int64 dense_key_limit_ = 0;
+  int64 num_buckets_ = 0;  // A power of 2.
+  int64 pool_size_ = 0;
+  std::string check_sum_string_;
+  std::string labeled_check_sum_string_;
+  bool aligned_ = false;  // Whether the region is aligned in the stream.
+
+  std::unique_ptr<MappedFile> region_;
+  const int64 *offsets_ = nullptr;           // num_symbols_ + 1 pool offsets.
+  const int64 *keys_ = nullptr;              // Key of each position.
+  const int64 *sparse_keys_ = nullptr;       // Keys past the dense range,
+  const int32 *sparse_positions_ = nullptr;  // sorted, with their positions.
+  const int32 *buckets_ = nullptr;           // Hash index of positions.
+  const char *pool_ = nullptr;
 };
 
 }  // namespace internal
@@ -338,8 +424,7 @@ class SymbolTable {
       int64 Label() const { return key_; }
 
       // Return the string of the current symbol.
-      // TODO(wolfsonkin): Consider adding caching.
-      std::string Symbol() const { return table_->Find(key_); }
+      std::string_view Symbol() const { return table_->Find(key_); }
 
      private:
       explicit value_type(const SymbolTable &table, ssize_t pos)
@@ -412,11 +497,10 @@ class SymbolTable {
       const std::string &source,
       const SymbolTableTextOptions &opts = SymbolTableTextOptions());
 
+  // Reads a binary dump of the symbol table, in either the default or the
+  // packed format, from a stream.
   static SymbolTable *Read(std::istream &strm,
-                           const SymbolTableReadOptions &opts) {
-    auto impl = fst::WrapUnique(internal::SymbolTableImpl::Read(strm, opts));
-    return impl ? new SymbolTable(std::move(impl)) : nullptr;
-  }
+                           const SymbolTableReadOptions &opts);
 
   // Reads a binary dump of the symbol table from a stream.
   static SymbolTable *Read(std::istream &strm, const std::string &source) {
@@ -474,8 +558,9 @@ class SymbolTable {
   int64 GetNthKey(ssize_t pos) const { return impl_->GetNthKey(pos); }
 
   // Returns the string associated with the key; if the key is out of
-  // range (<0, >max), returns an empty string.
-  std::string Find(int64 key) const { return impl_->Find(key); }
+  // range (<0, >max), returns an empty string. The result is invalidated by
+  // the next mutation of the table.
+  std::string_view Find(int64 key) const { return impl_->Find(key); }
 
   // Returns the key associated with the symbol; if the symbol does not exist,
   // kNoSymbol is returned.
@@ -543,8 +628,14 @@ class SymbolTable {
   }
 
  private:
+  // Before a mutation, replaces an immutable implementation by a mutable copy
+  // and unshares a mutable one.
   void MutateCheck() {
-    if (impl_.unique() || !impl_->IsMutable()) return;
+    if (!impl_->IsMutable()) {
+      impl_ = internal::SymbolTableImpl::CopyFrom(*impl_);
+      return;
+    }
+    if (impl_.unique()) return;
     std::unique_ptr<internal::SymbolTableImplBase> copy = impl_->Copy();
     CHECK(copy != nullptr);
     impl_ = std::move(copy);
@@ -553,6 +644,60 @@ class SymbolTable {
   std::shared_ptr<internal::SymbolTableImplBase> impl_;
 };
 
+// Symbol table in the packed format of PackedSymbolTableImpl, which takes a
+// fraction of the memory of a SymbolTable for large vocabularies and which is
+// memory-mapped when read with SymbolTableReadOptions::memory_map (or as part
+// of an FST read with FstReadOptions::MAP). It is written and read like any
+// other symbol table. The packed format is immutable: the first mutation of
+// the table copies it into the default implementation.
+class PackedSymbolTable : public SymbolTable {
+ public:
+  explicit PackedSymbolTable(const SymbolTable &table)
+      : SymbolTable(std::make_shared<internal::PackedSymbolTableImpl>(table)) {
+  }
+
+  PackedSymbolTable *Copy() const override {
+    return new PackedSymbolTable(*this);
+  }
+};
+
+// Thread-safe registry sharing one instance among equal symbol tables, as
+// identified by their name and labeled checksum. Reading many FSTs that carry
+// the same tables (e.g., from a FAR) through an interner, see
+// FstReadOptions::symbols_interner, loads each distinct table once; tables in
+// the packed format are not even parsed again. Tables stay registered until
+// Clear() is called.
+class SymbolTableInterner {
+ public:
+  SymbolTableInterner() = default;
+
+  // Returns a copy of the table registered under the name and labeled
+  // checksum, sharing its implementation, or nullptr if there is none.
+  SymbolTable *Find(const std::string &name,
+                    const std::string &labeled_check_sum) const;
+
+  // Registers the table unless an equal one is registered already, and returns
+  // a copy of the registered table sharing its implementation.
+  SymbolTable *Intern(std::unique_ptr<SymbolTable> table);
+
+  // Number of registered tables.
+  size_t Size() const;
+
+  void Clear();
+
+  // Returns the process-wide interner, used for all FST reads if
+  // --fst_intern_symbols is set.
+  static SymbolTableInterner *Global();
+
+ private:
+  mutable SharedMutex mu_;
+  std::map<std::pair<std::string, std::string>, std::unique_ptr<SymbolTable>>
+      tables_;
+
+  SymbolTableInterner(const SymbolTableInterner &) = delete;
+  SymbolTableInterner &operator=(const SymbolTableInterner &) = delete;
+};
+
 // Iterator class for symbols in a symbol table.
 class OPENFST_DEPRECATED(
     "Use SymbolTable::iterator, a C++ compliant iterator, instead")
@@ -570,7 +715,7 @@ class OPENFST_DEPRECATED(
   int64 Value() const { return iter_->Label(); }
 
   // Return the string of the current symbol.
-  std::string Symbol() const { return iter_->Symbol(); }
+  std::string Symbol() const { return std::string(iter_->Symbol()); }
 
   // Advances iterator.
   void Next() { ++iter_; }
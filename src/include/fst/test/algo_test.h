@@ -22,6 +22,7 @@
 
 #include <memory>
 #include <random>
+#include <sstream>
 #include <utility>
 
 #include <fst/types.h>
@@ -64,13 +65,14 @@ class EpsMapper {
 // Generic - no lookahead.
 template <class Arc>
 void LookAheadCompose(const Fst<Arc> &ifst1, const Fst<Arc> &ifst2,
-                      MutableFst<Arc> *ofst) {
-  Compose(ifst1, ifst2, ofst);
+                      MutableFst<Arc> *ofst, int num_threads = 1) {
+  Compose(ifst1, ifst2, ofst, ComposeOptions(true, AUTO_FILTER, num_threads));
 }
 
 // Specialized and epsilon olabel acyclic - lookahead.
 inline void LookAheadCompose(const Fst<StdArc> &ifst1, const Fst<StdArc> &ifst2,
-                             MutableFst<StdArc> *ofst) {
+                             MutableFst<StdArc> *ofst, int num_threads = 1) {
+  const ComposeOptions opts(true, AUTO_FILTER, num_threads);
   std::vector<StdArc::StateId> order;
   bool acyclic;
   TopOrderVisitor<StdArc> visitor(&order, &acyclic);
@@ -79,9 +81,9 @@ inline void LookAheadCompose(const Fst<StdArc> &ifst1, const Fst<StdArc> &ifst2,
     StdOLabelLookAheadFst lfst1(ifst1);
     StdVectorFst lfst2(ifst2);
     LabelLookAheadRelabeler<StdArc>::Relabel(&lfst2, lfst1, true);
-    Compose(lfst1, lfst2, ofst);
+    Compose(lfst1, lfst2, ofst, opts);
   } else {
-    Compose(ifst1, ifst2, ofst);
+    Compose(ifst1, ifst2, ofst, opts);
   }
 }
 
@@ -112,7 +114,116 @@ class WeightedTester {
     TestSearch(T1);
   }
 
+  // Tests the parallel algorithms on FSTs with wide frontiers and large
+  // classes, which are split among threads where those of the small random
+  // FSTs are not, against their sequential counterparts.
+  void TestParallel() {
+    const uint64 wprops = Weight::Properties();
+    constexpr StateId kWidth = 5000;
+    constexpr StateId kDepth = 3;
+    VectorFst<Arc> L;
+    MakeLayeredFst(kWidth, kDepth, false, &L);
+
+    if (wprops & kCommutative) {
+      VLOG(1) << "Check parallel and sequential composition of wide FSTs "
+              << "are equal.";
+      VectorFst<Arc> U;
+      U.AddState();
+      U.SetStart(0);
+      U.SetFinal(0);
+      for (Label label = 1; label <= kWidth + 2; ++label) {
+        U.EmplaceArc(0, label, label, generate_(), 0);
+      }
+      VectorFst<Arc> C1, C2;
+      Compose(L, U, &C1);
+      Compose(L, U, &C2, ComposeOptions(true, AUTO_FILTER, 4));
+      CHECK(Equal(C1, C2));
+    }
+
+    if ((wprops & kSemiring) == kSemiring) {
+      VLOG(1) << "Check parallel and sequential determinization of wide FSTs "
+              << "are equal.";
+      VectorFst<Arc> D1, D2;
+      Determinize(L, &D1);
+      DeterminizeOptions<Arc> opts;
+      opts.num_threads = 3;
+      Determinize(L, &D2, opts);
+      CHECK(Equal(D1, D2));
+      VectorFst<Arc> T(L);
+      for (StateId s = 0; s < T.NumStates(); ++s) {
+        for (MutableArcIterator<VectorFst<Arc>> aiter(&T, s); !aiter.Done();
+             aiter.Next()) {
+          auto arc = aiter.Value();
+          arc.olabel = arc.ilabel % 3;
+          aiter.SetValue(arc);
+        }
+      }
+      VectorFst<Arc> TD1, TD2;
+      opts.num_threads = 1;
+      Determinize(T, &TD1, opts);
+      opts.num_threads = 2;
+      Determinize(T, &TD2, opts);
+      CHECK(Equal(TD1, TD2));
+
+      VLOG(1) << "Check parallel and sequential minimization of acyclic FSTs "
+              << "with large heights are equal.";
+      VectorFst<Arc> M1(D1);
+      VectorFst<Arc> M2(D1);
+      Minimize(&M1, static_cast<MutableFst<Arc> *>(nullptr), kDelta);
+      Minimize(&M2, static_cast<MutableFst<Arc> *>(nullptr), kDelta, false, 3);
+      CHECK(Equal(M1, M2));
+    }
+
+    {
+      VLOG(1) << "Check parallel and sequential minimization of large cyclic "
+              << "FSTs agree.";
+      VectorFst<Arc> M1;
+      MakeLayeredFst(kWidth / 2, 2, true, &M1);
+      VectorFst<Arc> M2(M1);
+      Minimize(&M1);
+      Minimize(&M2, static_cast<MutableFst<Arc> *>(nullptr), kShortestDelta,
+               false, 2);
+      CHECK_EQ(M1.NumStates(), M2.NumStates());
+      CHECK(Isomorphic(M1, M2));
+    }
+  }
+
  private:
+  // Makes an input-deterministic acceptor with a start state and depth layers
+  // of width states. The start state has an arc to each state of the first
+  // layer, with distinct labels greater than 2; each layer state has arcs
+  // labeled 1 and 2 to two states of the next layer. If cyclic, the last
+  // layer leads back to the first, the FST is unweighted and some of its
+  // states are final; otherwise the weights are random and the states of
+  // the last layer are final.
+  void MakeLayeredFst(StateId width, StateId depth, bool cyclic,
+                      VectorFst<Arc> *fst) {
+    const auto weight = [&]() { return cyclic ? Weight::One() : generate_(); };
+    fst->DeleteStates();
+    fst->ReserveStates(1 + width * depth);
+    const auto start = fst->AddState();
+    fst->SetStart(start);
+    for (StateId s = 0; s < width * depth; ++s) fst->AddState();
+    const auto state = [&](StateId layer, StateId i) {
+      return 1 + (layer % depth) * width + i % width;
+    };
+    for (StateId i = 0; i < width; ++i) {
+      fst->EmplaceArc(start, i + 3, i + 3, weight(), state(0, i));
+    }
+    for (StateId layer = 0; layer < depth; ++layer) {
+      for (StateId i = 0; i < width; ++i) {
+        const auto s = state(layer, i);
+        if (layer + 1 < depth || cyclic) {
+          fst->EmplaceArc(s, 1, 1, weight(), state(layer + 1, i));
+          fst->EmplaceArc(s, 2, 2, weight(), state(layer + 1, i + 1));
+        }
+        if (cyclic ? i % 7 == 0 : layer + 1 == depth) {
+          fst->SetFinal(s, weight());
+        }
+      }
+    }
+  }
+
   // Tests rational operations with identities
   void TestRational(const Fst<Arc> &T1, const Fst<Arc> &T2,
                     const Fst<Arc> &T3) {
@@ -439,6 +550,31 @@ class WeightedTester {
       CHECK(Equiv(D, T));
     }
 
+    {
+      VLOG(1) << "Check encoding/decoding with a written table.";
+      VectorFst<Arc> E(T);
+      uint8 encode_props = 0;
+      if (std::bernoulli_distribution(.5)(rand_)) {
+        encode_props |= kEncodeLabels;
+      }
+      if (std::bernoulli_distribution(.5)(rand_)) {
+        encode_props |= kEncodeWeights;
+      }
+      EncodeMapper<Arc> encoder(encode_props, ENCODE);
+      Encode(&E, &encoder);
+      for (const bool align : {false, true}) {
+        std::stringstream strm;
+        CHECK(encoder.Write(
+            strm, FstWriteOptions("stream", true, true, true, align)));
+        std::unique_ptr<EncodeMapper<Arc>> decoder(
+            EncodeMapper<Arc>::Read(strm, "stream", DECODE));
+        CHECK(decoder);
+        VectorFst<Arc> D(E);
+        Decode(&D, *decoder);
+        CHECK(Equiv(D, T));
+      }
+    }
+
     {
       VLOG(1) << "Check encoding/decoding (delayed).";
       uint8 encode_props = 0;
@@ -575,6 +711,20 @@ class WeightedTester {
       LookAheadCompose(S1, S2, &C2);
       CHECK(Equiv(C1, C2));
     }
+
+    {
+      VLOG(1) << "Check parallel and sequential composition are equal.";
+      VectorFst<Arc> C1, C2;
+      Compose(S1, S3, &C1, ComposeOptions(false));
+      Compose(S1, S3, &C2, ComposeOptions(false, AUTO_FILTER, 3));
+      CHECK(Equal(C1, C2));
+      Compose(S1, S3, &C1, ComposeOptions(true, MATCH_FILTER));
+      Compose(S1, S3, &C2, ComposeOptions(true, MATCH_FILTER, 2));
+      CHECK(Equal(C1, C2));
+      LookAheadCompose(S1, S2, &C1);
+      LookAheadCompose(S1, S2, &C2, 2);
+      CHECK(Equal(C1, C2));
+    }
   }
 
   // Tests sorting operations
@@ -682,6 +832,21 @@ class WeightedTester {
       CHECK(ApproxEqual(w, w2, kTestDelta));
     }
 
+    if ((wprops & kSemiring) == kSemiring &&
+        (tprops & kAcyclic || wprops & kIdempotent)) {
+      VLOG(1) << "Check parallel and sequential shortest distances agree.";
+      for (const bool reverse : {false, true}) {
+        std::vector<Weight> d1;
+        ShortestDistance(T, &d1, reverse);
+        std::vector<Weight> d2;
+        ShortestDistance(T, &d2, reverse, kShortestDelta, /*num_threads=*/4);
+        CHECK_EQ(d1.size(), d2.size());
+        for (size_t s = 0; s < d1.size(); ++s) {
+          CHECK(ApproxEqual(d1[s], d2[s], kTestDelta));
+        }
+      }
+    }
+
     if ((wprops & kSemiring) == kSemiring && tprops & kAcyclic) {
       VLOG(1) << "Check determinized FSA is equivalent to its input.";
       DeterminizeFst<Arc> D(A);
@@ -695,6 +860,22 @@ class WeightedTester {
         CHECK(Equiv(T, DT));
       }
 
+      {
+        VLOG(1) << "Check parallel and sequential determinization are equal.";
+        VectorFst<Arc> D1, D2;
+        Determinize(A, &D1);
+        DeterminizeOptions<Arc> opts;
+        opts.num_threads = 3;
+        Determinize(A, &D2, opts);
+        CHECK(Equal(D1, D2));
+        opts.type = DETERMINIZE_NONFUNCTIONAL;
+        opts.num_threads = 1;
+        Determinize(T, &D1, opts);
+        opts.num_threads = 2;
+        Determinize(T, &D2, opts);
+        CHECK(Equal(D1, D2));
+      }
+
       if ((wprops & (kPath | kCommutative)) == (kPath | kCommutative)) {
         VLOG(1) << "Check pruning in determinization";
         VectorFst<Arc> P;
@@ -735,6 +916,15 @@ class WeightedTester {
         n = M.NumStates();
       }
 
+      {
+        VLOG(1) << "Check parallel and sequential minimization agree.";
+        VectorFst<Arc> M(D);
+        Minimize(&M, static_cast<MutableFst<Arc> *>(nullptr), kDelta, false,
+                 3);
+        CHECK(Equiv(D, M));
+        CHECK_EQ(n, M.NumStates());
+      }
+
       if (n && (wprops & kIdempotent) == kIdempotent &&
           A.Properties(kNoEpsilons, true)) {
         VLOG(1) << "Check that Revuz's algorithm leads to the"
@@ -851,6 +1041,65 @@ class WeightedTester {
         Reverse(R, &P2);
         CHECK(Equiv(P1, P2));
       }
+
+      {
+        VLOG(1) << "Check batched and single pruning are equal";
+        const Weight threshold = generate_();
+        const PruneOptions<Arc, AnyArcFilter<Arc>> opts(threshold);
+        std::vector<VectorFst<Arc>> fsts(8, VectorFst<Arc>(T));
+        fsts[1] = A;
+        std::vector<MutableFst<Arc> *> batch;
+        for (auto &fst : fsts) batch.push_back(&fst);
+        Prune(batch, opts, /*num_threads=*/3);
+        VectorFst<Arc> P1(T);
+        Prune(&P1, opts);
+        VectorFst<Arc> P2(A);
+        Prune(&P2, opts);
+        for (size_t i = 0; i < fsts.size(); ++i) {
+          CHECK(Equal(fsts[i], i == 1 ? P2 : P1));
+        }
+        // With a state threshold, and an empty FST in the batch.
+        const PruneOptions<Arc, AnyArcFilter<Arc>> sopts(threshold,
+                                                         /*nstate=*/3);
+        fsts.assign(5, VectorFst<Arc>(A));
+        fsts[2] = VectorFst<Arc>();
+        fsts[3] = T;
+        batch.clear();
+        for (auto &fst : fsts) batch.push_back(&fst);
+        Prune(batch, sopts, /*num_threads=*/2);
+        VectorFst<Arc> P3(A);
+        Prune(&P3, sopts);
+        VectorFst<Arc> P4(T);
+        Prune(&P4, sopts);
+        CHECK_EQ(fsts[2].NumStates(), 0);
+        CHECK(Equal(fsts[0], P3));
+        CHECK(Equal(fsts[3], P4));
+        CHECK(Equal(fsts[4], P3));
+      }
+
+      {
+        VLOG(1) << "Check a reused pruner matches fresh pruning";
+        const Weight threshold = generate_();
+        const PruneOptions<Arc, AnyArcFilter<Arc>> opts(threshold);
+        // With one thread, a single pruner prunes the whole batch in order;
+        // FSTs of different sizes alternate so that stale buffers would show.
+        std::vector<VectorFst<Arc>> fsts(5, VectorFst<Arc>(T));
+        fsts[1] = A;
+        fsts[2] = VectorFst<Arc>();
+        fsts[4] = A;
+        std::vector<MutableFst<Arc> *> batch;
+        for (auto &fst : fsts) batch.push_back(&fst);
+        Prune(batch, opts, /*num_threads=*/1);
+        VectorFst<Arc> P1(T);
+        Prune(&P1, opts);
+        VectorFst<Arc> P2(A);
+        Prune(&P2, opts);
+        CHECK(Equal(fsts[0], P1));
+        CHECK(Equal(fsts[1], P2));
+        CHECK_EQ(fsts[2].NumStates(), 0);
+        CHECK(Equal(fsts[3], P1));
+        CHECK(Equal(fsts[4], P2));
+      }
       {
         VLOG(1) << "Check: ShortestDistance(A - prune(A))"
                 << " > ShortestDistance(A) times Threshold";
@@ -1218,6 +1467,11 @@ class UnweightedTester<StdArc> {
         Minimize(&M, static_cast<MutableFst<Arc> *>(nullptr), kDelta);
         CHECK(Equiv(A, M));
         n = M.NumStates();
+        VectorFst<Arc> PM(D);
+        Minimize(&PM, static_cast<MutableFst<Arc> *>(nullptr), kDelta, false,
+                 2);
+        CHECK(Equiv(A, PM));
+        CHECK_EQ(n, PM.NumStates());
       }
 
       if (n) {  // Skips test if A is the empty machine.
@@ -1349,6 +1603,8 @@ class AlgoTester {
   void Test() {
     VLOG(1) << "weight type = " << Weight::Type();
 
+    weighted_tester_->TestParallel();
+
     for (int i = 0; i < FLAGS_repeat; ++i) {
       // Random transducers
       VectorFst<Arc> T1;
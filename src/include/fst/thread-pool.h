@@ -0,0 +1,138 @@
+// Copyright 2005-2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the 'License');
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an 'AS IS' BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// See www.openfst.org for extensive documentation on this weighted
+// finite-state transducer library.
+//
+// A simple fixed-size thread pool used by the parallel algorithms.
+
+#ifndef FST_THREAD_POOL_H_
+#define FST_THREAD_POOL_H_
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace fst {
+
+// A pool of worker threads running scheduled tasks in FIFO order. If
+// constructed with fewer than two threads, no workers are started and tasks
+// are run on the calling thread by Schedule(). Wait() blocks until all
+// scheduled tasks have finished; it must not be called from a task.
+class ThreadPool {
+ public:
+  explicit ThreadPool(int num_threads) {
+    if (num_threads < 2) return;
+    workers_.reserve(num_threads);
+    for (int i = 0; i < num_threads; ++i) {
+      workers_.emplace_back([this] { Work(); });
+    }
+  }
+
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(mu_);
+      done_ = true;
+    }
+    task_cv_.notify_all();
+    for (auto &worker : workers_) worker.join();
+  }
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  int NumThreads() const { return std::max<int>(1, workers_.size()); }
+
+  void Schedule(std::function<void()> task) {
+    if (workers_.empty()) {
+      task();
+      return;
+    }
+    {
+      std::lock_guard<std::mutex> lock(mu_);
+      tasks_.push_back(std::move(task));
+      ++pending_;
+    }
+    task_cv_.notify_one();
+  }
+
+  void Wait() {
+    std::unique_lock<std::mutex> lock(mu_);
+    idle_cv_.wait(lock, [this] { return pending_ == 0; });
+  }
+
+ private:
+  void Work() {
+    while (true) {
+      std::function<void()> task;
+      {
+        std::unique_lock<std::mutex> lock(mu_);
+        task_cv_.wait(lock, [this] { return done_ || !tasks_.empty(); });
+        if (tasks_.empty()) return;
+        task = std::move(tasks_.front());
+        tasks_.pop_front();
+      }
+      task();
+      {
+        std::lock_guard<std::mutex> lock(mu_);
+        if (--pending_ == 0) idle_cv_.notify_all();
+      }
+    }
+  }
+
+  std::vector<std::thread> workers_;
+  std::deque<std::function<void()>> tasks_;
+  size_t pending_ = 0;  // Scheduled tasks not yet finished.
+  bool done_ = false;
+  std::mutex mu_;
+  std::condition_variable task_cv_;
+  std::condition_variable idle_cv_;
+};
+
+// Calls fn(i) for each i in [begin, end), splitting the range into at most
+// one contiguous chunk per pool thread, each of at least min_chunk indices,
+// and blocks until all calls have returned. Ranges too small to split are run
+// on the calling thread, as is everything when pool is null.
+template <class F>
+void ParallelFor(ThreadPool *pool, size_t begin, size_t end, F fn,
+                 size_t min_chunk = 1) {
+  if (end <= begin) return;
+  const size_t size = end - begin;
+  const size_t nchunks =
+      pool ? std::min<size_t>(pool->NumThreads(),
+                              size / std::max<size_t>(min_chunk, 1))
+           : 1;
+  if (nchunks <= 1) {
+    for (auto i = begin; i < end; ++i) fn(i);
+    return;
+  }
+  const size_t chunk = (size + nchunks - 1) / nchunks;
+  for (auto lo = begin; lo < end; lo += chunk) {
+    const auto hi = std::min(end, lo + chunk);
+    pool->Schedule([&fn, lo, hi] {
+      for (auto i = lo; i < hi; ++i) fn(i);
+    });
+  }
+  pool->Wait();
+}
+
+}  // namespace fst
+
+#endif  // FST_THREAD_POOL_H_
@@ -30,6 +30,7 @@
 #include <fst/log.h>
 
 #include <fst/fst-decl.h>  // For optional argument declarations
+#include <fst/memory.h>
 #include <fst/mutable-fst.h>
 #include <fst/test-properties.h>
 
@@ -180,11 +181,14 @@ class VectorFstBaseImpl : public FstImpl<typename S::Arc> {
   VectorFstBaseImpl(const VectorFstBaseImpl<S> &) = delete;
   VectorFstBaseImpl &operator=(const VectorFstBaseImpl &) = delete;
 
-  // Moving is permitted.
+  // Moving is permitted. The allocators are shared with the moved-from
+  // implementation so that states remain valid with stateful allocators.
   VectorFstBaseImpl(VectorFstBaseImpl &&impl) noexcept
       : FstImpl<typename S::Arc>(),
         states_(std::move(impl.states_)),
-        start_(impl.start_) {
+        start_(impl.start_),
+        state_alloc_(impl.state_alloc_),
+        arc_alloc_(impl.arc_alloc_) {
     impl.states_.clear();
     impl.start_ = kNoStateId;
   }
@@ -197,6 +201,8 @@ class VectorFstBaseImpl : public FstImpl<typename S::Arc> {
     std::swap(states_, impl.states_);
     start_ = impl.start_;
     impl.start_ = kNoStateId;
+    state_alloc_ = impl.state_alloc_;
+    arc_alloc_ = impl.arc_alloc_;
     return *this;
   }
 
@@ -284,11 +290,15 @@ class VectorFstBaseImpl : public FstImpl<typename S::Arc> {
     if (Start() != kNoStateId) SetStart(newid[Start()]);
   }
 
+  // Deletes all states. Fresh allocators are then used so that memory held by
+  // stateful (e.g., arena) allocators is released in bulk.
   void DeleteStates() {
     for (size_t state = 0; state < states_.size(); ++state) {
       State::Destroy(states_[state], &state_alloc_);
     }
     states_.clear();
+    state_alloc_ = typename State::StateAllocator();
+    arc_alloc_ = typename State::ArcAllocator();
     SetStart(kNoStateId);
   }
 
@@ -619,6 +629,14 @@ class VectorFst : public ImplToMutableFst<internal::VectorFstImpl<S>> {
 template <class Arc, class State>
 inline VectorFst<Arc, State>::VectorFst(VectorFst &&fst) noexcept = default;
 
+// A VectorFst whose states and arcs are allocated from memory arenas (see
+// BlockAllocator in memory.h) rather than individually from the heap, which
+// greatly reduces allocation overhead and improves locality when building large
+// FSTs. Arena memory is not reused when states or arcs are deleted; it is
+// released in bulk when the FST is destroyed or all its states are deleted.
+template <class Arc>
+using ArenaVectorFst = VectorFst<Arc, VectorState<Arc, BlockAllocator<Arc>>>;
+
 template <class Arc, class State>
 inline VectorFst<Arc, State> &VectorFst<Arc, State>::operator=(
     VectorFst &&fst) noexcept = default;
@@ -36,6 +36,10 @@ DEFINE_bool(fst_default_cache_gc, true, "Enable garbage collection of cache");
 DEFINE_int64(fst_default_cache_gc_limit, 1 << 20LL,
              "Cache byte size that triggers garbage collection");
 
+DEFINE_bool(fst_default_cache_gc_clock, false,
+            "Use CLOCK replacement (approximate LRU) for cache garbage "
+            "collection");
+
 DEFINE_bool(fst_align, false, "Write FST data aligned where appropriate");
 
 DEFINE_string(save_relabel_ipairs, "", "Save input relabel pairs to file");
@@ -44,6 +48,9 @@ DEFINE_string(save_relabel_opairs, "", "Save output relabel pairs to file");
 DEFINE_string(fst_read_mode, "read",
               "Default file reading mode for mappable files");
 
+DEFINE_bool(fst_intern_symbols, false,
+            "Share the symbol tables of FSTs read with equal tables");
+
 namespace fst {
 
 // FST type definitions for lookahead FSTs.
@@ -114,7 +121,9 @@ FstReadOptions::FstReadOptions(const std::string_view source,
       isymbols(isymbols),
       osymbols(osymbols),
       read_isymbols(true),
-      read_osymbols(true) {
+      read_osymbols(true),
+      symbols_interner(FLAGS_fst_intern_symbols ? SymbolTableInterner::Global()
+                                                : nullptr) {
   mode = ReadMode(FLAGS_fst_read_mode);
 }
 
@@ -126,7 +135,9 @@ FstReadOptions::FstReadOptions(const std::string_view source,
       isymbols(isymbols),
       osymbols(osymbols),
       read_isymbols(true),
-      read_osymbols(true) {
+      read_osymbols(true),
+      symbols_interner(FLAGS_fst_intern_symbols ? SymbolTableInterner::Global()
+                                                : nullptr) {
   mode = ReadMode(FLAGS_fst_read_mode);
 }
 
@@ -145,7 +156,8 @@ std::string FstReadOptions::DebugString() const {
         << (read_osymbols ? "true" : "false") << "\" header: \""
         << (header ? "set" : "null") << "\" isymbols: \""
         << (isymbols ? "set" : "null") << "\" osymbols: \""
-        << (osymbols ? "set" : "null") << "\"";
+        << (osymbols ? "set" : "null") << "\" symbols_interner: \""
+        << (symbols_interner ? "set" : "null") << "\"";
   return ostrm.str();
 }
 
@@ -77,6 +77,16 @@ MappedFile *MappedFile::Map(std::istream *istrm, bool memorymap,
   VLOG(2) << "memorymap: " << (memorymap ? "true" : "false") << " source: \""
           << source << "\""
           << " size: " << size << " offset: " << spos;
+  if (auto *mstrm = dynamic_cast<MappedFileInputStream *>(istrm)) {
+    const auto *data = static_cast<const char *>(mstrm->File()->data());
+    if (spos >= 0 &&
+        reinterpret_cast<uintptr_t>(data + spos) % kArchAlignment == 0 &&
+        istrm->seekg(spos + static_cast<std::streamoff>(size))) {
+      return View(mstrm->File(), spos);
+    }
+    istrm->clear();
+    istrm->seekg(spos);
+  }
   if (memorymap && spos >= 0 && spos % kArchAlignment == 0) {
     const size_t pos = static_cast<size_t>(spos);
 #ifdef _WIN32
@@ -208,6 +218,52 @@ MappedFile *MappedFile::Borrow(void *data) {
   return new MappedFile(region);
 }
 
+MappedFile *MappedFile::View(std::shared_ptr<const MappedFile> file,
+                             size_t pos) {
+  MemoryRegion region;
+  region.data = static_cast<char *>(file->region_.data) + pos;
+  region.mmap = region.data;
+  region.size = 0;
+  region.offset = 0;
+  auto *view = new MappedFile(region);
+  view->owner_ = std::move(file);
+  return view;
+}
+
+MappedFileInputStream::MappedFileInputStream(
+    std::shared_ptr<const MappedFile> file, size_t size)
+    : std::istream(nullptr),
+      file_(std::move(file)),
+      buf_(static_cast<const char *>(file_->data()), size) {
+  rdbuf(&buf_);
+}
+
+MappedFileInputStream::StreamBuf::StreamBuf(const char *data, size_t size) {
+  // The get area is never written through.
+  auto *begin = const_cast<char *>(data);
+  setg(begin, begin, begin + size);
+}
+
+std::streambuf::pos_type MappedFileInputStream::StreamBuf::seekoff(
+    off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) {
+  off_type pos = off;
+  if (dir == std::ios_base::cur) {
+    pos += gptr() - eback();
+  } else if (dir == std::ios_base::end) {
+    pos += egptr() - eback();
+  }
+  if (!(which & std::ios_base::in) || pos < 0 || pos > egptr() - eback()) {
+    return pos_type(off_type(-1));
+  }
+  setg(eback(), eback() + pos, egptr());
+  return pos_type(pos);
+}
+
+std::streambuf::pos_type MappedFileInputStream::StreamBuf::seekpos(
+    pos_type pos, std::ios_base::openmode which) {
+  return seekoff(off_type(pos), std::ios_base::beg, which);
+}
+
 constexpr size_t MappedFile::kArchAlignment;
 
 constexpr size_t MappedFile::kMaxReadChunk;
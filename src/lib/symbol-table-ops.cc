@@ -61,7 +61,7 @@ SymbolTable *MergeSymbolTable(const SymbolTable &left, const SymbolTable &right,
     left_has_all = false;
     if (!merged->Find(ritem.Label()).empty()) {
       // We can't add this where we want to, add it later, in order.
-      conflicts.push_back(ritem.Symbol());
+      conflicts.emplace_back(ritem.Symbol());
       continue;
     }
     // There is a hole and we can add this symbol with its ID.
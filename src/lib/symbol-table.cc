@@ -19,6 +19,9 @@
 
 #include <fst/symbol-table.h>
 
+#include <algorithm>
+#include <limits>
+
 #include <fst/flags.h>
 #include <fst/types.h>
 #include <fst/log.h>
@@ -45,6 +48,9 @@ const int kLineLen = 8096;
 // Identifies stream data as a symbol table (and its endianity).
 static constexpr int32 kSymbolTableMagicNumber = 2125658996;
 
+// Identifies stream data as a packed symbol table (and its endianity).
+static constexpr int32 kPackedSymbolTableMagicNumber = 2125658997;
+
 constexpr int64 DenseSymbolMap::kEmptyBucket;
 
 DenseSymbolMap::DenseSymbolMap()
@@ -60,12 +66,14 @@ std::pair<int64, bool> DenseSymbolMap::InsertOrFind(KeyType key) {
   size_t idx = GetHash(key);
   while (buckets_[idx] != kEmptyBucket) {
     const auto stored_value = buckets_[idx];
-    if (symbols_[stored_value] == key) return {stored_value, false};
+    if (GetSymbol(stored_value) == key) return {stored_value, false};
     idx = (idx + 1) & hash_mask_;
   }
   const auto next = Size();
   buckets_[idx] = next;
-  symbols_.emplace_back(key);
+  // The key may point into the pool, which std::string::append allows.
+  pool_.append(key.data(), key.size());
+  ends_.push_back(pool_.size());
   return {next, true};
 }
 
@@ -73,7 +81,7 @@ int64 DenseSymbolMap::Find(KeyType key) const {
   size_t idx = str_hash_(key) & hash_mask_;
   while (buckets_[idx] != kEmptyBucket) {
     const auto stored_value = buckets_[idx];
-    if (symbols_[stored_value] == key) return stored_value;
+    if (GetSymbol(stored_value) == key) return stored_value;
     idx = (idx + 1) & hash_mask_;
   }
   return buckets_[idx];
@@ -84,7 +92,7 @@ void DenseSymbolMap::Rehash(size_t num_buckets) {
   hash_mask_ = buckets_.size() - 1;
   std::fill(buckets_.begin(), buckets_.end(), kEmptyBucket);
   for (size_t i = 0; i < Size(); ++i) {
-    size_t idx = GetHash(symbols_[i]);
+    size_t idx = GetHash(GetSymbol(i));
     while (buckets_[idx] != kEmptyBucket) {
       idx = (idx + 1) & hash_mask_;
     }
@@ -93,11 +101,18 @@ void DenseSymbolMap::Rehash(size_t num_buckets) {
 }
 
 void DenseSymbolMap::RemoveSymbol(size_t idx) {
-  symbols_.erase(symbols_.begin() + idx);
+  const size_t begin = idx == 0 ? 0 : ends_[idx - 1];
+  const size_t size = ends_[idx] - begin;
+  pool_.erase(begin, size);
+  ends_.erase(ends_.begin() + idx);
+  for (size_t i = idx; i < ends_.size(); ++i) ends_[i] -= size;
   Rehash(buckets_.size());
 }
 
-void DenseSymbolMap::ShrinkToFit() { symbols_.shrink_to_fit(); }
+void DenseSymbolMap::ShrinkToFit() {
+  pool_.shrink_to_fit();
+  ends_.shrink_to_fit();
+}
 
 void MutableSymbolTableImpl::AddTable(const SymbolTable &table) {
   for (const auto &item : table) {
@@ -173,14 +188,14 @@ void SymbolTableImpl::MaybeRecomputeCheckSum() const {
     if (check_sum_finalized_) return;
   }
   // We'll acquire an exclusive lock to recompute the checksums.
-  MutexLock check_sum_lock(&check_sum_mutex_);
+  WriterMutexLock check_sum_lock(&check_sum_mutex_);
   if (check_sum_finalized_) {  // Another thread (coming in around the same time
     return;                    // might have done it already). So we recheck.
   }
   // Calculates the original label-agnostic checksum.
   CheckSummer check_sum;
   for (size_t i = 0; i < symbols_.Size(); ++i) {
-    const auto &symbol = symbols_.GetSymbol(i);
+    const auto symbol = symbols_.GetSymbol(i);
     check_sum.Update(symbol.data(), symbol.size());
     check_sum.Update("", 1);
   }
@@ -205,7 +220,7 @@ void SymbolTableImpl::MaybeRecomputeCheckSum() const {
   check_sum_finalized_ = true;
 }
 
-std::string SymbolTableImpl::Find(int64 key) const {
+std::string_view SymbolTableImpl::Find(int64 key) const {
   int64 idx = key;
   if (key < 0 || key >= dense_key_limit_) {
     const auto it = key_map_.find(key);
@@ -216,6 +231,17 @@ std::string SymbolTableImpl::Find(int64 key) const {
   return symbols_.GetSymbol(idx);
 }
 
+std::unique_ptr<SymbolTableImpl> SymbolTableImpl::CopyFrom(
+    const SymbolTableImplBase &impl) {
+  auto copy = fst::make_unique<SymbolTableImpl>(impl.Name());
+  for (size_t pos = 0; pos < impl.NumSymbols(); ++pos) {
+    const auto key = impl.GetNthKey(pos);
+    copy->AddSymbol(impl.Find(key), key);
+  }
+  copy->available_key_ = std::max(copy->available_key_, impl.AvailableKey());
+  return copy;
+}
+
 int64 SymbolTableImpl::AddSymbol(SymbolType symbol, int64 key) {
   if (key == kNoSymbol) return key;
   const auto insert_key = symbols_.InsertOrFind(symbol);
@@ -283,12 +309,6 @@ void SymbolTableImpl::RemoveSymbol(const int64 key) {
 
 SymbolTableImpl *SymbolTableImpl::Read(std::istream &strm,
                                        const SymbolTableReadOptions &) {
-  int32 magic_number = 0;
-  ReadType(strm, &magic_number);
-  if (strm.fail()) {
-    LOG(ERROR) << "SymbolTable::Read: Read failed";
-    return nullptr;
-  }
   std::string name;
   ReadType(strm, &name);
   auto impl = fst::make_unique<SymbolTableImpl>(name);
@@ -322,11 +342,11 @@ bool SymbolTableImpl::Write(std::ostream &strm) const {
   const int64 size = symbols_.Size();
   WriteType(strm, size);
   for (int64 i = 0; i < dense_key_limit_; ++i) {
-    WriteType(strm, symbols_.GetSymbol(i));
+    WriteType(strm, std::string(symbols_.GetSymbol(i)));
     WriteType(strm, i);
   }
   for (const auto &p : key_map_) {
-    WriteType(strm, symbols_.GetSymbol(p.second));
+    WriteType(strm, std::string(symbols_.GetSymbol(p.second)));
     WriteType(strm, p.first);
   }
   strm.flush();
@@ -339,8 +359,257 @@ bool SymbolTableImpl::Write(std::ostream &strm) const {
 
 void SymbolTableImpl::ShrinkToFit() { symbols_.ShrinkToFit(); }
 
+constexpr int32 PackedSymbolTableImpl::kEmptyBucket;
+
+namespace {
+
+// 64-bit FNV-1a hash, which unlike std::hash is stable across platforms and
+// can thus be stored.
+uint64 PackedSymbolHash(std::string_view symbol) {
+  uint64 hash = 14695981039346656037ULL;
+  for (const unsigned char c : symbol) {
+    hash ^= c;
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+template <class T>
+void CopyArray(const std::vector<T> &values, char **data) {
+  std::copy(values.begin(), values.end(), reinterpret_cast<T *>(*data));
+  *data += values.size() * sizeof(T);
+}
+
+}  // namespace
+
+PackedSymbolTableImpl::PackedSymbolTableImpl(const SymbolTable &table)
+    : name_(table.Name()),
+      available_key_(table.AvailableKey()),
+      num_symbols_(table.NumSymbols()),
+      labeled_check_sum_string_(table.LabeledCheckSum()) {
+  if (num_symbols_ > std::numeric_limits<int32>::max()) {
+    LOG(FATAL) << "PackedSymbolTableImpl: Too many symbols: " << num_symbols_;
+  }
+  std::vector<int64> offsets(1, 0);
+  std::vector<int64> keys;
+  std::string pool;
+  offsets.reserve(num_symbols_ + 1);
+  keys.reserve(num_symbols_);
+  CheckSummer check_sum;
+  for (const auto &item : table) {
+    const auto symbol = item.Symbol();
+    pool.append(symbol.data(), symbol.size());
+    offsets.push_back(pool.size());
+    keys.push_back(item.Label());
+    check_sum.Update(symbol.data(), symbol.size());
+    check_sum.Update("", 1);
+  }
+  check_sum_string_ = check_sum.Digest();
+  pool_size_ = pool.size();
+  while (dense_key_limit_ < num_symbols_ &&
+         keys[dense_key_limit_] == dense_key_limit_) {
+    ++dense_key_limit_;
+  }
+  std::vector<std::pair<int64, int32>> sparse;
+  sparse.reserve(num_symbols_ - dense_key_limit_);
+  for (int64 pos = dense_key_limit_; pos < num_symbols_; ++pos) {
+    sparse.emplace_back(keys[pos], pos);
+  }
+  std::sort(sparse.begin(), sparse.end());
+  std::vector<int64> sparse_keys;
+  std::vector<int32> sparse_positions;
+  sparse_keys.reserve(sparse.size());
+  sparse_positions.reserve(sparse.size());
+  for (const auto &key_pos : sparse) {
+    sparse_keys.push_back(key_pos.first);
+    sparse_positions.push_back(key_pos.second);
+  }
+  // Uses the occupancy limit of DenseSymbolMap.
+  num_buckets_ = 1 << 4;
+  while (num_symbols_ >= 0.75 * num_buckets_) num_buckets_ *= 2;
+  std::vector<int32> buckets(num_buckets_, kEmptyBucket);
+  const uint64 mask = num_buckets_ - 1;
+  for (int32 pos = 0; pos < num_symbols_; ++pos) {
+    const std::string_view symbol(pool.data() + offsets[pos],
+                                  offsets[pos + 1] - offsets[pos]);
+    auto idx = PackedSymbolHash(symbol) & mask;
+    while (buckets[idx] != kEmptyBucket) idx = (idx + 1) & mask;
+    buckets[idx] = pos;
+  }
+  region_.reset(MappedFile::Allocate(RegionSize()));
+  auto *data = static_cast<char *>(region_->mutable_data());
+  CopyArray(offsets, &data);
+  CopyArray(keys, &data);
+  CopyArray(sparse_keys, &data);
+  CopyArray(sparse_positions, &data);
+  CopyArray(buckets, &data);
+  std::copy(pool.begin(), pool.end(), data);
+  InitArrays();
+}
+
+size_t PackedSymbolTableImpl::RegionSize() const {
+  const size_t num_sparse = num_symbols_ - dense_key_limit_;
+  return (2 * num_symbols_ + 1 + num_sparse) * sizeof(int64) +
+         (num_sparse + num_buckets_) * sizeof(int32) + pool_size_;
+}
+
+bool PackedSymbolTableImpl::InitArrays() {
+  const auto *data = static_cast<const char *>(region_->data());
+  offsets_ = reinterpret_cast<const int64 *>(data);
+  keys_ = offsets_ + num_symbols_ + 1;
+  sparse_keys_ = keys_ + num_symbols_;
+  sparse_positions_ =
+      reinterpret_cast<const int32 *>(sparse_keys_ + num_symbols_ -
+                                      dense_key_limit_);
+  buckets_ = sparse_positions_ + num_symbols_ - dense_key_limit_;
+  pool_ = reinterpret_cast<const char *>(buckets_ + num_buckets_);
+  return offsets_[0] == 0 && offsets_[num_symbols_] == pool_size_;
+}
+
+PackedSymbolTableImpl *PackedSymbolTableImpl::Read(
+    std::istream &strm, const SymbolTableReadOptions &opts) {
+  auto impl = fst::WrapUnique(ReadHeader(strm, opts));
+  if (!impl || !impl->ReadRegion(strm, opts)) return nullptr;
+  return impl.release();
+}
+
+PackedSymbolTableImpl *PackedSymbolTableImpl::ReadHeader(
+    std::istream &strm, const SymbolTableReadOptions &opts) {
+  auto impl = fst::WrapUnique(new PackedSymbolTableImpl());
+  ReadType(strm, &impl->name_);
+  ReadType(strm, &impl->available_key_);
+  ReadType(strm, &impl->num_symbols_);
+  ReadType(strm, &impl->dense_key_limit_);
+  ReadType(strm, &impl->num_buckets_);
+  ReadType(strm, &impl->pool_size_);
+  ReadType(strm, &impl->check_sum_string_);
+  ReadType(strm, &impl->labeled_check_sum_string_);
+  ReadType(strm, &impl->aligned_);
+  if (strm.fail()) {
+    LOG(ERROR) << "SymbolTable::Read: Read failed";
+    return nullptr;
+  }
+  if (impl->num_symbols_ < 0 ||
+      impl->num_symbols_ > std::numeric_limits<int32>::max() ||
+      impl->dense_key_limit_ < 0 ||
+      impl->dense_key_limit_ > impl->num_symbols_ ||
+      impl->num_buckets_ <= impl->num_symbols_ ||
+      (impl->num_buckets_ & (impl->num_buckets_ - 1)) != 0 ||
+      impl->pool_size_ < 0) {
+    LOG(ERROR) << "SymbolTable::Read: Corrupt packed symbol table header: "
+               << opts.source;
+    return nullptr;
+  }
+  return impl.release();
+}
+
+bool PackedSymbolTableImpl::ReadRegion(std::istream &strm,
+                                       const SymbolTableReadOptions &opts) {
+  if (aligned_ && !AlignInput(strm)) {
+    LOG(ERROR) << "SymbolTable::Read: Could not align stream: " << opts.source;
+    return false;
+  }
+  region_.reset(
+      MappedFile::Map(&strm, opts.memory_map, opts.source, RegionSize()));
+  if (!region_ || !InitArrays()) {
+    LOG(ERROR) << "SymbolTable::Read: Read failed: " << opts.source;
+    return false;
+  }
+  return true;
+}
+
+bool PackedSymbolTableImpl::SkipRegion(std::istream &strm,
+                                       const SymbolTableReadOptions &opts) {
+  if (aligned_ && !AlignInput(strm)) {
+    LOG(ERROR) << "SymbolTable::Read: Could not align stream: " << opts.source;
+    return false;
+  }
+  // Ignores rather than seeks past the region, which also works on pipes.
+  const auto size = RegionSize();
+  strm.ignore(size);
+  if (strm.fail() || static_cast<size_t>(strm.gcount()) != size) {
+    LOG(ERROR) << "SymbolTable::Read: Could not skip table: " << opts.source;
+    return false;
+  }
+  return true;
+}
+
+bool PackedSymbolTableImpl::Write(std::ostream &strm) const {
+  WriteType(strm, kPackedSymbolTableMagicNumber);
+  WriteType(strm, name_);
+  WriteType(strm, available_key_);
+  WriteType(strm, num_symbols_);
+  WriteType(strm, dense_key_limit_);
+  WriteType(strm, num_buckets_);
+  WriteType(strm, pool_size_);
+  WriteType(strm, check_sum_string_);
+  WriteType(strm, labeled_check_sum_string_);
+  // The region is aligned for memory mapping if the stream is seekable.
+  const bool aligned = strm.tellp() >= 0;
+  WriteType(strm, aligned);
+  if (aligned && !AlignOutput(strm)) {
+    LOG(ERROR) << "SymbolTable::Write: Could not align stream";
+    return false;
+  }
+  strm.write(static_cast<const char *>(region_->data()), RegionSize());
+  strm.flush();
+  if (strm.fail()) {
+    LOG(ERROR) << "SymbolTable::Write: Write failed";
+    return false;
+  }
+  return true;
+}
+
+std::string_view PackedSymbolTableImpl::Find(int64 key) const {
+  if (key >= 0 && key < dense_key_limit_) return GetSymbol(key);
+  const auto *end = sparse_keys_ + num_symbols_ - dense_key_limit_;
+  const auto *it = std::lower_bound(sparse_keys_, end, key);
+  if (it == end || *it != key) return std::string_view();
+  return GetSymbol(sparse_positions_[it - sparse_keys_]);
+}
+
+int64 PackedSymbolTableImpl::Find(SymbolType symbol) const {
+  const uint64 mask = num_buckets_ - 1;
+  for (auto idx = PackedSymbolHash(symbol) & mask;
+       buckets_[idx] != kEmptyBucket; idx = (idx + 1) & mask) {
+    if (GetSymbol(buckets_[idx]) == symbol) return keys_[buckets_[idx]];
+  }
+  return kNoSymbol;
+}
+
 }  // namespace internal
 
+SymbolTable *SymbolTable::Read(std::istream &strm,
+                               const SymbolTableReadOptions &opts) {
+  int32 magic_number = 0;
+  ReadType(strm, &magic_number);
+  if (strm.fail()) {
+    LOG(ERROR) << "SymbolTable::Read: Read failed";
+    return nullptr;
+  }
+  std::unique_ptr<internal::SymbolTableImplBase> impl;
+  if (magic_number == internal::kPackedSymbolTableMagicNumber) {
+    auto packed = fst::WrapUnique(
+        internal::PackedSymbolTableImpl::ReadHeader(strm, opts));
+    if (!packed) return nullptr;
+    if (opts.interner) {
+      std::unique_ptr<SymbolTable> table(
+          opts.interner->Find(packed->Name(), packed->LabeledCheckSum()));
+      if (table) {
+        return packed->SkipRegion(strm, opts) ? table.release() : nullptr;
+      }
+    }
+    if (!packed->ReadRegion(strm, opts)) return nullptr;
+    impl = std::move(packed);
+  } else {
+    impl.reset(internal::SymbolTableImpl::Read(strm, opts));
+  }
+  if (!impl) return nullptr;
+  auto table = fst::WrapUnique(new SymbolTable(std::move(impl)));
+  return opts.interner ? opts.interner->Intern(std::move(table))
+                       : table.release();
+}
+
 SymbolTable *SymbolTable::ReadText(const std::string &source,
                                    const SymbolTableTextOptions &opts) {
   std::ifstream strm(source, std::ios_base::in);
@@ -406,6 +675,36 @@ bool SymbolTable::WriteText(const std::string &source) const {
   }
 }
 
+SymbolTable *SymbolTableInterner::Find(
+    const std::string &name, const std::string &labeled_check_sum) const {
+  ReaderMutexLock lock(&mu_);
+  const auto it = tables_.find(std::make_pair(name, labeled_check_sum));
+  return it == tables_.end() ? nullptr : it->second->Copy();
+}
+
+SymbolTable *SymbolTableInterner::Intern(std::unique_ptr<SymbolTable> table) {
+  auto key = std::make_pair(table->Name(), table->LabeledCheckSum());
+  WriterMutexLock lock(&mu_);
+  auto &registered = tables_[std::move(key)];
+  if (!registered) registered = std::move(table);
+  return registered->Copy();
+}
+
+size_t SymbolTableInterner::Size() const {
+  ReaderMutexLock lock(&mu_);
+  return tables_.size();
+}
+
+void SymbolTableInterner::Clear() {
+  WriterMutexLock lock(&mu_);
+  tables_.clear();
+}
+
+SymbolTableInterner *SymbolTableInterner::Global() {
+  static auto *const interner = new SymbolTableInterner();
+  return interner;
+}
+
 bool CompatSymbols(const SymbolTable *syms1, const SymbolTable *syms2,
                    bool warning) {
   // Flag can explicitly override this check.
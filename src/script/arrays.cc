@@ -0,0 +1,42 @@
+// Copyright 2005-2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the 'License');
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an 'AS IS' BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// See www.openfst.org for extensive documentation on this weighted
+// finite-state transducer library.
+
+#include <fst/script/arrays.h>
+
+#include <fst/script/script-impl.h>
+
+namespace fst {
+namespace script {
+
+void FstToArrays(const FstClass &fst, FstArrays *arrays) {
+  FstToArraysArgs args(fst, arrays);
+  Apply<Operation<FstToArraysArgs>>("FstToArrays", fst.ArcType(), &args);
+}
+
+REGISTER_FST_OPERATION_3ARCS(FstToArrays, FstToArraysArgs);
+
+bool ArraysToFst(const FstArrays &arrays, MutableFstClass *fst) {
+  ArraysToFstInnerArgs iargs(arrays, fst);
+  ArraysToFstArgs args(iargs);
+  Apply<Operation<ArraysToFstArgs>>("ArraysToFst", fst->ArcType(), &args);
+  return args.retval;
+}
+
+REGISTER_FST_OPERATION_3ARCS(ArraysToFst, ArraysToFstArgs);
+
+}  // namespace script
+}  // namespace fst
@@ -26,27 +26,29 @@ void CompileFst(std::istream &istrm, const std::string &source,
                 const std::string &dest, const std::string &fst_type,
                 const std::string &arc_type, const SymbolTable *isyms,
                 const SymbolTable *osyms, const SymbolTable *ssyms, bool accep,
-                bool ikeep, bool okeep, bool nkeep,
-                bool allow_negative_labels) {
-  std::unique_ptr<FstClass> fst(
-      CompileFstInternal(istrm, source, fst_type, arc_type, isyms, osyms, ssyms,
-                         accep, ikeep, okeep, nkeep, allow_negative_labels));
-  fst->Write(dest);
+                bool ikeep, bool okeep, bool nkeep, bool allow_negative_labels,
+                int num_threads, bool map_source) {
+  CompileFstInnerArgs iargs{istrm, source, fst_type, isyms, osyms, ssyms, accep,
+                            ikeep, okeep, nkeep, allow_negative_labels,
+                            num_threads, map_source};
+  CompileFstToFileArgs args(iargs, dest);
+  Apply<Operation<CompileFstToFileArgs>>("CompileFst", arc_type, &args);
 }
 
 std::unique_ptr<FstClass> CompileFstInternal(
     std::istream &istrm, const std::string &source, const std::string &fst_type,
     const std::string &arc_type, const SymbolTable *isyms,
     const SymbolTable *osyms, const SymbolTable *ssyms, bool accep, bool ikeep,
-    bool okeep, bool nkeep, bool allow_negative_labels) {
+    bool okeep, bool nkeep, bool allow_negative_labels, int num_threads) {
   CompileFstInnerArgs iargs{istrm, source, fst_type, isyms, osyms, ssyms, accep,
-                            ikeep, okeep, nkeep, allow_negative_labels};
+                            ikeep, okeep, nkeep, allow_negative_labels,
+                            num_threads, false};
   CompileFstArgs args(iargs);
   Apply<Operation<CompileFstArgs>>("CompileFstInternal", arc_type, &args);
   return std::move(args.retval);
 }
 
-// This registers form 2; 1 does not require registration.
+REGISTER_FST_OPERATION_3ARCS(CompileFst, CompileFstToFileArgs);
 REGISTER_FST_OPERATION_3ARCS(CompileFstInternal, CompileFstArgs);
 
 }  // namespace script
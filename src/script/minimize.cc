@@ -23,13 +23,13 @@ namespace fst {
 namespace script {
 
 void Minimize(MutableFstClass *ofst1, MutableFstClass *ofst2, float delta,
-              bool allow_nondet) {
+              bool allow_nondet, int num_threads) {
   if (ofst2 && !internal::ArcTypesMatch(*ofst1, *ofst2, "Minimize")) {
     ofst1->SetProperties(kError, kError);
     ofst2->SetProperties(kError, kError);
     return;
   }
-  MinimizeArgs args(ofst1, ofst2, delta, allow_nondet);
+  MinimizeArgs args(ofst1, ofst2, delta, allow_nondet, num_threads);
   Apply<Operation<MinimizeArgs>>("Minimize", ofst1->ArcType(), &args);
 }
 
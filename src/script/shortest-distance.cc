@@ -30,8 +30,8 @@ void ShortestDistance(const FstClass &fst, std::vector<WeightClass> *distance,
 }
 
 void ShortestDistance(const FstClass &fst, std::vector<WeightClass> *distance,
-                      bool reverse, double delta) {
-  ShortestDistanceArgs2 args(fst, distance, reverse, delta);
+                      bool reverse, double delta, int num_threads) {
+  ShortestDistanceArgs2 args(fst, distance, reverse, delta, num_threads);
   Apply<Operation<ShortestDistanceArgs2>>("ShortestDistance", fst.ArcType(),
                                           &args);
 }
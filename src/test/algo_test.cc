@@ -66,8 +66,10 @@ int main(int argc, char **argv) {
   FLAGS_fst_default_cache_gc = std::bernoulli_distribution(.5)(rand);
   FLAGS_fst_default_cache_gc_limit =
       std::uniform_int_distribution<>(0, kCacheGcLimit)(rand);
+  FLAGS_fst_default_cache_gc_clock = std::bernoulli_distribution(.5)(rand);
   VLOG(1) << "default_cache_gc:" << FLAGS_fst_default_cache_gc;
   VLOG(1) << "default_cache_gc_limit:" << FLAGS_fst_default_cache_gc_limit;
+  VLOG(1) << "default_cache_gc_clock:" << FLAGS_fst_default_cache_gc_clock;
 
 #ifdef TEST_TROPICAL
   using TropicalWeightGenerate = WeightGenerate<TropicalWeight>;
@@ -0,0 +1,512 @@
+// Copyright 2005-2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// See www.openfst.org for extensive documentation on this weighted
+// finite-state transducer library.
+//
+// Regression test for finite-state archives.
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <fst/flags.h>
+#include <fst/log.h>
+#include <fst/extensions/far/compile-strings.h>
+#include <fst/extensions/far/convert.h>
+#include <fst/extensions/far/equal.h>
+#include <fst/extensions/far/far.h>
+#include <fst/extensions/far/isomorphic.h>
+#include <fst/extensions/far/parallel.h>
+#include <fst/extensions/far/prune.h>
+#include <fst/extensions/far/sttable.h>
+#include <fst/const-fst.h>
+#include <fst/equal.h>
+#include <fst/float-weight.h>
+#include <fst/prune.h>
+#include <fst/string.h>
+#include <fst/util.h>
+#include <fst/vector-fst.h>
+
+DECLARE_bool(fst_error_fatal);
+DECLARE_string(fst_read_mode);
+DECLARE_string(tmpdir);
+
+namespace fst {
+namespace {
+
+// Returns the key of the i-th test entry.
+std::string Key(int i) {
+  char key[16];
+  std::snprintf(key, sizeof(key), "%04d", i);
+  return key;
+}
+
+// Returns a small FST distinct for each i.
+StdVectorFst MakeFst(int i) {
+  StdVectorFst fst;
+  fst.AddState();
+  fst.AddState();
+  fst.SetStart(0);
+  fst.AddArc(0, StdArc(i % 17 + 1, i % 13 + 1, i * 0.25f, 1));
+  fst.SetFinal(1, i);
+  return fst;
+}
+
+// Returns an FST distinct for each i with paths of weight i % 5, i % 5 + 1
+// and i % 5 + 3.
+StdVectorFst MakePrunableFst(int i) {
+  StdVectorFst fst;
+  fst.AddStates(4);
+  fst.SetStart(0);
+  fst.AddArc(0, StdArc(i % 17 + 1, i % 17 + 1, i % 5, 1));
+  fst.AddArc(0, StdArc(2, 2, i % 5 + 1, 2));
+  fst.AddArc(0, StdArc(3, 3, i % 5 + 3, 3));
+  fst.SetFinal(1, 0);
+  fst.SetFinal(2, 0);
+  fst.SetFinal(3, 0);
+  return fst;
+}
+
+// Returns the keys read as by farprintstrings: from the lower bound of
+// begin_key if not empty, up to and including end_key if not empty.
+std::vector<std::string> ReadKeys(FarReader<StdArc> *reader,
+                                  const std::string &begin_key,
+                                  const std::string &end_key) {
+  if (begin_key.empty()) {
+    reader->Reset();
+  } else {
+    reader->Find(begin_key);
+  }
+  std::vector<std::string> keys;
+  for (; !reader->Done(); reader->Next()) {
+    if (!end_key.empty() && end_key < reader->GetKey()) break;
+    keys.push_back(reader->GetKey());
+  }
+  return keys;
+}
+
+// Writes entries as a version 1 STTable archive, whose index only holds the
+// entry positions.
+void WriteV1STTable(
+    const std::string &source,
+    const std::vector<std::pair<std::string, StdVectorFst>> &entries) {
+  std::ofstream strm(source, std::ios_base::out | std::ios_base::binary);
+  WriteType(strm, kSTTableMagicNumber);
+  WriteType(strm, static_cast<int32>(1));
+  std::vector<int64> positions;
+  for (const auto &[key, fst] : entries) {
+    positions.push_back(strm.tellp());
+    WriteType(strm, key);
+    fst.Write(strm, FstWriteOptions());
+  }
+  for (const auto position : positions) WriteType(strm, position);
+  WriteType(strm, static_cast<int64>(positions.size()));
+  CHECK(strm);
+}
+
+// Returns whether the version 2 index at the start of source reads, after
+// the given 64-bit word of the index region is set to value.
+bool ReadCorruptIndex(const std::string &source, size_t word, int64 value) {
+  std::string data;
+  {
+    std::ifstream strm(source, std::ios_base::in | std::ios_base::binary);
+    std::ostringstream ostrm;
+    ostrm << strm.rdbuf();
+    data = ostrm.str();
+  }
+  std::memcpy(&data[word * sizeof(int64)], &value, sizeof(value));
+  const std::string corrupt = source + ".corrupt";
+  {
+    std::ofstream strm(corrupt, std::ios_base::out | std::ios_base::binary);
+    strm << data;
+  }
+  std::ifstream strm(corrupt, std::ios_base::in | std::ios_base::binary);
+  STTableIndex index;
+  return index.Read(strm, corrupt, kSTTableFileVersion);
+}
+
+}  // namespace
+}  // namespace fst
+
+using fst::ConstFst;
+using fst::Equal;
+using fst::FarCompileStrings;
+using fst::FarConvert;
+using fst::FarEntryType;
+using fst::FarEqual;
+using fst::FarIsomorphic;
+using fst::FarParallelMap;
+using fst::FarPrune;
+using fst::FarReader;
+using fst::FarShardOptions;
+using fst::FarType;
+using fst::FarWriter;
+using fst::Fst;
+using fst::kNoStateId;
+using fst::Key;
+using fst::LogArc;
+using fst::LogWeight;
+using fst::MakeFst;
+using fst::MakePrunableFst;
+using fst::PruneOptions;
+using fst::ReadCorruptIndex;
+using fst::ReadKeys;
+using fst::STTableIndex;
+using fst::StdArc;
+using fst::StdVectorFst;
+using fst::TropicalWeight;
+using fst::STTableShardsFarWriter;
+using fst::STTableShardType;
+using fst::TokenType;
+using fst::WriteV1STTable;
+
+int main(int argc, char **argv) {
+  SET_FLAGS(argv[0], &argc, &argv, true);
+
+  // Test entries with sorted keys, one of them repeated.
+  std::vector<std::pair<std::string, StdVectorFst>> entries;
+  for (int i = 0; i < 300; ++i) {
+    entries.emplace_back(Key(i), MakeFst(i));
+    if (i == 150) entries.emplace_back(Key(i), MakeFst(1000));
+  }
+  const std::string single = FLAGS_tmpdir + "/far_test.far";
+  {
+    std::unique_ptr<FarWriter<StdArc>> writer(
+        FarWriter<StdArc>::Create(single, FarType::STTABLE));
+    CHECK(writer);
+    for (const auto &[key, fst] : entries) writer->Add(key, fst);
+    CHECK(!writer->Error());
+  }
+
+  LOG(INFO) << "Testing sharded STTable archives.";
+  {
+    std::unique_ptr<FarReader<StdArc>> reader1(
+        FarReader<StdArc>::Open(single));
+    CHECK(reader1);
+    for (const auto type : {STTableShardType::HASH, STTableShardType::RANGE}) {
+      const std::string source =
+          FLAGS_tmpdir + (type == STTableShardType::HASH ? "/far_test_hash.far"
+                                                         : "/far_test_rng.far");
+      {
+        std::unique_ptr<FarWriter<StdArc>> writer(
+            STTableShardsFarWriter<StdArc>::Create(
+                source, FarShardOptions(type, 3, 2048)));
+        CHECK(writer);
+        for (const auto &[key, fst] : entries) writer->Add(key, fst);
+        CHECK(!writer->Error());
+      }
+      std::unique_ptr<FarReader<StdArc>> reader2(
+          FarReader<StdArc>::Open(source));
+      CHECK(reader2);
+      CHECK(reader2->Type() == FarType::STTABLE);
+      size_t i = 0;
+      for (; !reader2->Done(); reader2->Next(), ++i) {
+        CHECK_LT(i, entries.size());
+        CHECK_EQ(reader2->GetKey(), entries[i].first);
+        CHECK(Equal(*reader2->GetFst(), entries[i].second));
+      }
+      CHECK_EQ(i, entries.size());
+      // Hits and misses, before the first, between and after the last keys.
+      for (const std::string begin_key :
+           {"0000", "0001", "0150", "0150x", "0151", "0298", "0299", "0299x",
+            "/", "zzzz"}) {
+        bool found = false;
+        for (const auto &entry : entries) found |= entry.first == begin_key;
+        CHECK_EQ(reader1->Find(begin_key), found);
+        CHECK_EQ(reader2->Find(begin_key), found);
+        for (const std::string end_key : {"", "0150", "0200"}) {
+          std::vector<std::string> keys;
+          for (const auto &entry : entries) {
+            if (entry.first < begin_key) continue;
+            if (!end_key.empty() && end_key < entry.first) break;
+            keys.push_back(entry.first);
+          }
+          CHECK(ReadKeys(reader1.get(), begin_key, end_key) == keys);
+          CHECK(ReadKeys(reader2.get(), begin_key, end_key) == keys);
+        }
+      }
+      // Both entries with a repeated key follow a hit.
+      CHECK(reader2->Find(Key(150)));
+      CHECK(Equal(*reader2->GetFst(), MakeFst(150)));
+      reader2->Next();
+      CHECK_EQ(reader2->GetKey(), Key(150));
+      CHECK(Equal(*reader2->GetFst(), MakeFst(1000)));
+      reader2->Next();
+      CHECK_EQ(reader2->GetKey(), Key(151));
+      CHECK(!reader2->Error());
+      CHECK(FarEqual<StdArc>(source, single, fst::kDelta, "0100", "0200"));
+      // Converting without sharding merges the shards back.
+      const std::string merged = FLAGS_tmpdir + "/far_test_merged.far";
+      FarConvert<StdArc>(source, merged, "", FarType::STTABLE);
+      CHECK(FarEqual<StdArc>(merged, single));
+    }
+  }
+
+  LOG(INFO) << "Testing STTable key index.";
+  {
+    // The hash table holds the first of the entries with a repeated key.
+    const std::vector<std::string> keys = {"a", "b", "b", "d"};
+    std::vector<int64> positions;
+    std::string key_blob;
+    std::vector<int64> key_offsets = {0};
+    for (size_t i = 0; i < keys.size(); ++i) {
+      positions.push_back(i * 100);
+      key_blob += keys[i];
+      key_offsets.push_back(key_blob.size());
+    }
+    const std::string source = FLAGS_tmpdir + "/far_test.index";
+    {
+      std::ofstream strm(source, std::ios_base::out | std::ios_base::binary);
+      CHECK(STTableIndex::Write(strm, positions, key_blob, key_offsets));
+    }
+    std::ifstream strm(source, std::ios_base::in | std::ios_base::binary);
+    STTableIndex index;
+    CHECK(index.Read(strm, source, fst::kSTTableFileVersion));
+    CHECK(index.HasKeys());
+    CHECK_EQ(index.Size(), keys.size());
+    for (size_t i = 0; i < keys.size(); ++i) {
+      CHECK_EQ(index.Key(i), keys[i]);
+      CHECK_EQ(index.Position(i), positions[i]);
+    }
+    // Hits.
+    CHECK_EQ(index.LowerBound("a"), 0);
+    CHECK_EQ(index.LowerBound("b"), 1);
+    CHECK_EQ(index.LowerBound("d"), 3);
+    // Misses fall back to the binary search.
+    CHECK_EQ(index.LowerBound(""), 0);
+    CHECK_EQ(index.LowerBound("ab"), 1);
+    CHECK_EQ(index.LowerBound("c"), 3);
+    CHECK_EQ(index.LowerBound("e"), 4);
+    // The region holds 4 positions, 5 key offsets, then 8 buckets.
+    CHECK(ReadCorruptIndex(source, 0, 0));
+    CHECK(!ReadCorruptIndex(source, 4, -1));    // First offset not 0.
+    CHECK(!ReadCorruptIndex(source, 5, 3));     // Offsets decreasing.
+    CHECK(!ReadCorruptIndex(source, 8, 1000));  // Offset past the keys.
+    CHECK(!ReadCorruptIndex(source, 9, 5));     // Bucket past the entries.
+  }
+
+  LOG(INFO) << "Testing version 1 STTable archives.";
+  {
+    const std::string source = FLAGS_tmpdir + "/far_test_v1.far";
+    WriteV1STTable(source, entries);
+    std::unique_ptr<FarReader<StdArc>> reader1(FarReader<StdArc>::Open(single));
+    std::unique_ptr<FarReader<StdArc>> reader2(FarReader<StdArc>::Open(source));
+    CHECK(reader1);
+    CHECK(reader2);
+    size_t i = 0;
+    for (; !reader2->Done(); reader2->Next(), ++i) {
+      CHECK_LT(i, entries.size());
+      CHECK_EQ(reader2->GetKey(), entries[i].first);
+      CHECK(Equal(*reader2->GetFst(), entries[i].second));
+    }
+    CHECK_EQ(i, entries.size());
+    for (const std::string key :
+         {"0000", "0150", "0150x", "0299", "/", "zzzz"}) {
+      CHECK_EQ(reader2->Find(key), reader1->Find(key));
+      CHECK_EQ(reader2->GetKey(), reader1->GetKey());
+    }
+    CHECK(reader2->Find(Key(150)));
+    CHECK(Equal(*reader2->GetFst(), MakeFst(150)));
+    reader2->Next();
+    CHECK_EQ(reader2->GetKey(), Key(150));
+    CHECK(Equal(*reader2->GetFst(), MakeFst(1000)));
+    CHECK(!reader2->Error());
+    CHECK(FarEqual<StdArc>(source, single));
+  }
+
+  LOG(INFO) << "Testing STTable archives read in map mode.";
+  {
+    const std::string source = FLAGS_tmpdir + "/far_test_const.far";
+    {
+      std::unique_ptr<FarWriter<StdArc>> writer(
+          FarWriter<StdArc>::Create(source, FarType::STTABLE));
+      CHECK(writer);
+      for (const auto &[key, fst] : entries) {
+        writer->Add(key, ConstFst<StdArc>(fst));
+      }
+      CHECK(!writer->Error());
+    }
+    FLAGS_fst_read_mode = "map";
+    std::vector<std::unique_ptr<Fst<StdArc>>> fsts;
+    {
+      std::unique_ptr<FarReader<StdArc>> reader(
+          FarReader<StdArc>::Open(source));
+      CHECK(reader);
+      CHECK(reader->Type() == FarType::STTABLE);
+      for (; !reader->Done(); reader->Next()) {
+        CHECK_EQ(reader->GetFst()->Type(), "const");
+        fsts.emplace_back(reader->GetFst()->Copy());
+      }
+      CHECK(reader->Find(Key(150)));
+      CHECK(Equal(*reader->GetFst(), MakeFst(150)));
+      reader->Next();
+      CHECK(Equal(*reader->GetFst(), MakeFst(1000)));
+      CHECK(!reader->Find("0150x"));
+      CHECK_EQ(reader->GetKey(), Key(151));
+      CHECK(!reader->Error());
+    }
+    FLAGS_fst_read_mode = "read";
+    // The entries outlive the reader and its mapping of the archive.
+    CHECK_EQ(fsts.size(), entries.size());
+    for (size_t i = 0; i < fsts.size(); ++i) {
+      CHECK(Equal(*fsts[i], entries[i].second));
+    }
+  }
+
+  LOG(INFO) << "Testing FarParallelMap.";
+  {
+    for (const int num_threads : {1, 2, 3}) {
+      const int batch_size = fst::kFarParallelBatchSize * num_threads;
+      // Inputs ending within a batch, at its end, or stopped by emit.
+      for (const int size : {0, 5, 2 * batch_size, 3 * batch_size + 7}) {
+        for (const int stop : {-1, 0, batch_size + 3}) {
+          if (stop >= size) continue;
+          int nread = 0;
+          bool done = false;
+          const auto read = [&](int *entry) {
+            CHECK(!done);
+            done = nread == size;
+            if (done) return false;
+            *entry = nread++;
+            return true;
+          };
+          const auto map = [](const int &entry) { return entry * entry; };
+          std::vector<int> emitted;
+          const auto emit = [&](int &entry, int &result) {
+            CHECK_EQ(result, entry * entry);
+            emitted.push_back(entry);
+            return entry != stop;
+          };
+          CHECK_EQ(FarParallelMap<int>(read, map, emit, num_threads),
+                   stop < 0);
+          CHECK_EQ(emitted.size(), stop < 0 ? size : stop + 1);
+          for (size_t i = 0; i < emitted.size(); ++i) {
+            CHECK_EQ(emitted[i], i);
+          }
+          // At most the batch after the stopping one is read ahead.
+          if (stop >= 0) CHECK_LE(nread, (stop / batch_size + 2) * batch_size);
+        }
+      }
+    }
+  }
+
+  LOG(INFO) << "Testing FAR operations with several threads.";
+  {
+    // Enough entries for several batches, and a copy with one entry changed.
+    const int size = 2000;
+    const std::string many = FLAGS_tmpdir + "/far_test_many.far";
+    const std::string changed = FLAGS_tmpdir + "/far_test_changed.far";
+    for (const auto &source : {many, changed}) {
+      std::unique_ptr<FarWriter<StdArc>> writer(
+          FarWriter<StdArc>::Create(source, FarType::STTABLE));
+      CHECK(writer);
+      for (int i = 0; i < size; ++i) {
+        writer->Add(Key(i), MakeFst(source == changed && i == 1500 ? 0 : i));
+      }
+      CHECK(!writer->Error());
+    }
+    const std::string text = FLAGS_tmpdir + "/far_test_strings.txt";
+    {
+      std::ofstream strm(text);
+      for (int i = 0; i < size; ++i) strm << "line " << i * 7919 << "\n";
+    }
+    const std::string compiled1 = FLAGS_tmpdir + "/far_test_strings1.far";
+    FarCompileStrings<StdArc>({text}, compiled1, "vector", FarType::STTABLE, 0,
+                              FarEntryType::LINE, TokenType::BYTE, "", "",
+                              false, false, false, "", "");
+    for (const int num_threads : {2, 3}) {
+      CHECK(FarEqual<StdArc>(many, many, fst::kDelta, "", "", num_threads));
+      CHECK(!FarEqual<StdArc>(many, changed, fst::kDelta, "", "",
+                              num_threads));
+      CHECK(FarIsomorphic<StdArc>(many, many, fst::kDelta, "", "",
+                                  num_threads));
+      CHECK(!FarIsomorphic<StdArc>(many, changed, fst::kDelta, "", "",
+                                   num_threads));
+      const std::string converted = FLAGS_tmpdir + "/far_test_converted.far";
+      FarConvert<StdArc>(many, converted, "const", FarType::STTABLE,
+                         num_threads);
+      std::unique_ptr<FarReader<StdArc>> reader(
+          FarReader<StdArc>::Open(converted));
+      CHECK(reader);
+      int i = 0;
+      for (; !reader->Done(); reader->Next(), ++i) {
+        CHECK_EQ(reader->GetKey(), Key(i));
+        CHECK_EQ(reader->GetFst()->Type(), "const");
+        CHECK(Equal(*reader->GetFst(), MakeFst(i)));
+      }
+      CHECK_EQ(i, size);
+      const std::string compiled = FLAGS_tmpdir + "/far_test_strings.far";
+      FarCompileStrings<StdArc>({text}, compiled, "vector", FarType::STTABLE,
+                                0, FarEntryType::LINE, TokenType::BYTE, "", "",
+                                false, false, false, "", "", num_threads);
+      CHECK(FarEqual<StdArc>(compiled, compiled1));
+    }
+  }
+
+  LOG(INFO) << "Testing FarPrune.";
+  {
+    // Enough entries for several batches with two threads.
+    const int size = 2 * 2 * fst::kFarPruneBatchSize + 37;
+    const std::string unpruned = FLAGS_tmpdir + "/far_test_unpruned.far";
+    {
+      std::unique_ptr<FarWriter<StdArc>> writer(
+          FarWriter<StdArc>::Create(unpruned, FarType::STTABLE));
+      CHECK(writer);
+      for (int i = 0; i < size; ++i) writer->Add(Key(i), MakePrunableFst(i));
+      CHECK(!writer->Error());
+    }
+    const std::string pruned = FLAGS_tmpdir + "/far_test_pruned.far";
+    for (const int nstate : {kNoStateId, 2}) {
+      const PruneOptions<StdArc, fst::AnyArcFilter<StdArc>> opts(
+          TropicalWeight(2), nstate);
+      for (const int num_threads : {1, 2, 3}) {
+        CHECK(FarPrune<StdArc>(unpruned, pruned, TropicalWeight(2), nstate,
+                               fst::kShortestDelta, FarType::STTABLE,
+                               num_threads));
+        std::unique_ptr<FarReader<StdArc>> reader(
+            FarReader<StdArc>::Open(pruned));
+        CHECK(reader);
+        int i = 0;
+        for (; !reader->Done(); reader->Next(), ++i) {
+          CHECK_EQ(reader->GetKey(), Key(i));
+          StdVectorFst expected = MakePrunableFst(i);
+          fst::Prune(&expected, opts);
+          CHECK_EQ(expected.NumStates(), nstate == kNoStateId ? 3 : 2);
+          CHECK(Equal(*reader->GetFst(), expected));
+        }
+        CHECK(!reader->Error());
+        CHECK_EQ(i, size);
+      }
+    }
+    FLAGS_fst_error_fatal = false;
+    // A missing input archive.
+    CHECK(!FarPrune<StdArc>(FLAGS_tmpdir + "/far_test_missing.far", pruned,
+                            TropicalWeight(2), kNoStateId, fst::kShortestDelta,
+                            FarType::STTABLE, 1));
+    // A weight without the path property.
+    CHECK(!FarPrune<LogArc>(unpruned, pruned, LogWeight(2), kNoStateId,
+                            fst::kShortestDelta, FarType::STTABLE, 1));
+    FLAGS_fst_error_fatal = true;
+  }
+
+  std::cout << "PASS" << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,319 @@
+// Copyright 2005-2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the 'License');
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an 'AS IS' BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// See www.openfst.org for extensive documentation on this weighted
+// finite-state transducer library.
+//
+// Benchmarks for core FST operations and FST file I/O.
+//
+// Micro-benchmarks run on random FSTs from RandFst; macro-benchmarks build a
+// synthetic pronunciation lexicon L and bigram grammar G and time the usual
+// det(rmeps(L o G)) pipeline. For each benchmark the best and mean wall time
+// over --repeat runs, the throughput in arcs per second and the peak resident
+// memory are reported.
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <fst/flags.h>
+#include <fst/log.h>
+#include <fst/arcsort.h>
+#include <fst/compact-fst.h>
+#include <fst/compose.h>
+#include <fst/const-fst.h>
+#include <fst/determinize.h>
+#include <fst/minimize.h>
+#include <fst/rmepsilon.h>
+#include <fst/shortest-path.h>
+#include <fst/vector-fst.h>
+#include <fst/test/rand-fst.h>
+
+#ifdef BENCHMARK_NGRAM
+#include <fst/extensions/ngram/ngram-fst.h>
+#endif  // BENCHMARK_NGRAM
+
+// BENCHMARK_NGRAM enables the NGramFst benchmarks; it is controlled by the
+// build rules since NGramFst lives in a separate library.
+
+DEFINE_uint64(seed, 403, "random seed");
+DEFINE_int32(repeat, 3, "number of runs of each benchmark");
+DEFINE_int32(num_states, 20000, "maximum number of states of random FSTs");
+DEFINE_int32(num_labels, 100, "number of labels of random FSTs");
+DEFINE_int32(num_words, 2000, "vocabulary size of the lexicon and grammar");
+DEFINE_int32(num_successors, 10,
+             "number of explicit successors of each grammar history");
+DEFINE_string(benchmark_filter, "",
+              "only run benchmarks whose name contains this string");
+
+namespace fst {
+namespace {
+
+// Number of states of the random FST composed with the --num_states one.
+constexpr int kFilterStates = 10;
+
+// Returns the peak resident set size in kilobytes.
+int64 PeakRssKb() {
+  std::ifstream strm("/proc/self/status");
+  std::string line;
+  while (std::getline(strm, line)) {
+    if (line.compare(0, 6, "VmHWM:") == 0) return std::stoll(line.substr(6));
+  }
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+  return usage.ru_maxrss / 1024;
+#else
+  return usage.ru_maxrss;
+#endif
+}
+
+// Resets the peak resident set size where the OS supports it, so each
+// benchmark reports its own peak rather than the process-wide one.
+void ResetPeakRss() {
+  std::ofstream strm("/proc/self/clear_refs");
+  if (strm) strm << "5";
+}
+
+template <class Arc>
+size_t CountArcs(const Fst<Arc> &fst) {
+  size_t narcs = 0;
+  for (StateIterator<Fst<Arc>> siter(fst); !siter.Done(); siter.Next()) {
+    narcs += fst.NumArcs(siter.Value());
+  }
+  return narcs;
+}
+
+// Times `fn`, which processes `narcs` arcs per run, and prints a result line.
+template <class F>
+void Run(const std::string &name, size_t narcs, F fn) {
+  if (name.find(FLAGS_benchmark_filter) == std::string::npos) return;
+  using Clock = std::chrono::steady_clock;
+  ResetPeakRss();
+  double best = std::numeric_limits<double>::infinity();
+  double total = 0.0;
+  for (int i = 0; i < FLAGS_repeat; ++i) {
+    const auto start = Clock::now();
+    fn();
+    const std::chrono::duration<double> elapsed = Clock::now() - start;
+    best = std::min(best, elapsed.count());
+    total += elapsed.count();
+  }
+  std::cout << std::left << std::setw(28) << name << std::right << std::fixed
+            << std::setprecision(3) << std::setw(12) << best * 1e3
+            << std::setw(12) << total * 1e3 / FLAGS_repeat << std::setw(12)
+            << std::setprecision(2) << narcs / best / 1e6 << std::setw(12)
+            << PeakRssKb() / 1024.0 << std::endl;
+}
+
+// Generates a random FST with at least half of `num_states` states and
+// non-negative tropical weights.
+void RandomFst(int num_states, int num_arcs, bool acyclic, uint64 seed,
+               StdVectorFst *fst) {
+  std::mt19937_64 rand(seed);
+  std::uniform_real_distribution<float> weight_dist(0, 10);
+  auto generate = [&]() { return TropicalWeight(weight_dist(rand)); };
+  do {
+    RandFst<StdArc>(num_states, num_arcs, FLAGS_num_labels, acyclic ? 0.0 : 1.0,
+                    generate, seed++, fst);
+  } while (fst->NumStates() < num_states / 2);
+}
+
+// Builds the closure of a pronunciation lexicon over 40 phones: each word is
+// given a distinct random spelling of 3 to 8 phones followed by a word-end
+// marker, so that L is functional and det(L o G) terminates. The word label
+// is emitted on the first arc.
+void LexiconFst(uint64 seed, StdVectorFst *fst) {
+  static constexpr int kNumPhones = 40;
+  static constexpr int kWordEnd = kNumPhones + 1;
+  std::mt19937_64 rand(seed);
+  std::uniform_int_distribution<int> length_dist(3, 8);
+  std::uniform_int_distribution<int> phone_dist(1, kNumPhones);
+  std::uniform_real_distribution<float> weight_dist(0, 1);
+  std::set<std::vector<int>> spellings;
+  fst->DeleteStates();
+  const auto start = fst->AddState();
+  fst->SetStart(start);
+  fst->SetFinal(start, TropicalWeight::One());
+  for (int word = 1; word <= FLAGS_num_words; ++word) {
+    std::vector<int> spelling;
+    do {
+      spelling.resize(length_dist(rand));
+      for (auto &phone : spelling) phone = phone_dist(rand);
+    } while (!spellings.insert(spelling).second);
+    spelling.push_back(kWordEnd);
+    auto s = start;
+    for (size_t i = 0; i < spelling.size(); ++i) {
+      const auto nextstate =
+          i + 1 == spelling.size() ? start : fst->AddState();
+      fst->AddArc(s, StdArc(spelling[i], i == 0 ? word : 0,
+                            i == 0 ? weight_dist(rand) : 0, nextstate));
+      s = nextstate;
+    }
+  }
+}
+
+// Builds a backoff bigram grammar in the form produced by OpenGrm: state 0 is
+// the unigram state, state 1 the sentence-start history and state w + 1 the
+// history of word w. Each history has a backoff epsilon arc to the unigram
+// state followed by --num_successors arcs to random next words.
+void GrammarFst(uint64 seed, StdVectorFst *fst) {
+  std::mt19937_64 rand(seed);
+  std::uniform_int_distribution<int> word_dist(1, FLAGS_num_words);
+  std::uniform_real_distribution<float> weight_dist(0, 10);
+  fst->DeleteStates();
+  fst->AddStates(FLAGS_num_words + 2);
+  fst->SetStart(1);
+  fst->SetFinal(0, weight_dist(rand));
+  for (int word = 1; word <= FLAGS_num_words; ++word) {
+    fst->AddArc(0, StdArc(word, word, weight_dist(rand), word + 1));
+  }
+  for (int history = 1; history <= FLAGS_num_words + 1; ++history) {
+    fst->AddArc(history, StdArc(0, 0, weight_dist(rand), 0));
+    std::set<int> successors;
+    while (successors.size() <
+           std::min<size_t>(FLAGS_num_successors, FLAGS_num_words)) {
+      successors.insert(word_dist(rand));
+    }
+    for (const auto word : successors) {
+      fst->AddArc(history, StdArc(word, word, weight_dist(rand), word + 1));
+    }
+    if (history > 1) fst->SetFinal(history, weight_dist(rand));
+  }
+}
+
+// Benchmarks conversion from `fst`, traversal, writing, reading and mapping
+// of FST type F.
+template <class F>
+void BenchmarkFstType(const std::string &type, const Fst<StdArc> &fst) {
+  const size_t narcs = CountArcs(fst);
+  std::unique_ptr<F> converted;
+  Run("convert/" + type, narcs, [&]() { converted.reset(new F(fst)); });
+  Run("traverse/" + type, narcs, [&]() {
+    size_t count = 0;
+    for (StateIterator<F> siter(*converted); !siter.Done(); siter.Next()) {
+      for (ArcIterator<F> aiter(*converted, siter.Value()); !aiter.Done();
+           aiter.Next()) {
+        count += aiter.Value().nextstate;
+      }
+    }
+    CHECK(count > 0);
+  });
+  const std::string source = FLAGS_tmpdir + "/fst_benchmark." + type;
+  Run("write/" + type, narcs, [&]() {
+    std::ofstream strm(source, std::ios_base::out | std::ios_base::binary);
+    FstWriteOptions opts(source);
+    opts.align = true;
+    CHECK(converted->Write(strm, opts));
+  });
+  for (const auto mode : {FstReadOptions::READ, FstReadOptions::MAP}) {
+    Run((mode == FstReadOptions::MAP ? "mmap/" : "read/") + type, narcs,
+        [&]() {
+          std::ifstream strm(source, std::ios_base::in | std::ios_base::binary);
+          FstReadOptions opts(source);
+          opts.mode = mode;
+          std::unique_ptr<F> read(F::Read(strm, opts));
+          CHECK(read);
+        });
+  }
+  std::remove(source.c_str());
+}
+
+void BenchmarkAlgorithms() {
+  StdVectorFst fst1;
+  StdVectorFst fst2;
+  StdVectorFst filter;
+  RandomFst(FLAGS_num_states, 4 * FLAGS_num_states, false, FLAGS_seed, &fst1);
+  RandomFst(FLAGS_num_states, 4 * FLAGS_num_states, true, FLAGS_seed + 1,
+            &fst2);
+  // A small, dense transducer, so that composition with it neither dies out
+  // nor blows up.
+  RandomFst(kFilterStates, 2 * kFilterStates * FLAGS_num_labels, false,
+            FLAGS_seed + 2, &filter);
+  const size_t narcs1 = CountArcs(fst1);
+  const size_t narcs2 = CountArcs(fst2);
+  Run("arcsort/random", narcs1, [&]() {
+    StdVectorFst sorted(fst1);
+    ArcSort(&sorted, StdILabelCompare());
+  });
+  Run("shortestpath/random", narcs1, [&]() {
+    StdVectorFst path;
+    ShortestPath(fst1, &path);
+  });
+  Run("rmepsilon/random", narcs2, [&]() {
+    StdVectorFst result(fst2);
+    RmEpsilon(&result);
+  });
+  ArcSort(&fst1, StdOLabelCompare());
+  ArcSort(&filter, StdILabelCompare());
+  Run("compose/random", narcs1 + CountArcs(filter), [&]() {
+    StdVectorFst result;
+    Compose(fst1, filter, &result);
+  });
+
+  StdVectorFst lexicon;
+  StdVectorFst grammar;
+  LexiconFst(FLAGS_seed, &lexicon);
+  GrammarFst(FLAGS_seed, &grammar);
+  ArcSort(&lexicon, StdOLabelCompare());
+  StdVectorFst lg;
+  Run("compose/lexicon-grammar", CountArcs(lexicon) + CountArcs(grammar),
+      [&]() { Compose(lexicon, grammar, &lg); });
+  StdVectorFst rmeps_lg;
+  Run("rmepsilon/lexicon-grammar", CountArcs(lg), [&]() {
+    rmeps_lg = lg;
+    RmEpsilon(&rmeps_lg);
+  });
+  StdVectorFst det_lg;
+  Run("determinize/lexicon-grammar", CountArcs(rmeps_lg),
+      [&]() { Determinize(rmeps_lg, &det_lg); });
+  Run("minimize/lexicon-grammar", CountArcs(det_lg), [&]() {
+    StdVectorFst min_lg(det_lg);
+    Minimize(&min_lg);
+  });
+
+  BenchmarkFstType<StdVectorFst>("vector", grammar);
+  BenchmarkFstType<StdConstFst>("const", grammar);
+  BenchmarkFstType<StdCompactAcceptorFst>("compact_acceptor", grammar);
+#ifdef BENCHMARK_NGRAM
+  BenchmarkFstType<NGramFst<StdArc>>("ngram", grammar);
+#endif  // BENCHMARK_NGRAM
+}
+
+}  // namespace
+}  // namespace fst
+
+int main(int argc, char **argv) {
+  std::set_new_handler(FailedNewHandler);
+  SET_FLAGS(argv[0], &argc, &argv, true);
+  if (FLAGS_repeat < 1) FLAGS_repeat = 1;
+
+  std::cout << std::left << std::setw(28) << "benchmark" << std::right
+            << std::setw(12) << "best ms" << std::setw(12) << "mean ms"
+            << std::setw(12) << "Marcs/s" << std::setw(12) << "peak MB"
+            << std::endl;
+  fst::BenchmarkAlgorithms();
+  return 0;
+}
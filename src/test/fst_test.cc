@@ -19,13 +19,26 @@
 
 #include <fst/test/fst_test.h>
 
+#include <iomanip>
+#include <memory>
+#include <sstream>
+#include <thread>
+#include <vector>
+
 #include <fst/flags.h>
 #include <fst/types.h>
 #include <fst/log.h>
+#include <fst/arc-map.h>
 #include <fst/compact-fst.h>
 #include <fst/const-fst.h>
 #include <fst/edit-fst.h>
+#include <fst/equal.h>
+#include <fst/lock.h>
+#include <fst/mapped-file.h>
 #include <fst/matcher-fst.h>
+#include <fst/script/compile-impl.h>
+#include <fst/script/print-impl.h>
+#include <fst/symbol-table.h>
 #include <fst/test/compactors.h>
 
 namespace fst {
@@ -71,20 +84,169 @@ static fst::FstRegisterer<
     CompactFst<CustomArc, TrivialCompactor<CustomArc>>>
     CompactFst_CustomArc_CustomCompactor_registerer;
 
+// A string buffer that cannot seek, like that of a pipe.
+class UnseekableStringBuf : public std::stringbuf {
+ protected:
+  pos_type seekoff(off_type off, std::ios_base::seekdir dir,
+                   std::ios_base::openmode which) override {
+    return pos_type(off_type(-1));
+  }
+
+  pos_type seekpos(pos_type pos, std::ios_base::openmode which) override {
+    return pos_type(off_type(-1));
+  }
+};
+
+// Caches states in a GC cache store with CLOCK replacement, first large and
+// then small ones so that the number of cached states grows while the hand is
+// mid-sweep, and checks that the store stays within its limit and that the
+// states it keeps are intact.
+template <class Store>
+void TestClockGC() {
+  using State = typename Store::State;
+  using StateId = typename State::Arc::StateId;
+  constexpr size_t kLimit = 16384;
+  constexpr StateId kNumStates = 3000;
+  GCCacheStore<Store> store(CacheOptions(true, kLimit, true));
+  for (StateId s = 0; s < kNumStates; ++s) {
+    auto *state = store.GetMutableState(s);
+    CHECK_EQ(state->NumArcs(), 0);
+    const int narcs = s < kNumStates / 4 ? 32 : 1;
+    for (int i = 0; i < narcs; ++i) state->PushArc(StdArc(i + 1, i + 1, 0, s));
+    store.SetArcs(state);
+    CHECK_LE(store.CacheSize(), store.CacheLimit());
+    // Revisits an older state if it is still cached.
+    if (auto *old = store.GetState(s / 2)) {
+      CHECK_EQ(old->GetArc(0).nextstate, s / 2);
+      store.GetMutableState(s / 2)->SetFlags(kCacheRecent, kCacheRecent);
+    }
+  }
+  CacheStats stats;
+  store.GetCacheStats(&stats);
+  CHECK_EQ(stats.cache_limit, kLimit);
+  CHECK_GT(stats.ngc, 0);
+  CHECK_GT(stats.nreclaimed, 0);
+  CHECK_EQ(stats.nstates, store.CountStates());
+  StateId ncached = 0;
+  for (StateId s = 0; s < kNumStates; ++s) {
+    const auto *state = store.GetState(s);
+    if (!state) continue;
+    ++ncached;
+    CHECK_EQ(state->NumArcs(), s < kNumStates / 4 ? 32 : 1);
+    for (size_t i = 0; i < state->NumArcs(); ++i) {
+      CHECK_EQ(state->GetArc(i).nextstate, s);
+    }
+  }
+  CHECK_GT(ncached, 0);
+  CHECK_LE(ncached, store.CountStates());
+}
+
+// Reads the final weight of every state of a delayed FST once and its arcs
+// twice, checking the cache statistics after each pass. With GC, the cache is
+// much smaller than the FST, so that states are reclaimed and expanded again.
+void TestCacheStats(bool gc, bool gc_clock) {
+  using Mapper = IdentityArcMapper<StdArc>;
+  constexpr StdArc::StateId kNumStates = 3000;
+  constexpr size_t kNumArcs = 8;
+  constexpr size_t kLimit = 16384;
+  StdVectorFst ifst;
+  ifst.AddStates(kNumStates);
+  ifst.SetStart(0);
+  for (StdArc::StateId s = 0; s < kNumStates; ++s) {
+    for (size_t i = 0; i < kNumArcs; ++i) {
+      ifst.AddArc(s, StdArc(i + 1, i + 1, i, (s + i + 1) % kNumStates));
+    }
+    ifst.SetFinal(s, s % 3);
+  }
+  const ArcMapFstOptions opts(
+      CacheOptions(gc, gc ? kLimit : 1 << 30, gc_clock));
+  const ArcMapFst<StdArc, StdArc, Mapper> fst(ifst, Mapper(), opts);
+  CacheStats stats = fst.GetCacheStats();
+  CHECK_EQ(stats.hits, 0);
+  CHECK_EQ(stats.misses, 0);
+  CHECK_EQ(stats.nexpanded, 0);
+  for (StdArc::StateId s = 0; s < kNumStates; ++s) fst.Final(s);
+  stats = fst.GetCacheStats();
+  CHECK_EQ(stats.misses, kNumStates);
+  CHECK_EQ(stats.nexpanded, 0);
+  for (int pass = 0; pass < 2; ++pass) {
+    const auto before = fst.GetCacheStats();
+    for (StdArc::StateId s = 0; s < kNumStates; ++s) {
+      CHECK_EQ(fst.NumArcs(s), kNumArcs);
+    }
+    stats = fst.GetCacheStats();
+    // Each arc lookup miss expands the state once, which also misses if the
+    // final weight was reclaimed with the state.
+    const auto nexpanded = stats.nexpanded - before.nexpanded;
+    CHECK_GE(stats.misses - before.misses, nexpanded);
+    CHECK_LE(stats.misses - before.misses, 2 * nexpanded);
+    if (!gc) {
+      // Expanding a state looks up its cached final weight twice, to check for
+      // a superfinal arc; later arc lookups are hits.
+      CHECK_EQ(stats.nexpanded, kNumStates);
+      CHECK_EQ(stats.hits, (pass == 0 ? 2 : 3) * kNumStates);
+      CHECK_EQ(stats.misses, 2 * kNumStates);
+      CHECK_EQ(stats.nstates, kNumStates);
+      CHECK_EQ(stats.cache_size, 0);
+      CHECK_EQ(stats.ngc, 0);
+      CHECK_EQ(stats.nreclaimed, 0);
+      CHECK_EQ(stats.bytes_reclaimed, 0);
+    } else {
+      CHECK_GT(stats.nexpanded, pass == 0 ? 0 : kNumStates);
+      CHECK_GT(stats.ngc, before.ngc);
+      CHECK_GT(stats.nreclaimed, before.nreclaimed);
+      CHECK_GT(stats.bytes_reclaimed, before.bytes_reclaimed);
+      CHECK_LT(stats.nstates, kNumStates);
+      CHECK_GT(stats.cache_size, 0);
+      CHECK_LE(stats.cache_size, stats.cache_limit);
+      CHECK_EQ(stats.cache_limit, kLimit);
+    }
+  }
+}
+
 }  // namespace
 }  // namespace fst
 
+using fst::ArenaVectorFst;
+using fst::CacheOptions;
+using fst::CacheState;
 using fst::CompactArcFst;
 using fst::CompactFst;
+using fst::ConcurrentCacheState;
+using fst::ConcurrentCacheStore;
 using fst::ConstFst;
 using fst::CustomArc;
 using fst::EditFst;
+using fst::EncodeMapper;
+using fst::ExpandedFst;
+using fst::MutexLock;
+using fst::PackedSymbolTable;
+using fst::Equal;
+using fst::FstCompiler;
+using fst::FstPrinter;
+using fst::FstReadOptions;
 using fst::FstTester;
+using fst::FirstCacheStore;
+using fst::FstWriteOptions;
+using fst::HashCacheStore;
+using fst::kCacheArcs;
+using fst::kCacheFinal;
+using fst::kError;
+using fst::ReadFrozenFst;
 using fst::StdArc;
 using fst::StdArcLookAheadFst;
+using fst::StdVectorFst;
+using fst::SymbolTable;
+using fst::SymbolTableInterner;
+using fst::SymbolTableReadOptions;
+using fst::TestCacheStats;
+using fst::TestClockGC;
 using fst::TrivialArcCompactor;
 using fst::TrivialCompactor;
+using fst::UnseekableStringBuf;
+using fst::VectorCacheStore;
 using fst::VectorFst;
+using fst::WriteFrozenFst;
 
 int main(int argc, char **argv) {
   FLAGS_fst_verify_properties = true;
@@ -119,6 +281,18 @@ int main(int argc, char **argv) {
     }
   }
 
+  LOG(INFO) << "Testing ArenaVectorFst<StdArc>.";
+  {
+    for (const size_t num_states : {0, 1, 2, 3, 128}) {
+      FstTester<ArenaVectorFst<StdArc>> std_arena_tester(num_states);
+      std_arena_tester.TestBase();
+      std_arena_tester.TestExpanded();
+      std_arena_tester.TestAssign();
+      std_arena_tester.TestCopy();
+      std_arena_tester.TestMutable();
+    }
+  }
+
   LOG(INFO) << "Testing ConstFst<StdArc>.";
   {
     FstTester<ConstFst<StdArc>> std_const_tester;
@@ -219,6 +393,18 @@ int main(int argc, char **argv) {
     // TODO(jrosenstock): Add tests on default-constructed Fst.
   }
 
+  // CompactFst<StdArc, TrivialCompactor<StdArc>> with a concurrent cache store.
+  {
+    for (const size_t num_states : {0, 1, 2, 3, 128}) {
+      FstTester<CompactFst<StdArc, TrivialCompactor<StdArc>,
+                           ConcurrentCacheStore<ConcurrentCacheState<StdArc>>>>
+          std_compact_tester(num_states);
+      std_compact_tester.TestBase();
+      std_compact_tester.TestExpanded();
+      std_compact_tester.TestCopy();
+    }
+  }
+
   // ConstFst<StdArc, uint16> tests
   {
     FstTester<ConstFst<StdArc, uint16>> std_const_tester;
@@ -256,6 +442,355 @@ int main(int argc, char **argv) {
     std_edit_tester.TestMutable();
   }
 
+  LOG(INFO) << "Testing frozen EditFst<StdArc>.";
+  {
+    VectorFst<StdArc> vfst;
+    for (int s = 0; s < 16; ++s) vfst.AddState();
+    vfst.SetStart(0);
+    for (int s = 0; s < 16; ++s) {
+      vfst.AddArc(s, StdArc(s + 1, s + 1, s, (s + 1) % 16));
+      vfst.AddArc(s, StdArc(0, s, 0.5, (s + 7) % 16));
+      if (s % 3 == 0) vfst.SetFinal(s, s);
+    }
+    const std::string filename = FLAGS_tmpdir + "/frozen.fst";
+    CHECK(WriteFrozenFst(vfst, filename));
+    std::unique_ptr<EditFst<StdArc>> ffst(ReadFrozenFst<StdArc>(filename));
+    CHECK(ffst);
+    CHECK(Equal(vfst, *ffst));
+    // Edits are local to the copy and leave the mapped file untouched.
+    ffst->AddArc(3, StdArc(5, 5, 1, 4));
+    ffst->SetFinal(1, 2);
+    CHECK(!Equal(vfst, *ffst));
+    std::unique_ptr<EditFst<StdArc>> gfst(ReadFrozenFst<StdArc>(filename));
+    CHECK(gfst);
+    CHECK(Equal(vfst, *gfst));
+  }
+
+  LOG(INFO) << "Testing GCCacheStore with CLOCK replacement.";
+  {
+    TestClockGC<VectorCacheStore<CacheState<StdArc>>>();
+    TestClockGC<HashCacheStore<CacheState<StdArc>>>();
+    TestClockGC<FirstCacheStore<VectorCacheStore<CacheState<StdArc>>>>();
+    TestClockGC<FirstCacheStore<HashCacheStore<CacheState<StdArc>>>>();
+  }
+
+  LOG(INFO) << "Testing cache statistics.";
+  {
+    TestCacheStats(/*gc=*/false, /*gc_clock=*/false);
+    TestCacheStats(/*gc=*/true, /*gc_clock=*/false);
+    TestCacheStats(/*gc=*/true, /*gc_clock=*/true);
+  }
+
+  LOG(INFO) << "Testing ConcurrentCacheStore with several threads.";
+  {
+    // Each thread builds the states it finds missing under their stripe lock,
+    // while reading states that other threads may be building.
+    using State = ConcurrentCacheState<StdArc>;
+    ConcurrentCacheStore<State> store((CacheOptions()));
+    constexpr int kNumStates = 5000;  // Spans several segments.
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+      threads.emplace_back([&store, t] {
+        for (int i = 0; i < kNumStates; ++i) {
+          const int s = (i * 7 + t * 1231) % kNumStates;
+          auto *state = store.GetMutableState(s);
+          {
+            MutexLock lock(store.StateMutex(s));
+            if (!(state->Flags() & kCacheArcs)) {
+              for (int a = 0; a < s % 5; ++a) {
+                state->PushArc(StdArc(a, a, s, a));
+              }
+              store.SetArcs(state);
+              state->SetFinal(s);
+              state->SetFlags(kCacheArcs | kCacheFinal,
+                              kCacheArcs | kCacheFinal);
+            }
+          }
+          const int o = s * 13 % kNumStates;
+          const auto *other = store.GetState(o);
+          if (other && (other->Flags() & kCacheArcs)) {
+            CHECK_EQ(other->NumArcs(), o % 5);
+            CHECK_EQ(other->Final(), o);
+          }
+        }
+      });
+    }
+    for (auto &thread : threads) thread.join();
+    CHECK_EQ(store.CountStates(), kNumStates);
+    for (int s = 0; s < kNumStates; ++s) {
+      const auto *state = store.GetState(s);
+      CHECK(state);
+      CHECK_EQ(state->NumArcs(), s % 5);
+      CHECK_EQ(state->NumInputEpsilons(), s % 5 > 0 ? 1 : 0);
+      CHECK_EQ(state->Final(), s);
+    }
+  }
+
+  LOG(INFO) << "Testing PackedSymbolTable.";
+  {
+    SymbolTable syms("words");
+    for (int i = 0; i < 100; ++i) syms.AddSymbol("w" + std::to_string(i));
+    syms.AddSymbol("sparse", 1000);
+    syms.AddSymbol("negative", -5);
+    const PackedSymbolTable psyms(syms);
+    CHECK_EQ(psyms.NumSymbols(), syms.NumSymbols());
+    CHECK_EQ(psyms.AvailableKey(), syms.AvailableKey());
+    CHECK_EQ(psyms.CheckSum(), syms.CheckSum());
+    CHECK_EQ(psyms.LabeledCheckSum(), syms.LabeledCheckSum());
+    const std::string filename = FLAGS_tmpdir + "/packed.syms";
+    CHECK(psyms.Write(filename));
+    for (const bool memory_map : {false, true}) {
+      std::ifstream strm(filename, std::ios_base::in | std::ios_base::binary);
+      SymbolTableReadOptions opts;
+      opts.source = filename;
+      opts.memory_map = memory_map;
+      std::unique_ptr<SymbolTable> rsyms(SymbolTable::Read(strm, opts));
+      CHECK(rsyms);
+      CHECK_EQ(rsyms->Name(), "words");
+      CHECK_EQ(rsyms->LabeledCheckSum(), syms.LabeledCheckSum());
+      for (const auto &item : syms) {
+        CHECK_EQ(rsyms->Find(item.Label()), item.Symbol());
+        CHECK_EQ(rsyms->Find(item.Symbol()), item.Label());
+      }
+      CHECK(rsyms->Find(100).empty());
+      CHECK_EQ(rsyms->Find("missing"), fst::kNoSymbol);
+      // Mutations copy the packed table, leaving shared copies unchanged.
+      std::unique_ptr<SymbolTable> msyms(rsyms->Copy());
+      msyms->SetName("mutated");
+      CHECK_EQ(msyms->LabeledCheckSum(), syms.LabeledCheckSum());
+      CHECK_EQ(msyms->AddSymbol("new"), syms.AvailableKey());
+      msyms->RemoveSymbol(0);
+      CHECK_EQ(msyms->Name(), "mutated");
+      CHECK_EQ(msyms->Find("new"), syms.AvailableKey());
+      CHECK_EQ(msyms->Find(1000), "sparse");
+      CHECK_EQ(msyms->Find("negative"), -5);
+      CHECK(msyms->Find(0).empty());
+      CHECK_EQ(rsyms->Name(), "words");
+      CHECK_EQ(rsyms->Find(0), "w0");
+      CHECK_EQ(rsyms->Find("new"), fst::kNoSymbol);
+      CHECK_EQ(rsyms->NumSymbols(), syms.NumSymbols());
+    }
+  }
+
+  LOG(INFO) << "Testing SymbolTableInterner.";
+  {
+    SymbolTable syms("words");
+    for (int i = 0; i < 10; ++i) syms.AddSymbol("w" + std::to_string(i));
+    const PackedSymbolTable psyms(syms);
+    VectorFst<StdArc> vfst;
+    vfst.AddState();
+    vfst.SetStart(0);
+    vfst.SetFinal(0, 0);
+    vfst.SetInputSymbols(&syms);
+    vfst.SetOutputSymbols(&psyms);
+    const std::string filename = FLAGS_tmpdir + "/interned.fst";
+    CHECK(vfst.Write(filename));
+    SymbolTableInterner interner;
+    FstReadOptions opts(filename);
+    opts.symbols_interner = &interner;
+    std::unique_ptr<VectorFst<StdArc>> fst1, fst2;
+    {
+      std::ifstream strm(filename, std::ios_base::in | std::ios_base::binary);
+      fst1.reset(VectorFst<StdArc>::Read(strm, opts));
+    }
+    {
+      std::ifstream strm(filename, std::ios_base::in | std::ios_base::binary);
+      fst2.reset(VectorFst<StdArc>::Read(strm, opts));
+    }
+    CHECK(fst1 && fst2);
+    CHECK(Equal(vfst, *fst2));
+    // The tables are equal, so the packed copy is skipped.
+    CHECK_EQ(interner.Size(), 1);
+    CHECK_EQ(fst2->InputSymbols()->LabeledCheckSum(), syms.LabeledCheckSum());
+    CHECK_EQ(fst2->OutputSymbols()->LabeledCheckSum(), syms.LabeledCheckSum());
+    // Both FSTs point at the same symbol storage.
+    CHECK_EQ(fst1->InputSymbols()->Find(3).data(),
+             fst2->InputSymbols()->Find(3).data());
+    CHECK_EQ(fst1->OutputSymbols()->Find(3).data(),
+             fst2->OutputSymbols()->Find(3).data());
+    // Mutating a shared table copies it first.
+    fst1->MutableInputSymbols()->AddSymbol("extra");
+    CHECK_EQ(fst2->InputSymbols()->NumSymbols(), syms.NumSymbols());
+    // Interned packed tables are also skipped in streams that cannot seek.
+    UnseekableStringBuf buf;
+    std::ostream ostrm(&buf);
+    CHECK(vfst.Write(ostrm, FstWriteOptions("pipe")));
+    CHECK(vfst.Write(ostrm, FstWriteOptions("pipe")));
+    std::istream istrm(&buf);
+    for (int i = 0; i < 2; ++i) {
+      std::unique_ptr<VectorFst<StdArc>> fst(
+          VectorFst<StdArc>::Read(istrm, opts));
+      CHECK(fst);
+      CHECK(Equal(vfst, *fst));
+      CHECK_EQ(fst->OutputSymbols()->Find(3).data(),
+               fst2->OutputSymbols()->Find(3).data());
+    }
+  }
+
+  LOG(INFO) << "Testing FstCompiler.";
+  {
+    // Enough text to be parsed in several chunks, with the arcs of the
+    // states out of order.
+    std::ostringstream text;
+    for (int i = 0; i < 40000; ++i) {
+      const int s = (i * 7919) % 5000;
+      text << s << "\t" << (s + i) % 5000 << "\t" << i % 97 << "\t"
+           << i % 89 << "\t" << (i % 13) * 0.25 << "\n";
+      if (i % 11 == 0) text << s << "\t" << i % 5 << "\n";
+    }
+    text << "7\t3\t5\t5\tInfinity";  // No final newline.
+    const std::string filename = FLAGS_tmpdir + "/compile.txt";
+    {
+      std::ofstream strm(filename);
+      strm << text.str();
+    }
+    std::istringstream strm1(text.str());
+    const FstCompiler<StdArc> compiler1(strm1, "text", nullptr, nullptr,
+                                        nullptr, false, false, false, false);
+    CHECK(!compiler1.Fst().Properties(kError, false));
+    CHECK_EQ(compiler1.Fst().NumStates(), 5000);
+    for (const bool const_output : {false, true}) {
+      std::ifstream strm2(filename);
+      const FstCompiler<StdArc> compiler2(strm2, filename, nullptr, nullptr,
+                                          nullptr, false, false, false, false,
+                                          false, 3, const_output, true);
+      const ExpandedFst<StdArc> &fst2 =
+          const_output ? compiler2.GetArrayFst() : compiler2.Fst();
+      CHECK(Equal(compiler1.Fst(), fst2));
+      CHECK(!fst2.Properties(kError, true));
+    }
+    const std::string const_filename = FLAGS_tmpdir + "/compile.fst";
+    {
+      std::istringstream strm3(text.str());
+      const FstCompiler<StdArc> compiler3(strm3, "text", nullptr, nullptr,
+                                          nullptr, false, false, false, false,
+                                          false, 2, true);
+      CHECK(compiler3.GetArrayFst().Write(const_filename));
+    }
+    std::unique_ptr<ConstFst<StdArc>> cfst(
+        ConstFst<StdArc>::Read(const_filename));
+    CHECK(cfst);
+    CHECK(Equal(compiler1.Fst(), *cfst));
+    // A stream named after an existing file is read, not the file.
+    std::istringstream strm4("0\t1\t1\t1\n1\n");
+    const FstCompiler<StdArc> compiler4(strm4, filename, nullptr, nullptr,
+                                        nullptr, false, false, false, false);
+    CHECK_EQ(compiler4.Fst().NumStates(), 2);
+    CHECK_EQ(compiler4.Fst().NumArcs(0), 1);
+  }
+
+  LOG(INFO) << "Testing aligned EncodeMapper.";
+  {
+    const auto make_arc = [](int i, int nweights) {
+      return StdArc(i % 50, i % 7, i % nweights, 1);
+    };
+    EncodeMapper<StdArc> encoder(fst::kEncodeLabels | fst::kEncodeWeights);
+    for (int i = 0; i < 5000; ++i) encoder(make_arc(i, 11));
+    const std::string filename = FLAGS_tmpdir + "/aligned.enc";
+    {
+      std::ofstream strm(filename, std::ios_base::out | std::ios_base::binary);
+      CHECK(encoder.Write(
+          strm, FstWriteOptions(filename, true, true, true, /*align=*/true)));
+    }
+    std::ifstream strm(filename, std::ios_base::in | std::ios_base::binary);
+    FstReadOptions opts(filename);
+    opts.mode = FstReadOptions::MAP;
+    std::unique_ptr<EncodeMapper<StdArc>> mapped(
+        EncodeMapper<StdArc>::Read(strm, opts));
+    CHECK(mapped);
+    EncodeMapper<StdArc> decoder(*mapped, fst::DECODE);
+    // Existing triples keep their labels, and new ones are appended in the
+    // same order.
+    for (int i = 0; i < 6000; ++i) {
+      const auto arc = make_arc(i, 13);
+      const auto encoded = (*mapped)(arc);
+      CHECK_EQ(encoded.ilabel, encoder(arc).ilabel);
+      const auto decoded = decoder(encoded);
+      CHECK_EQ(decoded.ilabel, arc.ilabel);
+      CHECK_EQ(decoded.olabel, arc.olabel);
+      CHECK_EQ(decoded.weight, arc.weight);
+    }
+  }
+
+  LOG(INFO) << "Testing FstPrinter.";
+  {
+    StdVectorFst fst;
+    for (int s = 0; s < 20000; ++s) fst.AddState();
+    fst.SetStart(17);
+    for (int s = 0; s < 20000; ++s) {
+      fst.AddArc(s, StdArc(s % 7, s % 5, s * 0.1f, (s * 31) % 20000));
+      if (s % 3 == 0) fst.SetFinal(s, s % 9 ? s / 7.0f : StdArc::Weight::One());
+    }
+    fst.SetFinal(5, fst::TropicalWeight::Zero());
+    fst.AddArc(5, StdArc(1, 2, fst::TropicalWeight::Zero(), 6));
+    const std::string sep = "\t";
+    std::ostringstream strm1;
+    strm1.precision(9);
+    FstPrinter<StdArc>(fst, nullptr, nullptr, nullptr, false, false, sep)
+        .Print(strm1, "strm1");
+    const std::string prefix1 = "17\t527\t3\t2\t1.70000005\n0\t0\t0\t0\n0\n";
+    CHECK_EQ(strm1.str().substr(0, prefix1.size()), prefix1);
+    // Formatting is the same on several threads and with a copied FST.
+    for (const int num_threads : {2, 3}) {
+      const ConstFst<StdArc> cfst(fst);
+      std::ostringstream strm2;
+      strm2.precision(9);
+      FstPrinter<StdArc>(cfst, nullptr, nullptr, nullptr, false, false, sep,
+                         "", num_threads)
+          .Print(strm2, "strm2");
+      CHECK_EQ(strm1.str(), strm2.str());
+    }
+    // Streams with other formatting are honored.
+    std::ostringstream strm3;
+    strm3 << std::fixed << std::setprecision(2);
+    FstPrinter<StdArc>(fst, nullptr, nullptr, nullptr, true, true, sep)
+        .Print(strm3, "strm3");
+    const std::string prefix3 =
+        "17\t527\t3\t2\t1.70\n0\t0\t0\t0\t0.00\n0\t0.00\n";
+    CHECK_EQ(strm3.str().substr(0, prefix3.size()), prefix3);
+    CHECK(strm3.str().find("\n3\t0.43\n") != std::string::npos);
+    CHECK(strm1.str().find("\n5\t6\t1\t2\tInfinity\n") != std::string::npos);
+  }
+
+  LOG(INFO) << "Testing MappedFileInputStream.";
+  {
+    StdVectorFst vfst;
+    for (int s = 0; s < 1000; ++s) vfst.AddState();
+    vfst.SetStart(0);
+    for (int s = 0; s < 1000; ++s) {
+      vfst.AddArc(s, StdArc(s % 11, s % 13, s * 0.5f, (s * 7) % 1000));
+      if (s % 5 == 0) vfst.SetFinal(s, s);
+    }
+    const ConstFst<StdArc> fst(vfst);
+    const std::string filename = FLAGS_tmpdir + "/mapped.fst";
+    {
+      std::ofstream strm(filename, std::ios_base::out | std::ios_base::binary);
+      // Unaligned data is read rather than referred to.
+      CHECK(fst.Write(strm, FstWriteOptions(filename)));
+      CHECK(fst.Write(
+          strm, FstWriteOptions(filename, true, true, true, /*align=*/true)));
+    }
+    std::ifstream strm(filename, std::ios_base::in | std::ios_base::binary);
+    strm.seekg(0, std::ios_base::end);
+    const size_t size = strm.tellg();
+    strm.seekg(0);
+    std::shared_ptr<const fst::MappedFile> file(
+        fst::MappedFile::Map(&strm, true, filename, size));
+    CHECK(file);
+    std::unique_ptr<ConstFst<StdArc>> fst1;
+    std::unique_ptr<ConstFst<StdArc>> fst2;
+    {
+      fst::MappedFileInputStream mstrm(file, size);
+      fst1.reset(ConstFst<StdArc>::Read(mstrm, FstReadOptions(filename)));
+      fst2.reset(ConstFst<StdArc>::Read(mstrm, FstReadOptions(filename)));
+      CHECK(mstrm.good());
+      CHECK_EQ(static_cast<size_t>(mstrm.tellg()), size);
+    }
+    file.reset();
+    CHECK(fst1 && Equal(fst, *fst1));
+    CHECK(fst2 && Equal(fst, *fst2));
+  }
+
   std::cout << "PASS" << std::endl;
 
   return 0;
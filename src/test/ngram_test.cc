@@ -0,0 +1,253 @@
+// Copyright 2005-2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// See www.openfst.org for extensive documentation on this weighted
+// finite-state transducer library.
+//
+// Regression test for NGramFst files and their bitmap indices.
+
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <fst/flags.h>
+#include <fst/types.h>
+#include <fst/log.h>
+#include <fst/extensions/ngram/bitmap-index.h>
+#include <fst/extensions/ngram/ngram-fst.h>
+#include <fst/equal.h>
+#include <fst/fst.h>
+#include <fst/vector-fst.h>
+
+DECLARE_bool(fst_error_fatal);
+DECLARE_string(tmpdir);
+
+namespace fst {
+namespace {
+
+// Builds a backoff bigram model: state 0 is the unigram state, state 1 the
+// start history and state w + 1 the history of word w. Each history has a
+// backoff arc to the unigram state and arcs for a few successors.
+void BigramFst(int num_words, StdVectorFst *fst) {
+  fst->DeleteStates();
+  fst->AddStates(num_words + 2);
+  fst->SetStart(1);
+  fst->SetFinal(0, 1.5);
+  for (int word = 1; word <= num_words; ++word) {
+    fst->AddArc(0, StdArc(word, word, word % 7 + 0.5, word + 1));
+  }
+  for (int history = 1; history <= num_words + 1; ++history) {
+    fst->AddArc(history, StdArc(0, 0, history % 3 + 0.25, 0));
+    const std::set<int> successors = {history * 7 % num_words + 1,
+                                      history * 13 % num_words + 1,
+                                      history * 29 % num_words + 1};
+    for (const auto word : successors) {
+      fst->AddArc(history,
+                  StdArc(word, word, (history + word) % 5 + 0.75, word + 1));
+    }
+    if (history > 1) fst->SetFinal(history, history % 4 + 2);
+  }
+}
+
+// Returns the contents of a file.
+std::string ReadFile(const std::string &source) {
+  std::ifstream strm(source, std::ios_base::in | std::ios_base::binary);
+  std::ostringstream ostrm;
+  ostrm << strm.rdbuf();
+  return ostrm.str();
+}
+
+void WriteFile(const std::string &source, const std::string &contents) {
+  std::ofstream strm(source, std::ios_base::out | std::ios_base::binary);
+  strm << contents;
+  CHECK(strm);
+}
+
+// Writes fst in file version 4, with the data but none of its indices.
+void WriteV4(const NGramFst<StdArc> &fst, const std::string &source) {
+  std::ofstream strm(source, std::ios_base::out | std::ios_base::binary);
+  FstHeader hdr;
+  hdr.SetFstType(fst.Type());
+  hdr.SetArcType(StdArc::Type());
+  hdr.SetVersion(4);
+  hdr.SetFlags(0);
+  hdr.SetProperties(fst.Properties(kFstProperties, false));
+  hdr.SetStart(fst.Start());
+  hdr.SetNumStates(fst.NumStates());
+  hdr.Write(strm, source);
+  size_t size = 0;
+  const char *data = fst.GetData(&size);
+  strm.write(data, size);
+  CHECK(strm);
+}
+
+// Reads an NGramFst in the given mode, returning nullptr on error.
+std::unique_ptr<NGramFst<StdArc>> ReadNGram(const std::string &source,
+                                            FstReadOptions::FileReadMode mode) {
+  std::ifstream strm(source, std::ios_base::in | std::ios_base::binary);
+  FstReadOptions opts(source);
+  opts.mode = mode;
+  std::unique_ptr<NGramFst<StdArc>> fst(NGramFst<StdArc>::Read(strm, opts));
+  if (!fst || fst->Properties(kError, false)) return nullptr;
+  return fst;
+}
+
+}  // namespace
+}  // namespace fst
+
+using fst::BigramFst;
+using fst::BitmapIndex;
+using fst::Equal;
+using fst::FstHeader;
+using fst::FstReadOptions;
+using fst::kError;
+using fst::NGramFst;
+using fst::ReadFile;
+using fst::ReadNGram;
+using fst::StdArc;
+using fst::StdVectorFst;
+using fst::WriteFile;
+using fst::WriteV4;
+
+int main(int argc, char **argv) {
+  SET_FLAGS(argv[0], &argc, &argv, true);
+  FLAGS_fst_error_fatal = false;
+
+  LOG(INFO) << "Testing borrowed bitmap indices.";
+  {
+    std::mt19937_64 rand(403);
+    const size_t num_bits = 5000;
+    std::vector<uint64> bits(BitmapIndex::StorageSize(num_bits));
+    for (auto &word : bits) word = rand();
+    bits.back() &= (BitmapIndex::kOne << (num_bits % 64)) - 1;
+    const BitmapIndex built(bits.data(), num_bits,
+                            /*enable_select_0_index=*/true,
+                            /*enable_select_1_index=*/true);
+    std::ostringstream strm;
+    CHECK(built.WriteIndex(strm));
+    const std::string serialized = strm.str();
+    const size_t size = serialized.size();
+    CHECK_EQ(size, built.SerializedIndexBytes());
+    // Copies the index into aligned storage, as a mapped file would be.
+    std::vector<uint64> words(size / sizeof(uint64));
+    std::memcpy(words.data(), serialized.data(), size);
+    const auto *index = reinterpret_cast<const char *>(words.data());
+    BitmapIndex borrowed;
+    CHECK_EQ(borrowed.BorrowIndex(bits.data(), num_bits, index, size), size);
+    const size_t ones = built.GetOnesCount();
+    CHECK_EQ(borrowed.GetOnesCount(), ones);
+    for (size_t i = 0; i <= num_bits; ++i) {
+      CHECK_EQ(borrowed.Rank1(i), built.Rank1(i));
+    }
+    for (size_t i = 0; i < ones; ++i) {
+      CHECK_EQ(borrowed.Select1(i), built.Select1(i));
+    }
+    for (size_t i = 0; i < num_bits - ones; ++i) {
+      CHECK_EQ(borrowed.Select0(i), built.Select0(i));
+    }
+    // Truncated indices.
+    BitmapIndex rejected;
+    CHECK_EQ(rejected.BorrowIndex(bits.data(), num_bits, index, size - 8), 0);
+    CHECK_EQ(rejected.BorrowIndex(bits.data(), num_bits, index, 16), 0);
+    // An index for a bitmap of another size.
+    CHECK_EQ(rejected.BorrowIndex(bits.data(), num_bits - 1024, index, size),
+             0);
+    // The header starts with the sizes of the rank, select 0 and select 1
+    // indices; each select index ends with the number of bits.
+    const std::pair<int, int64> corruptions[] = {
+        {0, 1}, {1, num_bits}, {1, -1}, {2, -1}};
+    for (const auto &[word, delta] : corruptions) {
+      words[word] += delta;
+      CHECK_EQ(rejected.BorrowIndex(bits.data(), num_bits, index, size), 0);
+      CHECK_EQ(borrowed.BorrowIndex(bits.data(), num_bits, index, size), 0);
+      words[word] -= delta;
+    }
+    // Failures leave an index unchanged.
+    CHECK_EQ(borrowed.Bits(), num_bits);
+    CHECK_EQ(borrowed.Rank1(num_bits), ones);
+    CHECK_EQ(borrowed.Select0(num_bits - ones - 1),
+             built.Select0(num_bits - ones - 1));
+  }
+
+  StdVectorFst model;
+  BigramFst(200, &model);
+  const NGramFst<StdArc> ngram(model);
+  CHECK(!ngram.Properties(kError, false));
+
+  LOG(INFO) << "Testing NGramFst file version 5.";
+  {
+    const std::string source = FLAGS_tmpdir + "/ngram_test_v5.fst";
+    CHECK(ngram.Write(source));
+    for (const auto mode : {FstReadOptions::MAP, FstReadOptions::READ}) {
+      const auto fst = ReadNGram(source, mode);
+      CHECK(fst);
+      CHECK(Equal(ngram, *fst));
+    }
+    // Truncated files.
+    const std::string contents = ReadFile(source);
+    const std::string truncated = FLAGS_tmpdir + "/ngram_test_truncated.fst";
+    WriteFile(truncated, contents.substr(0, contents.size() - 8));
+    CHECK(!ReadNGram(truncated, FstReadOptions::READ));
+    WriteFile(truncated, contents.substr(0, contents.size() / 2));
+    CHECK(!ReadNGram(truncated, FstReadOptions::READ));
+    // A file whose index region is too small for the indices. The sizes of
+    // the data and of the indices follow the header.
+    const uint64 data_size = ngram.StorageSize();
+    const auto pos = contents.find(std::string(
+        reinterpret_cast<const char *>(&data_size), sizeof(data_size)));
+    CHECK_NE(pos, std::string::npos);
+    std::string inconsistent = contents;
+    uint64 index_size = 0;
+    std::memcpy(&index_size, &inconsistent[pos + sizeof(data_size)],
+                sizeof(index_size));
+    index_size -= 8;
+    std::memcpy(&inconsistent[pos + sizeof(data_size)], &index_size,
+                sizeof(index_size));
+    WriteFile(truncated, inconsistent);
+    for (const auto mode : {FstReadOptions::MAP, FstReadOptions::READ}) {
+      CHECK(!ReadNGram(truncated, mode));
+    }
+  }
+
+  LOG(INFO) << "Testing NGramFst file version 4.";
+  {
+    const std::string source = FLAGS_tmpdir + "/ngram_test_v4.fst";
+    WriteV4(ngram, source);
+    for (const auto mode : {FstReadOptions::MAP, FstReadOptions::READ}) {
+      const auto fst = ReadNGram(source, mode);
+      CHECK(fst);
+      CHECK(Equal(ngram, *fst));
+    }
+    // Version 4 files are rewritten in version 5.
+    const std::string rewritten = FLAGS_tmpdir + "/ngram_test_v4_v5.fst";
+    CHECK(ReadNGram(source, FstReadOptions::READ)->Write(rewritten));
+    std::ifstream strm(rewritten, std::ios_base::in | std::ios_base::binary);
+    FstHeader hdr;
+    CHECK(hdr.Read(strm, rewritten));
+    CHECK_EQ(hdr.Version(), 5);
+    const auto fst = ReadNGram(rewritten, FstReadOptions::MAP);
+    CHECK(fst);
+    CHECK(Equal(ngram, *fst));
+  }
+
+  std::cout << "PASS" << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,151 @@
+// Copyright 2005-2020 Google LLC
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+//
+// See www.openfst.org for extensive documentation on this weighted
+// finite-state transducer library.
+//
+// Regression test for FST script operations.
+
+#include <utility>
+#include <vector>
+
+#include <fst/flags.h>
+#include <fst/log.h>
+#include <fst/arc.h>
+#include <fst/const-fst.h>
+#include <fst/equal.h>
+#include <fst/lexicographic-weight.h>
+#include <fst/vector-fst.h>
+#include <fst/script/fstscript.h>
+
+DECLARE_bool(fst_error_fatal);
+
+namespace fst {
+namespace {
+
+// Registering all operations must compile for arcs without a floating-point
+// weight, which the array operations do not support.
+using LexicographicTestArc =
+    LexicographicArc<TropicalWeight, TropicalWeight>;
+
+script::AllFstOperationsRegisterer<LexicographicTestArc>
+    register_lexicographic_test_arc;
+
+// Returns an FST with several arcs per state, one of them a self-loop.
+template <class Arc>
+VectorFst<Arc> MakeFst() {
+  using Weight = typename Arc::Weight;
+  VectorFst<Arc> fst;
+  for (int s = 0; s < 4; ++s) fst.AddState();
+  fst.SetStart(1);
+  fst.AddArc(0, Arc(1, 2, Weight(0.5), 1));
+  fst.AddArc(1, Arc(3, 4, Weight(1.5), 2));
+  fst.AddArc(1, Arc(5, 6, Weight(2.5), 1));
+  fst.AddArc(1, Arc(0, 0, Weight::One(), 3));
+  fst.SetFinal(2, Weight(0.25));
+  fst.SetFinal(3, Weight::One());
+  return fst;
+}
+
+// Checks that converting the FST to arrays and back is lossless.
+template <class Arc>
+void TestArrays(const Fst<Arc> &fst, bool shared) {
+  const VectorFst<Arc> vfst(fst);
+  const script::FstClass ifst(fst);
+  script::FstArrays arrays;
+  script::FstToArrays(ifst, &arrays);
+  CHECK_EQ(arrays.start, vfst.Start());
+  CHECK_EQ(arrays.num_states, vfst.NumStates());
+  CHECK_EQ(arrays.num_arcs, CountArcs(vfst));
+  CHECK_EQ(arrays.arc_storage == nullptr, shared);
+  size_t i = 0;
+  for (typename Arc::StateId s = 0; s < vfst.NumStates(); ++s) {
+    CHECK_EQ(arrays.finals.GetReal(s), vfst.Final(s).Value());
+    CHECK_EQ(arrays.offsets.Get<int64>(s), i);
+    for (ArcIterator<VectorFst<Arc>> aiter(vfst, s); !aiter.Done();
+         aiter.Next(), ++i) {
+      const auto &arc = aiter.Value();
+      CHECK_EQ(arrays.ilabels.Get<int32>(i), arc.ilabel);
+      CHECK_EQ(arrays.olabels.Get<int32>(i), arc.olabel);
+      CHECK_EQ(arrays.weights.GetReal(i), arc.weight.Value());
+      CHECK_EQ(arrays.nextstates.Get<int32>(i), arc.nextstate);
+    }
+  }
+  CHECK_EQ(arrays.offsets.Get<int64>(vfst.NumStates()), i);
+  script::VectorFstClass ofst(Arc::Type());
+  CHECK(script::ArraysToFst(arrays, &ofst));
+  CHECK(Equal(*ofst.GetFst<Arc>(), vfst));
+}
+
+// Checks that inconsistent arrays are rejected.
+template <class Arc>
+void TestBadArrays(const Fst<Arc> &fst) {
+  const script::FstClass ifst(fst);
+  script::FstArrays arrays;
+  script::FstToArrays(ifst, &arrays);
+  const auto num_states = static_cast<int64>(arrays.num_states);
+  script::VectorFstClass ofst(Arc::Type());
+  arrays.start = num_states;
+  CHECK(!script::ArraysToFst(arrays, &ofst));
+  arrays.start = 0;
+  // Offsets must span the arcs and not decrease.
+  ++arrays.num_arcs;
+  CHECK(!script::ArraysToFst(arrays, &ofst));
+  --arrays.num_arcs;
+  std::swap(arrays.offset_storage[1], arrays.offset_storage[2]);
+  CHECK(!script::ArraysToFst(arrays, &ofst));
+  std::swap(arrays.offset_storage[1], arrays.offset_storage[2]);
+  // Next states must be states.
+  std::vector<int32> nextstates(arrays.num_arcs, 0);
+  nextstates.back() = num_states;
+  const auto column = arrays.nextstates;
+  arrays.nextstates = script::FstArrayColumn(nextstates.data(), sizeof(int32),
+                                             sizeof(int32));
+  CHECK(!script::ArraysToFst(arrays, &ofst));
+  arrays.nextstates = column;
+  CHECK(script::ArraysToFst(arrays, &ofst));
+}
+
+}  // namespace
+}  // namespace fst
+
+using fst::ConstFst;
+using fst::Log64Arc;
+using fst::LogArc;
+using fst::MakeFst;
+using fst::StdArc;
+using fst::TestArrays;
+using fst::TestBadArrays;
+
+int main(int argc, char **argv) {
+  SET_FLAGS(argv[0], &argc, &argv, true);
+  FLAGS_fst_error_fatal = false;
+
+  LOG(INFO) << "Testing FST arrays.";
+  {
+    // Mutable FSTs are copied; ConstFst arcs are shared.
+    TestArrays(MakeFst<StdArc>(), false);
+    TestArrays(ConstFst<StdArc>(MakeFst<StdArc>()), true);
+    TestArrays(MakeFst<LogArc>(), false);
+    TestArrays(ConstFst<LogArc>(MakeFst<LogArc>()), true);
+    TestArrays(MakeFst<Log64Arc>(), false);
+    TestArrays(ConstFst<Log64Arc>(MakeFst<Log64Arc>()), true);
+    TestBadArrays(MakeFst<StdArc>());
+    TestBadArrays(MakeFst<Log64Arc>());
+  }
+
+  std::cout << "PASS" << std::endl;
+
+  return 0;
+}
@@ -17,11 +17,14 @@
 //
 // Regression test for FST weights.
 
+#include <vector>
+
 #include <fst/flags.h>
 #include <fst/log.h>
 #include <fst/expectation-weight.h>
 #include <fst/float-weight.h>
 #include <fst/lexicographic-weight.h>
+#include <fst/log-sum-exp.h>
 #include <fst/power-weight.h>
 #include <fst/product-weight.h>
 #include <fst/set-weight.h>
@@ -60,6 +63,7 @@ using fst::SparsePowerWeight;
 using fst::STRING_LEFT;
 using fst::STRING_RIGHT;
 using fst::StringWeight;
+using fst::SumWeights;
 using fst::TropicalWeight;
 using fst::TropicalWeightTpl;
 using fst::UnionWeight;
@@ -126,6 +130,21 @@ void TestSignedAdder(int n) {
   CHECK(ApproxEqual(sum, adder.Sum()));
 }
 
+template <class Weight>
+void TestSumWeights(int n) {
+  std::vector<Weight> weights;
+  Weight sum = Weight::Zero();
+  CHECK_EQ(SumWeights(weights.data(), weights.size()), sum);
+  for (int i = 0; i < n; ++i) {
+    const Weight w = i % 7 == 0 ? Weight::Zero() : Weight((i % 101) / 3.0);
+    weights.push_back(w);
+    sum = Plus(sum, w);
+    CHECK(ApproxEqual(SumWeights(weights.data(), weights.size()), sum));
+  }
+  weights.push_back(Weight::NoWeight());
+  CHECK(!SumWeights(weights.data(), weights.size()).Member());
+}
+
 template <typename Weight1, typename Weight2>
 void TestWeightConversion(Weight1 w1) {
   // Tests round-trp conversion.
@@ -317,6 +336,9 @@ int main(int argc, char **argv) {
   TestAdder<LogWeight>(1000);
   TestAdder<RealWeight>(1000);
   TestSignedAdder<SignedLogWeight>(1000);
+  TestSumWeights<LogWeight>(100);
+  TestSumWeights<LogWeightTpl<double>>(100);
+  TestSumWeights<TropicalWeight>(100);
 
   TestImplicitConversion<TropicalWeight>();
   TestImplicitConversion<LogWeight>();